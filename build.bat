@@ -33,8 +33,12 @@ if %debug%==yes (
 )
 
 rc.exe /nologo ..\cas.rc
-%compiler% %common_compiler_flags% ..\cas.c ..\cas_dialog.c /link ..\cas.res %common_linker_flags% /out:cas.exe
+%compiler% %common_compiler_flags% ..\cas.c ..\cas_dialog.c ..\cas_engine.c ..\cas_match.c ..\cas_rebalance.c ..\cas_topology.c ..\cas_topology_win32.c ..\cas_cpuset.c ..\cas_backend.c ..\cas_backend_win32.c ..\cas_events.c ..\cas_events_win32.c ..\cas_stats.c ..\cas_stats_win32.c ..\cas_config.c ..\cas_config_win32.c ..\cas_daemon.c ..\cas_daemon_win32.c ..\cas_pool.c ..\cas_pool_win32.c /link ..\cas.res %common_linker_flags% /out:cas.exe
 
 mt -nologo -manifest ..\cas.manifest -outputresource:cas.exe;1
 
+%compiler% %common_compiler_flags% /DCAS_COUNT_ALLOCATIONS ..\cas_bench.c ..\cas_engine.c ..\cas_match.c ..\cas_rebalance.c ..\cas_topology.c ..\cas_topology_win32.c ..\cas_cpuset.c ..\cas_backend.c ..\cas_backend_fake.c ..\cas_backend_win32.c ..\cas_stats.c ..\cas_stats_win32.c ..\cas_pool.c ..\cas_pool_win32.c /link /incremental:no /SUBSYSTEM:CONSOLE /out:cas_bench.exe
+
+%compiler% %common_compiler_flags% ..\cas_test.c ..\cas_config.c ..\cas_engine.c ..\cas_match.c ..\cas_rebalance.c ..\cas_topology.c ..\cas_topology_win32.c ..\cas_cpuset.c ..\cas_backend.c ..\cas_backend_fake.c ..\cas_events.c ..\cas_stats.c ..\cas_pool.c ..\cas_pool_win32.c /link /incremental:no /SUBSYSTEM:CONSOLE /out:cas_test.exe
+
 popd
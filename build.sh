@@ -1,3 +1,30 @@
 #!/bin/bash
 
-cmd.exe /c build.bat
+# NOTE: Under WSL or MSYS the Windows build is used, anywhere else the portable engine and benchmark are built with cc.
+if command -v cmd.exe > /dev/null 2>&1; then
+    cmd.exe /c build.bat
+    exit $?
+fi
+
+set -e
+
+mkdir -p build
+cd build
+
+debug=no
+compiler=${CC:-cc}
+
+debug_compiler_flags="-O0 -g -fsanitize=address,undefined"
+release_compiler_flags="-O2"
+common_compiler_flags="-std=c11 -Wall -Wextra -Wshadow -Wconversion -Wsign-conversion -Werror"
+common_linker_flags="-pthread"
+
+if [ "$debug" = "yes" ]; then
+    common_compiler_flags="$common_compiler_flags $debug_compiler_flags"
+else
+    common_compiler_flags="$common_compiler_flags $release_compiler_flags"
+fi
+
+$compiler $common_compiler_flags -DCAS_COUNT_ALLOCATIONS ../cas_bench.c ../cas_engine.c ../cas_match.c ../cas_rebalance.c ../cas_topology.c ../cas_topology_linux.c ../cas_cpuset.c ../cas_backend.c ../cas_backend_fake.c ../cas_backend_linux.c ../cas_stats.c ../cas_stats_linux.c ../cas_pool.c ../cas_pool_linux.c $common_linker_flags -o cas_bench
+$compiler $common_compiler_flags ../cas_test.c ../cas_config.c ../cas_engine.c ../cas_match.c ../cas_rebalance.c ../cas_topology.c ../cas_topology_linux.c ../cas_cpuset.c ../cas_backend.c ../cas_backend_fake.c ../cas_events.c ../cas_stats.c ../cas_pool.c ../cas_pool_linux.c $common_linker_flags -o cas_test
+$compiler $common_compiler_flags ../cas_daemon.c ../cas_daemon_linux.c ../cas_config.c ../cas_config_linux.c ../cas_engine.c ../cas_match.c ../cas_rebalance.c ../cas_topology.c ../cas_topology_linux.c ../cas_cpuset.c ../cas_backend.c ../cas_backend_linux.c ../cas_events.c ../cas_events_linux.c ../cas_stats.c ../cas_stats_linux.c ../cas_pool.c ../cas_pool_linux.c $common_linker_flags -o casd
@@ -1,5 +1,8 @@
 #include "cas.h"
 #include "cas_dialog.h"
+#include "cas_backend.h"
+#include "cas_topology.h"
+#include "cas_daemon.h"
 
 #define CAS_NAME                  (L"cas")
 #define CAS_URL                   (L"https://github.com/nukoseer/cas")
@@ -7,19 +10,85 @@
 
 #define WM_CAS_COMMAND            (WM_USER + 0)
 #define WM_CAS_ALREADY_RUNNING    (WM_USER + 1)
+#define WM_CAS_TOPOLOGY_CHANGED   (WM_USER + 2)
+#define WM_CAS_CONFIG_CHANGED     (WM_USER + 3)
 #define CMD_CAS                   (1)
 #define CMD_QUIT                  (2)
+#define CMD_STATS                 (3)
 #define HOT_MENU                  (13)
 
 #define SECONDS_TO_MILLISECONDS   (1000)
+#define SECONDS_TO_MICROSECONDS   (1000000)
+#define MAX_STATS_TEXT_LENGTH     (2048)
+
+// NOTE: The rules as the timer thread sees them, built on the window thread from the dialog rows and never changed
+// once published. The timer thread takes it out of Cas.pending_rules, loads it into its engine and frees it, so it is
+// never read by both threads and the dialog rows can change at any time.
+typedef struct
+{
+    uint32_t generation;
+    uint32_t max_poll_delay;
+    uint32_t drift_delay;
+    // NOTE: Auto-pin is off with a threshold of 0, auto_pin_mask holds mask_word_count words like a rule mask.
+    uint32_t auto_pin_threshold;
+    uint32_t auto_pin_time;
+    uint64_t* auto_pin_mask;
+    uint32_t merge;
+    uint32_t rule_count;
+    uint32_t mask_word_count;
+    uint64_t* affinity_masks;
+    // NOTE: rule_count + 1 offsets into lines, each line is NUL terminated and empty when it could not be converted.
+    uint32_t* line_offsets;
+    char* lines;
+} CasRules;
+
+// NOTE: Seqlock written by the timer thread only. sequence is odd while a write is in progress, a reader copies
+// and retries until it saw the same even sequence before and after. generation is the one of the rules the
+// dones belong to, only the rows the dialog shows are kept.
+typedef struct
+{
+    volatile LONG sequence;
+    volatile LONG generation;
+    volatile BYTE dones[MAX_ITEMS];
+} CasStatus;
 
 typedef struct
 {
     HWND window_handle;
-    HANDLE timer_handle;
     WCHAR ini_path[MAX_PATH];
     HICON icon;
     CasDialogConfig dialog_config;
+    CasBackend backend;
+    // NOTE: Started on the timer thread, its workers only run while that thread applies.
+    CasBackendPool apply_pool;
+    CasEngine engine;
+    CasProcessTable process_table;
+    CasProcessTable event_table;
+    CasEventSource poll_source;
+    CasEventSource kernel_source;
+    BOOL has_kernel_source;
+    // NOTE: Timer thread only, watches pinned processes when there are no kernel events.
+    CasEventSource exit_source;
+    // NOTE: The topology is only used on the window thread, the timer thread keeps its own signature to notice changes.
+    CasTopology topology;
+    uint64_t topology_signature;
+    uint64_t timer_topology_signature;
+    // NOTE: Shared so cas_bench --stats can read it from outside, 0 when the mapping could not be created.
+    CasStats* stats;
+    LARGE_INTEGER performance_frequency;
+    // NOTE: Read on the timer thread, which only tells the window thread to reload.
+    CasConfigWatch config_watch;
+    BOOL has_config_watch;
+    // NOTE: Window thread only, counts the rules published.
+    uint32_t rules_generation;
+    uint32_t max_poll_delay;
+    CasRules* volatile pending_rules;
+    // NOTE: Timer thread only, what the status is written from.
+    uint32_t timer_generation;
+    CasPollSchedule poll_schedule;
+    BYTE timer_dones[MAX_ITEMS];
+    CasStatus status;
+    volatile LONG running;
 } Cas;
 
 static Cas global_cas;
@@ -153,85 +222,125 @@ static void cas__create_shortcut_link(void)
     }
 }
 
-static BOOL cas__set_cpu_affinity(PROCESSENTRY32W* entry, unsigned int desired_affinity_mask)
+static CasRules* cas__build_rules(CasDialogConfig* dialog_config, uint32_t generation, uint32_t max_poll_delay)
 {
-    BOOL set = 0;
-    HANDLE handle_process = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_SET_INFORMATION, FALSE, entry->th32ProcessID);
-    DWORD_PTR process_affinity_mask = 0;
-    DWORD_PTR system_affinity_mask = 0;
+    size_t auto_pin_size = (size_t)dialog_config->mask_word_count * sizeof(uint64_t);
+    size_t masks_size = (size_t)dialog_config->rule_count * dialog_config->mask_word_count * sizeof(uint64_t);
+    size_t offsets_size = ((size_t)dialog_config->rule_count + 1) * sizeof(uint32_t);
+    size_t lines_size = 0;
+    uint32_t offset = 0;
+    CasRules* rules = 0;
+    uint64_t active_words[MAX_AFFINITY_MASK_WORDS] = { 0 };
+    CasCpuSet active_set = { active_words, dialog_config->mask_word_count };
+    CasCpuSet auto_pin_set = { 0 };
+
+    for (uint32_t i = 0; i < dialog_config->rule_count; ++i)
+    {
+        int length = WideCharToMultiByte(CP_UTF8, 0, dialog_config->processes[i], -1, 0, 0, 0, 0);
 
-    if (handle_process)
+        lines_size += length > 0 && length <= CAS_RULE_LINE_LENGTH ? (size_t)length : 1;
+    }
+
+    rules = malloc(sizeof(CasRules) + auto_pin_size + masks_size + offsets_size + lines_size);
+
+    if (!rules)
     {
-        GetProcessAffinityMask(handle_process, (PDWORD_PTR)&process_affinity_mask, (PDWORD_PTR)&system_affinity_mask);
+        return 0;
+    }
 
-        if (process_affinity_mask != desired_affinity_mask)
-        {
-            SetProcessAffinityMask(handle_process, desired_affinity_mask);
-            GetProcessAffinityMask(handle_process, (PDWORD_PTR)&process_affinity_mask, (PDWORD_PTR)&system_affinity_mask);
+    rules->generation = generation;
+    rules->max_poll_delay = max_poll_delay;
+    rules->drift_delay = dialog_config->config.drift_check * SECONDS_TO_MILLISECONDS;
+    rules->auto_pin_time = dialog_config->config.auto_pin_time;
+    rules->merge = dialog_config->config.merge;
+    rules->auto_pin_mask = (uint64_t*)(rules + 1);
+    rules->rule_count = dialog_config->rule_count;
+    rules->mask_word_count = dialog_config->mask_word_count;
+    rules->affinity_masks = rules->auto_pin_mask + rules->mask_word_count;
+    rules->line_offsets = (uint32_t*)((BYTE*)rules->affinity_masks + masks_size);
+    rules->lines = (char*)(rules->line_offsets + rules->rule_count + 1);
+
+    if (masks_size)
+    {
+        memcpy(rules->affinity_masks, dialog_config->affinity_masks, masks_size);
+    }
 
-            if (process_affinity_mask == desired_affinity_mask)
-            {
-                set = 1;
-            }
-        }
-        else
+    // NOTE: Auto-pin CPUs that are not active turn auto-pin off, like a rule mask skips its rule.
+    auto_pin_set = (CasCpuSet){ rules->auto_pin_mask, rules->mask_word_count };
+    cas_cpu_active_set(&active_set);
+    rules->auto_pin_threshold = cas_config_resolve_auto_pin(&dialog_config->config, cas_current_topology(), &auto_pin_set) &&
+                                cas_cpu_set_is_subset(&auto_pin_set, &active_set) ? dialog_config->config.auto_pin_threshold : 0;
+
+    for (uint32_t i = 0; i < rules->rule_count; ++i)
+    {
+        int available = (int)(lines_size - offset < CAS_RULE_LINE_LENGTH ? lines_size - offset : CAS_RULE_LINE_LENGTH);
+        int length = WideCharToMultiByte(CP_UTF8, 0, dialog_config->processes[i], -1, rules->lines + offset, available, 0, 0);
+
+        if (length <= 0)
         {
-            set = 1;
+            rules->lines[offset] = '\0';
+            length = 1;
         }
 
-        CloseHandle(handle_process);
+        rules->line_offsets[i] = offset;
+        offset += (uint32_t)length;
     }
 
-    return set;
+    rules->line_offsets[rules->rule_count] = offset;
+
+    return rules;
 }
 
-static void cas__cpu_affinity_routine(CasDialogConfig* dialog_config)
+// NOTE: Window thread only. A snapshot the timer thread has not taken yet was never read, it is replaced and freed.
+static void cas__publish_rules(Cas* cas)
 {
-    unsigned int i = 0;
+    CasRules* rules = cas__build_rules(&cas->dialog_config, ++cas->rules_generation, cas->max_poll_delay);
 
-    for (i = 0; i < MAX_ITEMS; ++i)
+    if (rules)
     {
-        WCHAR* process = dialog_config->processes[i];
-        BOOL found = FALSE;
+        free(InterlockedExchangePointer((PVOID volatile*)&cas->pending_rules, rules));
+    }
+}
 
-        if (*process)
-        {
-            PROCESSENTRY32W entry = { .dwSize = sizeof(PROCESSENTRY32W) };
-            HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+static void cas__load_rules(CasEngine* engine, const CasRules* rules)
+{
+    uint64_t empty_words[MAX_AFFINITY_MASK_WORDS] = { 0 };
+    CasCpuSet empty_mask = { empty_words, rules->mask_word_count };
 
-            if (Process32FirstW(snapshot, &entry))
-            {
-                do
-                {
-                    if (!lstrcmpW((LPCWSTR)entry.szExeFile, process))
-                    {
-                        UINT affinity_mask = dialog_config->affinity_masks[i];
-                        dialog_config->dones[i] = cas__set_cpu_affinity(&entry, affinity_mask);
-                        found = TRUE;
-                    }
-                } while (Process32NextW(snapshot, &entry));
-            }
-            
-            if (!found)
-            {
-                dialog_config->dones[i] = 0;
-            }
+    cas_engine_clear_rules(engine);
 
-            CloseHandle(snapshot);
-        }
-        else
+    for (uint32_t i = 0; i < rules->rule_count; ++i)
+    {
+        const char* line = rules->lines + rules->line_offsets[i];
+        uint32_t length = rules->line_offsets[i + 1] - rules->line_offsets[i] - 1;
+        CasCpuSet affinity_mask = { rules->affinity_masks + (size_t)i * rules->mask_word_count, rules->mask_word_count };
+
+        // NOTE: "process.exe[/thread name][;key=value]..." is split by the engine. Rules are indexed by their row,
+        // an unconvertible name keeps its slot but never matches.
+        if (!length || !cas_engine_add_rule_line(engine, line, length, &affinity_mask))
         {
-            break;
+            cas_engine_add_rule(engine, "?", 1, &empty_mask);
         }
     }
+
+    cas_engine_set_merge(engine, rules->merge);
+    cas_engine_build_index(engine);
 }
 
-static HANDLE cas__create_timer(void)
+// NOTE: Timer thread only, the Interlocked increments are full barriers around the copy.
+static void cas__write_status(Cas* cas)
 {
-    HANDLE timer_handle = CreateWaitableTimerW(0, 0, 0);
-    ASSERT(timer_handle);
+    CasStatus* status = &cas->status;
+
+    InterlockedIncrement(&status->sequence);
+    status->generation = (LONG)cas->timer_generation;
 
-    return timer_handle;
+    for (uint32_t i = 0; i < MAX_ITEMS; ++i)
+    {
+        status->dones[i] = cas->timer_dones[i];
+    }
+
+    InterlockedIncrement(&status->sequence);
 }
 
 static void cas__show_notification(HWND window_handle, LPCWSTR message, LPCWSTR title, DWORD flags)
@@ -284,6 +393,20 @@ static void cas__remove_tray_icon(HWND window_handle)
     Shell_NotifyIconW(NIM_DELETE, &data);
 }
 
+static void cas__show_stats(Cas* cas)
+{
+    CasStatsThread total;
+    char text[MAX_STATS_TEXT_LENGTH];
+    WCHAR wide_text[MAX_STATS_TEXT_LENGTH];
+
+    if (cas->stats && cas_stats_snapshot(cas->stats, &total))
+    {
+        cas_stats_format_text(&total, text, ARRAY_COUNT(text));
+        MultiByteToWideChar(CP_UTF8, 0, text, -1, wide_text, ARRAY_COUNT(wide_text));
+        MessageBoxW(cas->window_handle, wide_text, CAS_NAME, MB_OK | MB_ICONINFORMATION);
+    }
+}
+
 static LRESULT CALLBACK cas__window_proc(HWND window_handle, UINT message, WPARAM wparam, LPARAM lparam)
 {
     if (message == WM_CREATE)
@@ -293,6 +416,11 @@ static LRESULT CALLBACK cas__window_proc(HWND window_handle, UINT message, WPARA
     }
     else if (message == WM_DESTROY)
     {
+        if (global_cas.has_kernel_source)
+        {
+            global_cas.kernel_source.stop(&global_cas.kernel_source);
+        }
+
 	cas__remove_tray_icon(window_handle);
 	PostQuitMessage(0);
 
@@ -304,6 +432,37 @@ static LRESULT CALLBACK cas__window_proc(HWND window_handle, UINT message, WPARA
 
 	return 0;
     }
+    else if (message == WM_CAS_TOPOLOGY_CHANGED)
+    {
+        // NOTE: Symbolic masks are resolved again, the timer thread picks the new rules up on its next tick.
+        cas_dialog_resolve_masks(&global_cas.dialog_config);
+        cas__publish_rules(&global_cas);
+
+        return 0;
+    }
+    else if (message == WM_CAS_CONFIG_CHANGED)
+    {
+        // NOTE: A bad edit keeps the rules running, the tray says so instead of a message box stealing focus.
+        uint32_t bad_line = 0;
+
+        if (cas_dialog_config_reload(&global_cas.dialog_config, &bad_line) == CAS_DIALOG_RELOAD_FAILED)
+        {
+            WCHAR text[128];
+
+            if (bad_line)
+            {
+                _snwprintf(text, ARRAY_COUNT(text), L"cas.ini line %u is not valid, the previous rules are kept.", bad_line);
+            }
+            else
+            {
+                _snwprintf(text, ARRAY_COUNT(text), L"Not enough memory to reload cas.ini, the previous rules are kept.");
+            }
+
+            cas__show_notification(window_handle, text, 0, NIIF_WARNING);
+        }
+
+        return 0;
+    }
     else if (message == WM_CAS_COMMAND)
     {
 	if (LOWORD(lparam) == WM_LBUTTONUP)
@@ -317,6 +476,7 @@ static LRESULT CALLBACK cas__window_proc(HWND window_handle, UINT message, WPARA
 
             AppendMenuW(menu, MF_STRING, CMD_CAS, CAS_NAME);
 	    AppendMenuW(menu, MF_SEPARATOR, 0, NULL);
+            AppendMenuW(menu, global_cas.stats ? MF_STRING : MF_STRING | MF_GRAYED, CMD_STATS, L"Stats");
 	    AppendMenuW(menu, MF_STRING, CMD_QUIT, L"Exit");
 
 	    POINT mouse;
@@ -329,6 +489,10 @@ static LRESULT CALLBACK cas__window_proc(HWND window_handle, UINT message, WPARA
 	    {
 		ShellExecuteW(NULL, L"open", CAS_URL, NULL, NULL, SW_SHOWNORMAL);
 	    }
+            else if (command == CMD_STATS)
+            {
+                cas__show_stats(&global_cas);
+            }
 	    else if (command == CMD_QUIT)
 	    {
 		DestroyWindow(window_handle);
@@ -350,42 +514,222 @@ static LRESULT CALLBACK cas__window_proc(HWND window_handle, UINT message, WPARA
     return DefWindowProcW(window_handle, message, wparam, lparam);
 }
 
+// NOTE: Whether the rule is one a match of its set applies. That is the winning process rule, every top rank rule
+// when their masks were merged, and a thread rule when threads of its name pick it over the others.
+static int cas__is_rule_applied(const CasEngine* engine, const CasMatch* match, uint32_t rule_index)
+{
+    const CasRuleSet* set = engine->rule_sets + match->rule_set;
+    uint32_t thread_length = engine->rule_thread_name_lengths[rule_index];
+
+    if (thread_length)
+    {
+        const char* thread_name = engine->name_arena + engine->rule_thread_name_offsets[rule_index];
+
+        return cas_engine_find_thread_rule(engine, match->rule_set, thread_name, thread_length) == rule_index;
+    }
+
+    return rule_index == match->rule_index ||
+           (set->mask_offset != CAS_NO_RULE && match->rule_index != CAS_NO_RULE &&
+            engine->rule_ranks[rule_index] == engine->rule_ranks[match->rule_index]);
+}
+
+// NOTE: Rules that lost are cleared first, so a rule that lost for one process and was applied to another stays done.
+static void cas__update_dones(Cas* cas)
+{
+    CasEngine* engine = &cas->engine;
+
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        for (uint32_t i = 0; i < engine->match_count; ++i)
+        {
+            CasMatch* match = engine->matches + i;
+            CasRuleSet* set = engine->rule_sets + match->rule_set;
+
+            for (uint32_t j = 0; j < set->count; ++j)
+            {
+                uint32_t rule_index = engine->rule_set_rules[set->offset + j];
+                uint32_t status = engine->rule_thread_name_lengths[rule_index] ? match->thread_status : match->status;
+                int is_applied = cas__is_rule_applied(engine, match, rule_index);
+
+                if (rule_index >= MAX_ITEMS)
+                {
+                    continue;
+                }
+
+                if (pass == 0 && !is_applied)
+                {
+                    cas->timer_dones[rule_index] = 0;
+                }
+                else if (pass == 1 && is_applied)
+                {
+                    cas->timer_dones[rule_index] = status == CAS_STATUS_PINNED;
+                }
+            }
+        }
+    }
+}
+
+static void cas__handle_events(Cas* cas, CasEventSource* source)
+{
+    CasEngine* engine = &cas->engine;
+    LARGE_INTEGER start;
+    LARGE_INTEGER end;
+    uint32_t processes = 0;
+    uint32_t delay = 0;
+    BOOL sweep = FALSE;
+    uint64_t topology_signature = 0;
+
+    QueryPerformanceCounter(&start);
+    sweep = cas_backend_read_events(&cas->backend, engine, source, &cas->event_table);
+    topology_signature = cas_topology_signature();
+
+    if (topology_signature != cas->timer_topology_signature)
+    {
+        // NOTE: The first tick only records it, masks were resolved against the current topology when loaded.
+        if (cas->timer_topology_signature)
+        {
+            PostMessageW(cas->window_handle, WM_CAS_TOPOLOGY_CHANGED, 0, 0);
+        }
+
+        cas->timer_topology_signature = topology_signature;
+    }
+
+    if (cas->running)
+    {
+        CasRules* rules = InterlockedExchangePointer((PVOID volatile*)&cas->pending_rules, 0);
+
+        if (rules)
+        {
+            CasCpuSet auto_pin_set = { rules->auto_pin_mask, rules->mask_word_count };
+
+            cas__load_rules(engine, rules);
+            cas_engine_set_auto_pin(engine, rules->auto_pin_threshold ? &auto_pin_set : 0, rules->auto_pin_threshold,
+                                    (uint64_t)rules->auto_pin_time * cas->backend.clock_frequency);
+            cas->timer_generation = rules->generation;
+            cas_poll_schedule_init(&cas->poll_schedule, rules->max_poll_delay, rules->drift_delay,
+                                   rules->auto_pin_threshold ? rules->auto_pin_time * SECONDS_TO_MILLISECONDS : 0);
+            cas_engine_set_drift_check(engine, rules->drift_delay != 0);
+            memset(cas->timer_dones, 0, sizeof(cas->timer_dones));
+            free(rules);
+            sweep = TRUE;
+        }
+
+        if (sweep)
+        {
+            if (cas_backend_sweep(&cas->backend, engine, &cas->process_table))
+            {
+                cas__update_dones(cas);
+
+                for (uint32_t i = 0; i < engine->rule_count && i < MAX_ITEMS; ++i)
+                {
+                    if (!engine->rule_found[i])
+                    {
+                        cas->timer_dones[i] = 0;
+                    }
+                }
+            }
+
+            processes = cas->process_table.count;
+            cas__write_status(cas);
+
+            // NOTE: A sweep for an exit counts as a poll, the next one is scheduled from it.
+            if (source != &cas->kernel_source)
+            {
+                delay = cas_poll_schedule_next(&cas->poll_schedule, cas_engine_is_busy(engine));
+            }
+
+            delay = cas_poll_schedule_drift(&cas->poll_schedule, delay, cas_engine_has_drifted(engine));
+            delay = cas_poll_schedule_sample(&cas->poll_schedule, delay);
+
+            if (delay)
+            {
+                cas_event_source_poll_set_delay(&cas->poll_source, delay);
+            }
+        }
+        else if (cas->event_table.count && cas_engine_match(engine, &cas->event_table))
+        {
+            processes = cas->event_table.count;
+            cas_backend_apply(&cas->backend, engine, &cas->event_table);
+            cas__update_dones(cas);
+            cas__write_status(cas);
+        }
+
+        // NOTE: Polling already comes back soon while matches are left, kernel events need the poll timer fired for them.
+        if (cas->has_kernel_source && processes && !cas_engine_is_applied(engine))
+        {
+            cas_event_source_poll_set_delay(&cas->poll_source, CAS_POLL_MIN_DELAY);
+        }
+
+        QueryPerformanceCounter(&end);
+        cas_stats_tick(cas->backend.stats, (uint64_t)(end.QuadPart - start.QuadPart) * SECONDS_TO_MICROSECONDS / (uint64_t)cas->performance_frequency.QuadPart,
+                       processes, processes ? engine->match_count : 0);
+    }
+}
+
 static DWORD WINAPI cas__timer_thread_proc(LPVOID parameter)
 {
     Cas* cas = (Cas*)parameter;
-    HANDLE timer_handle = cas->timer_handle;
+    CasEventSource* sources[3] = { &cas->poll_source };
+    HANDLE handles[4] = { (HANDLE)cas->poll_source.wait_handle };
+    DWORD source_count = 1;
+    DWORD handle_count = 0;
+
+    if (cas->has_kernel_source)
+    {
+        sources[source_count] = &cas->kernel_source;
+        handles[source_count++] = (HANDLE)cas->kernel_source.wait_handle;
+    }
+
+    // NOTE: Only without kernel events, those already report every exit.
+    if (!cas->has_kernel_source && cas_event_source_exits(&cas->exit_source) && cas->exit_source.start(&cas->exit_source))
+    {
+        cas->backend.exits = &cas->exit_source;
+        sources[source_count] = &cas->exit_source;
+        handles[source_count++] = (HANDLE)cas->exit_source.wait_handle;
+    }
+
+    handle_count = source_count;
+
+    if (cas->has_config_watch)
+    {
+        handles[handle_count++] = (HANDLE)cas->config_watch.wait_handle;
+    }
+
+    cas->backend.stats = cas->stats ? cas_stats_claim(cas->stats) : 0;
+    cas_backend_pool_start(&cas->backend, &cas->apply_pool, cas->stats);
 
     for (;;)
     {
-        DWORD wait = WaitForSingleObject(timer_handle, INFINITE);
+        DWORD wait = WaitForMultipleObjects(handle_count, handles, FALSE, INFINITE);
 
-        if (wait == WAIT_OBJECT_0)
+        if (wait < WAIT_OBJECT_0 + source_count)
         {
-            cas__cpu_affinity_routine(&cas->dialog_config);
+            cas__handle_events(cas, sources[wait - WAIT_OBJECT_0]);
+        }
+        else if (wait < WAIT_OBJECT_0 + handle_count && cas_config_watch_read(&cas->config_watch))
+        {
+            PostMessageW(cas->window_handle, WM_CAS_CONFIG_CHANGED, 0, 0);
         }
     }
 
     return 0;
 }
 
+// NOTE: With kernel process events the timer only fires once to sweep what was already running. Without them
+// seconds is the longest wait between polls, the timer thread polls sooner while processes come and go.
 void cas_set_timer(int seconds)
 {
-    LARGE_INTEGER due_time = { 0 };
-    BOOL is_timer_set = 0;
-    FILETIME file_time = { 0 };
-
-    GetSystemTimeAsFileTime(&file_time);
+    global_cas.max_poll_delay = global_cas.has_kernel_source ? 0 : (uint32_t)seconds * SECONDS_TO_MILLISECONDS;
+    cas__publish_rules(&global_cas);
+    InterlockedExchange(&global_cas.running, 1);
 
-    due_time.LowPart = file_time.dwLowDateTime;
-    due_time.HighPart = file_time.dwHighDateTime;
-
-    is_timer_set = SetWaitableTimer(global_cas.timer_handle, &due_time, seconds * SECONDS_TO_MILLISECONDS, 0, 0, 0);
-    ASSERT(is_timer_set);
+    cas_event_source_poll_set_period(&global_cas.poll_source, 0);
 }
 
 void cas_stop_timer(void)
 {
-    CancelWaitableTimer(global_cas.timer_handle);
+    InterlockedExchange(&global_cas.running, 0);
+    global_cas.poll_source.stop(&global_cas.poll_source);
 }
 
 // NOTE: https://github.com/winsiderss/systeminformer/blob/5d97d6b3f99bd7c651b448ae414f39150cf9af2f/SystemInformer/admintask.c#L22
@@ -577,6 +921,80 @@ HRESULT cas_delete_admin_task(void)
     return status;
 }
 
+uint32_t cas_cpu_count(void)
+{
+    return global_cas.backend.cpu_count;
+}
+
+void cas_cpu_active_set(CasCpuSet* set)
+{
+    global_cas.backend.active_cpus(&global_cas.backend, set);
+}
+
+// NOTE: Discovered on first use and whenever it changed, 0 when it cannot be. Window thread only.
+const CasTopology* cas_current_topology(void)
+{
+    uint64_t signature = cas_topology_signature();
+
+    if (signature != global_cas.topology_signature || !global_cas.topology.cpu_count)
+    {
+        if (!cas_topology_discover(&global_cas.topology, global_cas.backend.cpu_count))
+        {
+            return 0;
+        }
+
+        global_cas.topology_signature = signature;
+    }
+
+    return &global_cas.topology;
+}
+
+// NOTE: CPU lists like "0-3,8" and "node1", "l3:0", "cores 0-7 of node0"... against the current topology.
+BOOL cas_resolve_mask(const WCHAR* text, CasCpuSet* set)
+{
+    char mask_text[MAX_MASK_TEXT_LENGTH];
+    const CasTopology* topology = cas_current_topology();
+    int length = WideCharToMultiByte(CP_UTF8, 0, text, -1, mask_text, (int)sizeof(mask_text), 0, 0);
+
+    return length > 1 && cas_config_resolve(mask_text, (uint32_t)(length - 1), topology, set);
+}
+
+// NOTE: Never blocks the timer thread, only retries while a write is in progress. Dones of rules older than the
+// last published ones read as not done.
+void cas_read_dones(BOOL* dones, uint32_t count)
+{
+    CasStatus* status = &global_cas.status;
+    BYTE copy[MAX_ITEMS];
+    LONG sequence = 0;
+    LONG generation = 0;
+
+    for (;;)
+    {
+        sequence = status->sequence;
+        MemoryBarrier();
+        generation = status->generation;
+
+        for (uint32_t i = 0; i < MAX_ITEMS; ++i)
+        {
+            copy[i] = status->dones[i];
+        }
+
+        MemoryBarrier();
+
+        if (!(sequence & 1) && sequence == status->sequence)
+        {
+            break;
+        }
+
+        YieldProcessor();
+    }
+
+    for (uint32_t i = 0; i < count && i < MAX_ITEMS; ++i)
+    {
+        dones[i] = generation == (LONG)global_cas.rules_generation && copy[i];
+    }
+}
+
 void cas_disable_hotkeys(void)
 {
     UnregisterHotKey(global_cas.window_handle, HOT_MENU);
@@ -609,7 +1027,16 @@ void WinMainCRTStartup(void)
 	.hInstance = GetModuleHandle(0),
 	.lpszClassName = CAS_NAME,
     };
-    
+
+    int argument_count = 0;
+    WCHAR** arguments = CommandLineToArgvW(GetCommandLineW(), &argument_count);
+
+    // NOTE: Headless runs only need the engine, the window, the tray, COM and the dialog are never set up.
+    if (arguments && argument_count > 1 && (!lstrcmpW(arguments[1], L"--headless") || !lstrcmpW(arguments[1], L"--service")))
+    {
+        ExitProcess((UINT)cas_daemon_main(argument_count, arguments));
+    }
+
     HWND existing = FindWindowW(window_class.lpszClassName, NULL);
     if (existing)
     {
@@ -626,15 +1053,31 @@ void WinMainCRTStartup(void)
     global_cas.window_handle = CreateWindowExW(0, window_class.lpszClassName, window_class.lpszClassName, WS_POPUP,
                                                CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT, CW_USEDEFAULT,
                                                NULL, NULL, window_class.hInstance, NULL);
-    global_cas.timer_handle = cas__create_timer();
+    BOOL has_backend = cas_backend_native(&global_cas.backend);
+    ASSERT(has_backend);
 
-    CloseHandle(CreateThread(0, 0, (LPTHREAD_START_ROUTINE)&cas__timer_thread_proc, (LPVOID)&global_cas, 0, 0));
+    cas_engine_init(&global_cas.engine);
+    cas_engine_set_cpu_count(&global_cas.engine, global_cas.backend.cpu_count);
+
+    BOOL has_poll_source = cas_event_source_poll(&global_cas.poll_source);
+    ASSERT(has_poll_source);
+
+    global_cas.has_kernel_source = cas_event_source_kernel(&global_cas.kernel_source) && global_cas.kernel_source.start(&global_cas.kernel_source);
+
+    global_cas.stats = cas_stats_map(1);
+    QueryPerformanceFrequency(&global_cas.performance_frequency);
 
     WCHAR exe_path[MAX_PATH];
+    char utf8_ini_path[MAX_PATH * 3];
     GetModuleFileNameW(NULL, exe_path, ARRAY_COUNT(exe_path));
     PathRemoveFileSpecW(exe_path);
     PathCombineW(global_cas.ini_path, exe_path, CAS_INI);
 
+    global_cas.has_config_watch = WideCharToMultiByte(CP_UTF8, 0, global_cas.ini_path, -1, utf8_ini_path, (int)sizeof(utf8_ini_path), 0, 0) &&
+                                  cas_config_watch_start(&global_cas.config_watch, utf8_ini_path);
+
+    CloseHandle(CreateThread(0, 0, (LPTHREAD_START_ROUTINE)&cas__timer_thread_proc, (LPVOID)&global_cas, 0, 0));
+
     CoInitializeEx(0, COINIT_MULTITHREADED);
     CoInitializeSecurity(0, -1, 0, 0, RPC_C_AUTHN_LEVEL_PKT_PRIVACY, RPC_C_IMP_LEVEL_IMPERSONATE, 0, 0, 0);
 
@@ -22,6 +22,10 @@
 #include <stdlib.h>
 #pragma warning(pop)
 
+#include "cas_base.h"
+#include "cas_cpuset.h"
+#include "cas_topology.h"
+
 #pragma comment (lib, "kernel32")
 #pragma comment (lib, "user32")
 #pragma comment (lib, "advapi32")
@@ -31,19 +35,18 @@
 #pragma comment (lib, "ole32")
 #pragma comment (lib, "runtimeobject")
 #pragma comment(lib, "taskschd.lib")
-
-#ifdef _DEBUG
-#define ASSERT(x) do { if (!(x)) { *(volatile int*)0; } } while (0)
-#else
-#define ASSERT(x) (void)(x);
-#endif
-
-#define ARRAY_COUNT(x)      (sizeof(x) / sizeof(*(x)))
+#pragma comment (lib, "ntdll")
 
 void cas_set_timer(int seconds);
 void cas_stop_timer(void);
 HRESULT cas_create_admin_task(void);
 HRESULT cas_delete_admin_task(void);
+uint32_t cas_cpu_count(void);
+void cas_cpu_active_set(CasCpuSet* set);
+const CasTopology* cas_current_topology(void);
+BOOL cas_resolve_mask(const WCHAR* text, CasCpuSet* set);
+// NOTE: Which of the first count rows (at most MAX_ITEMS) were pinned on the last tick.
+void cas_read_dones(BOOL* dones, uint32_t count);
 void cas_disable_hotkeys(void);
 BOOL cas_enable_hotkeys(void);
 
@@ -0,0 +1,549 @@
+#include "cas_backend.h"
+
+static uint64_t global_cpu_busy[CAS_CPU_SET_MAX_CPUS];
+static uint64_t global_cpu_total[CAS_CPU_SET_MAX_CPUS];
+
+static char cas_backend__fold(char c)
+{
+    return c >= 'A' && c <= 'Z' ? (char)(c + ('a' - 'A')) : c;
+}
+
+// NOTE: value is already folded by the engine.
+static int cas_backend__folded_equal(const char* text, uint32_t text_length, const char* value, uint32_t length)
+{
+    uint32_t i = 0;
+
+    if (text_length != length)
+    {
+        return 0;
+    }
+
+    while (i < length && cas_backend__fold(text[i]) == value[i])
+    {
+        ++i;
+    }
+
+    return i == length;
+}
+
+static int cas_backend__folded_contains(const char* text, uint32_t text_length, const char* value, uint32_t length)
+{
+    for (uint32_t start = 0; start + length <= text_length; ++start)
+    {
+        if (cas_backend__folded_equal(text + start, length, value, length))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// NOTE: Runs only for processes whose name already matched a rule with predicates, the engine keeps the answer
+// in the process state so each one is asked once per process and rule reload.
+static int cas_backend__evaluate_predicate(void* context, const CasProcess* process, uint32_t kind, const char* value, uint32_t length)
+{
+    CasBackend* backend = (CasBackend*)context;
+    char buffer[CAS_BACKEND_ATTRIBUTE_LENGTH];
+    uint32_t buffer_length = 0;
+    int result = 0;
+
+    if (kind == CAS_PREDICATE_PARENT)
+    {
+        CasProcess parent;
+
+        // NOTE: A parent started after its child is a reused PID, the real parent is gone.
+        result = process->parent_pid && backend->query_process(backend, process->parent_pid, &parent) &&
+                 parent.create_time <= process->create_time &&
+                 cas_backend__folded_equal(parent.name, parent.name_length, value, length);
+    }
+    else if (kind == CAS_PREDICATE_MODULE)
+    {
+        result = backend->has_module && backend->has_module(backend, process, value, length);
+    }
+    else if (backend->query_attribute)
+    {
+        buffer_length = backend->query_attribute(backend, process, kind, buffer, sizeof(buffer));
+
+        if (kind == CAS_PREDICATE_CMDLINE)
+        {
+            result = cas_backend__folded_contains(buffer, buffer_length, value, length);
+        }
+        else if (kind == CAS_PREDICATE_PATH)
+        {
+            result = cas_backend__folded_equal(buffer, buffer_length, value, length);
+        }
+        else if (kind == CAS_PREDICATE_USER)
+        {
+            const char* user = memchr(buffer, '\\', buffer_length);
+
+            // NOTE: Either the whole account name or the part after the domain.
+            result = cas_backend__folded_equal(buffer, buffer_length, value, length) ||
+                     (user && cas_backend__folded_equal(user + 1, (uint32_t)(buffer + buffer_length - user - 1), value, length));
+        }
+    }
+
+    return result;
+}
+
+static int cas_backend__grow(void** data, uint32_t* capacity, uint32_t needed, size_t element_size)
+{
+    int result = 1;
+
+    if (needed > *capacity)
+    {
+        uint32_t new_capacity = *capacity ? *capacity : 16;
+        void* new_data = 0;
+
+        while (new_capacity < needed)
+        {
+            new_capacity *= 2;
+        }
+
+        new_data = realloc(*data, new_capacity * element_size);
+
+        if (new_data)
+        {
+            *data = new_data;
+            *capacity = new_capacity;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int cas_backend__is_pending(const CasMatch* match)
+{
+    return match->status == CAS_STATUS_UNKNOWN || (match->status == CAS_STATUS_PINNED && match->thread_status == CAS_STATUS_UNKNOWN);
+}
+
+// NOTE: Only matches the state table could not answer cost any system calls.
+// The policy goes with the mask, a process only counts as pinned once both are in place.
+// Threads go second, setting the process mask resets every thread mask.
+// Writes nothing shared but the state slot of the match, matches can be applied on several threads at once.
+static void cas_backend__apply_match(CasBackend* backend, CasEngine* engine, const CasProcessTable* table, CasMatch* match, uint64_t* policy_corrections)
+{
+    const CasProcess* process = table->processes + match->process_index;
+
+    if (match->status == CAS_STATUS_UNKNOWN)
+    {
+        CasCpuSet affinity_mask = cas_engine_match_mask(engine, match->rule_set, match->rule_index);
+        const CasPolicy* policy = cas_engine_rule_policy(engine, match->rule_index);
+        uint32_t previous_status = engine->state_tables[engine->current_state_table].slots[match->state_index].status;
+
+        backend->last_error = 0;
+        match->status = backend->set_affinity(backend, process->pid, &affinity_mask);
+        cas_stats_set(backend->stats, match->status != CAS_STATUS_PINNED, backend->last_error);
+
+        if (match->status == CAS_STATUS_PINNED && policy && backend->set_policy)
+        {
+            uint32_t corrected = 0;
+
+            match->status = backend->set_policy(backend, process->pid, policy, &corrected);
+
+            for (uint32_t attribute = 0; attribute < CAS_POLICY_COUNT; ++attribute)
+            {
+                policy_corrections[attribute] += (corrected >> attribute) & 1;
+            }
+        }
+
+        // NOTE: Only the first pin of a process is timed, pinning again after a reload or a rebalance move is not late.
+        if (match->status == CAS_STATUS_PINNED && previous_status != CAS_STATUS_PINNED && backend->stats && backend->clock)
+        {
+            uint64_t now = backend->clock(backend);
+
+            cas_stats_pin(backend->stats, now > process->create_time ? (now - process->create_time) * 1000 / backend->clock_frequency : 0);
+        }
+
+        if (match->status == CAS_STATUS_PINNED && engine->is_drift_checked && backend->clock)
+        {
+            cas_engine_set_checked(engine, match, backend->clock(backend));
+        }
+
+        cas_engine_set_result(engine, match, match->status);
+    }
+
+    if (match->status == CAS_STATUS_PINNED && match->thread_status == CAS_STATUS_UNKNOWN)
+    {
+        match->thread_status = backend->set_thread_affinity(backend, engine, process, match->rule_set);
+        cas_engine_set_thread_result(engine, match, process, match->thread_status);
+    }
+}
+
+static void cas_backend__all_cpus(CasBackend* backend, CasCpuSet* set)
+{
+    cas_cpu_set_zero(set);
+
+    for (uint32_t cpu = 0; cpu < backend->cpu_count; ++cpu)
+    {
+        cas_cpu_set_add(set, cpu);
+    }
+}
+
+// NOTE: The mask from before is read the first time, a process that does not touch the reserved CPUs is left
+// alone and needs no record. One that sits exactly on the CPUs left over inherited them from an evicted parent and
+// gets every CPU back later. A process only on reserved CPUs goes to all the others. Like a match, writes nothing
+// shared but its state slot and its isolation record.
+static void cas_backend__apply_eviction(CasBackend* backend, CasEngine* engine, const CasProcessTable* table, CasEviction* eviction)
+{
+    const CasProcess* process = table->processes + eviction->process_index;
+    CasCpuSet reserved = cas_engine_isolation_mask(engine);
+    CasCpuSet original = cas_engine_eviction_original(engine, eviction);
+    uint64_t words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    CasCpuSet desired = { words, engine->cpu_word_count };
+    int keeps_original = (int)eviction->is_recorded;
+    int is_moved = (int)eviction->is_recorded;
+
+    eviction->status = CAS_STATUS_PINNED;
+    cas_backend__all_cpus(backend, &desired);
+    cas_cpu_set_andnot(&desired, &desired, &reserved);
+
+    if (backend->is_protected && backend->is_protected(backend, process))
+    {
+        keeps_original = 0;
+        is_moved = 0;
+    }
+    else if (!eviction->is_recorded)
+    {
+        eviction->status = backend->query_affinity(backend, process->pid, &original);
+        keeps_original = eviction->status == CAS_STATUS_PINNED && (cas_cpu_set_equal(&original, &desired) || cas_cpu_set_intersects(&original, &reserved));
+        is_moved = keeps_original && !cas_cpu_set_equal(&original, &desired);
+
+        if (keeps_original && !is_moved)
+        {
+            cas_backend__all_cpus(backend, &original);
+        }
+    }
+
+    if (is_moved)
+    {
+        if (cas_cpu_set_is_empty(&reserved))
+        {
+            cas_cpu_set_copy(&desired, &original);
+        }
+        else if (!cas_cpu_set_is_subset(&original, &reserved))
+        {
+            cas_cpu_set_andnot(&desired, &original, &reserved);
+        }
+    }
+
+    // NOTE: Rules reserving every CPU leave nowhere to go, the process stays where it is. One seen for the first time
+    // then was never moved and has nothing to restore.
+    if (is_moved && cas_cpu_set_is_empty(&desired))
+    {
+        keeps_original = (int)eviction->is_recorded;
+    }
+    else if (is_moved)
+    {
+        backend->last_error = 0;
+        eviction->status = backend->set_affinity(backend, process->pid, &desired);
+        cas_stats_set(backend->stats, eviction->status != CAS_STATUS_PINNED, backend->last_error);
+        keeps_original = !cas_cpu_set_is_empty(&reserved) || eviction->status != CAS_STATUS_PINNED;
+    }
+
+    cas_engine_set_eviction_result(engine, eviction, eviction->status, keeps_original);
+}
+
+static void cas_backend__apply_item(void* context, uint32_t worker, uint32_t item)
+{
+    CasBackendPool* backend_pool = (CasBackendPool*)context;
+    CasBackend* backend = worker ? backend_pool->workers + worker : backend_pool->backend;
+    CasEngine* engine = backend_pool->engine;
+    uint32_t index = backend_pool->pending[item];
+
+    if (index < engine->match_count)
+    {
+        cas_backend__apply_match(backend, engine, backend_pool->table, engine->matches + index, backend_pool->policy_corrections[worker]);
+    }
+    else
+    {
+        cas_backend__apply_eviction(backend, engine, backend_pool->table, engine->evictions + index - engine->match_count);
+    }
+}
+
+// NOTE: Runs on the calling thread before the apply, a drifted process is pinned again by the same apply.
+// Nobody tells us who changed a mask, neither /proc nor the process APIs keep the caller.
+static void cas_backend__check_drift(CasBackend* backend, CasEngine* engine, const CasProcessTable* table)
+{
+    uint64_t words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    CasCpuSet found = { words, engine->cpu_word_count };
+    uint64_t now = backend->clock(backend);
+
+    for (uint32_t i = 0; i < engine->match_count; ++i)
+    {
+        CasMatch* match = engine->matches + i;
+        const CasProcessState* state = engine->state_tables[engine->current_state_table].slots + match->state_index;
+        CasCpuSet affinity_mask = cas_engine_match_mask(engine, match->rule_set, match->rule_index);
+        uint32_t status = CAS_STATUS_UNKNOWN;
+        uint64_t duration = 0;
+
+        if (!match->is_drift_check)
+        {
+            continue;
+        }
+
+        status = backend->check_affinity(backend, table->processes[match->process_index].pid, &affinity_mask, &found);
+
+        if (status == CAS_STATUS_PINNED)
+        {
+            cas_engine_set_checked(engine, match, now);
+            cas_engine_set_drift_result(engine, match, 0, 0);
+        }
+        else if (status == CAS_STATUS_FAILED)
+        {
+            duration = now > state->checked_time ? (now - state->checked_time) * 1000 / backend->clock_frequency : 0;
+            cas_engine_set_drift_result(engine, match, &found, duration);
+        }
+
+        if (status != CAS_STATUS_UNKNOWN)
+        {
+            cas_stats_drift(backend->stats, status == CAS_STATUS_FAILED, duration);
+        }
+    }
+}
+
+// NOTE: Runs on the calling thread after the apply, there are never more auto-pins than CPUs in the pool so they
+// go without a budget. The mask from before is read on the way in and set again on the way out.
+static void cas_backend__apply_auto_pins(CasBackend* backend, CasEngine* engine, const CasProcessTable* table)
+{
+    uint64_t words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    CasCpuSet desired = { words, engine->cpu_word_count };
+
+    for (uint32_t i = 0; i < engine->auto_pin_count; ++i)
+    {
+        CasAutoPin* auto_pin = engine->auto_pins + i;
+        const CasProcess* process = table->processes + auto_pin->process_index;
+        CasCpuSet original = cas_engine_auto_pin_original(engine, auto_pin->cpu);
+        uint32_t status = CAS_STATUS_DENIED;
+        int is_saved = (int)auto_pin->is_release;
+
+        if (!is_saved && backend->query_affinity && !(backend->is_protected && backend->is_protected(backend, process)))
+        {
+            is_saved = backend->query_affinity(backend, process->pid, &original) == CAS_STATUS_PINNED;
+        }
+
+        if (auto_pin->is_release)
+        {
+            cas_cpu_set_copy(&desired, &original);
+        }
+        else
+        {
+            cas_cpu_set_zero(&desired);
+            cas_cpu_set_add(&desired, auto_pin->cpu);
+        }
+
+        if (is_saved)
+        {
+            backend->last_error = 0;
+            status = backend->set_affinity(backend, process->pid, &desired);
+            cas_stats_set(backend->stats, status != CAS_STATUS_PINNED, backend->last_error);
+        }
+
+        cas_engine_set_auto_pin_result(engine, auto_pin, status);
+    }
+}
+
+// NOTE: Runs on the calling thread after the apply, the exit source is not shared with the workers.
+static void cas_backend__watch_exits(CasBackend* backend, CasEngine* engine, const CasProcessTable* table)
+{
+    CasProcessStateTable* states = engine->state_tables + engine->current_state_table;
+
+    for (uint32_t i = 0; i < engine->match_count; ++i)
+    {
+        const CasMatch* match = engine->matches + i;
+        CasProcessState* state = states->slots + match->state_index;
+
+        if (match->status == CAS_STATUS_PINNED && !state->is_watched)
+        {
+            const CasProcess* process = table->processes + match->process_index;
+
+            backend->exits->watch(backend->exits, process->pid, process->create_time);
+            state->is_watched = 1;
+        }
+    }
+}
+
+// NOTE: Apply workers are mostly waiting on the system, one per CPU is plenty. Threads past the stats blocks
+// left over record nothing.
+// NOTE: A CPU count of 0 means the query failed, the pool then runs on the calling thread alone.
+int cas_backend_pool_start(CasBackend* backend, CasBackendPool* backend_pool, CasStats* stats)
+{
+    uint32_t cpu_count = backend->cpu_count ? backend->cpu_count : 1;
+    uint32_t thread_count = cpu_count < CAS_POOL_MAX_WORKERS ? cpu_count - 1 : CAS_POOL_MAX_THREADS;
+    int result = 0;
+
+    memset(backend_pool, 0, sizeof(*backend_pool));
+    result = cas_pool_start(&backend_pool->pool, thread_count);
+    backend_pool->backend = backend;
+
+    for (uint32_t i = 1; i <= backend_pool->pool.thread_count; ++i)
+    {
+        backend_pool->workers[i] = *backend;
+        backend_pool->workers[i].stats = stats ? cas_stats_claim(stats) : 0;
+    }
+
+    backend->pool = backend_pool;
+
+    return result;
+}
+
+void cas_backend_pool_stop(CasBackend* backend, CasBackendPool* backend_pool)
+{
+    cas_pool_stop(&backend_pool->pool);
+    free(backend_pool->pending);
+    backend_pool->pending = 0;
+    backend_pool->pending_capacity = 0;
+    backend->pool = 0;
+}
+
+// NOTE: With a pool the matches that need a system call are spread over its workers, a slow process only holds up
+// the worker it is on while the others steal the rest. Returns how many matches the budget left for the next tick.
+uint32_t cas_backend_apply(CasBackend* backend, CasEngine* engine, const CasProcessTable* table)
+{
+    CasBackendPool* backend_pool = backend->pool;
+    uint32_t pending_count = 0;
+    uint32_t left = 0;
+
+    if (engine->is_drift_checked && backend->check_affinity && backend->clock)
+    {
+        cas_backend__check_drift(backend, engine, table);
+    }
+
+    // NOTE: Evictions need a mask to read, without one isolation does nothing.
+    if (!backend->query_affinity)
+    {
+        engine->eviction_count = 0;
+    }
+
+    if (!backend_pool || !cas_backend__grow((void**)&backend_pool->pending, &backend_pool->pending_capacity,
+                                            engine->match_count + engine->eviction_count, sizeof(uint32_t)))
+    {
+        for (uint32_t i = 0; i < engine->match_count; ++i)
+        {
+            cas_backend__apply_match(backend, engine, table, engine->matches + i, engine->counters.policy_corrections);
+        }
+
+        for (uint32_t i = 0; i < engine->eviction_count; ++i)
+        {
+            cas_backend__apply_eviction(backend, engine, table, engine->evictions + i);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 0; i < engine->match_count; ++i)
+        {
+            if (cas_backend__is_pending(engine->matches + i))
+            {
+                backend_pool->pending[pending_count++] = i;
+            }
+        }
+
+        for (uint32_t i = 0; i < engine->eviction_count; ++i)
+        {
+            backend_pool->pending[pending_count++] = engine->match_count + i;
+        }
+
+        memset(backend_pool->policy_corrections, 0, sizeof(backend_pool->policy_corrections));
+        backend_pool->engine = engine;
+        backend_pool->table = table;
+        left = cas_pool_run(&backend_pool->pool, pending_count, CAS_BACKEND_APPLY_BUDGET, &cas_backend__apply_item, backend_pool);
+
+        for (uint32_t worker = 0; worker < CAS_POOL_MAX_WORKERS; ++worker)
+        {
+            for (uint32_t attribute = 0; attribute < CAS_POLICY_COUNT; ++attribute)
+            {
+                engine->counters.policy_corrections[attribute] += backend_pool->policy_corrections[worker][attribute];
+            }
+        }
+    }
+
+    if (engine->auto_pin_count)
+    {
+        cas_backend__apply_auto_pins(backend, engine, table);
+    }
+
+    if (backend->exits)
+    {
+        cas_backend__watch_exits(backend, engine, table);
+    }
+
+    return left;
+}
+
+int cas_backend_sweep(CasBackend* backend, CasEngine* engine, CasProcessTable* table)
+{
+    int result = 0;
+
+    engine->predicate_function = &cas_backend__evaluate_predicate;
+    engine->predicate_context = backend;
+
+    // NOTE: Loads are only sampled while some rule has a core count, a failed sample keeps the last selection.
+    if (engine->rebalancer.entry_count && backend->cpu_times && backend->cpu_times(backend, global_cpu_busy, global_cpu_total))
+    {
+        cas_engine_rebalance(engine, global_cpu_busy, global_cpu_total, backend->cpu_count);
+    }
+
+    // NOTE: Process CPU times are compared between sweeps, each is timed right before its snapshot.
+    if (backend->clock)
+    {
+        cas_engine_set_sample_time(engine, backend->clock(backend));
+    }
+
+    if (backend->snapshot(backend, table) && cas_engine_sweep(engine, table))
+    {
+        cas_backend_apply(backend, engine, table);
+        result = 1;
+    }
+
+    return result;
+}
+
+// NOTE: Drains the source into the table, started processes are looked up right away.
+// Returns whether the events can only be answered by a full sweep.
+int cas_backend_read_events(CasBackend* backend, CasEngine* engine, CasEventSource* source, CasProcessTable* table)
+{
+    CasProcessEvent events[64];
+    uint32_t event_count = 0;
+    int sweep = 0;
+
+    table->count = 0;
+    engine->predicate_function = &cas_backend__evaluate_predicate;
+    engine->predicate_context = backend;
+
+    while ((event_count = source->read(source, events, ARRAY_COUNT(events))) > 0)
+    {
+        for (uint32_t i = 0; i < event_count; ++i)
+        {
+            CasProcessEvent* event = events + i;
+
+            if (event->type == CAS_EVENT_START)
+            {
+                CasProcess* process = cas_process_table_push(table);
+
+                if (process && !backend->query_process(backend, event->pid, process))
+                {
+                    --table->count;
+                }
+                else if (process && event->parent_pid)
+                {
+                    process->parent_pid = event->parent_pid;
+                }
+            }
+            else if (event->type == CAS_EVENT_EXIT)
+            {
+                // NOTE: Only an exiting matched process can change what has been pinned.
+                sweep = sweep || cas_engine_is_matched(engine, event->pid);
+            }
+            else if (event->type == CAS_EVENT_RESYNC)
+            {
+                sweep = 1;
+            }
+        }
+    }
+
+    return sweep;
+}
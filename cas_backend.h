@@ -0,0 +1,95 @@
+#ifndef H_CAS_BACKEND_H
+
+#include "cas_engine.h"
+#include "cas_events.h"
+#include "cas_pool.h"
+#include "cas_stats.h"
+
+// NOTE: Longer command lines and paths are cut, predicates only see this much.
+#define CAS_BACKEND_ATTRIBUTE_LENGTH (4096)
+// NOTE: Milliseconds one apply may start new matches for, the rest wait for the next tick. Calls already started are
+// not cut short, and the calling thread is worker 0, so a system call hanging there still holds up the whole tick.
+#define CAS_BACKEND_APPLY_BUDGET     (250)
+
+typedef struct CasBackend CasBackend;
+typedef struct CasBackendPool CasBackendPool;
+
+// NOTE: Everything the engine needs from the operating system. The snapshot fills the table with
+// every running process, query_process looks up a single PID reported by an event source.
+// set_thread_affinity walks the threads of a process and pins the ones named by the thread rules in its rule set.
+// query_attribute and has_module answer rule predicates, either may be missing and then those predicates never pass.
+// cpu_times fills cumulative busy and total times for cpu_count CPUs, without it rebalanced rules keep their whole mask.
+// set_policy only writes the attributes that differ from the policy and reports them as 1 << CAS_POLICY_* bits.
+// check_affinity reads a pinned mask back: pinned when it is still in place, failed with the mask found when someone
+// changed it, unknown when it can not tell. Without it drift checks never find anything.
+// query_affinity reads the current mask of a process for isolation and auto-pin, is_protected names the processes
+// both leave alone. Without query_affinity no process is evicted or auto-pinned.
+// A failing set_affinity leaves the system error code in last_error. clock reads the current time in the units of
+// create_time, clock_frequency per second. stats is the block of the thread applying rules, 0 records nothing.
+// Everything but snapshot and query_process may run on several threads at once, each with a CasBackend of its own.
+// Without a pool matches are applied one after another on the calling thread and without a budget.
+// Processes pinned while exits is set are watched by it once each, their exit no longer waits for the next poll.
+struct CasBackend
+{
+    const char* name;
+    uint32_t cpu_count;
+    int (*snapshot)(CasBackend* backend, CasProcessTable* table);
+    int (*query_process)(CasBackend* backend, uint32_t pid, CasProcess* process);
+    uint32_t (*set_affinity)(CasBackend* backend, uint32_t pid, const CasCpuSet* affinity_mask);
+    uint32_t (*set_thread_affinity)(CasBackend* backend, const CasEngine* engine, const CasProcess* process, uint32_t rule_set);
+    uint32_t (*check_affinity)(CasBackend* backend, uint32_t pid, const CasCpuSet* affinity_mask, CasCpuSet* found);
+    uint32_t (*query_affinity)(CasBackend* backend, uint32_t pid, CasCpuSet* affinity_mask);
+    int (*is_protected)(CasBackend* backend, const CasProcess* process);
+    void (*active_cpus)(CasBackend* backend, CasCpuSet* set);
+    uint32_t (*query_attribute)(CasBackend* backend, const CasProcess* process, uint32_t kind, char* buffer, uint32_t capacity);
+    int (*has_module)(CasBackend* backend, const CasProcess* process, const char* name, uint32_t length);
+    int (*cpu_times)(CasBackend* backend, uint64_t* busy, uint64_t* total);
+    uint32_t (*set_policy)(CasBackend* backend, uint32_t pid, const CasPolicy* policy, uint32_t* corrected);
+    uint64_t (*clock)(CasBackend* backend);
+    uint64_t clock_frequency;
+    uint32_t last_error;
+    CasStatsThread* stats;
+    CasBackendPool* pool;
+    CasEventSource* exits;
+    void* context;
+};
+
+// NOTE: Worker 0 is the thread calling cas_backend_apply and uses its backend, the other workers use a copy with a
+// last_error and stats block of their own. Policy corrections are counted per worker and added to the engine once
+// the run is over. pending holds the indices of the matches that need a system call, followed by evictions as
+// match_count + their index.
+struct CasBackendPool
+{
+    CasPool pool;
+    CasBackend* backend;
+    CasBackend workers[CAS_POOL_MAX_WORKERS];
+    uint64_t policy_corrections[CAS_POOL_MAX_WORKERS][CAS_POLICY_COUNT];
+    uint32_t* pending;
+    uint32_t pending_capacity;
+    CasEngine* engine;
+    const CasProcessTable* table;
+};
+
+typedef struct
+{
+    CasProcessTable processes;
+    uint32_t snapshot_count;
+    uint32_t set_affinity_count;
+    uint32_t thread_walk_count;
+    uint32_t set_policy_count;
+    uint32_t denied_pid;
+} CasBackendFake;
+
+int cas_backend_native(CasBackend* backend);
+void cas_backend_fake(CasBackend* backend, CasBackendFake* fake, uint32_t cpu_count);
+CasProcess* cas_backend_fake_add_process(CasBackendFake* fake, uint32_t pid, const char* name, uint64_t create_time);
+void cas_backend_fake_remove_process(CasBackendFake* fake, uint32_t pid);
+
+int cas_backend_pool_start(CasBackend* backend, CasBackendPool* backend_pool, CasStats* stats);
+void cas_backend_pool_stop(CasBackend* backend, CasBackendPool* backend_pool);
+uint32_t cas_backend_apply(CasBackend* backend, CasEngine* engine, const CasProcessTable* table);
+int cas_backend_sweep(CasBackend* backend, CasEngine* engine, CasProcessTable* table);
+int cas_backend_read_events(CasBackend* backend, CasEngine* engine, CasEventSource* source, CasProcessTable* table);
+
+#define H_CAS_BACKEND_H
+#endif
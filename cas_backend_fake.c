@@ -0,0 +1,142 @@
+#include "cas_backend.h"
+
+static int cas_backend__fake_snapshot(CasBackend* backend, CasProcessTable* table)
+{
+    CasBackendFake* fake = (CasBackendFake*)backend->context;
+
+    ++fake->snapshot_count;
+    table->count = 0;
+
+    for (uint32_t i = 0; i < fake->processes.count; ++i)
+    {
+        CasProcess* process = cas_process_table_push(table);
+
+        if (!process)
+        {
+            return 0;
+        }
+
+        *process = fake->processes.processes[i];
+    }
+
+    return 1;
+}
+
+static int cas_backend__fake_query_process(CasBackend* backend, uint32_t pid, CasProcess* process)
+{
+    CasBackendFake* fake = (CasBackendFake*)backend->context;
+
+    for (uint32_t i = 0; i < fake->processes.count; ++i)
+    {
+        if (fake->processes.processes[i].pid == pid)
+        {
+            *process = fake->processes.processes[i];
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t cas_backend__fake_set_affinity(CasBackend* backend, uint32_t pid, const CasCpuSet* affinity_mask)
+{
+    CasBackendFake* fake = (CasBackendFake*)backend->context;
+    CasProcess process;
+
+    (void)affinity_mask;
+    ++fake->set_affinity_count;
+
+    if (pid == fake->denied_pid)
+    {
+        return CAS_STATUS_DENIED;
+    }
+
+    return cas_backend__fake_query_process(backend, pid, &process) ? CAS_STATUS_PINNED : CAS_STATUS_FAILED;
+}
+
+// NOTE: Fake processes have no threads, only the walks are counted.
+static uint32_t cas_backend__fake_set_thread_affinity(CasBackend* backend, const CasEngine* engine, const CasProcess* process, uint32_t rule_set)
+{
+    CasBackendFake* fake = (CasBackendFake*)backend->context;
+
+    (void)engine, (void)rule_set;
+    ++fake->thread_walk_count;
+
+    return process->pid == fake->denied_pid ? CAS_STATUS_DENIED : CAS_STATUS_PINNED;
+}
+
+// NOTE: Fake processes start out with no policy, the first application corrects every attribute it names.
+static uint32_t cas_backend__fake_set_policy(CasBackend* backend, uint32_t pid, const CasPolicy* policy, uint32_t* corrected)
+{
+    CasBackendFake* fake = (CasBackendFake*)backend->context;
+
+    ++fake->set_policy_count;
+    *corrected = (policy->priority ? 1u << CAS_POLICY_PRIORITY : 0) | (policy->nice != CAS_NICE_UNSET ? 1u << CAS_POLICY_NICE : 0) |
+                 (policy->sched ? 1u << CAS_POLICY_SCHED : 0) | (policy->io ? 1u << CAS_POLICY_IO : 0) |
+                 (policy->memory ? 1u << CAS_POLICY_MEMORY : 0);
+
+    return pid == fake->denied_pid ? CAS_STATUS_DENIED : CAS_STATUS_PINNED;
+}
+
+static void cas_backend__fake_active_cpus(CasBackend* backend, CasCpuSet* set)
+{
+    cas_cpu_set_zero(set);
+
+    for (uint32_t i = 0; i < backend->cpu_count; ++i)
+    {
+        cas_cpu_set_add(set, i);
+    }
+}
+
+// NOTE: In-memory process list for benchmarks and tests, every set_affinity succeeds except on denied_pid.
+void cas_backend_fake(CasBackend* backend, CasBackendFake* fake, uint32_t cpu_count)
+{
+    memset(fake, 0, sizeof(*fake));
+    fake->denied_pid = 0xffffffff;
+
+    *backend = (CasBackend)
+    {
+        .name = "fake",
+        .cpu_count = cpu_count,
+        .snapshot = &cas_backend__fake_snapshot,
+        .query_process = &cas_backend__fake_query_process,
+        .set_affinity = &cas_backend__fake_set_affinity,
+        .set_thread_affinity = &cas_backend__fake_set_thread_affinity,
+        .active_cpus = &cas_backend__fake_active_cpus,
+        .set_policy = &cas_backend__fake_set_policy,
+        .context = fake,
+    };
+}
+
+CasProcess* cas_backend_fake_add_process(CasBackendFake* fake, uint32_t pid, const char* name, uint64_t create_time)
+{
+    CasProcess* process = cas_process_table_push(&fake->processes);
+
+    if (process)
+    {
+        size_t length = strlen(name);
+
+        length = length < sizeof(process->name) - 1 ? length : sizeof(process->name) - 1;
+        memcpy(process->name, name, length);
+        process->name[length] = '\0';
+        process->pid = pid;
+        process->create_time = create_time;
+        process->cpu_time = 0;
+        process->name_length = (uint32_t)length;
+        process->name_hash = cas_engine_hash_name(process->name, process->name_length);
+    }
+
+    return process;
+}
+
+void cas_backend_fake_remove_process(CasBackendFake* fake, uint32_t pid)
+{
+    for (uint32_t i = 0; i < fake->processes.count; ++i)
+    {
+        if (fake->processes.processes[i].pid == pid)
+        {
+            fake->processes.processes[i] = fake->processes.processes[--fake->processes.count];
+            break;
+        }
+    }
+}
@@ -0,0 +1,722 @@
+#define _GNU_SOURCE
+
+#include "cas_backend.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pwd.h>
+#include <sched.h>
+#include <stdio.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// NOTE: TASK_COMM_LEN - 1, longer names are cut in /proc/<pid>/stat.
+#define CAS_BACKEND_COMM_LENGTH  (15)
+#define CAS_BACKEND_STAT_SIZE    (1024)
+
+// NOTE: From linux/ioprio.h, glibc has no wrapper.
+#define CAS_BACKEND_IOPRIO_WHO_PROCESS (1)
+#define CAS_BACKEND_IOPRIO_CLASS_BE    (2)
+#define CAS_BACKEND_IOPRIO_CLASS_IDLE  (3)
+#define CAS_BACKEND_IOPRIO(class, data) (((class) << 13) | (data))
+
+// NOTE: Masks are built on the stack of the applying thread, CPU_ALLOC_SIZE(CAS_CPU_SET_MAX_CPUS) bytes at most.
+typedef struct
+{
+    cpu_set_t sets[CAS_CPU_SET_MAX_CPUS / CPU_SETSIZE];
+} CasBackendCpuSet;
+
+typedef struct
+{
+    DIR* proc_directory;
+    size_t cpu_set_size;
+} CasBackendLinux;
+
+static CasBackendLinux global_linux;
+
+static uint32_t cas_backend__read_file(const char* path, char* buffer, uint32_t capacity)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t length = 0;
+
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    length = read(fd, buffer, capacity - 1);
+    close(fd);
+
+    length = length > 0 ? length : 0;
+    buffer[length] = '\0';
+
+    return (uint32_t)length;
+}
+
+// NOTE: comm is cut at 15 bytes, in that case the full name is the basename of argv[0] as long as it starts the same.
+static void cas_backend__full_name(uint32_t pid, CasProcess* process)
+{
+    char path[64];
+    char cmdline[CAS_PROCESS_NAME_LENGTH * 2];
+    uint32_t length = 0;
+    const char* name = cmdline;
+
+    snprintf(path, sizeof(path), "/proc/%u/cmdline", pid);
+    length = cas_backend__read_file(path, cmdline, sizeof(cmdline));
+
+    if (!length)
+    {
+        return;
+    }
+
+    for (const char* c = cmdline; *c; ++c)
+    {
+        if (*c == '/')
+        {
+            name = c + 1;
+        }
+    }
+
+    length = (uint32_t)strlen(name);
+
+    if (length > process->name_length && length < sizeof(process->name) && !memcmp(name, process->name, process->name_length))
+    {
+        memcpy(process->name, name, length + 1);
+        process->name_length = length;
+    }
+}
+
+// NOTE: /proc/<pid>/stat carries the name, the CPU time and the start time (fields 14, 15 and 22, clock ticks),
+// so a process costs one read unless its name was cut.
+static int cas_backend__linux_query_process(CasBackend* backend, uint32_t pid, CasProcess* process)
+{
+    char path[64];
+    char stat[CAS_BACKEND_STAT_SIZE];
+    char* name_start = 0;
+    char* name_end = 0;
+    char* field = 0;
+    uint32_t length = 0;
+
+    (void)backend;
+
+    snprintf(path, sizeof(path), "/proc/%u/stat", pid);
+    length = cas_backend__read_file(path, stat, sizeof(stat));
+    name_start = length ? strchr(stat, '(') : 0;
+    name_end = length ? strrchr(stat, ')') : 0;
+
+    if (!name_start || !name_end || name_end < name_start)
+    {
+        return 0;
+    }
+
+    ++name_start;
+    field = name_end + 1;
+
+    process->cpu_time = 0;
+
+    // NOTE: The name is field 2, walk forward to ppid (4), utime (14), stime (15), num_threads (20) and starttime (22).
+    for (uint32_t i = 3; i <= 22 && field; ++i)
+    {
+        field = strchr(field, ' ');
+        field = field ? field + 1 : 0;
+
+        if (i == 4 && field)
+        {
+            process->parent_pid = (uint32_t)strtoul(field, 0, 10);
+        }
+        else if ((i == 14 || i == 15) && field)
+        {
+            process->cpu_time += strtoull(field, 0, 10);
+        }
+        else if (i == 20 && field)
+        {
+            process->thread_count = (uint32_t)strtoul(field, 0, 10);
+        }
+    }
+
+    if (!field)
+    {
+        return 0;
+    }
+
+    process->pid = pid;
+    process->create_time = strtoull(field, 0, 10);
+    process->name_length = (uint32_t)(name_end - name_start);
+    memcpy(process->name, name_start, process->name_length);
+    process->name[process->name_length] = '\0';
+
+    if (process->name_length == CAS_BACKEND_COMM_LENGTH)
+    {
+        cas_backend__full_name(pid, process);
+    }
+
+    process->name_hash = cas_engine_hash_name(process->name, process->name_length);
+
+    return 1;
+}
+
+static int cas_backend__linux_snapshot(CasBackend* backend, CasProcessTable* table)
+{
+    CasBackendLinux* linux_backend = (CasBackendLinux*)backend->context;
+    struct dirent* entry = 0;
+
+    table->count = 0;
+
+    if (!linux_backend->proc_directory)
+    {
+        return 0;
+    }
+
+    rewinddir(linux_backend->proc_directory);
+
+    while ((entry = readdir(linux_backend->proc_directory)) != 0)
+    {
+        CasProcess* process = 0;
+        char* end = 0;
+        unsigned long pid = strtoul(entry->d_name, &end, 10);
+
+        if (*end || entry->d_name[0] < '0' || entry->d_name[0] > '9')
+        {
+            continue;
+        }
+
+        process = cas_process_table_push(table);
+
+        if (!process)
+        {
+            return 0;
+        }
+
+        // NOTE: The process may be gone between readdir and the read.
+        if (!cas_backend__linux_query_process(backend, (uint32_t)pid, process))
+        {
+            --table->count;
+        }
+    }
+
+    return 1;
+}
+
+static void cas_backend__fill_cpu_set(cpu_set_t* cpu_set, size_t cpu_set_size, uint32_t cpu_count, const CasCpuSet* affinity_mask)
+{
+    CPU_ZERO_S(cpu_set_size, cpu_set);
+
+    for (uint32_t cpu = cas_cpu_set_next(affinity_mask, 0); cpu != CAS_NO_CPU && cpu < cpu_count; cpu = cas_cpu_set_next(affinity_mask, cpu + 1))
+    {
+        CPU_SET_S(cpu, cpu_set_size, cpu_set);
+    }
+}
+
+// NOTE: sched_setaffinity only moves the thread it is given, every thread in /proc/<pid>/task is set.
+// Threads created afterwards inherit the mask from their creator.
+static uint32_t cas_backend__linux_set_affinity(CasBackend* backend, uint32_t pid, const CasCpuSet* affinity_mask)
+{
+    CasBackendLinux* linux_backend = (CasBackendLinux*)backend->context;
+    CasBackendCpuSet desired;
+    CasBackendCpuSet current;
+    cpu_set_t* cpu_set = desired.sets;
+    size_t cpu_set_size = linux_backend->cpu_set_size;
+    uint32_t status = CAS_STATUS_FAILED;
+    char path[64];
+    DIR* task_directory = 0;
+    struct dirent* entry = 0;
+    int denied = 0;
+
+    cas_backend__fill_cpu_set(cpu_set, cpu_set_size, backend->cpu_count, affinity_mask);
+
+    snprintf(path, sizeof(path), "/proc/%u/task", pid);
+    task_directory = opendir(path);
+
+    if (!task_directory)
+    {
+        backend->last_error = (uint32_t)errno;
+        return errno == EACCES ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+    }
+
+    while ((entry = readdir(task_directory)) != 0)
+    {
+        char* end = 0;
+        unsigned long tid = strtoul(entry->d_name, &end, 10);
+
+        if (*end || entry->d_name[0] < '0' || entry->d_name[0] > '9')
+        {
+            continue;
+        }
+
+        // NOTE: A thread exiting under us is not a failure.
+        if (sched_setaffinity((pid_t)tid, cpu_set_size, cpu_set) < 0 && errno == EPERM)
+        {
+            backend->last_error = EPERM;
+            denied = 1;
+            break;
+        }
+    }
+
+    closedir(task_directory);
+
+    // NOTE: The kernel silently drops CPUs outside the process cpuset, only an exact mask counts as pinned.
+    if (denied)
+    {
+        status = CAS_STATUS_DENIED;
+    }
+    else if (sched_getaffinity((pid_t)pid, cpu_set_size, current.sets) == 0 && CPU_EQUAL_S(cpu_set_size, current.sets, cpu_set))
+    {
+        status = CAS_STATUS_PINNED;
+    }
+
+    return status;
+}
+
+// NOTE: Only the main thread is read, it is what taskset -p and most tools move.
+static uint32_t cas_backend__linux_check_affinity(CasBackend* backend, uint32_t pid, const CasCpuSet* affinity_mask, CasCpuSet* found)
+{
+    CasBackendLinux* linux_backend = (CasBackendLinux*)backend->context;
+    CasBackendCpuSet desired;
+    CasBackendCpuSet current;
+    size_t cpu_set_size = linux_backend->cpu_set_size;
+
+    if (sched_getaffinity((pid_t)pid, cpu_set_size, current.sets) < 0)
+    {
+        return CAS_STATUS_UNKNOWN;
+    }
+
+    cas_backend__fill_cpu_set(desired.sets, cpu_set_size, backend->cpu_count, affinity_mask);
+
+    if (CPU_EQUAL_S(cpu_set_size, current.sets, desired.sets))
+    {
+        return CAS_STATUS_PINNED;
+    }
+
+    cas_cpu_set_zero(found);
+
+    for (uint32_t cpu = 0; cpu < backend->cpu_count; ++cpu)
+    {
+        if (CPU_ISSET_S(cpu, cpu_set_size, current.sets))
+        {
+            cas_cpu_set_add(found, cpu);
+        }
+    }
+
+    return CAS_STATUS_FAILED;
+}
+
+static uint32_t cas_backend__linux_query_affinity(CasBackend* backend, uint32_t pid, CasCpuSet* affinity_mask)
+{
+    CasBackendLinux* linux_backend = (CasBackendLinux*)backend->context;
+    CasBackendCpuSet current;
+
+    if (sched_getaffinity((pid_t)pid, linux_backend->cpu_set_size, current.sets) < 0)
+    {
+        return errno == EPERM ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+    }
+
+    cas_cpu_set_zero(affinity_mask);
+
+    for (uint32_t cpu = 0; cpu < backend->cpu_count; ++cpu)
+    {
+        if (CPU_ISSET_S(cpu, linux_backend->cpu_set_size, current.sets))
+        {
+            cas_cpu_set_add(affinity_mask, cpu);
+        }
+    }
+
+    return CAS_STATUS_PINNED;
+}
+
+// NOTE: Kernel threads are kthreadd and its children, many of them are bound to one CPU for good.
+static int cas_backend__linux_is_protected(CasBackend* backend, const CasProcess* process)
+{
+    (void)backend;
+
+    return process->pid == 2 || process->parent_pid == 2 || process->pid == (uint32_t)getpid();
+}
+
+// NOTE: Thread names come from /proc/<pid>/task/<tid>/comm, the same 15 bytes prctl(PR_SET_NAME) and pthread_setname_np set.
+static uint32_t cas_backend__linux_set_thread_affinity(CasBackend* backend, const CasEngine* engine, const CasProcess* process, uint32_t rule_set)
+{
+    CasBackendLinux* linux_backend = (CasBackendLinux*)backend->context;
+    uint32_t status = CAS_STATUS_PINNED;
+    char path[64];
+    DIR* task_directory = 0;
+    struct dirent* entry = 0;
+
+    snprintf(path, sizeof(path), "/proc/%u/task", process->pid);
+    task_directory = opendir(path);
+
+    if (!task_directory)
+    {
+        return errno == EACCES ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+    }
+
+    while ((entry = readdir(task_directory)) != 0 && status == CAS_STATUS_PINNED)
+    {
+        char comm[32];
+        char* end = 0;
+        unsigned long tid = strtoul(entry->d_name, &end, 10);
+        uint32_t length = 0;
+        uint32_t rule_index = CAS_NO_RULE;
+
+        if (*end || entry->d_name[0] < '0' || entry->d_name[0] > '9')
+        {
+            continue;
+        }
+
+        snprintf(path, sizeof(path), "/proc/%u/task/%lu/comm", process->pid, tid);
+        length = cas_backend__read_file(path, comm, sizeof(comm));
+
+        if (length && comm[length - 1] == '\n')
+        {
+            comm[--length] = '\0';
+        }
+
+        rule_index = length ? cas_engine_find_thread_rule(engine, rule_set, comm, length) : CAS_NO_RULE;
+
+        if (rule_index != CAS_NO_RULE)
+        {
+            CasCpuSet affinity_mask = cas_engine_rule_mask(engine, rule_index);
+            CasBackendCpuSet desired;
+
+            cas_backend__fill_cpu_set(desired.sets, linux_backend->cpu_set_size, backend->cpu_count, &affinity_mask);
+
+            if (sched_setaffinity((pid_t)tid, linux_backend->cpu_set_size, desired.sets) < 0 && errno != ESRCH)
+            {
+                status = errno == EPERM ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+            }
+        }
+    }
+
+    closedir(task_directory);
+
+    return status;
+}
+
+// NOTE: cmdline has its arguments NUL separated, they are joined with spaces so a predicate can span them.
+static uint32_t cas_backend__linux_query_attribute(CasBackend* backend, const CasProcess* process, uint32_t kind, char* buffer, uint32_t capacity)
+{
+    char path[64];
+    uint32_t length = 0;
+
+    (void)backend;
+
+    if (kind == CAS_PREDICATE_CMDLINE)
+    {
+        snprintf(path, sizeof(path), "/proc/%u/cmdline", process->pid);
+        length = cas_backend__read_file(path, buffer, capacity);
+
+        while (length && !buffer[length - 1])
+        {
+            --length;
+        }
+
+        for (uint32_t i = 0; i < length; ++i)
+        {
+            buffer[i] = buffer[i] ? buffer[i] : ' ';
+        }
+    }
+    else if (kind == CAS_PREDICATE_PATH)
+    {
+        ssize_t link_length = 0;
+
+        snprintf(path, sizeof(path), "/proc/%u/exe", process->pid);
+        link_length = readlink(path, buffer, capacity - 1);
+        length = link_length > 0 ? (uint32_t)link_length : 0;
+    }
+    else if (kind == CAS_PREDICATE_USER)
+    {
+        char status[CAS_BACKEND_ATTRIBUTE_LENGTH];
+        char* uid = 0;
+        struct passwd entry;
+        struct passwd* found = 0;
+
+        snprintf(path, sizeof(path), "/proc/%u/status", process->pid);
+        uid = cas_backend__read_file(path, status, sizeof(status)) ? strstr(status, "\nUid:") : 0;
+
+        // NOTE: The name lives in the rest of buffer, it is overwritten once the lookup is done.
+        if (uid && !getpwuid_r((uid_t)strtoul(uid + 5, 0, 10), &entry, buffer, capacity, &found) && found)
+        {
+            length = (uint32_t)strlen(found->pw_name);
+            memmove(buffer, found->pw_name, length);
+        }
+    }
+
+    buffer[length] = '\0';
+
+    return length;
+}
+
+// NOTE: Every mapped file counts, a module is matched by the basename of its path.
+static int cas_backend__linux_has_module(CasBackend* backend, const CasProcess* process, const char* name, uint32_t length)
+{
+    char path[64];
+    char line[CAS_BACKEND_ATTRIBUTE_LENGTH];
+    FILE* maps = 0;
+    int result = 0;
+
+    (void)backend;
+
+    snprintf(path, sizeof(path), "/proc/%u/maps", process->pid);
+    maps = fopen(path, "re");
+
+    while (maps && !result && fgets(line, sizeof(line), maps))
+    {
+        uint32_t line_length = (uint32_t)strlen(line);
+        char* base = strrchr(line, '/');
+
+        line[line_length - (line_length && line[line_length - 1] == '\n')] = '\0';
+        line_length = base ? (uint32_t)strlen(++base) : 0;
+
+        if (line_length == length && !strncasecmp(base, name, length))
+        {
+            result = 1;
+        }
+    }
+
+    if (maps)
+    {
+        fclose(maps);
+    }
+
+    return result;
+}
+
+// NOTE: Returns 0 or the errno of the first attribute that could not be set. The scheduling class goes first,
+// nice and ioprio are kept per class. A priority class without a nice maps onto nice, realtime stops at -20.
+static int cas_backend__linux_set_task_policy(pid_t tid, const CasPolicy* policy, uint32_t* corrected)
+{
+    static const int sched_policies[] = { 0, SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO };
+    static const int priority_nices[] = { 0, 19, 10, 0, -5, -10, -20 };
+    static const int io_priorities[] =
+    {
+        0,
+        CAS_BACKEND_IOPRIO(CAS_BACKEND_IOPRIO_CLASS_IDLE, 0),
+        CAS_BACKEND_IOPRIO(CAS_BACKEND_IOPRIO_CLASS_BE, 7),
+        CAS_BACKEND_IOPRIO(CAS_BACKEND_IOPRIO_CLASS_BE, 4),
+        CAS_BACKEND_IOPRIO(CAS_BACKEND_IOPRIO_CLASS_BE, 0),
+    };
+
+    if (policy->sched)
+    {
+        struct sched_param param = { 0 };
+        struct sched_param current_param = { 0 };
+        int current = sched_getscheduler(tid);
+
+        param.sched_priority = policy->sched == CAS_SCHED_FIFO ? (policy->sched_priority ? (int)policy->sched_priority : 1) : 0;
+
+        if (current < 0 || sched_getparam(tid, &current_param) < 0)
+        {
+            return errno;
+        }
+
+        // NOTE: sched_getscheduler reports SCHED_RESET_ON_FORK along with the policy.
+        if ((current & ~SCHED_RESET_ON_FORK) != sched_policies[policy->sched] || current_param.sched_priority != param.sched_priority)
+        {
+            *corrected |= 1u << CAS_POLICY_SCHED;
+
+            if (sched_setscheduler(tid, sched_policies[policy->sched], &param) < 0)
+            {
+                return errno;
+            }
+        }
+    }
+
+    if (policy->priority || policy->nice != CAS_NICE_UNSET)
+    {
+        int nice = policy->nice != CAS_NICE_UNSET ? policy->nice : priority_nices[policy->priority];
+        int current = 0;
+
+        errno = 0;
+        current = getpriority(PRIO_PROCESS, (id_t)tid);
+
+        if (errno)
+        {
+            return errno;
+        }
+
+        if (current != nice)
+        {
+            *corrected |= 1u << (policy->nice != CAS_NICE_UNSET ? CAS_POLICY_NICE : CAS_POLICY_PRIORITY);
+
+            if (setpriority(PRIO_PROCESS, (id_t)tid, nice) < 0)
+            {
+                return errno;
+            }
+        }
+    }
+
+    if (policy->io)
+    {
+        long current = syscall(SYS_ioprio_get, CAS_BACKEND_IOPRIO_WHO_PROCESS, tid);
+
+        if (current < 0)
+        {
+            return errno;
+        }
+
+        if (current != io_priorities[policy->io])
+        {
+            *corrected |= 1u << CAS_POLICY_IO;
+
+            if (syscall(SYS_ioprio_set, CAS_BACKEND_IOPRIO_WHO_PROCESS, tid, io_priorities[policy->io]) < 0)
+            {
+                return errno;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// NOTE: Scheduling class, nice and ioprio all belong to a thread on Linux, every thread in /proc/<pid>/task is set
+// like the mask. Memory priority has no Linux counterpart and is left alone.
+static uint32_t cas_backend__linux_set_policy(CasBackend* backend, uint32_t pid, const CasPolicy* policy, uint32_t* corrected)
+{
+    uint32_t status = CAS_STATUS_PINNED;
+    char path[64];
+    DIR* task_directory = 0;
+    struct dirent* entry = 0;
+
+    (void)backend;
+
+    snprintf(path, sizeof(path), "/proc/%u/task", pid);
+    task_directory = opendir(path);
+
+    if (!task_directory)
+    {
+        return errno == EACCES ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+    }
+
+    while ((entry = readdir(task_directory)) != 0 && status == CAS_STATUS_PINNED)
+    {
+        char* end = 0;
+        unsigned long tid = strtoul(entry->d_name, &end, 10);
+        int error = 0;
+
+        if (*end || entry->d_name[0] < '0' || entry->d_name[0] > '9')
+        {
+            continue;
+        }
+
+        error = cas_backend__linux_set_task_policy((pid_t)tid, policy, corrected);
+
+        // NOTE: Raising priority needs CAP_SYS_NICE, that is a denial like any other and retried with backoff.
+        if (error == EPERM || error == EACCES)
+        {
+            status = CAS_STATUS_DENIED;
+        }
+        else if (error && error != ESRCH)
+        {
+            status = CAS_STATUS_FAILED;
+        }
+    }
+
+    closedir(task_directory);
+
+    return status;
+}
+
+// NOTE: /proc/stat has one "cpuN user nice system idle iowait irq softirq steal" line per online CPU in clock ticks.
+// Offline CPUs have no line and read as idle.
+static int cas_backend__linux_cpu_times(CasBackend* backend, uint64_t* busy, uint64_t* total)
+{
+    FILE* stat = fopen("/proc/stat", "re");
+    char line[256];
+
+    if (!stat)
+    {
+        return 0;
+    }
+
+    memset(busy, 0, backend->cpu_count * sizeof(uint64_t));
+    memset(total, 0, backend->cpu_count * sizeof(uint64_t));
+
+    while (fgets(line, sizeof(line), stat))
+    {
+        char* field = 0;
+        unsigned long cpu = 0;
+        uint64_t idle = 0;
+        uint64_t sum = 0;
+
+        if (strncmp(line, "cpu", 3) || line[3] < '0' || line[3] > '9')
+        {
+            continue;
+        }
+
+        cpu = strtoul(line + 3, &field, 10);
+
+        for (uint32_t i = 0; i < 8 && cpu < backend->cpu_count; ++i)
+        {
+            uint64_t value = strtoull(field, &field, 10);
+
+            sum += value;
+            idle += i == 3 || i == 4 ? value : 0;
+        }
+
+        if (cpu < backend->cpu_count)
+        {
+            busy[cpu] = sum - idle;
+            total[cpu] = sum;
+        }
+    }
+
+    fclose(stat);
+
+    return 1;
+}
+
+// NOTE: Process start times in /proc/<pid>/stat are clock ticks since boot, CLOCK_BOOTTIME counts from the same point.
+static uint64_t cas_backend__linux_clock(CasBackend* backend)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_BOOTTIME, &now);
+
+    return (uint64_t)now.tv_sec * backend->clock_frequency + (uint64_t)now.tv_nsec * backend->clock_frequency / 1000000000u;
+}
+
+static void cas_backend__linux_active_cpus(CasBackend* backend, CasCpuSet* set)
+{
+    cas_cpu_set_zero(set);
+
+    for (uint32_t i = 0; i < backend->cpu_count; ++i)
+    {
+        cas_cpu_set_add(set, i);
+    }
+}
+
+int cas_backend_native(CasBackend* backend)
+{
+    CasBackendLinux* linux_backend = &global_linux;
+    long configured = sysconf(_SC_NPROCESSORS_CONF);
+    uint32_t cpu_count = configured > 0 ? (uint32_t)configured : 1;
+
+    cpu_count = cpu_count < CAS_CPU_SET_MAX_CPUS ? cpu_count : CAS_CPU_SET_MAX_CPUS;
+
+    linux_backend->proc_directory = opendir("/proc");
+    linux_backend->cpu_set_size = CPU_ALLOC_SIZE(cpu_count);
+
+    *backend = (CasBackend)
+    {
+        .name = "linux",
+        .cpu_count = cpu_count,
+        .snapshot = &cas_backend__linux_snapshot,
+        .query_process = &cas_backend__linux_query_process,
+        .set_affinity = &cas_backend__linux_set_affinity,
+        .set_thread_affinity = &cas_backend__linux_set_thread_affinity,
+        .check_affinity = &cas_backend__linux_check_affinity,
+        .query_affinity = &cas_backend__linux_query_affinity,
+        .is_protected = &cas_backend__linux_is_protected,
+        .active_cpus = &cas_backend__linux_active_cpus,
+        .query_attribute = &cas_backend__linux_query_attribute,
+        .has_module = &cas_backend__linux_has_module,
+        .cpu_times = &cas_backend__linux_cpu_times,
+        .set_policy = &cas_backend__linux_set_policy,
+        .clock = &cas_backend__linux_clock,
+        .clock_frequency = (uint64_t)sysconf(_SC_CLK_TCK),
+        .context = linux_backend,
+    };
+
+    return linux_backend->proc_directory != 0;
+}
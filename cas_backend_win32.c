@@ -0,0 +1,887 @@
+#include "cas.h"
+#include "cas_backend.h"
+
+#define SYSTEM_PROCESS_INFORMATION_CLASS (5)
+#define PROCESS_COMMAND_LINE_INFORMATION (60)
+#define SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION_CLASS (8)
+#define PROCESS_IO_PRIORITY_INFORMATION  (33)
+// NOTE: ProcessMemoryPriority in PROCESS_INFORMATION_CLASS, the information is one ULONG.
+#define CAS_PROCESS_MEMORY_PRIORITY      (0)
+#define CAS_MAX_PROCESSOR_GROUPS         (64)
+
+NTSYSAPI NTSTATUS NTAPI NtQuerySystemInformation(ULONG system_information_class, PVOID system_information, ULONG system_information_length, PULONG return_length);
+NTSYSAPI NTSTATUS NTAPI NtQuerySystemInformationEx(ULONG system_information_class, PVOID input_buffer, ULONG input_buffer_length, PVOID system_information, ULONG system_information_length, PULONG return_length);
+NTSYSAPI NTSTATUS NTAPI NtQueryInformationProcess(HANDLE process, ULONG process_information_class, PVOID process_information, ULONG process_information_length, PULONG return_length);
+NTSYSAPI NTSTATUS NTAPI NtSetInformationProcess(HANDLE process, ULONG process_information_class, PVOID process_information, ULONG process_information_length);
+
+// NOTE: The full SYSTEM_PROCESS_INFORMATION layout, winternl.h only exposes part of it.
+typedef struct
+{
+    ULONG NextEntryOffset;
+    ULONG NumberOfThreads;
+    LARGE_INTEGER WorkingSetPrivateSize;
+    ULONG HardFaultCount;
+    ULONG NumberOfThreadsHighWatermark;
+    ULONGLONG CycleTime;
+    LARGE_INTEGER CreateTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER KernelTime;
+    struct
+    {
+        USHORT Length;
+        USHORT MaximumLength;
+        PWSTR Buffer;
+    } ImageName;
+    LONG BasePriority;
+    HANDLE UniqueProcessId;
+    HANDLE InheritedFromUniqueProcessId;
+    ULONG HandleCount;
+    ULONG SessionId;
+    ULONG_PTR UniqueProcessKey;
+    SIZE_T PeakVirtualSize;
+    SIZE_T VirtualSize;
+    ULONG PageFaultCount;
+    SIZE_T PeakWorkingSetSize;
+    SIZE_T WorkingSetSize;
+    SIZE_T QuotaPeakPagedPoolUsage;
+    SIZE_T QuotaPagedPoolUsage;
+    SIZE_T QuotaPeakNonPagedPoolUsage;
+    SIZE_T QuotaNonPagedPoolUsage;
+    SIZE_T PagefileUsage;
+    SIZE_T PeakPagefileUsage;
+    SIZE_T PrivatePageCount;
+    LARGE_INTEGER ReadOperationCount;
+    LARGE_INTEGER WriteOperationCount;
+    LARGE_INTEGER OtherOperationCount;
+    LARGE_INTEGER ReadTransferCount;
+    LARGE_INTEGER WriteTransferCount;
+    LARGE_INTEGER OtherTransferCount;
+} CasSystemProcessInformation;
+
+// NOTE: Per CPU times in 100ns units, KernelTime includes IdleTime.
+typedef struct
+{
+    LARGE_INTEGER IdleTime;
+    LARGE_INTEGER KernelTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER DpcTime;
+    LARGE_INTEGER InterruptTime;
+    ULONG InterruptCount;
+} CasSystemProcessorPerformanceInformation;
+
+// NOTE: NumberOfThreads of these follow every process entry in the snapshot.
+typedef struct
+{
+    LARGE_INTEGER KernelTime;
+    LARGE_INTEGER UserTime;
+    LARGE_INTEGER CreateTime;
+    ULONG WaitTime;
+    PVOID StartAddress;
+    struct
+    {
+        HANDLE UniqueProcess;
+        HANDLE UniqueThread;
+    } ClientId;
+    LONG Priority;
+    LONG BasePriority;
+    ULONG ContextSwitches;
+    ULONG ThreadState;
+    ULONG WaitReason;
+} CasSystemThreadInformation;
+
+// NOTE: CPU n of a set is bit n - first_cpus[g] of processor group g, groups are laid out back to back.
+typedef struct
+{
+    WORD group_count;
+    uint32_t cpu_count;
+    uint32_t first_cpus[CAS_MAX_PROCESSOR_GROUPS];
+    uint32_t group_cpu_counts[CAS_MAX_PROCESSOR_GROUPS];
+} CasProcessorGroups;
+
+typedef BOOL (WINAPI* CasSetProcessDefaultCpuSetMasks)(HANDLE process, PGROUP_AFFINITY cpu_set_masks, USHORT cpu_set_mask_count);
+typedef BOOL (WINAPI* CasSetThreadSelectedCpuSetMasks)(HANDLE thread, PGROUP_AFFINITY cpu_set_masks, USHORT cpu_set_mask_count);
+typedef HRESULT (WINAPI* CasGetThreadDescription)(HANDLE thread, PWSTR* description);
+typedef BOOL (WINAPI* CasGetProcessInformation)(HANDLE process, int information_class, LPVOID information, DWORD information_size);
+typedef BOOL (WINAPI* CasSetProcessInformation)(HANDLE process, int information_class, LPVOID information, DWORD information_size);
+
+typedef struct
+{
+    CasProcessorGroups processor_groups;
+    CasSetProcessDefaultCpuSetMasks set_process_default_cpu_set_masks;
+    CasSetThreadSelectedCpuSetMasks set_thread_selected_cpu_set_masks;
+    CasGetThreadDescription get_thread_description;
+    CasGetProcessInformation get_process_information;
+    CasSetProcessInformation set_process_information;
+    void* snapshot_buffer;
+    ULONG snapshot_buffer_size;
+    BOOL is_snapshot_valid;
+} CasBackendWin32;
+
+static CasBackendWin32 global_win32;
+
+static void cas_backend__init_processor_groups(CasBackendWin32* win32)
+{
+    CasProcessorGroups* groups = &win32->processor_groups;
+    WORD group_count = GetActiveProcessorGroupCount();
+
+    groups->group_count = group_count < CAS_MAX_PROCESSOR_GROUPS ? group_count : CAS_MAX_PROCESSOR_GROUPS;
+    groups->cpu_count = 0;
+
+    for (WORD i = 0; i < groups->group_count; ++i)
+    {
+        groups->first_cpus[i] = groups->cpu_count;
+        groups->group_cpu_counts[i] = GetActiveProcessorCount(i);
+        groups->cpu_count += groups->group_cpu_counts[i];
+    }
+
+    if (groups->cpu_count > CAS_CPU_SET_MAX_CPUS)
+    {
+        groups->cpu_count = CAS_CPU_SET_MAX_CPUS;
+    }
+
+    HMODULE kernel32 = GetModuleHandleW(L"kernel32");
+
+    // NOTE: Windows 11 and Server 2022 only, older systems can not move a process or thread across groups.
+    *(FARPROC*)&win32->set_process_default_cpu_set_masks = GetProcAddress(kernel32, "SetProcessDefaultCpuSetMasks");
+    *(FARPROC*)&win32->set_thread_selected_cpu_set_masks = GetProcAddress(kernel32, "SetThreadSelectedCpuSetMasks");
+
+    // NOTE: Windows 10 1607 and later, without it thread rules never match.
+    *(FARPROC*)&win32->get_thread_description = GetProcAddress(kernel32, "GetThreadDescription");
+
+    // NOTE: Windows 8 and later, without them memory priorities are left alone.
+    *(FARPROC*)&win32->get_process_information = GetProcAddress(kernel32, "GetProcessInformation");
+    *(FARPROC*)&win32->set_process_information = GetProcAddress(kernel32, "SetProcessInformation");
+}
+
+static void cas_backend__win32_active_cpus(CasBackend* backend, CasCpuSet* set)
+{
+    cas_cpu_set_zero(set);
+
+    for (uint32_t i = 0; i < backend->cpu_count; ++i)
+    {
+        cas_cpu_set_add(set, i);
+    }
+}
+
+// NOTE: Splits the set into one affinity per processor group, returns how many groups have CPUs in it.
+static WORD cas_backend__cpu_set_to_groups(const CasProcessorGroups* groups, const CasCpuSet* set, GROUP_AFFINITY* group_affinities)
+{
+    WORD count = 0;
+
+    for (WORD i = 0; i < groups->group_count; ++i)
+    {
+        KAFFINITY mask = 0;
+
+        for (uint32_t j = 0; j < groups->group_cpu_counts[i]; ++j)
+        {
+            if (cas_cpu_set_contains(set, groups->first_cpus[i] + j))
+            {
+                mask |= (KAFFINITY)1 << j;
+            }
+        }
+
+        if (mask)
+        {
+            memset(group_affinities + count, 0, sizeof(*group_affinities));
+            group_affinities[count].Group = i;
+            group_affinities[count].Mask = mask;
+            ++count;
+        }
+    }
+
+    return count;
+}
+
+static uint32_t cas_backend__win32_set_affinity(CasBackend* backend, uint32_t process_id, const CasCpuSet* desired_affinity_mask)
+{
+    CasBackendWin32* win32 = (CasBackendWin32*)backend->context;
+    uint32_t status = CAS_STATUS_FAILED;
+    GROUP_AFFINITY group_affinities[CAS_MAX_PROCESSOR_GROUPS];
+    WORD group_affinity_count = cas_backend__cpu_set_to_groups(&win32->processor_groups, desired_affinity_mask, group_affinities);
+    HANDLE handle_process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_SET_INFORMATION | PROCESS_SET_LIMITED_INFORMATION, FALSE, process_id);
+
+    if (handle_process)
+    {
+        USHORT process_groups[CAS_MAX_PROCESSOR_GROUPS] = { 0 };
+        USHORT process_group_count = ARRAY_COUNT(process_groups);
+        BOOL single_group = group_affinity_count == 1 &&
+            GetProcessGroupAffinity(handle_process, &process_group_count, process_groups) &&
+            process_group_count == 1 && process_groups[0] == group_affinities[0].Group;
+
+        // NOTE: The classic affinity mask only works inside the group the process already lives in,
+        // anything else goes through default CPU sets.
+        if (single_group)
+        {
+            DWORD_PTR desired_mask = (DWORD_PTR)group_affinities[0].Mask;
+            DWORD_PTR process_affinity_mask = 0;
+            DWORD_PTR system_affinity_mask = 0;
+
+            GetProcessAffinityMask(handle_process, (PDWORD_PTR)&process_affinity_mask, (PDWORD_PTR)&system_affinity_mask);
+
+            if (process_affinity_mask != desired_mask)
+            {
+                if (!SetProcessAffinityMask(handle_process, desired_mask))
+                {
+                    backend->last_error = GetLastError();
+                }
+
+                GetProcessAffinityMask(handle_process, (PDWORD_PTR)&process_affinity_mask, (PDWORD_PTR)&system_affinity_mask);
+            }
+
+            if (process_affinity_mask == desired_mask)
+            {
+                status = CAS_STATUS_PINNED;
+            }
+        }
+        else if (group_affinity_count && win32->set_process_default_cpu_set_masks)
+        {
+            if (win32->set_process_default_cpu_set_masks(handle_process, group_affinities, group_affinity_count))
+            {
+                status = CAS_STATUS_PINNED;
+            }
+            else
+            {
+                backend->last_error = GetLastError();
+            }
+        }
+
+        CloseHandle(handle_process);
+    }
+    else
+    {
+        backend->last_error = GetLastError();
+    }
+
+    // NOTE: Refused by the process itself or by its mask, both back off like a refused open.
+    if (status != CAS_STATUS_PINNED && backend->last_error == ERROR_ACCESS_DENIED)
+    {
+        status = CAS_STATUS_DENIED;
+    }
+
+    return status;
+}
+
+// NOTE: Only the classic mask can be read back, a process pinned through default CPU sets is never checked.
+static uint32_t cas_backend__win32_check_affinity(CasBackend* backend, uint32_t process_id, const CasCpuSet* affinity_mask, CasCpuSet* found)
+{
+    CasBackendWin32* win32 = (CasBackendWin32*)backend->context;
+    const CasProcessorGroups* groups = &win32->processor_groups;
+    uint32_t status = CAS_STATUS_UNKNOWN;
+    GROUP_AFFINITY group_affinities[CAS_MAX_PROCESSOR_GROUPS];
+    WORD group_affinity_count = cas_backend__cpu_set_to_groups(groups, affinity_mask, group_affinities);
+    HANDLE handle_process = group_affinity_count == 1 ? OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process_id) : 0;
+
+    if (handle_process)
+    {
+        USHORT process_groups[CAS_MAX_PROCESSOR_GROUPS] = { 0 };
+        USHORT process_group_count = ARRAY_COUNT(process_groups);
+        DWORD_PTR process_affinity_mask = 0;
+        DWORD_PTR system_affinity_mask = 0;
+
+        if (GetProcessGroupAffinity(handle_process, &process_group_count, process_groups) &&
+            process_group_count == 1 && process_groups[0] == group_affinities[0].Group &&
+            GetProcessAffinityMask(handle_process, (PDWORD_PTR)&process_affinity_mask, (PDWORD_PTR)&system_affinity_mask))
+        {
+            WORD group = group_affinities[0].Group;
+
+            status = process_affinity_mask == (DWORD_PTR)group_affinities[0].Mask ? CAS_STATUS_PINNED : CAS_STATUS_FAILED;
+            cas_cpu_set_zero(found);
+
+            for (uint32_t i = 0; status == CAS_STATUS_FAILED && i < groups->group_cpu_counts[group]; ++i)
+            {
+                if ((process_affinity_mask >> i) & 1)
+                {
+                    cas_cpu_set_add(found, groups->first_cpus[group] + i);
+                }
+            }
+        }
+
+        CloseHandle(handle_process);
+    }
+
+    return status;
+}
+
+// NOTE: Like the check, only a process inside one processor group has a mask that can be read back.
+static uint32_t cas_backend__win32_query_affinity(CasBackend* backend, uint32_t process_id, CasCpuSet* affinity_mask)
+{
+    CasBackendWin32* win32 = (CasBackendWin32*)backend->context;
+    const CasProcessorGroups* groups = &win32->processor_groups;
+    uint32_t status = CAS_STATUS_DENIED;
+    HANDLE handle_process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process_id);
+
+    if (handle_process)
+    {
+        USHORT process_groups[CAS_MAX_PROCESSOR_GROUPS] = { 0 };
+        USHORT process_group_count = ARRAY_COUNT(process_groups);
+        DWORD_PTR process_affinity_mask = 0;
+        DWORD_PTR system_affinity_mask = 0;
+
+        if (GetProcessGroupAffinity(handle_process, &process_group_count, process_groups) &&
+            process_group_count == 1 && process_groups[0] < groups->group_count &&
+            GetProcessAffinityMask(handle_process, (PDWORD_PTR)&process_affinity_mask, (PDWORD_PTR)&system_affinity_mask))
+        {
+            USHORT group = process_groups[0];
+
+            cas_cpu_set_zero(affinity_mask);
+
+            for (uint32_t i = 0; i < groups->group_cpu_counts[group]; ++i)
+            {
+                if ((process_affinity_mask >> i) & 1)
+                {
+                    cas_cpu_set_add(affinity_mask, groups->first_cpus[group] + i);
+                }
+            }
+
+            status = CAS_STATUS_PINNED;
+        }
+
+        CloseHandle(handle_process);
+    }
+    else
+    {
+        status = GetLastError() == ERROR_ACCESS_DENIED ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+    }
+
+    return status;
+}
+
+// NOTE: The system processes Windows itself depends on, most of them can not be opened anyway.
+static int cas_backend__win32_is_protected(CasBackend* backend, const CasProcess* process)
+{
+    static const char* names[] =
+    {
+        "system", "registry", "secure system", "memory compression", "smss.exe", "csrss.exe", "wininit.exe",
+        "winlogon.exe", "services.exe", "lsass.exe", "lsaiso.exe", "fontdrvhost.exe", "dwm.exe",
+    };
+
+    (void)backend;
+
+    if (process->pid == 0 || process->pid == 4 || process->pid == GetCurrentProcessId())
+    {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(names); ++i)
+    {
+        if (!_stricmp(process->name, names[i]))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// NOTE: One NtQuerySystemInformation call per tick, it carries creation times that Toolhelp does not.
+// Names are converted and hashed once here so matching never touches WCHARs. The buffer grows as needed and
+// stays with the caller, also when the query fails.
+static int cas_backend__win32_query_snapshot(void** snapshot_buffer, ULONG* snapshot_buffer_size)
+{
+    NTSTATUS status = STATUS_INFO_LENGTH_MISMATCH;
+    ULONG needed = 0;
+
+    while (status == STATUS_INFO_LENGTH_MISMATCH)
+    {
+        status = NtQuerySystemInformation(SYSTEM_PROCESS_INFORMATION_CLASS, *snapshot_buffer, *snapshot_buffer_size, &needed);
+
+        if (status == STATUS_INFO_LENGTH_MISMATCH)
+        {
+            // NOTE: Leave room for processes started between the two calls.
+            ULONG size = needed + needed / 4;
+            void* buffer = realloc(*snapshot_buffer, size);
+
+            if (!buffer)
+            {
+                return 0;
+            }
+
+            *snapshot_buffer = buffer;
+            *snapshot_buffer_size = size;
+        }
+    }
+
+    return status == STATUS_SUCCESS;
+}
+
+static int cas_backend__win32_snapshot(CasBackend* backend, CasProcessTable* table)
+{
+    CasBackendWin32* win32 = (CasBackendWin32*)backend->context;
+
+    table->count = 0;
+
+    win32->is_snapshot_valid = cas_backend__win32_query_snapshot(&win32->snapshot_buffer, &win32->snapshot_buffer_size);
+
+    if (!win32->is_snapshot_valid)
+    {
+        return 0;
+    }
+
+    for (BYTE* pointer = win32->snapshot_buffer;;)
+    {
+        CasSystemProcessInformation* information = (CasSystemProcessInformation*)pointer;
+        CasProcess* process = cas_process_table_push(table);
+
+        if (!process)
+        {
+            return 0;
+        }
+
+        int length = 0;
+
+        if (information->ImageName.Buffer)
+        {
+            length = WideCharToMultiByte(CP_UTF8, 0, information->ImageName.Buffer, (int)(information->ImageName.Length / sizeof(WCHAR)),
+                                         process->name, (int)sizeof(process->name) - 1, 0, 0);
+        }
+
+        process->pid = (uint32_t)(ULONG_PTR)information->UniqueProcessId;
+        process->create_time = (uint64_t)information->CreateTime.QuadPart;
+        process->parent_pid = (uint32_t)(ULONG_PTR)information->InheritedFromUniqueProcessId;
+        process->thread_count = information->NumberOfThreads;
+        process->cpu_time = (uint64_t)information->UserTime.QuadPart + (uint64_t)information->KernelTime.QuadPart;
+        process->name_length = length > 0 ? (uint32_t)length : 0;
+        process->name[process->name_length] = '\0';
+        process->name_hash = cas_engine_hash_name(process->name, process->name_length);
+
+        if (!information->NextEntryOffset)
+        {
+            break;
+        }
+
+        pointer += information->NextEntryOffset;
+    }
+
+    return 1;
+}
+
+// NOTE: Event sources only report PIDs, the name of a freshly started process is looked up here.
+static int cas_backend__win32_query_process(CasBackend* backend, uint32_t process_id, CasProcess* process)
+{
+    int result = 0;
+    HANDLE handle_process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process_id);
+
+    (void)backend;
+
+    if (handle_process)
+    {
+        WCHAR path[MAX_PATH];
+        DWORD path_length = ARRAY_COUNT(path);
+
+        if (QueryFullProcessImageNameW(handle_process, 0, path, &path_length))
+        {
+            int length = WideCharToMultiByte(CP_UTF8, 0, PathFindFileNameW(path), -1, process->name, (int)sizeof(process->name), 0, 0);
+
+            FILETIME create_time;
+            FILETIME exit_time;
+            FILETIME kernel_time;
+            FILETIME user_time;
+
+            if (length > 1 && GetProcessTimes(handle_process, &create_time, &exit_time, &kernel_time, &user_time))
+            {
+                process->pid = process_id;
+                process->create_time = ((uint64_t)create_time.dwHighDateTime << 32) | create_time.dwLowDateTime;
+                process->parent_pid = 0;
+                process->thread_count = 0;
+                process->cpu_time = (((uint64_t)user_time.dwHighDateTime << 32) | user_time.dwLowDateTime) +
+                                    (((uint64_t)kernel_time.dwHighDateTime << 32) | kernel_time.dwLowDateTime);
+                process->name_length = (uint32_t)(length - 1);
+                process->name_hash = cas_engine_hash_name(process->name, process->name_length);
+                result = 1;
+            }
+        }
+
+        CloseHandle(handle_process);
+    }
+
+    return result;
+}
+
+static CasSystemProcessInformation* cas_backend__win32_find_snapshot(void* snapshot_buffer, const CasProcess* process)
+{
+    for (BYTE* pointer = snapshot_buffer; pointer;)
+    {
+        CasSystemProcessInformation* information = (CasSystemProcessInformation*)pointer;
+
+        if ((uint32_t)(ULONG_PTR)information->UniqueProcessId == process->pid && (uint64_t)information->CreateTime.QuadPart == process->create_time)
+        {
+            return information;
+        }
+
+        pointer = information->NextEntryOffset ? pointer + information->NextEntryOffset : 0;
+    }
+
+    return 0;
+}
+
+static uint32_t cas_backend__win32_set_thread_group_affinity(CasBackendWin32* win32, HANDLE handle_thread, const CasCpuSet* affinity_mask)
+{
+    GROUP_AFFINITY group_affinities[CAS_MAX_PROCESSOR_GROUPS];
+    WORD group_affinity_count = cas_backend__cpu_set_to_groups(&win32->processor_groups, affinity_mask, group_affinities);
+    BOOL success = FALSE;
+
+    // NOTE: A thread runs in one group, a mask spanning groups needs selected CPU sets.
+    if (group_affinity_count == 1)
+    {
+        success = SetThreadGroupAffinity(handle_thread, group_affinities, 0);
+    }
+    else if (group_affinity_count && win32->set_thread_selected_cpu_set_masks)
+    {
+        success = win32->set_thread_selected_cpu_set_masks(handle_thread, group_affinities, group_affinity_count);
+    }
+
+    return success ? CAS_STATUS_PINNED : CAS_STATUS_FAILED;
+}
+
+// NOTE: Threads come from the snapshot taken this tick. Event path processes are not in it yet, those get a snapshot
+// of their own: this runs on pool workers while others read the shared one, which is only ever written by the sweep.
+static uint32_t cas_backend__win32_set_thread_affinity(CasBackend* backend, const CasEngine* engine, const CasProcess* process, uint32_t rule_set)
+{
+    CasBackendWin32* win32 = (CasBackendWin32*)backend->context;
+    CasSystemProcessInformation* information = win32->is_snapshot_valid ? cas_backend__win32_find_snapshot(win32->snapshot_buffer, process) : 0;
+    void* own_buffer = 0;
+    ULONG own_buffer_size = 0;
+    uint32_t status = CAS_STATUS_PINNED;
+
+    if (!win32->get_thread_description)
+    {
+        return CAS_STATUS_FAILED;
+    }
+
+    if (!information && cas_backend__win32_query_snapshot(&own_buffer, &own_buffer_size))
+    {
+        information = cas_backend__win32_find_snapshot(own_buffer, process);
+    }
+
+    if (!information)
+    {
+        free(own_buffer);
+        return CAS_STATUS_FAILED;
+    }
+
+    CasSystemThreadInformation* threads = (CasSystemThreadInformation*)(information + 1);
+
+    for (ULONG i = 0; i < information->NumberOfThreads && status == CAS_STATUS_PINNED; ++i)
+    {
+        DWORD thread_id = (DWORD)(ULONG_PTR)threads[i].ClientId.UniqueThread;
+        HANDLE handle_thread = OpenThread(THREAD_QUERY_INFORMATION | THREAD_SET_INFORMATION, FALSE, thread_id);
+        PWSTR description = 0;
+
+        if (!handle_thread)
+        {
+            if (GetLastError() == ERROR_ACCESS_DENIED)
+            {
+                status = CAS_STATUS_DENIED;
+            }
+
+            continue;
+        }
+
+        if (SUCCEEDED(win32->get_thread_description(handle_thread, &description)) && description)
+        {
+            char name[CAS_RULE_NAME_LENGTH];
+            int length = WideCharToMultiByte(CP_UTF8, 0, description, -1, name, (int)sizeof(name), 0, 0);
+            uint32_t rule_index = length > 1 ? cas_engine_find_thread_rule(engine, rule_set, name, (uint32_t)(length - 1)) : CAS_NO_RULE;
+
+            if (rule_index != CAS_NO_RULE)
+            {
+                CasCpuSet affinity_mask = cas_engine_rule_mask(engine, rule_index);
+                status = cas_backend__win32_set_thread_group_affinity(win32, handle_thread, &affinity_mask);
+            }
+
+            LocalFree(description);
+        }
+
+        CloseHandle(handle_thread);
+    }
+
+    free(own_buffer);
+
+    return status;
+}
+
+static uint32_t cas_backend__win32_utf8(const WCHAR* text, int text_length, char* buffer, uint32_t capacity)
+{
+    int length = WideCharToMultiByte(CP_UTF8, 0, text, text_length, buffer, (int)capacity - 1, 0, 0);
+
+    length = length > 0 ? length : 0;
+    buffer[length] = '\0';
+
+    return (uint32_t)length;
+}
+
+static uint32_t cas_backend__win32_query_user(HANDLE handle_process, char* buffer, uint32_t capacity)
+{
+    uint32_t length = 0;
+    HANDLE token = 0;
+
+    if (OpenProcessToken(handle_process, TOKEN_QUERY, &token))
+    {
+        BYTE token_user[sizeof(TOKEN_USER) + SECURITY_MAX_SID_SIZE];
+        DWORD size = 0;
+        WCHAR account[MAX_PATH];
+        DWORD account_length = ARRAY_COUNT(account) - 1;
+        WCHAR domain[MAX_PATH];
+        DWORD domain_length = ARRAY_COUNT(domain);
+        SID_NAME_USE use;
+
+        if (GetTokenInformation(token, TokenUser, token_user, sizeof(token_user), &size) &&
+            LookupAccountSidW(0, ((TOKEN_USER*)token_user)->User.Sid, account, &account_length, domain, &domain_length, &use))
+        {
+            WCHAR name[MAX_PATH * 2 + 2];
+
+            _snwprintf(name, ARRAY_COUNT(name), L"%s\\%s", domain, account);
+            name[ARRAY_COUNT(name) - 1] = L'\0';
+            length = cas_backend__win32_utf8(name, -1, buffer, capacity);
+            length = length ? length - 1 : 0;
+        }
+
+        CloseHandle(token);
+    }
+
+    return length;
+}
+
+// NOTE: The command line comes from NtQueryInformationProcess, it only needs PROCESS_QUERY_LIMITED_INFORMATION
+// where reading the PEB would need PROCESS_VM_READ.
+static uint32_t cas_backend__win32_query_attribute(CasBackend* backend, const CasProcess* process, uint32_t kind, char* buffer, uint32_t capacity)
+{
+    uint32_t length = 0;
+    HANDLE handle_process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, process->pid);
+
+    (void)backend;
+    buffer[0] = '\0';
+
+    if (!handle_process)
+    {
+        return 0;
+    }
+
+    if (kind == CAS_PREDICATE_CMDLINE)
+    {
+        BYTE information[CAS_BACKEND_ATTRIBUTE_LENGTH * sizeof(WCHAR) + sizeof(UNICODE_STRING)];
+        ULONG needed = 0;
+
+        if (NtQueryInformationProcess(handle_process, PROCESS_COMMAND_LINE_INFORMATION, information, sizeof(information), &needed) == STATUS_SUCCESS)
+        {
+            UNICODE_STRING* command_line = (UNICODE_STRING*)information;
+            length = cas_backend__win32_utf8(command_line->Buffer, (int)(command_line->Length / sizeof(WCHAR)), buffer, capacity);
+        }
+    }
+    else if (kind == CAS_PREDICATE_PATH)
+    {
+        WCHAR path[MAX_PATH];
+        DWORD path_length = ARRAY_COUNT(path);
+
+        if (QueryFullProcessImageNameW(handle_process, 0, path, &path_length))
+        {
+            length = cas_backend__win32_utf8(path, (int)path_length, buffer, capacity);
+        }
+    }
+    else if (kind == CAS_PREDICATE_USER)
+    {
+        length = cas_backend__win32_query_user(handle_process, buffer, capacity);
+    }
+
+    CloseHandle(handle_process);
+
+    return length;
+}
+
+static int cas_backend__win32_has_module(CasBackend* backend, const CasProcess* process, const char* name, uint32_t length)
+{
+    int result = 0;
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPMODULE | TH32CS_SNAPMODULE32, process->pid);
+    MODULEENTRY32W entry = { .dwSize = sizeof(entry) };
+
+    (void)backend;
+
+    if (snapshot == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+
+    for (BOOL more = Module32FirstW(snapshot, &entry); more && !result; more = Module32NextW(snapshot, &entry))
+    {
+        char module[MAX_MODULE_NAME32 * 3 + 1];
+        uint32_t module_length = cas_backend__win32_utf8(entry.szModule, -1, module, sizeof(module));
+
+        // NOTE: With -1 the terminator is counted too.
+        result = module_length && module_length - 1 == length && !_strnicmp(module, name, length);
+    }
+
+    CloseHandle(snapshot);
+
+    return result;
+}
+
+// NOTE: Creation times are FILETIMEs, 100 ns units since 1601.
+static uint64_t cas_backend__win32_clock(CasBackend* backend)
+{
+    FILETIME now;
+
+    (void)backend;
+    GetSystemTimeAsFileTime(&now);
+
+    return ((uint64_t)now.dwHighDateTime << 32) | now.dwLowDateTime;
+}
+
+// NOTE: A nice without a priority class picks the nearest class, it never reaches realtime.
+static uint32_t cas_backend__win32_nice_priority(int32_t nice)
+{
+    uint32_t priority = 0;
+
+    if (nice != CAS_NICE_UNSET)
+    {
+        priority = nice <= -15 ? CAS_PRIORITY_HIGH : nice <= -5 ? CAS_PRIORITY_ABOVE_NORMAL :
+                   nice < 5 ? CAS_PRIORITY_NORMAL : nice < 15 ? CAS_PRIORITY_BELOW_NORMAL : CAS_PRIORITY_IDLE;
+    }
+
+    return priority;
+}
+
+// NOTE: Priority class, I/O priority and memory priority are per process on Windows. Every attribute is read
+// first and only written when it differs. Without SeIncreaseBasePriorityPrivilege realtime quietly turns into high
+// and high I/O priority is refused, both count as denied so they are retried with backoff. sched and rtprio are Linux only.
+static uint32_t cas_backend__win32_set_policy(CasBackend* backend, uint32_t process_id, const CasPolicy* policy, uint32_t* corrected)
+{
+    static const DWORD priority_classes[] =
+    {
+        0, IDLE_PRIORITY_CLASS, BELOW_NORMAL_PRIORITY_CLASS, NORMAL_PRIORITY_CLASS, ABOVE_NORMAL_PRIORITY_CLASS, HIGH_PRIORITY_CLASS, REALTIME_PRIORITY_CLASS,
+    };
+    CasBackendWin32* win32 = (CasBackendWin32*)backend->context;
+    uint32_t status = CAS_STATUS_PINNED;
+    uint32_t priority = policy->priority ? policy->priority : cas_backend__win32_nice_priority(policy->nice);
+    HANDLE handle_process = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | PROCESS_SET_INFORMATION, FALSE, process_id);
+
+    if (!handle_process)
+    {
+        return GetLastError() == ERROR_ACCESS_DENIED ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+    }
+
+    if (priority && GetPriorityClass(handle_process) != priority_classes[priority])
+    {
+        *corrected |= 1u << (policy->priority ? CAS_POLICY_PRIORITY : CAS_POLICY_NICE);
+
+        if (!SetPriorityClass(handle_process, priority_classes[priority]))
+        {
+            status = GetLastError() == ERROR_ACCESS_DENIED ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+        }
+        else if (GetPriorityClass(handle_process) != priority_classes[priority])
+        {
+            status = CAS_STATUS_DENIED;
+        }
+    }
+
+    if (policy->io && status == CAS_STATUS_PINNED)
+    {
+        // NOTE: IoPriorityVeryLow is 0, the levels are one below ours.
+        ULONG io_priority = policy->io - 1;
+        ULONG current = 0;
+        ULONG needed = 0;
+
+        if (NtQueryInformationProcess(handle_process, PROCESS_IO_PRIORITY_INFORMATION, &current, (ULONG)sizeof(current), &needed) != STATUS_SUCCESS)
+        {
+            status = CAS_STATUS_FAILED;
+        }
+        else if (current != io_priority)
+        {
+            NTSTATUS result = 0;
+
+            *corrected |= 1u << CAS_POLICY_IO;
+            result = NtSetInformationProcess(handle_process, PROCESS_IO_PRIORITY_INFORMATION, &io_priority, (ULONG)sizeof(io_priority));
+
+            if (result != STATUS_SUCCESS)
+            {
+                status = (result == STATUS_PRIVILEGE_NOT_HELD || result == STATUS_ACCESS_DENIED) ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+            }
+        }
+    }
+
+    if (policy->memory && status == CAS_STATUS_PINNED && win32->get_process_information && win32->set_process_information)
+    {
+        ULONG memory_priority = policy->memory;
+        ULONG current = 0;
+
+        if (!win32->get_process_information(handle_process, CAS_PROCESS_MEMORY_PRIORITY, &current, (DWORD)sizeof(current)))
+        {
+            status = CAS_STATUS_FAILED;
+        }
+        else if (current != memory_priority)
+        {
+            *corrected |= 1u << CAS_POLICY_MEMORY;
+
+            if (!win32->set_process_information(handle_process, CAS_PROCESS_MEMORY_PRIORITY, &memory_priority, (DWORD)sizeof(memory_priority)))
+            {
+                status = GetLastError() == ERROR_ACCESS_DENIED ? CAS_STATUS_DENIED : CAS_STATUS_FAILED;
+            }
+        }
+    }
+
+    CloseHandle(handle_process);
+
+    return status;
+}
+
+// NOTE: The plain query only reports the group of the calling thread, the Ex form is asked once per group.
+static int cas_backend__win32_cpu_times(CasBackend* backend, uint64_t* busy, uint64_t* total)
+{
+    CasBackendWin32* win32 = (CasBackendWin32*)backend->context;
+    const CasProcessorGroups* groups = &win32->processor_groups;
+    CasSystemProcessorPerformanceInformation information[64];
+
+    for (USHORT group = 0; group < groups->group_count; ++group)
+    {
+        ULONG length = 0;
+        uint32_t count = 0;
+
+        if (NtQuerySystemInformationEx(SYSTEM_PROCESSOR_PERFORMANCE_INFORMATION_CLASS, &group, (ULONG)sizeof(group),
+                                       information, (ULONG)sizeof(information), &length) != STATUS_SUCCESS)
+        {
+            return 0;
+        }
+
+        count = (uint32_t)(length / sizeof(*information));
+        count = count < groups->group_cpu_counts[group] ? count : groups->group_cpu_counts[group];
+
+        for (uint32_t i = 0; i < count && groups->first_cpus[group] + i < backend->cpu_count; ++i)
+        {
+            uint64_t cpu_total = (uint64_t)(information[i].KernelTime.QuadPart + information[i].UserTime.QuadPart);
+
+            busy[groups->first_cpus[group] + i] = cpu_total - (uint64_t)information[i].IdleTime.QuadPart;
+            total[groups->first_cpus[group] + i] = cpu_total;
+        }
+    }
+
+    return 1;
+}
+
+int cas_backend_native(CasBackend* backend)
+{
+    CasBackendWin32* win32 = &global_win32;
+
+    cas_backend__init_processor_groups(win32);
+
+    *backend = (CasBackend)
+    {
+        .name = "win32",
+        .cpu_count = win32->processor_groups.cpu_count,
+        .snapshot = &cas_backend__win32_snapshot,
+        .query_process = &cas_backend__win32_query_process,
+        .set_affinity = &cas_backend__win32_set_affinity,
+        .set_thread_affinity = &cas_backend__win32_set_thread_affinity,
+        .check_affinity = &cas_backend__win32_check_affinity,
+        .query_affinity = &cas_backend__win32_query_affinity,
+        .is_protected = &cas_backend__win32_is_protected,
+        .active_cpus = &cas_backend__win32_active_cpus,
+        .query_attribute = &cas_backend__win32_query_attribute,
+        .has_module = &cas_backend__win32_has_module,
+        .cpu_times = &cas_backend__win32_cpu_times,
+        .set_policy = &cas_backend__win32_set_policy,
+        .clock = &cas_backend__win32_clock,
+        .clock_frequency = 10000000,
+        .context = win32,
+    };
+
+    return 1;
+}
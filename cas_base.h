@@ -0,0 +1,54 @@
+#ifndef H_CAS_BASE_H
+
+#ifdef _WIN32
+#ifndef _CRT_SECURE_NO_WARNINGS
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+#endif
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <stdlib.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#pragma warning(pop)
+#endif
+
+#ifdef _DEBUG
+#define ASSERT(x) do { if (!(x)) { *(volatile int*)0; } } while (0)
+#else
+#define ASSERT(x) (void)(x);
+#endif
+
+#define ARRAY_COUNT(x)      (sizeof(x) / sizeof(*(x)))
+
+// NOTE: cas_bench is built with CAS_COUNT_ALLOCATIONS to report allocations per tick. The standard headers are
+// already in above, so only calls are counted and their declarations are left alone.
+#ifdef CAS_COUNT_ALLOCATIONS
+extern uint64_t global_allocation_count;
+#define malloc(size)              (++global_allocation_count, malloc(size))
+#define calloc(count, size)       (++global_allocation_count, calloc(count, size))
+#define realloc(pointer, size)    (++global_allocation_count, realloc(pointer, size))
+#endif
+
+// NOTE: Shared fields are declared volatile, which already gives acquire/release semantics on x64 with /volatile:ms.
+#ifdef _MSC_VER
+#define CAS_ATOMIC_LOAD(pointer)            (*(pointer))
+#define CAS_ATOMIC_STORE(pointer, value)    (*(pointer) = (value))
+#define CAS_ATOMIC_ADD32(pointer, value)    ((uint32_t)_InterlockedExchangeAdd((volatile long*)(pointer), (long)(value)))
+#define CAS_ATOMIC_CAS64(pointer, expected, desired) \
+    (_InterlockedCompareExchange64((volatile __int64*)(pointer), (__int64)(desired), (__int64)(expected)) == (__int64)(expected))
+#else
+#define CAS_ATOMIC_LOAD(pointer)            __atomic_load_n((pointer), __ATOMIC_ACQUIRE)
+#define CAS_ATOMIC_STORE(pointer, value)    __atomic_store_n((pointer), (value), __ATOMIC_RELEASE)
+#define CAS_ATOMIC_ADD32(pointer, value)    __atomic_fetch_add((pointer), (value), __ATOMIC_ACQ_REL)
+#define CAS_ATOMIC_CAS64(pointer, expected, desired) \
+    __sync_bool_compare_and_swap((pointer), (expected), (desired))
+#endif
+
+#define H_CAS_BASE_H
+#endif
@@ -0,0 +1,595 @@
+// NOTE: Sweep benchmark on a synthetic process table. Run cas_bench.exe [processes] [iterations] for the report,
+// or cas_bench.exe --json [processes] [rules] [iterations] for only the per stage numbers as JSON. A count left
+// out or 0 runs the whole range, 100 to 100000 processes and 1 to 10000 rules. cas_bench.exe --stats prints the
+// counters of the running cas as JSON instead.
+
+#include "cas_backend.h"
+#include "cas_topology.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+#include <stdio.h>
+#include <time.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#ifdef CAS_COUNT_ALLOCATIONS
+uint64_t global_allocation_count;
+#define CAS_BENCH_ALLOCATIONS (global_allocation_count)
+#else
+#define CAS_BENCH_ALLOCATIONS (0)
+#endif
+
+#define CAS_BENCH_STAGE_COUNT (3)
+
+// NOTE: Totals over all timed ticks. Syscalls are the fake backend calls, each one is at least one system call
+// on a real backend.
+typedef struct
+{
+    const char* name;
+    double elapsed;
+    uint64_t allocations;
+    uint64_t syscalls;
+} CasBenchStage;
+
+typedef struct
+{
+    double start;
+    uint64_t allocations;
+    uint64_t syscalls;
+} CasBenchMark;
+
+static double cas_bench__now(void)
+{
+    struct timespec now;
+
+    timespec_get(&now, TIME_UTC);
+
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+// NOTE: Every eighth process is a worker, names repeat after name_count processes.
+static void cas_bench__fill_table(CasProcessTable* table, uint32_t process_count, uint32_t name_count)
+{
+    table->count = 0;
+
+    for (uint32_t i = 0; i < process_count; ++i)
+    {
+        CasProcess* process = cas_process_table_push(table);
+        int length = snprintf(process->name, sizeof(process->name), (i % 8) ? "service%u.exe" : "Worker%u.EXE", i % name_count);
+
+        process->pid = 4 + i * 4;
+        process->create_time = 1000 + i;
+        process->name_length = (uint32_t)length;
+        process->name_hash = cas_engine_hash_name(process->name, process->name_length);
+    }
+}
+
+static void cas_bench__fill_rules(CasEngine* engine, uint32_t rule_count)
+{
+    uint64_t mask_words[2] = { 0 };
+    CasCpuSet mask = { mask_words, ARRAY_COUNT(mask_words) };
+
+    cas_engine_clear_rules(engine);
+    cas_engine_set_cpu_count(engine, 128);
+
+    for (uint32_t i = 0; i < rule_count; ++i)
+    {
+        char name[CAS_RULE_NAME_LENGTH];
+        int length = snprintf(name, sizeof(name), "worker%u.exe", i * 8);
+
+        cas_cpu_set_zero(&mask);
+        cas_cpu_set_add(&mask, i % 128);
+        cas_engine_add_rule(engine, name, (uint32_t)length, &mask);
+    }
+
+    cas_engine_build_index(engine);
+}
+
+static int cas_bench__names_equal(const char* folded, const char* name, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        char c = (name[i] >= 'A' && name[i] <= 'Z') ? (char)(name[i] + ('a' - 'A')) : name[i];
+
+        if (c != folded[i])
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: The per-rule loop cas__cpu_affinity_routine used before the index, kept as the baseline.
+static uint32_t cas_bench__legacy_sweep(const CasEngine* engine, const CasProcessTable* table)
+{
+    uint32_t matches = 0;
+
+    for (uint32_t rule_index = 0; rule_index < engine->rule_count; ++rule_index)
+    {
+        const char* name = cas_engine_rule_name(engine, rule_index);
+        uint32_t name_length = engine->rule_name_lengths[rule_index];
+
+        for (uint32_t process_index = 0; process_index < table->count; ++process_index)
+        {
+            const CasProcess* process = table->processes + process_index;
+
+            if (process->name_length == name_length && cas_bench__names_equal(name, process->name, name_length))
+            {
+                ++matches;
+            }
+        }
+    }
+
+    return matches;
+}
+
+// NOTE: Whole ticks through a backend, snapshot copy and set_affinity calls included.
+static void cas_bench__backend(CasBackend* backend, CasEngine* engine, uint32_t iterations)
+{
+    CasProcessTable table = { 0 };
+    double start = 0;
+    double elapsed = 0;
+
+    cas_backend_sweep(backend, engine, &table);
+    start = cas_bench__now();
+
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        cas_backend_sweep(backend, engine, &table);
+    }
+
+    elapsed = (cas_bench__now() - start) / iterations;
+
+    printf("%-8s %10u %14.0f %14.2f %8u\n", backend->name, table.count, elapsed, table.count ? elapsed / table.count : 0.0, engine->match_count);
+
+    cas_process_table_free(&table);
+}
+
+static uint64_t cas_bench__syscalls(const CasBackendFake* fake)
+{
+    return (uint64_t)fake->snapshot_count + fake->set_affinity_count + fake->thread_walk_count + fake->set_policy_count;
+}
+
+static CasBenchMark cas_bench__mark(const CasBackendFake* fake)
+{
+    CasBenchMark mark = { cas_bench__now(), CAS_BENCH_ALLOCATIONS, cas_bench__syscalls(fake) };
+
+    return mark;
+}
+
+static void cas_bench__end_stage(CasBenchStage* stage, const CasBackendFake* fake, const CasBenchMark* mark)
+{
+    stage->elapsed += cas_bench__now() - mark->start;
+    stage->allocations += CAS_BENCH_ALLOCATIONS - mark->allocations;
+    stage->syscalls += cas_bench__syscalls(fake) - mark->syscalls;
+}
+
+// NOTE: Whole ticks split into the stages the timer routine runs, enumerate (snapshot), match (sweep) and apply.
+// One percent of the processes restart every tick under the same PIDs, so match and apply see new processes
+// the way they do on a live system. The first tick is not timed, it only grows the tables.
+static void cas_bench__stages(uint32_t process_count, uint32_t rule_count, uint32_t iterations, int is_json, int is_first)
+{
+    CasBenchStage stages[CAS_BENCH_STAGE_COUNT] = { { "enumerate", 0, 0, 0 }, { "match", 0, 0, 0 }, { "apply", 0, 0, 0 } };
+    uint32_t churn = process_count / 100 ? process_count / 100 : 1;
+    CasProcessTable names = { 0 };
+    CasProcessTable table = { 0 };
+    CasBackendFake fake;
+    CasBackend backend;
+    CasEngine engine;
+
+    cas_engine_init(&engine);
+    cas_backend_fake(&backend, &fake, 128);
+    cas_bench__fill_table(&names, process_count, process_count);
+
+    for (uint32_t i = 0; i < names.count; ++i)
+    {
+        cas_backend_fake_add_process(&fake, names.processes[i].pid, names.processes[i].name, names.processes[i].create_time);
+    }
+
+    cas_bench__fill_rules(&engine, rule_count);
+    cas_backend_sweep(&backend, &engine, &table);
+
+    for (uint32_t i = 0; i < iterations; ++i)
+    {
+        CasBenchMark mark;
+
+        for (uint32_t j = 0; j < churn; ++j)
+        {
+            ++fake.processes.processes[(i * churn + j) % process_count].create_time;
+        }
+
+        mark = cas_bench__mark(&fake);
+        backend.snapshot(&backend, &table);
+        cas_bench__end_stage(stages + 0, &fake, &mark);
+
+        mark = cas_bench__mark(&fake);
+        cas_engine_sweep(&engine, &table);
+        cas_bench__end_stage(stages + 1, &fake, &mark);
+
+        mark = cas_bench__mark(&fake);
+        cas_backend_apply(&backend, &engine, &table);
+        cas_bench__end_stage(stages + 2, &fake, &mark);
+    }
+
+    if (is_json)
+    {
+        printf("%s  {\"processes\": %u, \"rules\": %u, \"iterations\": %u, \"matches\": %u, \"stages\": [",
+               is_first ? "" : ",\n", process_count, rule_count, iterations, engine.match_count);
+    }
+
+    for (uint32_t i = 0; i < CAS_BENCH_STAGE_COUNT; ++i)
+    {
+        const CasBenchStage* stage = stages + i;
+        double tick = stage->elapsed / iterations;
+
+        if (is_json)
+        {
+            printf("%s{\"stage\": \"%s\", \"ns_per_tick\": %.1f, \"ns_per_process\": %.3f, \"ns_per_rule\": %.3f, "
+                   "\"allocations_per_tick\": %.3f, \"syscalls_per_tick\": %.3f}",
+                   i ? ", " : "", stage->name, tick, tick / process_count, tick / rule_count,
+                   (double)stage->allocations / iterations, (double)stage->syscalls / iterations);
+        }
+        else
+        {
+            printf("%10u %8u %-10s %14.0f %12.2f %12.2f %12.2f %12.2f\n", process_count, rule_count, stage->name, tick, tick / process_count,
+                   tick / rule_count, (double)stage->allocations / iterations, (double)stage->syscalls / iterations);
+        }
+    }
+
+    if (is_json)
+    {
+        printf("]}");
+    }
+
+    cas_engine_free(&engine);
+    cas_process_table_free(&fake.processes);
+    cas_process_table_free(&names);
+    cas_process_table_free(&table);
+}
+
+// NOTE: Iterations shrink with the table so every size takes about as long, unless they are given.
+static void cas_bench__stage_suite(uint32_t process_count, uint32_t rule_count, uint32_t iterations, int is_json)
+{
+    static const uint32_t process_counts[] = { 100, 1000, 10000, 100000 };
+    static const uint32_t rule_counts[] = { 1, 100, 10000 };
+    int is_first = 1;
+
+    if (is_json)
+    {
+        printf("[\n");
+    }
+    else
+    {
+        printf("\n%10s %8s %-10s %14s %12s %12s %12s %12s\n", "processes", "rules", "stage", "ns/tick", "ns/process", "ns/rule", "allocs/tick", "syscalls/tick");
+    }
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(process_counts); ++i)
+    {
+        uint32_t processes = process_count ? process_count : process_counts[i];
+
+        for (uint32_t j = 0; j < ARRAY_COUNT(rule_counts); ++j)
+        {
+            uint32_t rules = rule_count ? rule_count : rule_counts[j];
+            uint32_t ticks = iterations ? iterations : (2000000 / processes < 200 ? 2000000 / processes : 200);
+
+            cas_bench__stages(processes, rules, ticks, is_json, is_first);
+            is_first = 0;
+
+            if (rule_count)
+            {
+                break;
+            }
+        }
+
+        if (process_count)
+        {
+            break;
+        }
+    }
+
+    if (is_json)
+    {
+        printf("\n]\n");
+    }
+}
+
+static int cas_bench__print_stats(void)
+{
+    CasStats* stats = cas_stats_map(0);
+    CasStatsThread total;
+    char text[4096];
+    int result = 1;
+
+    if (stats && cas_stats_snapshot(stats, &total))
+    {
+        cas_stats_format_json(&total, text, sizeof(text));
+        printf("%s", text);
+        result = 0;
+    }
+    else
+    {
+        fprintf(stderr, "no running cas to read stats from\n");
+    }
+
+    if (stats)
+    {
+        cas_stats_unmap(stats);
+    }
+
+    return result;
+}
+
+// NOTE: Counts are plain decimal, anything strtoull would stop early on or that does not fit 32 bits is refused.
+static int cas_bench__parse_counts(char** arguments, uint32_t argument_count, uint32_t* counts, uint32_t count_capacity)
+{
+    if (argument_count > count_capacity)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < argument_count; ++i)
+    {
+        char* end = 0;
+        unsigned long long value = 0;
+
+        if (arguments[i][0] < '0' || arguments[i][0] > '9')
+        {
+            return 0;
+        }
+
+        value = strtoull(arguments[i], &end, 10);
+
+        if (*end || value > 0xffffffffull)
+        {
+            return 0;
+        }
+
+        counts[i] = (uint32_t)value;
+    }
+
+    return 1;
+}
+
+static int cas_bench__usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [processes] [iterations]\n"
+                    "       %s --json [processes] [rules] [iterations]\n"
+                    "       %s --stats\n", program, program, program);
+
+    return 1;
+}
+
+int main(int argc, char** argv)
+{
+    uint32_t counts[3] = { 0 };
+
+    if (argc == 2 && !strcmp(argv[1], "--stats"))
+    {
+        return cas_bench__print_stats();
+    }
+
+    if (argc > 1 && !strcmp(argv[1], "--json"))
+    {
+        if (!cas_bench__parse_counts(argv + 2, (uint32_t)(argc - 2), counts, ARRAY_COUNT(counts)))
+        {
+            return cas_bench__usage(argv[0]);
+        }
+
+        cas_bench__stage_suite(counts[0], counts[1], counts[2], 1);
+        return 0;
+    }
+
+    counts[0] = 2000;
+    counts[1] = 200;
+
+    // NOTE: Unlike the JSON suite there is no range to run here, a count of 0 would time nothing.
+    if (!cas_bench__parse_counts(argv + 1, (uint32_t)(argc - 1), counts, 2) || !counts[0] || !counts[1])
+    {
+        return cas_bench__usage(argv[0]);
+    }
+
+    uint32_t process_count = counts[0];
+    uint32_t iterations = counts[1];
+    CasProcessTable table = { 0 };
+    CasEngine engine;
+
+    cas_engine_init(&engine);
+    cas_bench__fill_table(&table, process_count, 512);
+
+    printf("%8s %10s %14s %14s %14s %8s %12s\n", "rules", "processes", "ns/tick", "ns/process", "legacy ns/tick", "matches", "misses/tick");
+
+    // NOTE: Powers of two up to 1024, then a fleet sized policy.
+    for (uint32_t rule_count = 1; rule_count <= 10000; rule_count = rule_count < 1024 ? rule_count * 2 : rule_count + 8976)
+    {
+        double start = 0;
+        double elapsed = 0;
+        double legacy_elapsed = 0;
+        uint32_t legacy_matches = 0;
+        uint32_t legacy_iterations = rule_count > 1024 ? (iterations + 9) / 10 : iterations;
+
+        uint64_t misses = 0;
+
+        cas_bench__fill_rules(&engine, rule_count);
+        cas_engine_sweep(&engine, &table);
+
+        // NOTE: Pretend every match got pinned, the timed sweeps then measure the steady state.
+        for (uint32_t i = 0; i < engine.match_count; ++i)
+        {
+            cas_engine_set_result(&engine, engine.matches + i, CAS_STATUS_PINNED);
+        }
+
+        misses = engine.counters.state_misses;
+        start = cas_bench__now();
+
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            cas_engine_sweep(&engine, &table);
+        }
+
+        elapsed = (cas_bench__now() - start) / iterations;
+        misses = engine.counters.state_misses - misses;
+
+        start = cas_bench__now();
+
+        for (uint32_t i = 0; i < legacy_iterations; ++i)
+        {
+            legacy_matches += cas_bench__legacy_sweep(&engine, &table);
+        }
+
+        legacy_elapsed = (cas_bench__now() - start) / legacy_iterations;
+
+        if (legacy_matches != engine.match_count * legacy_iterations)
+        {
+            printf("match count mismatch: %u != %u\n", legacy_matches / legacy_iterations, engine.match_count);
+            return 1;
+        }
+
+        printf("%8u %10u %14.0f %14.2f %14.0f %8u %12.2f\n", rule_count, process_count, elapsed, elapsed / process_count, legacy_elapsed, engine.match_count, (double)misses / iterations);
+    }
+
+    // NOTE: Reloads reuse the rule arrays and name arena, after the first one nothing is allocated.
+    {
+        uint32_t reloads = (iterations + 9) / 10;
+        double start = cas_bench__now();
+
+        for (uint32_t i = 0; i < reloads; ++i)
+        {
+            cas_bench__fill_rules(&engine, 10000);
+        }
+
+        printf("\nreload of %u rules: %.0f ns, %u bytes of names\n", engine.rule_count, (cas_bench__now() - start) / reloads, engine.name_arena_used);
+    }
+
+    // NOTE: Globs and regular expressions share one DFA, a name costs one pass however many patterns there are.
+    printf("\n%8s %10s %14s %14s %14s %8s\n", "patterns", "processes", "ns/tick", "ns/process", "compile ns", "states");
+
+    for (uint32_t pattern_count = 1; pattern_count <= 1024; pattern_count *= 4)
+    {
+        uint64_t mask_words[2] = { 1 };
+        CasCpuSet mask = { mask_words, ARRAY_COUNT(mask_words) };
+        double start = 0;
+        double compile_elapsed = 0;
+        double elapsed = 0;
+
+        cas_engine_clear_rules(&engine);
+
+        for (uint32_t i = 0; i < pattern_count; ++i)
+        {
+            char pattern[CAS_RULE_NAME_LENGTH];
+            int length = snprintf(pattern, sizeof(pattern), (i % 2) ? "re:service%u[0-9]*\\.exe" : "worker%u?.exe", i);
+
+            cas_engine_add_rule(&engine, pattern, (uint32_t)length, &mask);
+        }
+
+        start = cas_bench__now();
+        cas_engine_build_index(&engine);
+        compile_elapsed = cas_bench__now() - start;
+        start = cas_bench__now();
+
+        for (uint32_t i = 0; i < iterations; ++i)
+        {
+            cas_engine_sweep(&engine, &table);
+        }
+
+        elapsed = (cas_bench__now() - start) / iterations;
+
+        printf("%8u %10u %14.0f %14.2f %14.0f %8u\n", pattern_count, process_count, elapsed, elapsed / process_count, compile_elapsed, engine.matcher.state_count);
+    }
+
+    CasBackend backend;
+    CasBackendFake fake;
+
+    cas_backend_fake(&backend, &fake, 128);
+
+    for (uint32_t i = 0; i < table.count; ++i)
+    {
+        CasProcess* process = table.processes + i;
+        cas_backend_fake_add_process(&fake, process->pid, process->name, process->create_time);
+    }
+
+    printf("\n%-8s %10s %14s %14s %8s\n", "backend", "processes", "ns/tick", "ns/process", "matches");
+
+    cas_bench__fill_rules(&engine, 64);
+    cas_bench__backend(&backend, &engine, iterations);
+    cas_process_table_free(&fake.processes);
+
+    // NOTE: The native snapshot runs against the real process list, rules are synthetic so nothing gets pinned.
+    if (cas_backend_native(&backend))
+    {
+        cas_bench__backend(&backend, &engine, iterations / 10 ? iterations / 10 : 1);
+    }
+
+    // NOTE: Symbolic masks are resolved against the real topology, once per load and again when it changes.
+    if (backend.cpu_count)
+    {
+        const char* masks[] = { "all", "node0", "l3:0", "physical-cores", "cores 0-1 of node0" };
+        uint64_t mask_words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS] = { 0 };
+        CasCpuSet mask = { mask_words, cas_cpu_set_word_count(backend.cpu_count) };
+        CasTopology topology = { 0 };
+        double start = cas_bench__now();
+
+        if (cas_topology_discover(&topology, backend.cpu_count))
+        {
+            printf("\ntopology discovery: %.0f ns, %u cores, %u l3 caches\n", cas_bench__now() - start, topology.core_count, topology.l3_count);
+
+            for (uint32_t i = 0; i < ARRAY_COUNT(masks); ++i)
+            {
+                char hex[CAS_CPU_SET_MAX_CPUS / 4 + 1];
+                int is_resolved = 0;
+
+                start = cas_bench__now();
+                is_resolved = cas_topology_resolve(&topology, masks[i], (uint32_t)strlen(masks[i]), &mask);
+                cas_cpu_set_format_hex(&mask, hex, ARRAY_COUNT(hex));
+                printf("%-20s %10.0f ns  %s\n", masks[i], cas_bench__now() - start, is_resolved ? hex : "-");
+            }
+        }
+
+        cas_topology_free(&topology);
+    }
+
+    // NOTE: Every pair mask is parsed on each load, thousands of them should not be noticed.
+    {
+        const char* masks[] = { "0-3,8,10-15:2", "0-255:2", "0-31:2/4", "1:ff,3:f0", "FF00FF00FF00FF00FF00FF00FF00FF00" };
+        const uint32_t formats[] = { CAS_CPU_SET_FORMAT_LIST, CAS_CPU_SET_FORMAT_LIST, CAS_CPU_SET_FORMAT_LIST, CAS_CPU_SET_FORMAT_GROUPS, CAS_CPU_SET_FORMAT_HEX };
+        uint64_t mask_words[256 / CAS_CPU_SET_WORD_BITS] = { 0 };
+        CasCpuSet mask = { mask_words, ARRAY_COUNT(mask_words) };
+        uint32_t parses = 100000;
+
+        printf("\n%-36s %10s %10s\n", "mask", "ns/parse", "ns/format");
+
+        for (uint32_t i = 0; i < ARRAY_COUNT(masks); ++i)
+        {
+            char text[CAS_CPU_SET_MAX_CPUS / 4 + 1];
+            uint32_t length = (uint32_t)strlen(masks[i]);
+            double parse_elapsed = 0;
+            int is_parsed = 1;
+            double start = cas_bench__now();
+
+            for (uint32_t j = 0; j < parses; ++j)
+            {
+                is_parsed &= cas_cpu_set_parse(&mask, formats[i], masks[i], length);
+            }
+
+            parse_elapsed = (cas_bench__now() - start) / parses;
+            start = cas_bench__now();
+
+            for (uint32_t j = 0; j < parses; ++j)
+            {
+                cas_cpu_set_format(&mask, formats[i], text, ARRAY_COUNT(text));
+            }
+
+            printf("%-36s %10.1f %10.1f  %s\n", masks[i], parse_elapsed, (cas_bench__now() - start) / parses, is_parsed ? text : "-");
+        }
+    }
+
+    cas_bench__stage_suite(0, 0, 0, 0);
+
+    cas_engine_free(&engine);
+    cas_process_table_free(&table);
+
+    return 0;
+}
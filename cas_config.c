@@ -0,0 +1,388 @@
+#include "cas_config.h"
+
+#define CAS_CONFIG_PAIRS_SECTION          "pairs"
+#define CAS_CONFIG_SETTINGS_SECTION       "settings"
+#define CAS_CONFIG_PERIOD_KEY             "period"
+#define CAS_CONFIG_SILENT_START_KEY       "silent-start"
+#define CAS_CONFIG_AUTO_START_KEY         "auto-start"
+#define CAS_CONFIG_MENU_SHORTCUT_KEY      "menu-shortcut"
+#define CAS_CONFIG_DRIFT_CHECK_KEY        "drift-check"
+#define CAS_CONFIG_AUTO_PIN_KEY           "auto-pin"
+#define CAS_CONFIG_AUTO_PIN_THRESHOLD_KEY "auto-pin-threshold"
+#define CAS_CONFIG_AUTO_PIN_TIME_KEY      "auto-pin-time"
+#define CAS_CONFIG_MERGE_KEY              "merge"
+
+#define CAS_CONFIG_SECTION_NONE      (0)
+#define CAS_CONFIG_SECTION_PAIRS     (1)
+#define CAS_CONFIG_SECTION_SETTINGS  (2)
+#define CAS_CONFIG_SECTION_OTHER     (3)
+
+static int cas_config__grow(void** data, uint32_t* capacity, uint32_t needed, size_t element_size)
+{
+    int result = 1;
+
+    if (needed > *capacity)
+    {
+        uint32_t new_capacity = *capacity ? *capacity : 16;
+        void* new_data = 0;
+
+        while (new_capacity < needed)
+        {
+            new_capacity *= 2;
+        }
+
+        new_data = realloc(*data, new_capacity * element_size);
+
+        if (new_data)
+        {
+            *data = new_data;
+            *capacity = new_capacity;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static int cas_config__is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static int cas_config__is_hex(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+}
+
+static int cas_config__equals(const char* text, uint32_t length, const char* word)
+{
+    uint32_t i = 0;
+
+    for (; i < length && word[i]; ++i)
+    {
+        char c = text[i] >= 'A' && text[i] <= 'Z' ? (char)(text[i] - 'A' + 'a') : text[i];
+
+        if (c != word[i])
+        {
+            return 0;
+        }
+    }
+
+    return i == length && !word[i];
+}
+
+static void cas_config__trim(const char* text, uint32_t* start, uint32_t* end)
+{
+    while (*start < *end && cas_config__is_space(text[*start]))
+    {
+        ++*start;
+    }
+
+    while (*end > *start && cas_config__is_space(text[*end - 1]))
+    {
+        --*end;
+    }
+}
+
+// NOTE: Anything but hex digits after an optional 0x is a CPU list or left to the topology.
+int cas_config_is_symbolic(const char* text, uint32_t length)
+{
+    uint32_t start = length >= 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X') ? 2 : 0;
+
+    for (uint32_t i = start; i < length; ++i)
+    {
+        if (!cas_config__is_hex(text[i]))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int cas_config_resolve(const char* text, uint32_t length, const CasTopology* topology, CasCpuSet* set)
+{
+    int result = 0;
+
+    if (cas_config_is_symbolic(text, length))
+    {
+        result = cas_cpu_set_parse_list(set, text, length) || (topology && cas_topology_resolve(topology, text, length, set));
+    }
+    else
+    {
+        result = length && cas_cpu_set_parse_hex(set, text, length);
+    }
+
+    return result && !cas_cpu_set_is_empty(set);
+}
+
+// NOTE: "name:mask" is split at the last colon, unless the text after an earlier one resolves on its own as in
+// "name:l3:0", "name:0-15:2" or "name:1:ff". The earliest such colon wins.
+static uint32_t cas_config__mask_separator(const char* pair, uint32_t length, const CasTopology* topology, CasCpuSet* set)
+{
+    uint32_t separator = length;
+
+    for (uint32_t colon = length; colon > 0; --colon)
+    {
+        if (pair[colon - 1] == ':' &&
+            (separator == length || (colon > 1 && cas_config_resolve(pair + colon, length - colon, topology, set))))
+        {
+            separator = colon - 1;
+        }
+    }
+
+    return separator;
+}
+
+void cas_config_init(CasConfig* config)
+{
+    memset(config, 0, sizeof(*config));
+    config->period = CAS_CONFIG_DEFAULT_PERIOD;
+}
+
+void cas_config_free(CasConfig* config)
+{
+    free(config->text);
+    free(config->pairs);
+    cas_config_init(config);
+}
+
+// NOTE: Sections and keys are matched without case like GetPrivateProfile* does, lines starting with ';' or '#' are comments.
+int cas_config_parse(CasConfig* config, const char* text, uint32_t length, const CasTopology* topology)
+{
+    uint32_t section = CAS_CONFIG_SECTION_NONE;
+    uint32_t line_number = 0;
+    uint32_t position = 0;
+    CasCpuSet scratch = { 0 };
+
+    config->pair_count = 0;
+    config->text_length = 0;
+    config->period = CAS_CONFIG_DEFAULT_PERIOD;
+    config->menu_shortcut = 0;
+    config->silent_start = 0;
+    config->auto_start = 0;
+    config->drift_check = 0;
+    config->auto_pin_offset = 0;
+    config->auto_pin_length = 0;
+    config->auto_pin_line = 0;
+    config->auto_pin_threshold = CAS_CONFIG_DEFAULT_AUTO_PIN_THRESHOLD;
+    config->auto_pin_time = CAS_CONFIG_DEFAULT_AUTO_PIN_TIME;
+    config->merge = CAS_MERGE_LAST;
+
+    // NOTE: The scratch set is as wide as any mask, so where a pair splits does not depend on the CPUs of this machine.
+    if (!cas_config__grow((void**)&config->text, &config->text_capacity, length + 1, sizeof(char)) ||
+        !cas_cpu_set_alloc(&scratch, CAS_CPU_SET_MAX_CPUS))
+    {
+        return 0;
+    }
+
+    memcpy(config->text, text, length);
+    config->text[length] = '\0';
+    config->text_length = length;
+    text = config->text;
+
+    if (length >= 3 && (uint8_t)text[0] == 0xef && (uint8_t)text[1] == 0xbb && (uint8_t)text[2] == 0xbf)
+    {
+        position = 3;
+    }
+
+    while (position < length)
+    {
+        uint32_t start = position;
+        uint32_t end = position;
+
+        while (end < length && text[end] != '\n')
+        {
+            ++end;
+        }
+
+        position = end + 1;
+        ++line_number;
+        cas_config__trim(text, &start, &end);
+
+        if (start == end || text[start] == ';' || text[start] == '#')
+        {
+            continue;
+        }
+
+        if (text[start] == '[' && text[end - 1] == ']')
+        {
+            uint32_t name_start = start + 1;
+            uint32_t name_end = end - 1;
+
+            cas_config__trim(text, &name_start, &name_end);
+            section = cas_config__equals(text + name_start, name_end - name_start, CAS_CONFIG_PAIRS_SECTION) ? CAS_CONFIG_SECTION_PAIRS :
+                      cas_config__equals(text + name_start, name_end - name_start, CAS_CONFIG_SETTINGS_SECTION) ? CAS_CONFIG_SECTION_SETTINGS :
+                      CAS_CONFIG_SECTION_OTHER;
+        }
+        else if (section == CAS_CONFIG_SECTION_PAIRS)
+        {
+            uint32_t colon = start + cas_config__mask_separator(text + start, end - start, topology, &scratch);
+            uint32_t name_end = colon < end ? colon : end;
+            uint32_t mask_start = colon < end ? colon + 1 : end;
+
+            if (!cas_config__grow((void**)&config->pairs, &config->pair_capacity, config->pair_count + 1, sizeof(CasConfigPair)))
+            {
+                cas_cpu_set_free(&scratch);
+                return 0;
+            }
+
+            cas_config__trim(text, &start, &name_end);
+            cas_config__trim(text, &mask_start, &end);
+            config->pairs[config->pair_count++] = (CasConfigPair){ start, name_end - start, mask_start, end - mask_start, line_number };
+        }
+        else if (section == CAS_CONFIG_SECTION_SETTINGS)
+        {
+            uint32_t equals = start;
+            uint32_t key_end = 0;
+            unsigned long value = 0;
+
+            while (equals < end && text[equals] != '=')
+            {
+                ++equals;
+            }
+
+            key_end = equals;
+            cas_config__trim(text, &start, &key_end);
+            value = equals < end ? strtoul(text + equals + 1, 0, 10) : 0;
+
+            if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_PERIOD_KEY))
+            {
+                config->period = value > CAS_CONFIG_MAX_PERIOD ? CAS_CONFIG_MAX_PERIOD : (uint32_t)value;
+            }
+            else if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_SILENT_START_KEY))
+            {
+                config->silent_start = value != 0;
+            }
+            else if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_AUTO_START_KEY))
+            {
+                config->auto_start = value != 0;
+            }
+            else if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_MENU_SHORTCUT_KEY))
+            {
+                config->menu_shortcut = (uint32_t)value;
+            }
+            else if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_DRIFT_CHECK_KEY))
+            {
+                config->drift_check = value > CAS_CONFIG_MAX_DRIFT_CHECK ? CAS_CONFIG_MAX_DRIFT_CHECK : (uint32_t)value;
+            }
+            else if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_AUTO_PIN_KEY))
+            {
+                uint32_t mask_start = equals < end ? equals + 1 : end;
+
+                cas_config__trim(text, &mask_start, &end);
+                config->auto_pin_offset = mask_start;
+                config->auto_pin_length = end - mask_start;
+                config->auto_pin_line = line_number;
+            }
+            else if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_AUTO_PIN_THRESHOLD_KEY))
+            {
+                config->auto_pin_threshold = value > 100 ? 100 : (uint32_t)value;
+            }
+            else if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_AUTO_PIN_TIME_KEY))
+            {
+                config->auto_pin_time = value < 1 ? 1 : value > CAS_CONFIG_MAX_AUTO_PIN_TIME ? CAS_CONFIG_MAX_AUTO_PIN_TIME : (uint32_t)value;
+            }
+            else if (cas_config__equals(text + start, key_end - start, CAS_CONFIG_MERGE_KEY))
+            {
+                // NOTE: In the order of CAS_MERGE_*, anything else keeps the default.
+                static const char* merges[] = { "last", "first", "intersect", "union" };
+                uint32_t value_start = equals < end ? equals + 1 : end;
+
+                cas_config__trim(text, &value_start, &end);
+
+                for (uint32_t i = 0; i < ARRAY_COUNT(merges); ++i)
+                {
+                    if (cas_config__equals(text + value_start, end - value_start, merges[i]))
+                    {
+                        config->merge = i;
+                    }
+                }
+            }
+        }
+    }
+
+    cas_cpu_set_free(&scratch);
+
+    return 1;
+}
+
+int cas_config_resolve_mask(const CasConfig* config, uint32_t pair_index, const CasTopology* topology, CasCpuSet* set)
+{
+    const CasConfigPair* pair = config->pairs + pair_index;
+
+    return cas_config_resolve(config->text + pair->mask_offset, pair->mask_length, topology, set);
+}
+
+int cas_config_resolve_auto_pin(const CasConfig* config, const CasTopology* topology, CasCpuSet* set)
+{
+    return config->auto_pin_length && cas_config_resolve(config->text + config->auto_pin_offset, config->auto_pin_length, topology, set);
+}
+
+uint32_t cas_config_check(const CasConfig* config, const CasTopology* topology, const CasCpuSet* active_set)
+{
+    CasCpuSet affinity_mask = { 0 };
+    uint32_t bad_line = 0;
+
+    if (!cas_cpu_set_alloc(&affinity_mask, active_set->word_count * CAS_CPU_SET_WORD_BITS))
+    {
+        return config->pair_count ? config->pairs[0].line_number : 0;
+    }
+
+    for (uint32_t i = 0; i < config->pair_count && !bad_line; ++i)
+    {
+        if (!config->pairs[i].name_length || config->pairs[i].name_length >= CAS_RULE_LINE_LENGTH ||
+            !cas_config_resolve_mask(config, i, topology, &affinity_mask) || !cas_cpu_set_is_subset(&affinity_mask, active_set))
+        {
+            bad_line = config->pairs[i].line_number;
+        }
+    }
+
+    if (!bad_line && config->auto_pin_line &&
+        (!cas_config_resolve_auto_pin(config, topology, &affinity_mask) || !cas_cpu_set_is_subset(&affinity_mask, active_set)))
+    {
+        bad_line = config->auto_pin_line;
+    }
+
+    cas_cpu_set_free(&affinity_mask);
+
+    return bad_line;
+}
+
+uint32_t cas_config_add_rules(const CasConfig* config, CasEngine* engine, const CasTopology* topology, const CasCpuSet* active_set, uint32_t* bad_line)
+{
+    CasCpuSet affinity_mask = { 0 };
+    uint32_t count = 0;
+
+    *bad_line = 0;
+
+    if (!cas_cpu_set_alloc(&affinity_mask, active_set->word_count * CAS_CPU_SET_WORD_BITS))
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < config->pair_count; ++i)
+    {
+        const CasConfigPair* pair = config->pairs + i;
+        int is_added = pair->name_length &&
+                       cas_config_resolve_mask(config, i, topology, &affinity_mask) &&
+                       cas_cpu_set_is_subset(&affinity_mask, active_set) &&
+                       cas_engine_add_rule_line(engine, config->text + pair->name_offset, pair->name_length, &affinity_mask);
+
+        if (is_added)
+        {
+            ++count;
+        }
+        else if (!*bad_line)
+        {
+            *bad_line = pair->line_number;
+        }
+    }
+
+    cas_cpu_set_free(&affinity_mask);
+
+    return count;
+}
@@ -0,0 +1,86 @@
+#ifndef H_CAS_CONFIG_H
+
+#include "cas_base.h"
+#include "cas_cpuset.h"
+#include "cas_engine.h"
+#include "cas_topology.h"
+
+#define CAS_CONFIG_DEFAULT_PERIOD             (5)
+#define CAS_CONFIG_MAX_PERIOD                 (99)
+#define CAS_CONFIG_MAX_DRIFT_CHECK            (3600)
+#define CAS_CONFIG_DEFAULT_AUTO_PIN_THRESHOLD (90)
+#define CAS_CONFIG_DEFAULT_AUTO_PIN_TIME      (10)
+#define CAS_CONFIG_MAX_AUTO_PIN_TIME          (3600)
+
+// NOTE: One "name:mask" line of the pairs section, offsets into the text of the config. A line without a
+// separator has an empty mask and never passes cas_config_check.
+typedef struct
+{
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t mask_offset;
+    uint32_t mask_length;
+    uint32_t line_number;
+} CasConfigPair;
+
+// NOTE: cas.ini parsed once, read without the Windows profile API so it works headless and on Linux.
+// A parsed config is never changed, a reload parses into a new one and swaps it in whole.
+typedef struct
+{
+    char* text;
+    uint32_t text_length;
+    uint32_t text_capacity;
+    CasConfigPair* pairs;
+    uint32_t pair_count;
+    uint32_t pair_capacity;
+    uint32_t period;
+    uint32_t menu_shortcut;
+    int silent_start;
+    int auto_start;
+    // NOTE: Seconds between checks of processes that drifted off their mask before, 0 never checks pinned processes again.
+    uint32_t drift_check;
+    // NOTE: The CPUs auto-pin hands out as offsets into text like a pair mask, none turns it off. A process has to
+    // use more than auto_pin_threshold percent of a CPU for auto_pin_time seconds to get one of them.
+    uint32_t auto_pin_offset;
+    uint32_t auto_pin_length;
+    uint32_t auto_pin_line;
+    uint32_t auto_pin_threshold;
+    uint32_t auto_pin_time;
+    // NOTE: One of CAS_MERGE_*, how process rules of the same rank that match one process are combined.
+    uint32_t merge;
+} CasConfig;
+
+void cas_config_init(CasConfig* config);
+void cas_config_free(CasConfig* config);
+// NOTE: The topology is only needed to tell "name:l3:0" apart from a name ending in "l3", it may be 0.
+int cas_config_parse(CasConfig* config, const char* text, uint32_t length, const CasTopology* topology);
+int cas_config_resolve_mask(const CasConfig* config, uint32_t pair_index, const CasTopology* topology, CasCpuSet* set);
+int cas_config_is_symbolic(const char* text, uint32_t length);
+// NOTE: Resolves a mask as written in a pair, hex, a CPU list like "0-3,8" or a topology name. Empty sets fail,
+// without a topology only the first two resolve.
+int cas_config_resolve(const char* text, uint32_t length, const CasTopology* topology, CasCpuSet* set);
+// NOTE: 0 when auto-pin is off or its CPUs do not resolve.
+int cas_config_resolve_auto_pin(const CasConfig* config, const CasTopology* topology, CasCpuSet* set);
+// NOTE: 0 when every pair has a name and a mask of active CPUs and the auto-pin CPUs are active too, otherwise the
+// line of the first one that does not.
+uint32_t cas_config_check(const CasConfig* config, const CasTopology* topology, const CasCpuSet* active_set);
+// NOTE: Returns the number of rules added, pairs with a bad mask are skipped and the first one is reported in bad_line.
+uint32_t cas_config_add_rules(const CasConfig* config, CasEngine* engine, const CasTopology* topology, const CasCpuSet* active_set, uint32_t* bad_line);
+
+// NOTE: Watches the directory of the config, the file itself is often replaced rather than written in place.
+typedef struct
+{
+    // NOTE: HANDLE on Windows, file descriptor on Linux, signaled when the directory changed.
+    intptr_t wait_handle;
+    void* context;
+} CasConfigWatch;
+
+// NOTE: Per platform, cas_config_win32.c and cas_config_linux.c. Paths are UTF-8, the text read is UTF-8 as well.
+char* cas_config_read_file(const char* path, uint32_t* length);
+int cas_config_watch_start(CasConfigWatch* watch, const char* path);
+// NOTE: Drains the notifications and waits for the next ones, 1 when the config file was among them.
+int cas_config_watch_read(CasConfigWatch* watch);
+void cas_config_watch_stop(CasConfigWatch* watch);
+
+#define H_CAS_CONFIG_H
+#endif
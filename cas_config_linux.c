@@ -0,0 +1,138 @@
+#define _GNU_SOURCE
+
+#include "cas_config.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CAS_CONFIG_MAX_SIZE        (16 * 1024 * 1024)
+#define CAS_CONFIG_WATCH_MASK      (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE)
+
+typedef struct
+{
+    int inotify_fd;
+    char file_name[NAME_MAX + 1];
+} CasConfigWatchLinux;
+
+static CasConfigWatchLinux global_watch = { .inotify_fd = -1 };
+
+char* cas_config_read_file(const char* path, uint32_t* length)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat status;
+    char* text = 0;
+    size_t size = 0;
+
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    if (fstat(fd, &status) == 0 && status.st_size >= 0 && status.st_size <= CAS_CONFIG_MAX_SIZE)
+    {
+        text = malloc((size_t)status.st_size + 1);
+    }
+
+    while (text && size < (size_t)status.st_size)
+    {
+        ssize_t received = read(fd, text + size, (size_t)status.st_size - size);
+
+        if (received <= 0)
+        {
+            break;
+        }
+
+        size += (size_t)received;
+    }
+
+    close(fd);
+
+    if (text)
+    {
+        text[size] = '\0';
+        *length = (uint32_t)size;
+    }
+
+    return text;
+}
+
+int cas_config_watch_start(CasConfigWatch* watch, const char* path)
+{
+    CasConfigWatchLinux* linux_watch = &global_watch;
+    const char* slash = strrchr(path, '/');
+    char directory[PATH_MAX];
+    size_t directory_length = slash ? (size_t)(slash - path) : 0;
+
+    if (directory_length >= sizeof(directory) || strlen(slash ? slash + 1 : path) > NAME_MAX)
+    {
+        return 0;
+    }
+
+    memcpy(directory, path, directory_length);
+    directory[directory_length] = '\0';
+    strcpy(linux_watch->file_name, slash ? slash + 1 : path);
+
+    if (!slash)
+    {
+        strcpy(directory, ".");
+    }
+    else if (!directory_length)
+    {
+        strcpy(directory, "/");
+    }
+
+    linux_watch->inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (linux_watch->inotify_fd < 0 || inotify_add_watch(linux_watch->inotify_fd, directory, CAS_CONFIG_WATCH_MASK) < 0)
+    {
+        cas_config_watch_stop(watch);
+        return 0;
+    }
+
+    *watch = (CasConfigWatch){ .wait_handle = linux_watch->inotify_fd, .context = linux_watch };
+
+    return 1;
+}
+
+// NOTE: A dropped queue may have hidden a change to the file, it counts as one.
+int cas_config_watch_read(CasConfigWatch* watch)
+{
+    CasConfigWatchLinux* linux_watch = (CasConfigWatchLinux*)watch->context;
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t received = 0;
+    int result = 0;
+
+    while ((received = read(linux_watch->inotify_fd, buffer, sizeof(buffer))) > 0)
+    {
+        for (char* pointer = buffer; pointer < buffer + received;)
+        {
+            const struct inotify_event* event = (const struct inotify_event*)pointer;
+
+            if ((event->mask & IN_Q_OVERFLOW) || (event->len && !strcmp(event->name, linux_watch->file_name)))
+            {
+                result = 1;
+            }
+
+            pointer += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    return result;
+}
+
+void cas_config_watch_stop(CasConfigWatch* watch)
+{
+    CasConfigWatchLinux* linux_watch = &global_watch;
+
+    if (linux_watch->inotify_fd >= 0)
+    {
+        close(linux_watch->inotify_fd);
+        linux_watch->inotify_fd = -1;
+    }
+
+    watch->wait_handle = -1;
+    watch->context = 0;
+}
@@ -0,0 +1,207 @@
+#include "cas.h"
+#include "cas_config.h"
+
+#define CAS_CONFIG_MAX_SIZE            (16 * 1024 * 1024)
+#define CAS_CONFIG_WATCH_FILTER        (FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE)
+
+typedef struct
+{
+    HANDLE directory;
+    OVERLAPPED overlapped;
+    WCHAR file_name[MAX_PATH];
+    DWORD buffer[4096];
+} CasConfigWatchWin32;
+
+static CasConfigWatchWin32 global_watch = { .directory = INVALID_HANDLE_VALUE };
+
+// NOTE: The profile API writes cas.ini as UTF-16 when the file started out that way and in the ANSI code page
+// otherwise, both are turned into the UTF-8 the parser and the engine use. Already valid UTF-8 is kept.
+static char* cas_config__to_utf8(char* text, uint32_t* length)
+{
+    int is_utf16 = *length >= 2 && (BYTE)text[0] == 0xff && (BYTE)text[1] == 0xfe;
+    UINT code_page = MultiByteToWideChar(CP_UTF8, MB_ERR_INVALID_CHARS, text, (int)*length, 0, 0) || !*length ? CP_UTF8 : CP_ACP;
+    WCHAR* wide_text = 0;
+    int wide_length = 0;
+    char* result = 0;
+    int result_length = 0;
+
+    if (!is_utf16 && code_page == CP_UTF8)
+    {
+        return text;
+    }
+
+    if (is_utf16)
+    {
+        wide_text = (WCHAR*)(text + 2);
+        wide_length = (int)((*length - 2) / sizeof(WCHAR));
+    }
+    else
+    {
+        wide_length = MultiByteToWideChar(code_page, 0, text, (int)*length, 0, 0);
+        wide_text = malloc((size_t)wide_length * sizeof(WCHAR));
+        wide_length = wide_text ? MultiByteToWideChar(code_page, 0, text, (int)*length, wide_text, wide_length) : 0;
+    }
+
+    result_length = WideCharToMultiByte(CP_UTF8, 0, wide_text, wide_length, 0, 0, 0, 0);
+    result = wide_text ? malloc((size_t)result_length + 1) : 0;
+
+    if (result)
+    {
+        WideCharToMultiByte(CP_UTF8, 0, wide_text, wide_length, result, result_length, 0, 0);
+        result[result_length] = '\0';
+        *length = (uint32_t)result_length;
+    }
+
+    if (!is_utf16)
+    {
+        free(wide_text);
+    }
+
+    free(text);
+
+    return result;
+}
+
+char* cas_config_read_file(const char* path, uint32_t* length)
+{
+    WCHAR wide_path[MAX_PATH];
+    HANDLE file = INVALID_HANDLE_VALUE;
+    LARGE_INTEGER size = { 0 };
+    DWORD read = 0;
+    char* text = 0;
+
+    if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, wide_path, ARRAY_COUNT(wide_path)))
+    {
+        return 0;
+    }
+
+    file = CreateFileW(wide_path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return 0;
+    }
+
+    if (GetFileSizeEx(file, &size) && size.QuadPart <= CAS_CONFIG_MAX_SIZE)
+    {
+        text = malloc((size_t)size.QuadPart + 1);
+    }
+
+    if (text && !ReadFile(file, text, (DWORD)size.QuadPart, &read, 0))
+    {
+        free(text);
+        text = 0;
+    }
+
+    CloseHandle(file);
+
+    if (text)
+    {
+        text[read] = '\0';
+        *length = read;
+        text = cas_config__to_utf8(text, length);
+    }
+
+    return text;
+}
+
+static int cas_config__watch_issue(CasConfigWatchWin32* win32_watch)
+{
+    ResetEvent(win32_watch->overlapped.hEvent);
+
+    return ReadDirectoryChangesW(win32_watch->directory, win32_watch->buffer, sizeof(win32_watch->buffer), FALSE,
+                                 CAS_CONFIG_WATCH_FILTER, 0, &win32_watch->overlapped, 0) != 0;
+}
+
+int cas_config_watch_start(CasConfigWatch* watch, const char* path)
+{
+    CasConfigWatchWin32* win32_watch = &global_watch;
+    WCHAR directory[MAX_PATH];
+    WCHAR* separator = 0;
+
+    if (!MultiByteToWideChar(CP_UTF8, 0, path, -1, directory, ARRAY_COUNT(directory)))
+    {
+        return 0;
+    }
+
+    separator = wcsrchr(directory, L'\\');
+    separator = separator ? separator : wcsrchr(directory, L'/');
+
+    if (!separator)
+    {
+        return 0;
+    }
+
+    wcscpy_s(win32_watch->file_name, ARRAY_COUNT(win32_watch->file_name), separator + 1);
+    *separator = L'\0';
+
+    win32_watch->directory = CreateFileW(directory, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, 0,
+                                         OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, 0);
+    win32_watch->overlapped.hEvent = CreateEventW(0, TRUE, FALSE, 0);
+
+    if (win32_watch->directory == INVALID_HANDLE_VALUE || !win32_watch->overlapped.hEvent || !cas_config__watch_issue(win32_watch))
+    {
+        cas_config_watch_stop(watch);
+        return 0;
+    }
+
+    *watch = (CasConfigWatch){ .wait_handle = (intptr_t)win32_watch->overlapped.hEvent, .context = win32_watch };
+
+    return 1;
+}
+
+// NOTE: Zero bytes means the buffer overflowed and the changes were dropped, that counts as a change of the file.
+int cas_config_watch_read(CasConfigWatch* watch)
+{
+    CasConfigWatchWin32* win32_watch = (CasConfigWatchWin32*)watch->context;
+    DWORD received = 0;
+    int result = 0;
+
+    if (!GetOverlappedResult(win32_watch->directory, &win32_watch->overlapped, &received, FALSE))
+    {
+        cas_config__watch_issue(win32_watch);
+        return 0;
+    }
+
+    result = received == 0;
+
+    for (BYTE* pointer = (BYTE*)win32_watch->buffer; received && !result;)
+    {
+        const FILE_NOTIFY_INFORMATION* information = (const FILE_NOTIFY_INFORMATION*)pointer;
+        int name_length = (int)(information->FileNameLength / sizeof(WCHAR));
+
+        result = CompareStringOrdinal(information->FileName, name_length, win32_watch->file_name, -1, TRUE) == CSTR_EQUAL;
+
+        if (!information->NextEntryOffset)
+        {
+            break;
+        }
+
+        pointer += information->NextEntryOffset;
+    }
+
+    cas_config__watch_issue(win32_watch);
+
+    return result;
+}
+
+void cas_config_watch_stop(CasConfigWatch* watch)
+{
+    CasConfigWatchWin32* win32_watch = &global_watch;
+
+    if (win32_watch->directory != INVALID_HANDLE_VALUE)
+    {
+        CancelIoEx(win32_watch->directory, &win32_watch->overlapped);
+        CloseHandle(win32_watch->directory);
+        win32_watch->directory = INVALID_HANDLE_VALUE;
+    }
+
+    if (win32_watch->overlapped.hEvent)
+    {
+        CloseHandle(win32_watch->overlapped.hEvent);
+        win32_watch->overlapped.hEvent = 0;
+    }
+
+    watch->wait_handle = 0;
+    watch->context = 0;
+}
@@ -0,0 +1,747 @@
+#include "cas_cpuset.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#define CAS_CPU_SET_SSE2
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+#endif
+
+static uint32_t cas_cpu_set__popcount(uint64_t word)
+{
+#ifdef _MSC_VER
+    return (uint32_t)__popcnt64(word);
+#else
+    return (uint32_t)__builtin_popcountll(word);
+#endif
+}
+
+static uint32_t cas_cpu_set__lowest_bit(uint64_t word)
+{
+#ifdef _MSC_VER
+    unsigned long index = 0;
+    _BitScanForward64(&index, word);
+    return (uint32_t)index;
+#else
+    return (uint32_t)__builtin_ctzll(word);
+#endif
+}
+
+uint32_t cas_cpu_set_word_count(uint32_t cpu_count)
+{
+    return (cpu_count + CAS_CPU_SET_WORD_BITS - 1) / CAS_CPU_SET_WORD_BITS;
+}
+
+int cas_cpu_set_alloc(CasCpuSet* set, uint32_t cpu_count)
+{
+    set->word_count = cas_cpu_set_word_count(cpu_count ? cpu_count : 1);
+    set->words = calloc(set->word_count, sizeof(uint64_t));
+
+    return set->words != 0;
+}
+
+void cas_cpu_set_free(CasCpuSet* set)
+{
+    free(set->words);
+    set->words = 0;
+    set->word_count = 0;
+}
+
+void cas_cpu_set_zero(CasCpuSet* set)
+{
+    memset(set->words, 0, set->word_count * sizeof(uint64_t));
+}
+
+void cas_cpu_set_copy(CasCpuSet* destination, const CasCpuSet* source)
+{
+    ASSERT(destination->word_count == source->word_count);
+    memcpy(destination->words, source->words, source->word_count * sizeof(uint64_t));
+}
+
+void cas_cpu_set_add(CasCpuSet* set, uint32_t cpu)
+{
+    if (cpu / CAS_CPU_SET_WORD_BITS < set->word_count)
+    {
+        set->words[cpu / CAS_CPU_SET_WORD_BITS] |= 1ull << (cpu % CAS_CPU_SET_WORD_BITS);
+    }
+}
+
+void cas_cpu_set_remove(CasCpuSet* set, uint32_t cpu)
+{
+    if (cpu / CAS_CPU_SET_WORD_BITS < set->word_count)
+    {
+        set->words[cpu / CAS_CPU_SET_WORD_BITS] &= ~(1ull << (cpu % CAS_CPU_SET_WORD_BITS));
+    }
+}
+
+int cas_cpu_set_contains(const CasCpuSet* set, uint32_t cpu)
+{
+    return cpu / CAS_CPU_SET_WORD_BITS < set->word_count && ((set->words[cpu / CAS_CPU_SET_WORD_BITS] >> (cpu % CAS_CPU_SET_WORD_BITS)) & 1);
+}
+
+// NOTE: Two words per step with SSE2, the tail word (odd counts) is done on its own.
+void cas_cpu_set_or(CasCpuSet* destination, const CasCpuSet* a, const CasCpuSet* b)
+{
+    uint32_t i = 0;
+
+    ASSERT(destination->word_count == a->word_count && a->word_count == b->word_count);
+
+#ifdef CAS_CPU_SET_SSE2
+    for (; i + 2 <= a->word_count; i += 2)
+    {
+        __m128i result = _mm_or_si128(_mm_loadu_si128((const __m128i*)(a->words + i)), _mm_loadu_si128((const __m128i*)(b->words + i)));
+        _mm_storeu_si128((__m128i*)(destination->words + i), result);
+    }
+#endif
+
+    for (; i < a->word_count; ++i)
+    {
+        destination->words[i] = a->words[i] | b->words[i];
+    }
+}
+
+void cas_cpu_set_and(CasCpuSet* destination, const CasCpuSet* a, const CasCpuSet* b)
+{
+    uint32_t i = 0;
+
+    ASSERT(destination->word_count == a->word_count && a->word_count == b->word_count);
+
+#ifdef CAS_CPU_SET_SSE2
+    for (; i + 2 <= a->word_count; i += 2)
+    {
+        __m128i result = _mm_and_si128(_mm_loadu_si128((const __m128i*)(a->words + i)), _mm_loadu_si128((const __m128i*)(b->words + i)));
+        _mm_storeu_si128((__m128i*)(destination->words + i), result);
+    }
+#endif
+
+    for (; i < a->word_count; ++i)
+    {
+        destination->words[i] = a->words[i] & b->words[i];
+    }
+}
+
+// NOTE: a & ~b
+void cas_cpu_set_andnot(CasCpuSet* destination, const CasCpuSet* a, const CasCpuSet* b)
+{
+    uint32_t i = 0;
+
+    ASSERT(destination->word_count == a->word_count && a->word_count == b->word_count);
+
+#ifdef CAS_CPU_SET_SSE2
+    for (; i + 2 <= a->word_count; i += 2)
+    {
+        __m128i result = _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(b->words + i)), _mm_loadu_si128((const __m128i*)(a->words + i)));
+        _mm_storeu_si128((__m128i*)(destination->words + i), result);
+    }
+#endif
+
+    for (; i < a->word_count; ++i)
+    {
+        destination->words[i] = a->words[i] & ~b->words[i];
+    }
+}
+
+uint32_t cas_cpu_set_count(const CasCpuSet* set)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < set->word_count; ++i)
+    {
+        count += cas_cpu_set__popcount(set->words[i]);
+    }
+
+    return count;
+}
+
+uint32_t cas_cpu_set_next(const CasCpuSet* set, uint32_t cpu)
+{
+    uint32_t word_index = cpu / CAS_CPU_SET_WORD_BITS;
+
+    if (word_index < set->word_count)
+    {
+        uint64_t word = set->words[word_index] & (~0ull << (cpu % CAS_CPU_SET_WORD_BITS));
+
+        for (;;)
+        {
+            if (word)
+            {
+                return word_index * CAS_CPU_SET_WORD_BITS + cas_cpu_set__lowest_bit(word);
+            }
+
+            if (++word_index == set->word_count)
+            {
+                break;
+            }
+
+            word = set->words[word_index];
+        }
+    }
+
+    return CAS_NO_CPU;
+}
+
+int cas_cpu_set_is_empty(const CasCpuSet* set)
+{
+    uint64_t any = 0;
+
+    for (uint32_t i = 0; i < set->word_count; ++i)
+    {
+        any |= set->words[i];
+    }
+
+    return any == 0;
+}
+
+int cas_cpu_set_equal(const CasCpuSet* a, const CasCpuSet* b)
+{
+    return a->word_count == b->word_count && !memcmp(a->words, b->words, a->word_count * sizeof(uint64_t));
+}
+
+int cas_cpu_set_is_subset(const CasCpuSet* set, const CasCpuSet* of)
+{
+    uint64_t outside = 0;
+    uint32_t i = 0;
+
+    ASSERT(set->word_count == of->word_count);
+
+#ifdef CAS_CPU_SET_SSE2
+    __m128i outside_wide = _mm_setzero_si128();
+
+    for (; i + 2 <= set->word_count; i += 2)
+    {
+        outside_wide = _mm_or_si128(outside_wide, _mm_andnot_si128(_mm_loadu_si128((const __m128i*)(of->words + i)),
+                                                                   _mm_loadu_si128((const __m128i*)(set->words + i))));
+    }
+
+    outside = (uint64_t)_mm_cvtsi128_si64(_mm_or_si128(outside_wide, _mm_unpackhi_epi64(outside_wide, outside_wide)));
+#endif
+
+    for (; i < set->word_count; ++i)
+    {
+        outside |= set->words[i] & ~of->words[i];
+    }
+
+    return outside == 0;
+}
+
+int cas_cpu_set_intersects(const CasCpuSet* a, const CasCpuSet* b)
+{
+    uint64_t common = 0;
+
+    ASSERT(a->word_count == b->word_count);
+
+    for (uint32_t i = 0; i < a->word_count; ++i)
+    {
+        common |= a->words[i] & b->words[i];
+    }
+
+    return common != 0;
+}
+
+static int cas_cpu_set__hex_value(char digit)
+{
+    if (digit >= '0' && digit <= '9') return digit - '0';
+    if (digit >= 'a' && digit <= 'f') return digit - 'a' + 10;
+    if (digit >= 'A' && digit <= 'F') return digit - 'A' + 10;
+
+    return -1;
+}
+
+// NOTE: Most significant digit first like the old masks, any length as long as the set bits fit.
+int cas_cpu_set_parse_hex(CasCpuSet* set, const char* text, uint32_t length)
+{
+    cas_cpu_set_zero(set);
+
+    if (length > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X'))
+    {
+        text += 2;
+        length -= 2;
+    }
+
+    if (!length)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        int value = cas_cpu_set__hex_value(text[length - i - 1]);
+        uint32_t word_index = i / 16;
+
+        if (value < 0)
+        {
+            return 0;
+        }
+
+        if (value)
+        {
+            if (word_index >= set->word_count)
+            {
+                return 0;
+            }
+
+            set->words[word_index] |= (uint64_t)value << ((i % 16) * 4);
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: Whole words at a time, so a range over thousands of CPUs is a handful of stores. last must fit the set.
+static void cas_cpu_set__add_range(CasCpuSet* set, uint32_t first, uint32_t last)
+{
+    uint32_t first_word = first / CAS_CPU_SET_WORD_BITS;
+    uint32_t last_word = last / CAS_CPU_SET_WORD_BITS;
+    uint64_t first_mask = ~0ull << (first % CAS_CPU_SET_WORD_BITS);
+    uint64_t last_mask = ~0ull >> (CAS_CPU_SET_WORD_BITS - 1 - last % CAS_CPU_SET_WORD_BITS);
+
+    if (first_word == last_word)
+    {
+        set->words[first_word] |= first_mask & last_mask;
+        return;
+    }
+
+    set->words[first_word] |= first_mask;
+
+    for (uint32_t i = first_word + 1; i < last_word; ++i)
+    {
+        set->words[i] = ~0ull;
+    }
+
+    set->words[last_word] |= last_mask;
+}
+
+static int cas_cpu_set__is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void cas_cpu_set__skip_spaces(const char* text, uint32_t length, uint32_t* position)
+{
+    while (*position < length && cas_cpu_set__is_space(text[*position]))
+    {
+        ++*position;
+    }
+}
+
+static int cas_cpu_set__number(const char* text, uint32_t length, uint32_t* position, uint32_t* number)
+{
+    uint32_t start = *position;
+
+    *number = 0;
+
+    for (; *position < length && text[*position] >= '0' && text[*position] <= '9'; ++*position)
+    {
+        *number = *number * 10 + (uint32_t)(text[*position] - '0');
+
+        if (*number > CAS_CPU_SET_MAX_CPUS)
+        {
+            return 0;
+        }
+    }
+
+    return *position > start;
+}
+
+static int cas_cpu_set__accept(const char* text, uint32_t length, uint32_t* position, char c)
+{
+    if (*position < length && text[*position] == c)
+    {
+        ++*position;
+        return 1;
+    }
+
+    return 0;
+}
+
+// NOTE: "g:ff" ors a 64-bit word of hex into group g, the CPUs 64g to 64g + 63.
+static int cas_cpu_set__parse_group(CasCpuSet* set, uint32_t group, const char* text, uint32_t length, uint32_t* position)
+{
+    uint64_t word = 0;
+    uint32_t digit_count = 0;
+
+    if (length - *position > 2 && text[*position] == '0' && (text[*position + 1] == 'x' || text[*position + 1] == 'X'))
+    {
+        *position += 2;
+    }
+
+    for (; *position < length && cas_cpu_set__hex_value(text[*position]) >= 0; ++*position, ++digit_count)
+    {
+        word = word << 4 | (uint64_t)cas_cpu_set__hex_value(text[*position]);
+    }
+
+    if (!digit_count || digit_count > CAS_CPU_SET_WORD_BITS / 4 || (word && group >= set->word_count))
+    {
+        return 0;
+    }
+
+    if (word)
+    {
+        set->words[group] |= word;
+    }
+
+    return 1;
+}
+
+// NOTE: Terms are joined by commas. "8" is one CPU, "0-3" a range, "0-15:2" every second CPU of a range and
+// "0-15:2/4" the first two of every four like the kernel writes it. Group words as in "1:ff" can be mixed in.
+int cas_cpu_set_parse_list(CasCpuSet* set, const char* text, uint32_t length)
+{
+    uint32_t cpu_limit = set->word_count * CAS_CPU_SET_WORD_BITS;
+    uint32_t position = 0;
+
+    cas_cpu_set_zero(set);
+
+    for (;;)
+    {
+        uint32_t first = 0;
+        uint32_t last = 0;
+        uint32_t used = 1;
+        uint32_t group = 1;
+
+        cas_cpu_set__skip_spaces(text, length, &position);
+
+        if (!cas_cpu_set__number(text, length, &position, &first))
+        {
+            return 0;
+        }
+
+        if (cas_cpu_set__accept(text, length, &position, ':'))
+        {
+            if (!cas_cpu_set__parse_group(set, first, text, length, &position))
+            {
+                return 0;
+            }
+        }
+        else
+        {
+            last = first;
+
+            if (cas_cpu_set__accept(text, length, &position, '-'))
+            {
+                if (!cas_cpu_set__number(text, length, &position, &last) || last < first)
+                {
+                    return 0;
+                }
+
+                if (cas_cpu_set__accept(text, length, &position, ':'))
+                {
+                    if (!cas_cpu_set__number(text, length, &position, &group))
+                    {
+                        return 0;
+                    }
+
+                    if (cas_cpu_set__accept(text, length, &position, '/'))
+                    {
+                        used = group;
+
+                        if (!cas_cpu_set__number(text, length, &position, &group))
+                        {
+                            return 0;
+                        }
+                    }
+
+                    if (!used || used > group)
+                    {
+                        return 0;
+                    }
+                }
+            }
+
+            if (last >= cpu_limit)
+            {
+                return 0;
+            }
+
+            for (uint32_t cpu = first; cpu <= last; cpu += group)
+            {
+                cas_cpu_set__add_range(set, cpu, cpu + used - 1 < last ? cpu + used - 1 : last);
+            }
+        }
+
+        cas_cpu_set__skip_spaces(text, length, &position);
+
+        if (position == length)
+        {
+            return 1;
+        }
+
+        if (!cas_cpu_set__accept(text, length, &position, ','))
+        {
+            return 0;
+        }
+    }
+}
+
+// NOTE: Most significant bit first like the hex masks, with an optional 0b.
+int cas_cpu_set_parse_bits(CasCpuSet* set, const char* text, uint32_t length)
+{
+    cas_cpu_set_zero(set);
+
+    if (length > 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B'))
+    {
+        text += 2;
+        length -= 2;
+    }
+
+    if (!length)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        char digit = text[length - i - 1];
+
+        if (digit != '0' && digit != '1')
+        {
+            return 0;
+        }
+
+        if (digit == '1')
+        {
+            if (i / CAS_CPU_SET_WORD_BITS >= set->word_count)
+            {
+                return 0;
+            }
+
+            set->words[i / CAS_CPU_SET_WORD_BITS] |= 1ull << (i % CAS_CPU_SET_WORD_BITS);
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: Groups are written as list terms, so both read back with the list parser.
+int cas_cpu_set_parse(CasCpuSet* set, uint32_t format, const char* text, uint32_t length)
+{
+    if (format == CAS_CPU_SET_FORMAT_HEX)
+    {
+        return cas_cpu_set_parse_hex(set, text, length);
+    }
+
+    if (format == CAS_CPU_SET_FORMAT_BITS)
+    {
+        return cas_cpu_set_parse_bits(set, text, length);
+    }
+
+    return (format == CAS_CPU_SET_FORMAT_LIST || format == CAS_CPU_SET_FORMAT_GROUPS) && cas_cpu_set_parse_list(set, text, length);
+}
+
+uint32_t cas_cpu_set_format_hex(const CasCpuSet* set, char* text, uint32_t capacity)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    uint32_t length = 0;
+    uint32_t digit_count = set->word_count * 16;
+
+    // NOTE: Skip leading zero digits but always print at least one.
+    while (digit_count > 1 && !((set->words[(digit_count - 1) / 16] >> (((digit_count - 1) % 16) * 4)) & 0xf))
+    {
+        --digit_count;
+    }
+
+    if (digit_count + 1 > capacity)
+    {
+        if (capacity)
+        {
+            text[0] = '\0';
+        }
+
+        return 0;
+    }
+
+    for (uint32_t i = digit_count; i > 0; --i)
+    {
+        text[length++] = digits[(set->words[(i - 1) / 16] >> (((i - 1) % 16) * 4)) & 0xf];
+    }
+
+    text[length] = '\0';
+
+    return length;
+}
+
+static int cas_cpu_set__append(char* text, uint32_t capacity, uint32_t* length, char separator, uint32_t number)
+{
+    char digits[10];
+    uint32_t digit_count = 0;
+
+    for (;;)
+    {
+        digits[digit_count++] = (char)('0' + number % 10);
+        number /= 10;
+
+        if (!number)
+        {
+            break;
+        }
+    }
+
+    if (*length + (separator != 0) + digit_count + 1 > capacity)
+    {
+        return 0;
+    }
+
+    if (separator)
+    {
+        text[(*length)++] = separator;
+    }
+
+    while (digit_count)
+    {
+        text[(*length)++] = digits[--digit_count];
+    }
+
+    return 1;
+}
+
+// NOTE: Runs are written as ranges, and a lone CPU followed by at least two more at the same distance as a
+// stride, so the SMT siblings of a machine come out as "0-14:2". An empty set is an empty list.
+uint32_t cas_cpu_set_format_list(const CasCpuSet* set, char* text, uint32_t capacity)
+{
+    uint32_t length = 0;
+    int is_fit = capacity > 0;
+
+    for (uint32_t cpu = cas_cpu_set_next(set, 0); cpu != CAS_NO_CPU && is_fit; cpu = cas_cpu_set_next(set, cpu))
+    {
+        uint32_t last = cpu;
+        uint32_t stride = 0;
+        uint32_t next = 0;
+
+        while (cas_cpu_set_contains(set, last + 1))
+        {
+            ++last;
+        }
+
+        next = cas_cpu_set_next(set, last + 1);
+
+        if (last == cpu && next != CAS_NO_CPU)
+        {
+            uint32_t count = 1;
+
+            stride = next - cpu;
+
+            while (cas_cpu_set_next(set, last + 1) == last + stride && !cas_cpu_set_contains(set, last + stride + 1))
+            {
+                last += stride;
+                ++count;
+            }
+
+            if (count < 3)
+            {
+                last = cpu;
+                stride = 0;
+            }
+        }
+
+        is_fit = cas_cpu_set__append(text, capacity, &length, length ? ',' : 0, cpu) &&
+                 (last == cpu || cas_cpu_set__append(text, capacity, &length, '-', last)) &&
+                 (!stride || cas_cpu_set__append(text, capacity, &length, ':', stride));
+        cpu = last + 1;
+    }
+
+    if (!is_fit)
+    {
+        length = 0;
+    }
+
+    if (capacity)
+    {
+        text[length] = '\0';
+    }
+
+    return length;
+}
+
+// NOTE: One "g:hex" term per group that has CPUs in it, "0:0" for an empty set.
+uint32_t cas_cpu_set_format_groups(const CasCpuSet* set, char* text, uint32_t capacity)
+{
+    uint32_t length = 0;
+    int is_fit = capacity > 0;
+    int is_empty = cas_cpu_set_is_empty(set);
+
+    for (uint32_t i = 0; i < set->word_count && is_fit; ++i)
+    {
+        if (set->words[i] || (is_empty && !i))
+        {
+            CasCpuSet word = { set->words + i, 1 };
+            uint32_t hex_length = 0;
+
+            is_fit = cas_cpu_set__append(text, capacity, &length, length ? ',' : 0, i) && length + 1 < capacity;
+
+            if (is_fit)
+            {
+                text[length++] = ':';
+                hex_length = cas_cpu_set_format_hex(&word, text + length, capacity - length);
+                length += hex_length;
+                is_fit = hex_length != 0;
+            }
+        }
+    }
+
+    if (!is_fit)
+    {
+        length = 0;
+    }
+
+    if (capacity)
+    {
+        text[length] = '\0';
+    }
+
+    return length;
+}
+
+uint32_t cas_cpu_set_format_bits(const CasCpuSet* set, char* text, uint32_t capacity)
+{
+    uint32_t length = 0;
+    uint32_t bit_count = set->word_count * CAS_CPU_SET_WORD_BITS;
+
+    // NOTE: Skip leading zero bits but always print at least one.
+    while (bit_count > 1 && !cas_cpu_set_contains(set, bit_count - 1))
+    {
+        --bit_count;
+    }
+
+    if (bit_count + 1 > capacity)
+    {
+        if (capacity)
+        {
+            text[0] = '\0';
+        }
+
+        return 0;
+    }
+
+    for (uint32_t i = bit_count; i > 0; --i)
+    {
+        text[length++] = cas_cpu_set_contains(set, i - 1) ? '1' : '0';
+    }
+
+    text[length] = '\0';
+
+    return length;
+}
+
+uint32_t cas_cpu_set_format(const CasCpuSet* set, uint32_t format, char* text, uint32_t capacity)
+{
+    if (format == CAS_CPU_SET_FORMAT_LIST)
+    {
+        return cas_cpu_set_format_list(set, text, capacity);
+    }
+
+    if (format == CAS_CPU_SET_FORMAT_GROUPS)
+    {
+        return cas_cpu_set_format_groups(set, text, capacity);
+    }
+
+    if (format == CAS_CPU_SET_FORMAT_BITS)
+    {
+        return cas_cpu_set_format_bits(set, text, capacity);
+    }
+
+    return cas_cpu_set_format_hex(set, text, capacity);
+}
@@ -0,0 +1,56 @@
+#ifndef H_CAS_CPUSET_H
+
+#include "cas_base.h"
+
+#define CAS_CPU_SET_WORD_BITS   (64)
+#define CAS_CPU_SET_MAX_CPUS    (4096)
+#define CAS_NO_CPU              (0xffffffff)
+
+#define CAS_CPU_SET_FORMAT_LIST    (0)
+#define CAS_CPU_SET_FORMAT_HEX     (1)
+#define CAS_CPU_SET_FORMAT_GROUPS  (2)
+#define CAS_CPU_SET_FORMAT_BITS    (3)
+
+// NOTE: A view over word_count 64-bit words, CPU n is bit n % 64 of word n / 64.
+// Binary operations expect sets of the same width.
+typedef struct
+{
+    uint64_t* words;
+    uint32_t word_count;
+} CasCpuSet;
+
+uint32_t cas_cpu_set_word_count(uint32_t cpu_count);
+int cas_cpu_set_alloc(CasCpuSet* set, uint32_t cpu_count);
+void cas_cpu_set_free(CasCpuSet* set);
+
+void cas_cpu_set_zero(CasCpuSet* set);
+void cas_cpu_set_copy(CasCpuSet* destination, const CasCpuSet* source);
+void cas_cpu_set_add(CasCpuSet* set, uint32_t cpu);
+void cas_cpu_set_remove(CasCpuSet* set, uint32_t cpu);
+int cas_cpu_set_contains(const CasCpuSet* set, uint32_t cpu);
+
+void cas_cpu_set_or(CasCpuSet* destination, const CasCpuSet* a, const CasCpuSet* b);
+void cas_cpu_set_and(CasCpuSet* destination, const CasCpuSet* a, const CasCpuSet* b);
+void cas_cpu_set_andnot(CasCpuSet* destination, const CasCpuSet* a, const CasCpuSet* b);
+
+uint32_t cas_cpu_set_count(const CasCpuSet* set);
+uint32_t cas_cpu_set_next(const CasCpuSet* set, uint32_t cpu);
+int cas_cpu_set_is_empty(const CasCpuSet* set);
+int cas_cpu_set_equal(const CasCpuSet* a, const CasCpuSet* b);
+int cas_cpu_set_is_subset(const CasCpuSet* set, const CasCpuSet* of);
+int cas_cpu_set_intersects(const CasCpuSet* a, const CasCpuSet* b);
+
+// NOTE: Parsers fail on anything malformed and on CPUs past the width of the set, formatters return the length
+// without the terminator and 0 when the text does not fit the capacity.
+int cas_cpu_set_parse_hex(CasCpuSet* set, const char* text, uint32_t length);
+int cas_cpu_set_parse_list(CasCpuSet* set, const char* text, uint32_t length);
+int cas_cpu_set_parse_bits(CasCpuSet* set, const char* text, uint32_t length);
+int cas_cpu_set_parse(CasCpuSet* set, uint32_t format, const char* text, uint32_t length);
+uint32_t cas_cpu_set_format_hex(const CasCpuSet* set, char* text, uint32_t capacity);
+uint32_t cas_cpu_set_format_list(const CasCpuSet* set, char* text, uint32_t capacity);
+uint32_t cas_cpu_set_format_groups(const CasCpuSet* set, char* text, uint32_t capacity);
+uint32_t cas_cpu_set_format_bits(const CasCpuSet* set, char* text, uint32_t capacity);
+uint32_t cas_cpu_set_format(const CasCpuSet* set, uint32_t format, char* text, uint32_t capacity);
+
+#define H_CAS_CPUSET_H
+#endif
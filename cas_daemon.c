@@ -0,0 +1,437 @@
+#include "cas_daemon.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+#include <stdarg.h>
+#include <stdio.h>
+#include <time.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#define CAS_DAEMON_SECONDS_TO_MILLISECONDS  (1000)
+
+static void cas_daemon__discover(CasDaemon* daemon)
+{
+    daemon->topology_signature = cas_topology_signature();
+
+    if (!cas_topology_discover(&daemon->topology, daemon->backend.cpu_count))
+    {
+        cas_daemon_log(daemon, "no CPU topology, only hex masks resolve");
+    }
+}
+
+static const CasTopology* cas_daemon__topology(CasDaemon* daemon)
+{
+    return daemon->topology.cpu_count ? &daemon->topology : 0;
+}
+
+// NOTE: Masks are resolved against the topology of the moment, a hex mask outside the active CPUs skips its pair
+// and auto-pin CPUs outside them turn auto-pin off.
+static int cas_daemon__load_rules(CasDaemon* daemon)
+{
+    CasCpuSet active_set = { 0 };
+    CasCpuSet auto_pin_set = { 0 };
+    uint32_t bad_line = 0;
+    uint32_t rule_count = 0;
+    int is_auto_pinned = 0;
+
+    if (!cas_cpu_set_alloc(&active_set, daemon->backend.cpu_count) || !cas_cpu_set_alloc(&auto_pin_set, daemon->backend.cpu_count))
+    {
+        cas_cpu_set_free(&active_set);
+        return 0;
+    }
+
+    daemon->backend.active_cpus(&daemon->backend, &active_set);
+    cas_engine_clear_rules(&daemon->engine);
+    rule_count = cas_config_add_rules(&daemon->config, &daemon->engine, cas_daemon__topology(daemon), &active_set, &bad_line);
+    cas_engine_set_merge(&daemon->engine, daemon->config.merge);
+    cas_engine_build_index(&daemon->engine);
+    is_auto_pinned = cas_config_resolve_auto_pin(&daemon->config, cas_daemon__topology(daemon), &auto_pin_set) &&
+                     cas_cpu_set_is_subset(&auto_pin_set, &active_set);
+    cas_engine_set_auto_pin(&daemon->engine, is_auto_pinned ? &auto_pin_set : 0, daemon->config.auto_pin_threshold,
+                            daemon->config.auto_pin_time * daemon->backend.clock_frequency);
+    cas_cpu_set_free(&active_set);
+
+    if (bad_line)
+    {
+        cas_daemon_log(daemon, "%s:%u: %u pair(s) skipped, the first here, for a malformed mask or CPUs that are not active",
+                       daemon->options.config_path, bad_line, daemon->config.pair_count - rule_count);
+    }
+
+    cas_daemon_log(daemon, "%u rule(s) loaded from %s", rule_count, daemon->options.config_path);
+
+    if (daemon->engine.isolation_rule_count)
+    {
+        CasCpuSet reserved = cas_engine_isolation_mask(&daemon->engine);
+        char reserved_text[CAS_CPU_SET_MAX_CPUS / 4 + 1];
+
+        cas_cpu_set_format_hex(&reserved, reserved_text, sizeof(reserved_text));
+        cas_daemon_log(daemon, "CPUs 0x%s reserved by %u isolating rule(s), other processes are moved off them", reserved_text,
+                       daemon->engine.isolation_rule_count);
+    }
+
+    if (daemon->engine.auto_pin_threshold)
+    {
+        char auto_pin_text[CAS_CPU_SET_MAX_CPUS / 4 + 1];
+
+        cas_cpu_set_format_hex(&auto_pin_set, auto_pin_text, sizeof(auto_pin_text));
+        cas_daemon_log(daemon, "CPUs 0x%s handed out by auto-pin to processes over %u%% of a CPU for %u s", auto_pin_text,
+                       daemon->config.auto_pin_threshold, daemon->config.auto_pin_time);
+    }
+    else if (daemon->config.auto_pin_line)
+    {
+        cas_daemon_log(daemon, "%s:%u: auto-pin off for a malformed mask or CPUs that are not active", daemon->options.config_path,
+                       daemon->config.auto_pin_line);
+    }
+
+    cas_cpu_set_free(&auto_pin_set);
+
+    return 1;
+}
+
+static void cas_daemon__set_period(CasDaemon* daemon)
+{
+    // NOTE: Same as the tray, with kernel process events the poll timer only fires once for what is already running,
+    // without them the period is the longest wait between polls.
+    cas_poll_schedule_init(&daemon->poll_schedule, daemon->has_kernel_source ? 0 : daemon->config.period * CAS_DAEMON_SECONDS_TO_MILLISECONDS,
+                           daemon->config.drift_check * CAS_DAEMON_SECONDS_TO_MILLISECONDS,
+                           daemon->engine.auto_pin_threshold ? daemon->config.auto_pin_time * CAS_DAEMON_SECONDS_TO_MILLISECONDS : 0);
+    cas_engine_set_drift_check(&daemon->engine, daemon->config.drift_check != 0);
+    cas_event_source_poll_set_period(&daemon->poll_source, 0);
+}
+
+// NOTE: Drifts past the engine log size since the last tick are only counted.
+static void cas_daemon__log_drifts(CasDaemon* daemon)
+{
+    CasEngine* engine = &daemon->engine;
+    uint64_t words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    CasCpuSet found = { words, engine->cpu_word_count };
+    char set_text[CAS_CPU_SET_MAX_CPUS / 4 + 1];
+    char found_text[CAS_CPU_SET_MAX_CPUS / 4 + 1];
+
+    if (engine->drift_total - daemon->drift_logged > CAS_DRIFT_LOG_SIZE)
+    {
+        cas_daemon_log(daemon, "%u drift(s) not logged", engine->drift_total - daemon->drift_logged - CAS_DRIFT_LOG_SIZE);
+        daemon->drift_logged = engine->drift_total - CAS_DRIFT_LOG_SIZE;
+    }
+
+    for (; daemon->drift_logged != engine->drift_total; ++daemon->drift_logged)
+    {
+        const CasDrift* drift = cas_engine_drift(engine, daemon->drift_logged, &found);
+        CasCpuSet affinity_mask = cas_engine_match_mask(engine, drift->rule_set, drift->rule_index);
+        const CasRuleDrift* rule_drift = engine->rule_drifts + drift->rule_index;
+
+        cas_cpu_set_format_hex(&affinity_mask, set_text, sizeof(set_text));
+        cas_cpu_set_format_hex(&found, found_text, sizeof(found_text));
+        cas_daemon_log(daemon, "pid %u (%s) moved from 0x%s to 0x%s at most %llu ms ago, pinned again, %u of %u check(s) of the rule found a drift",
+                       drift->pid, cas_engine_rule_name(engine, drift->rule_index), set_text, found_text,
+                       (unsigned long long)drift->duration_milliseconds, rule_drift->drifts, rule_drift->checks);
+    }
+}
+
+// NOTE: Pins that failed are not logged, a protected or short lived process would come back every auto-pin time.
+static void cas_daemon__log_auto_pins(CasDaemon* daemon, const CasProcessTable* table)
+{
+    const CasEngine* engine = &daemon->engine;
+
+    for (uint32_t i = 0; i < engine->auto_pin_count; ++i)
+    {
+        const CasAutoPin* auto_pin = engine->auto_pins + i;
+        const CasProcess* process = table->processes + auto_pin->process_index;
+
+        if (auto_pin->is_release)
+        {
+            cas_daemon_log(daemon, "pid %u (%s) gave CPU %u back", process->pid, process->name, auto_pin->cpu);
+        }
+        else if (auto_pin->status == CAS_STATUS_PINNED)
+        {
+            cas_daemon_log(daemon, "pid %u (%s) ran hot, auto-pinned to CPU %u", process->pid, process->name, auto_pin->cpu);
+        }
+    }
+}
+
+int cas_daemon_parse_arguments(CasDaemonOptions* options, int argument_count, char** arguments)
+{
+    memset(options, 0, sizeof(*options));
+
+    for (int i = 1; i < argument_count; ++i)
+    {
+        if (!strcmp(arguments[i], "--log") && i + 1 < argument_count)
+        {
+            options->log_path = arguments[++i];
+        }
+        else if (!strcmp(arguments[i], "--service"))
+        {
+            options->is_service = 1;
+        }
+        else if (!strcmp(arguments[i], "--daemon"))
+        {
+            options->is_background = 1;
+        }
+        else if (!strcmp(arguments[i], "--headless"))
+        {
+            continue;
+        }
+        else if (arguments[i][0] != '-' && !options->config_path)
+        {
+            options->config_path = arguments[i];
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    return options->config_path != 0;
+}
+
+void cas_daemon_log(CasDaemon* daemon, const char* format, ...)
+{
+    char text[CAS_DAEMON_MAX_LOG_LENGTH];
+    time_t now = time(0);
+    size_t length = strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S ", localtime(&now));
+    va_list arguments;
+    int written = 0;
+
+    va_start(arguments, format);
+    written = vsnprintf(text + length, sizeof(text) - length - 1, format, arguments);
+    va_end(arguments);
+
+    if (written > 0)
+    {
+        length += (size_t)written < sizeof(text) - length - 1 ? (size_t)written : sizeof(text) - length - 2;
+    }
+
+    text[length++] = '\n';
+    cas_daemon_write_log(daemon, text, (uint32_t)length);
+}
+
+int cas_daemon_start(CasDaemon* daemon)
+{
+    uint32_t length = 0;
+    char* text = 0;
+    int result = 0;
+
+    if (!cas_backend_native(&daemon->backend))
+    {
+        cas_daemon_log(daemon, "no affinity backend on this system");
+        return 0;
+    }
+
+    cas_engine_init(&daemon->engine);
+    cas_engine_set_cpu_count(&daemon->engine, daemon->backend.cpu_count);
+    cas_config_init(&daemon->config);
+    cas_daemon__discover(daemon);
+
+    text = cas_config_read_file(daemon->options.config_path, &length);
+    result = text && cas_config_parse(&daemon->config, text, length, cas_daemon__topology(daemon));
+    free(text);
+
+    if (!result)
+    {
+        cas_daemon_log(daemon, "cannot read %s", daemon->options.config_path);
+        return 0;
+    }
+
+    if (!cas_daemon__load_rules(daemon) || !cas_event_source_poll(&daemon->poll_source))
+    {
+        cas_daemon_log(daemon, "not enough memory or no timer to poll with");
+        return 0;
+    }
+
+    daemon->has_kernel_source = cas_event_source_kernel(&daemon->kernel_source) && daemon->kernel_source.start(&daemon->kernel_source);
+    daemon->has_exit_source = !daemon->has_kernel_source && cas_event_source_exits(&daemon->exit_source) &&
+                              daemon->exit_source.start(&daemon->exit_source);
+    daemon->backend.exits = daemon->has_exit_source ? &daemon->exit_source : 0;
+    daemon->stats = cas_stats_map(1);
+    daemon->backend.stats = daemon->stats ? cas_stats_claim(daemon->stats) : 0;
+
+    if (!cas_backend_pool_start(&daemon->backend, &daemon->apply_pool, daemon->stats))
+    {
+        cas_daemon_log(daemon, "not every apply thread started, %u running", daemon->apply_pool.pool.thread_count);
+    }
+
+    daemon->has_config_watch = cas_config_watch_start(&daemon->config_watch, daemon->options.config_path);
+    cas_daemon__set_period(daemon);
+
+    if (!daemon->has_config_watch)
+    {
+        cas_daemon_log(daemon, "cannot watch %s, edits need a restart", daemon->options.config_path);
+    }
+
+    if (daemon->has_kernel_source)
+    {
+        cas_daemon_log(daemon, "started on %u CPU(s) with kernel process events", daemon->backend.cpu_count);
+    }
+    else
+    {
+        cas_daemon_log(daemon, "started on %u CPU(s), polling every %u ms to %u s%s", daemon->backend.cpu_count, CAS_POLL_MIN_DELAY, daemon->config.period,
+                       daemon->has_exit_source ? ", pinned processes report their exit" : "");
+    }
+
+    return 1;
+}
+
+void cas_daemon_handle_events(CasDaemon* daemon, CasEventSource* source)
+{
+    CasEngine* engine = &daemon->engine;
+    uint64_t start = cas_daemon_microseconds();
+    uint32_t processes = 0;
+    uint32_t delay = 0;
+    int sweep = cas_backend_read_events(&daemon->backend, engine, source, &daemon->event_table);
+
+    // NOTE: CPUs or nodes came or went, symbolic masks may cover different CPUs now.
+    if (cas_topology_signature() != daemon->topology_signature)
+    {
+        cas_daemon_log(daemon, "CPU topology changed, resolving masks again");
+        cas_daemon__discover(daemon);
+        sweep = cas_daemon__load_rules(daemon) || sweep;
+    }
+
+    if (sweep)
+    {
+        cas_backend_sweep(&daemon->backend, engine, &daemon->process_table);
+        processes = daemon->process_table.count;
+
+        // NOTE: A sweep for an exit counts as a poll, the next one is scheduled from it.
+        if (source != &daemon->kernel_source)
+        {
+            delay = cas_poll_schedule_next(&daemon->poll_schedule, cas_engine_is_busy(engine));
+        }
+
+        delay = cas_poll_schedule_drift(&daemon->poll_schedule, delay, cas_engine_has_drifted(engine));
+        delay = cas_poll_schedule_sample(&daemon->poll_schedule, delay);
+        cas_daemon__log_auto_pins(daemon, &daemon->process_table);
+
+        if (delay)
+        {
+            cas_event_source_poll_set_delay(&daemon->poll_source, delay);
+        }
+    }
+    else if (daemon->event_table.count && cas_engine_match(engine, &daemon->event_table))
+    {
+        cas_backend_apply(&daemon->backend, engine, &daemon->event_table);
+        cas_daemon__log_auto_pins(daemon, &daemon->event_table);
+        processes = daemon->event_table.count;
+    }
+
+    // NOTE: Polling already comes back soon while matches are left, kernel events need the poll timer fired for them.
+    if (daemon->has_kernel_source && processes && !cas_engine_is_applied(engine))
+    {
+        cas_event_source_poll_set_delay(&daemon->poll_source, CAS_POLL_MIN_DELAY);
+    }
+
+    cas_stats_tick(daemon->backend.stats, cas_daemon_microseconds() - start, processes, processes ? engine->match_count : 0);
+    cas_daemon__log_drifts(daemon);
+}
+
+// NOTE: The edited file is parsed into a config of its own and only replaces the running one when every pair in it
+// checks out, a half saved or mistyped file leaves the previous rules in place.
+void cas_daemon_reload_config(CasDaemon* daemon)
+{
+    CasConfig config;
+    CasCpuSet active_set = { 0 };
+    uint32_t length = 0;
+    uint32_t bad_line = 0;
+    char* text = 0;
+    int result = 0;
+
+    if (!cas_config_watch_read(&daemon->config_watch))
+    {
+        return;
+    }
+
+    text = cas_config_read_file(daemon->options.config_path, &length);
+
+    if (!text || (length == daemon->config.text_length && !memcmp(text, daemon->config.text, length)))
+    {
+        free(text);
+        return;
+    }
+
+    cas_config_init(&config);
+    result = cas_config_parse(&config, text, length, cas_daemon__topology(daemon)) && cas_cpu_set_alloc(&active_set, daemon->backend.cpu_count);
+    free(text);
+
+    if (result)
+    {
+        daemon->backend.active_cpus(&daemon->backend, &active_set);
+        bad_line = cas_config_check(&config, cas_daemon__topology(daemon), &active_set);
+        cas_cpu_set_free(&active_set);
+    }
+
+    if (!result || bad_line)
+    {
+        cas_daemon_log(daemon, "%s:%u: edit not applied, keeping the previous config", daemon->options.config_path, bad_line);
+        cas_config_free(&config);
+        return;
+    }
+
+    cas_config_free(&daemon->config);
+    daemon->config = config;
+    cas_daemon_log(daemon, "%s changed, reloading", daemon->options.config_path);
+    cas_daemon__load_rules(daemon);
+    // NOTE: Also fires the poll timer once, the new rules are applied by that sweep.
+    cas_daemon__set_period(daemon);
+}
+
+void cas_daemon_stop(CasDaemon* daemon)
+{
+    if (daemon->has_config_watch)
+    {
+        cas_config_watch_stop(&daemon->config_watch);
+        daemon->has_config_watch = 0;
+    }
+
+    if (daemon->has_kernel_source)
+    {
+        daemon->kernel_source.stop(&daemon->kernel_source);
+    }
+
+    if (daemon->has_exit_source)
+    {
+        daemon->exit_source.stop(&daemon->exit_source);
+        daemon->backend.exits = 0;
+    }
+
+    daemon->poll_source.stop(&daemon->poll_source);
+
+    // NOTE: Without rules every evicted process is moved back, sweeps go on until the budget left none behind.
+    // Auto-pinned processes get their masks back on the first of them.
+    if (daemon->engine.isolation_rule_count || cas_engine_has_auto_pins(&daemon->engine))
+    {
+        uint32_t isolation_rule_count = daemon->engine.isolation_rule_count;
+
+        cas_engine_set_auto_pin(&daemon->engine, 0, 0, 0);
+        cas_engine_clear_rules(&daemon->engine);
+        cas_engine_build_index(&daemon->engine);
+
+        while (cas_backend_sweep(&daemon->backend, &daemon->engine, &daemon->process_table))
+        {
+            cas_daemon__log_auto_pins(daemon, &daemon->process_table);
+
+            if (cas_engine_is_applied(&daemon->engine))
+            {
+                break;
+            }
+        }
+
+        if (isolation_rule_count)
+        {
+            cas_daemon_log(daemon, "isolation undone");
+        }
+    }
+
+    cas_backend_pool_stop(&daemon->backend, &daemon->apply_pool);
+
+    if (daemon->stats)
+    {
+        cas_stats_unmap(daemon->stats);
+        daemon->stats = 0;
+        daemon->backend.stats = 0;
+    }
+
+    cas_daemon_log(daemon, "stopped");
+}
@@ -0,0 +1,68 @@
+#ifndef H_CAS_DAEMON_H
+
+#include "cas_base.h"
+#include "cas_backend.h"
+#include "cas_config.h"
+#include "cas_events.h"
+#include "cas_stats.h"
+#include "cas_topology.h"
+
+#define CAS_DAEMON_MAX_LOG_LENGTH  (1024)
+
+// NOTE: --service runs under the Windows service control manager, --daemon detaches from the terminal on Linux.
+// Without --log messages go to stderr.
+typedef struct
+{
+    const char* config_path;
+    const char* log_path;
+    int is_service;
+    int is_background;
+} CasDaemonOptions;
+
+// NOTE: Headless cas, only the engine and a backend. Nothing here creates a window, touches COM or the shell.
+typedef struct
+{
+    CasDaemonOptions options;
+    CasBackend backend;
+    CasBackendPool apply_pool;
+    CasEngine engine;
+    CasProcessTable process_table;
+    CasProcessTable event_table;
+    CasEventSource poll_source;
+    CasEventSource kernel_source;
+    int has_kernel_source;
+    // NOTE: Only without kernel events, those already report every exit.
+    CasEventSource exit_source;
+    int has_exit_source;
+    CasPollSchedule poll_schedule;
+    CasTopology topology;
+    uint64_t topology_signature;
+    CasConfig config;
+    CasConfigWatch config_watch;
+    int has_config_watch;
+    CasStats* stats;
+    // NOTE: Drifts of the engine log already written to ours.
+    uint32_t drift_logged;
+    // NOTE: HANDLE on Windows, file descriptor on Linux, like an event source wait handle.
+    intptr_t log_handle;
+} CasDaemon;
+
+int cas_daemon_parse_arguments(CasDaemonOptions* options, int argument_count, char** arguments);
+void cas_daemon_log(CasDaemon* daemon, const char* format, ...);
+int cas_daemon_start(CasDaemon* daemon);
+void cas_daemon_handle_events(CasDaemon* daemon, CasEventSource* source);
+// NOTE: Called when the config watch is signaled.
+void cas_daemon_reload_config(CasDaemon* daemon);
+void cas_daemon_stop(CasDaemon* daemon);
+
+// NOTE: Per platform, cas_daemon_win32.c and cas_daemon_linux.c.
+void cas_daemon_write_log(CasDaemon* daemon, const char* text, uint32_t length);
+uint64_t cas_daemon_microseconds(void);
+
+#ifdef _WIN32
+// NOTE: cas.exe hands --headless and --service runs over before any window exists.
+int cas_daemon_main(int argument_count, wchar_t** arguments);
+#endif
+
+#define H_CAS_DAEMON_H
+#endif
@@ -0,0 +1,128 @@
+#define _GNU_SOURCE
+
+#include "cas_daemon.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/signalfd.h>
+#include <time.h>
+#include <unistd.h>
+
+static CasDaemon global_daemon;
+
+void cas_daemon_write_log(CasDaemon* daemon, const char* text, uint32_t length)
+{
+    ssize_t written = write((int)daemon->log_handle, text, length);
+
+    (void)written;
+}
+
+uint64_t cas_daemon_microseconds(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_nsec / 1000u;
+}
+
+// NOTE: casd <config> [--log <file>] [--daemon]. Runs in the foreground until SIGINT or SIGTERM, --daemon detaches first.
+// The config path is made absolute before that since a daemon leaves its working directory.
+int main(int argc, char** argv)
+{
+    CasDaemon* cas_daemon = &global_daemon;
+    char* config_path = 0;
+    sigset_t signals;
+    int signal_fd = -1;
+
+    if (!cas_daemon_parse_arguments(&cas_daemon->options, argc, argv) || cas_daemon->options.is_service)
+    {
+        fprintf(stderr, "usage: %s <cas.ini> [--log <file>] [--daemon]\n", argv[0]);
+        return 2;
+    }
+
+    cas_daemon->log_handle = STDERR_FILENO;
+
+    if (cas_daemon->options.log_path)
+    {
+        int log_fd = open(cas_daemon->options.log_path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+
+        if (log_fd < 0)
+        {
+            fprintf(stderr, "cannot open %s: %s\n", cas_daemon->options.log_path, strerror(errno));
+            return 1;
+        }
+
+        cas_daemon->log_handle = log_fd;
+    }
+
+    config_path = realpath(cas_daemon->options.config_path, 0);
+    cas_daemon->options.config_path = config_path ? config_path : cas_daemon->options.config_path;
+
+    if (cas_daemon->options.is_background && daemon(0, cas_daemon->options.log_path == 0) < 0)
+    {
+        cas_daemon_log(cas_daemon, "cannot detach: %s", strerror(errno));
+        return 1;
+    }
+
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigprocmask(SIG_BLOCK, &signals, 0);
+    signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+    if (signal_fd < 0 || !cas_daemon_start(cas_daemon))
+    {
+        return 1;
+    }
+
+    for (;;)
+    {
+        CasEventSource* sources[3] = { &cas_daemon->poll_source, &cas_daemon->kernel_source, &cas_daemon->exit_source };
+        struct pollfd fds[5] =
+        {
+            { .fd = signal_fd, .events = POLLIN },
+            { .fd = (int)cas_daemon->poll_source.wait_handle, .events = POLLIN },
+            { .fd = cas_daemon->has_kernel_source ? (int)cas_daemon->kernel_source.wait_handle : -1, .events = POLLIN },
+            { .fd = cas_daemon->has_exit_source ? (int)cas_daemon->exit_source.wait_handle : -1, .events = POLLIN },
+            { .fd = cas_daemon->has_config_watch ? (int)cas_daemon->config_watch.wait_handle : -1, .events = POLLIN },
+        };
+
+        if (poll(fds, ARRAY_COUNT(fds), -1) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+
+            break;
+        }
+
+        if (fds[0].revents)
+        {
+            break;
+        }
+
+        for (uint32_t i = 0; i < ARRAY_COUNT(sources); ++i)
+        {
+            if (fds[i + 1].revents)
+            {
+                cas_daemon_handle_events(cas_daemon, sources[i]);
+            }
+        }
+
+        if (fds[4].revents)
+        {
+            cas_daemon_reload_config(cas_daemon);
+        }
+    }
+
+    cas_daemon_stop(cas_daemon);
+    close(signal_fd);
+    free(config_path);
+
+    return 0;
+}
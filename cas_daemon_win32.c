@@ -0,0 +1,218 @@
+#include "cas.h"
+#include "cas_daemon.h"
+
+#define CAS_DAEMON_SERVICE_NAME      (L"cas")
+#define CAS_DAEMON_STOP_WAIT_HINT    (3000)
+
+static CasDaemon global_daemon;
+static HANDLE global_stop_event;
+static SERVICE_STATUS_HANDLE global_service_status;
+
+void cas_daemon_write_log(CasDaemon* daemon, const char* text, uint32_t length)
+{
+    HANDLE handle = (HANDLE)daemon->log_handle;
+    DWORD written = 0;
+
+    if (handle && handle != INVALID_HANDLE_VALUE)
+    {
+        WriteFile(handle, text, length, &written, 0);
+    }
+}
+
+uint64_t cas_daemon_microseconds(void)
+{
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+
+    return (uint64_t)counter.QuadPart / (uint64_t)frequency.QuadPart * 1000000u +
+           (uint64_t)counter.QuadPart % (uint64_t)frequency.QuadPart * 1000000u / (uint64_t)frequency.QuadPart;
+}
+
+static void cas_daemon__run(CasDaemon* daemon)
+{
+    CasEventSource* sources[3] = { &daemon->poll_source };
+    HANDLE handles[5] = { global_stop_event, (HANDLE)daemon->poll_source.wait_handle };
+    DWORD source_count = 1;
+    DWORD handle_count = 0;
+
+    if (daemon->has_kernel_source)
+    {
+        sources[source_count] = &daemon->kernel_source;
+        handles[1 + source_count++] = (HANDLE)daemon->kernel_source.wait_handle;
+    }
+
+    if (daemon->has_exit_source)
+    {
+        sources[source_count] = &daemon->exit_source;
+        handles[1 + source_count++] = (HANDLE)daemon->exit_source.wait_handle;
+    }
+
+    handle_count = 1 + source_count;
+
+    if (daemon->has_config_watch)
+    {
+        handles[handle_count++] = (HANDLE)daemon->config_watch.wait_handle;
+    }
+
+    for (;;)
+    {
+        DWORD wait = WaitForMultipleObjects(handle_count, handles, FALSE, INFINITE);
+
+        if (wait == WAIT_OBJECT_0 || wait >= WAIT_OBJECT_0 + handle_count)
+        {
+            break;
+        }
+
+        if (wait - WAIT_OBJECT_0 > source_count)
+        {
+            cas_daemon_reload_config(daemon);
+        }
+        else
+        {
+            cas_daemon_handle_events(daemon, sources[wait - WAIT_OBJECT_0 - 1]);
+        }
+    }
+}
+
+static void cas_daemon__report(DWORD state, DWORD exit_code)
+{
+    SERVICE_STATUS status =
+    {
+        .dwServiceType = SERVICE_WIN32_OWN_PROCESS,
+        .dwCurrentState = state,
+        .dwControlsAccepted = state == SERVICE_RUNNING ? SERVICE_ACCEPT_STOP | SERVICE_ACCEPT_SHUTDOWN : 0,
+        .dwWin32ExitCode = exit_code,
+        .dwWaitHint = state == SERVICE_START_PENDING || state == SERVICE_STOP_PENDING ? CAS_DAEMON_STOP_WAIT_HINT : 0,
+    };
+
+    SetServiceStatus(global_service_status, &status);
+}
+
+static DWORD WINAPI cas_daemon__service_control(DWORD control, DWORD event_type, LPVOID event_data, LPVOID context)
+{
+    (void)event_type, (void)event_data, (void)context;
+
+    if (control == SERVICE_CONTROL_STOP || control == SERVICE_CONTROL_SHUTDOWN)
+    {
+        cas_daemon__report(SERVICE_STOP_PENDING, NO_ERROR);
+        SetEvent(global_stop_event);
+
+        return NO_ERROR;
+    }
+
+    return control == SERVICE_CONTROL_INTERROGATE ? NO_ERROR : ERROR_CALL_NOT_IMPLEMENTED;
+}
+
+// NOTE: Arguments given to "sc start" are ignored, the ones in the service binary path were parsed already.
+static void WINAPI cas_daemon__service_main(DWORD argument_count, LPWSTR* arguments)
+{
+    (void)argument_count, (void)arguments;
+
+    global_service_status = RegisterServiceCtrlHandlerExW(CAS_DAEMON_SERVICE_NAME, &cas_daemon__service_control, 0);
+
+    if (!global_service_status)
+    {
+        return;
+    }
+
+    cas_daemon__report(SERVICE_START_PENDING, NO_ERROR);
+
+    if (!cas_daemon_start(&global_daemon))
+    {
+        cas_daemon__report(SERVICE_STOPPED, ERROR_BAD_CONFIGURATION);
+        return;
+    }
+
+    cas_daemon__report(SERVICE_RUNNING, NO_ERROR);
+    cas_daemon__run(&global_daemon);
+    cas_daemon_stop(&global_daemon);
+    cas_daemon__report(SERVICE_STOPPED, NO_ERROR);
+}
+
+static BOOL WINAPI cas_daemon__console_control(DWORD control)
+{
+    (void)control;
+    SetEvent(global_stop_event);
+
+    return TRUE;
+}
+
+// NOTE: cas.exe is a GUI program, a headless run borrows the console it was started from for its log.
+static HANDLE cas_daemon__log_handle(const CasDaemonOptions* options)
+{
+    HANDLE handle = 0;
+
+    if (options->log_path)
+    {
+        WCHAR wide_path[MAX_PATH];
+
+        if (MultiByteToWideChar(CP_UTF8, 0, options->log_path, -1, wide_path, ARRAY_COUNT(wide_path)))
+        {
+            handle = CreateFileW(wide_path, FILE_APPEND_DATA, FILE_SHARE_READ | FILE_SHARE_WRITE, 0, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, 0);
+        }
+    }
+    else
+    {
+        handle = GetStdHandle(STD_ERROR_HANDLE);
+
+        if ((!handle || handle == INVALID_HANDLE_VALUE) && !options->is_service && AttachConsole(ATTACH_PARENT_PROCESS))
+        {
+            handle = CreateFileW(L"CONOUT$", GENERIC_WRITE, FILE_SHARE_WRITE, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+        }
+    }
+
+    return handle;
+}
+
+// NOTE: cas.exe --headless <cas.ini> [--log <file>] runs until Ctrl+C, cas.exe --service <cas.ini> [--log <file>]
+// is the binary path of a service created with sc.exe.
+int cas_daemon_main(int argument_count, wchar_t** arguments)
+{
+    char** utf8_arguments = calloc((size_t)argument_count, sizeof(char*));
+    int result = 1;
+
+    for (int i = 0; utf8_arguments && i < argument_count; ++i)
+    {
+        int length = WideCharToMultiByte(CP_UTF8, 0, arguments[i], -1, 0, 0, 0, 0);
+
+        utf8_arguments[i] = malloc((size_t)length);
+
+        if (!utf8_arguments[i] || !WideCharToMultiByte(CP_UTF8, 0, arguments[i], -1, utf8_arguments[i], length, 0, 0))
+        {
+            return 1;
+        }
+    }
+
+    if (!utf8_arguments || !cas_daemon_parse_arguments(&global_daemon.options, argument_count, utf8_arguments))
+    {
+        global_daemon.log_handle = (intptr_t)cas_daemon__log_handle(&global_daemon.options);
+        cas_daemon_log(&global_daemon, "usage: cas.exe --headless|--service <cas.ini> [--log <file>]");
+        return 2;
+    }
+
+    global_daemon.log_handle = (intptr_t)cas_daemon__log_handle(&global_daemon.options);
+    global_stop_event = CreateEventW(0, TRUE, FALSE, 0);
+
+    if (global_daemon.options.is_service)
+    {
+        SERVICE_TABLE_ENTRYW services[] =
+        {
+            { CAS_DAEMON_SERVICE_NAME, &cas_daemon__service_main },
+            { 0, 0 },
+        };
+
+        result = StartServiceCtrlDispatcherW(services) ? 0 : 1;
+    }
+    else if (cas_daemon_start(&global_daemon))
+    {
+        SetConsoleCtrlHandler(&cas_daemon__console_control, TRUE);
+        cas_daemon__run(&global_daemon);
+        cas_daemon_stop(&global_daemon);
+        result = 0;
+    }
+
+    return result;
+}
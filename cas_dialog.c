@@ -11,6 +11,8 @@
 #define ITEM_HEIGHT  (14)
 #define PADDING      (4)
 
+#define MAX_VALUE_LENGTH  (2 * CAS_CPU_SET_MAX_CPUS)
+
 #define ID_PERIOD         (10)
 #define ID_SILENT_START   (11)
 #define ID_AUTO_START     (12)
@@ -21,6 +23,7 @@
 #define ID_VALUE          (500)
 #define ID_RESULT         (600)
 #define ID_SHORTCUT_MENU  (700)
+#define ID_RESULT_TYPE    (800)
 
 #define ITEM_CHECKBOX     (1 << 0)
 #define ITEM_NUMBER       (1 << 1)
@@ -78,12 +81,15 @@ typedef struct
 } CasDialogLayout;
 
 static BOOL global_is_elavated;
-static SYSTEM_INFO global_system_info;
 static HWND global_dialog_window;
 static WCHAR* global_ini_path;
+static char global_utf8_ini_path[MAX_PATH * 3];
 static HICON global_icon;
 static int global_started;
+// NOTE: Indices of the type comboboxes, CAS_CPU_SET_FORMAT_LIST and on.
 static int global_value_type;
+static int global_result_type = CAS_CPU_SET_FORMAT_HEX;
+static const WCHAR* global_value_types[] = { L"List", L"Hex", L"Groups", L"Bit" };
 static const char global_check_mark[] = "\x20\x00\x20\x00\x20\x00\x20\x00\x13\x27\x00\x00"; // NOTE: Four space and check mark for easy printing.
 struct {
     WNDPROC window_proc;
@@ -140,16 +146,25 @@ static void cas_dialog__format_key(DWORD key_mod, WCHAR* text)
     StrCatW(text, key_text);
 }
 
-static int cas_dialog__validate_bits(const WCHAR* bits, int length, const WCHAR** wrong_bit)
+static int cas_dialog__is_hex(WCHAR digit)
+{
+    int result = ((digit >= L'0' && digit <= L'9') ||
+                  (digit >= L'a' && digit <= L'f')  ||
+                  (digit >= L'A' && digit <= L'F'));
+
+    return result;
+}
+
+static int cas_dialog__validate_hex(const WCHAR* hex, int length, const WCHAR** wrong_hex)
 {
     int result = 1;
 
     for (int i = 0; i < length; ++i)
     {
-        if ((bits[i] != L'0' && bits[i] != L'1'))
+        if (!cas_dialog__is_hex(hex[i]))
         {
             result = 0;
-            *wrong_bit = bits + i;
+            *wrong_hex = hex + i;
             break;
         }
     }
@@ -157,69 +172,118 @@ static int cas_dialog__validate_bits(const WCHAR* bits, int length, const WCHAR*
     return result;
 }
 
-static unsigned int cas_dialog__bits_to_integer(const WCHAR* bits, int length)
+// NOTE: Anything that is not only hex digits (with an optional 0x) is a CPU list like "0-3,8" or a topology name
+// like "node1" or "no-smt".
+static int cas_dialog__is_symbolic(const WCHAR* text)
 {
-    unsigned int result = 0;
-    int i;
-
-    ASSERT(length <= 32);
+    const WCHAR* digits = (text[0] == L'0' && (text[1] == L'x' || text[1] == L'X')) ? text + 2 : text;
 
-    for (i = 0; i < length; ++i)
+    for (; *digits; ++digits)
     {
-        int char_bit = bits[i] - '0';
-
-        result += (1 << (length - i - 1)) * char_bit;
+        if (!cas_dialog__is_hex(*digits))
+        {
+            return 1;
+        }
     }
 
-    return result;
+    return 0;
 }
 
-static int cas_dialog__is_hex(WCHAR digit)
+CasCpuSet cas_dialog_affinity_mask(CasDialogConfig* dialog_config, uint32_t index)
 {
-    int result = ((digit >= L'0' && digit <= L'9') ||
-                  (digit >= L'a' && digit <= L'f')  ||
-                  (digit >= L'A' && digit <= L'F'));
+    CasCpuSet affinity_mask = { dialog_config->affinity_masks + index * dialog_config->mask_word_count, dialog_config->mask_word_count };
 
-    return result;
+    return affinity_mask;
 }
 
-static int cas_dialog__validate_hex(const WCHAR* hex, int length, const WCHAR** wrong_hex)
+// NOTE: A mask that no longer resolves (its node went away) keeps the CPUs it had.
+void cas_dialog_resolve_masks(CasDialogConfig* dialog_config)
 {
-    int result = 1;
+    uint64_t words[MAX_AFFINITY_MASK_WORDS] = { 0 };
+    CasCpuSet resolved = { words, dialog_config->mask_word_count };
 
-    for (int i = 0; i < length; ++i)
+    for (uint32_t i = 0; i < dialog_config->rule_count; ++i)
     {
-        if (!cas_dialog__is_hex(hex[i]))
+        if (dialog_config->affinity_mask_texts[i][0] && cas_resolve_mask(dialog_config->affinity_mask_texts[i], &resolved))
         {
-            result = 0;
-            *wrong_hex = hex + i;
-            break;
+            CasCpuSet affinity_mask = cas_dialog_affinity_mask(dialog_config, i);
+            cas_cpu_set_copy(&affinity_mask, &resolved);
         }
     }
-
-    return result;
 }
 
-static void cas_dialog__integer_to_bits(WCHAR* bits, unsigned long long integer, int length)
+static int cas_dialog__reserve_rules(CasDialogConfig* dialog_config, uint32_t count)
 {
-    int i;
+    uint32_t capacity = dialog_config->rule_capacity ? dialog_config->rule_capacity : MAX_ITEMS;
+    WCHAR (*processes)[MAX_PROCESS_LENGTH] = 0;
+    uint64_t* affinity_masks = 0;
+    WCHAR (*affinity_mask_texts)[MAX_MASK_TEXT_LENGTH] = 0;
+
+    if (count <= dialog_config->rule_capacity)
+    {
+        return TRUE;
+    }
 
-    for (i = 0; i < length; ++i)
+    while (capacity < count)
     {
-        bits[i] = (unsigned long long)(1 << (length - i - 1)) & integer ? L'1' : L'0';
+        capacity *= 2;
     }
+
+    processes = realloc(dialog_config->processes, capacity * sizeof(*processes));
+    dialog_config->processes = processes ? processes : dialog_config->processes;
+    affinity_masks = realloc(dialog_config->affinity_masks, capacity * dialog_config->mask_word_count * sizeof(uint64_t));
+    dialog_config->affinity_masks = affinity_masks ? affinity_masks : dialog_config->affinity_masks;
+    affinity_mask_texts = realloc(dialog_config->affinity_mask_texts, capacity * sizeof(*affinity_mask_texts));
+    dialog_config->affinity_mask_texts = affinity_mask_texts ? affinity_mask_texts : dialog_config->affinity_mask_texts;
+
+    if (!processes || !affinity_masks || !affinity_mask_texts)
+    {
+        return FALSE;
+    }
+
+    dialog_config->rule_capacity = capacity;
+
+    return TRUE;
 }
 
 static void cas_dialog__set_values(HWND window, CasDialogConfig* dialog_config)
 {
+    BOOL dones[MAX_ITEMS] = { 0 };
+
+    if (global_started)
+    {
+        cas_read_dones(dones, MAX_ITEMS);
+    }
+
     for (unsigned int i = 0; i < MAX_ITEMS; ++i)
     {
+        if (i >= dialog_config->rule_count)
+        {
+            SetDlgItemTextW(window, ID_PROCESS + i, L"");
+            SetDlgItemTextW(window, ID_AFFINITY_MASK + i, L"");
+            SetDlgItemTextW(window, ID_SET + i, L"");
+            continue;
+        }
+
+        CasCpuSet affinity_mask = cas_dialog_affinity_mask(dialog_config, i);
+
         SetDlgItemTextW(window, ID_PROCESS + i, dialog_config->processes[i]);
 
-        if (dialog_config->affinity_masks[i])
+        if (dialog_config->affinity_mask_texts[i][0])
         {
-            WCHAR hex_value_string[32] = { 0 };
-            _snwprintf(hex_value_string, ARRAY_COUNT(hex_value_string), L"%X", dialog_config->affinity_masks[i]);
+            SetDlgItemTextW(window, ID_AFFINITY_MASK + i, dialog_config->affinity_mask_texts[i]);
+        }
+        else if (!cas_cpu_set_is_empty(&affinity_mask))
+        {
+            char hex_string[MAX_AFFINITY_MASK_LENGTH + 1] = { 0 };
+            WCHAR hex_value_string[MAX_AFFINITY_MASK_LENGTH + 1] = { 0 };
+            uint32_t length = cas_cpu_set_format_hex(&affinity_mask, hex_string, ARRAY_COUNT(hex_string));
+
+            for (uint32_t j = 0; j < length; ++j)
+            {
+                hex_value_string[j] = (WCHAR)hex_string[j];
+            }
+
             SetDlgItemTextW(window, ID_AFFINITY_MASK + i, hex_value_string);
         }
         else
@@ -227,27 +291,20 @@ static void cas_dialog__set_values(HWND window, CasDialogConfig* dialog_config)
             SetDlgItemTextW(window, ID_AFFINITY_MASK + i, L"");
         }
 
-        SetDlgItemTextW(window, ID_SET + i, dialog_config->dones[i] ? (WCHAR*)global_check_mark : L"");
+        SetDlgItemTextW(window, ID_SET + i, dones[i] ? (WCHAR*)global_check_mark : L"");
     }
 
-    HWND control = GetDlgItem(window, ID_VALUE_TYPE);
-    ComboBox_SetCurSel(control, 0);
-
-    UINT silent_start = GetPrivateProfileIntW(CAS_DIALOG_INI_SETTINGS_SECTION, CAS_DIALOG_INI_SILENT_START_KEY, 0, global_ini_path);
-    CheckDlgButton(window, ID_SILENT_START, silent_start);
+    ComboBox_SetCurSel(GetDlgItem(window, ID_VALUE_TYPE), global_value_type);
+    ComboBox_SetCurSel(GetDlgItem(window, ID_RESULT_TYPE), global_result_type);
 
-    UINT auto_start = GetPrivateProfileIntW(CAS_DIALOG_INI_SETTINGS_SECTION, CAS_DIALOG_INI_AUTO_START_KEY, 0, global_ini_path);
-    CheckDlgButton(window, ID_AUTO_START, auto_start);
-
-    UINT period = GetPrivateProfileIntW(CAS_DIALOG_INI_SETTINGS_SECTION, CAS_DIALOG_INI_PERIOD_KEY, 5, global_ini_path);
-    SetDlgItemInt(window, ID_PERIOD, period, FALSE);
+    CheckDlgButton(window, ID_SILENT_START, dialog_config->config.silent_start ? BST_CHECKED : BST_UNCHECKED);
+    CheckDlgButton(window, ID_AUTO_START, dialog_config->config.auto_start ? BST_CHECKED : BST_UNCHECKED);
+    SetDlgItemInt(window, ID_PERIOD, dialog_config->config.period, FALSE);
 
     WCHAR text[64] = { 0 };
-    UINT menu_shortcut = GetPrivateProfileIntW(CAS_DIALOG_INI_SETTINGS_SECTION, CAS_DIALOG_INI_SHORTCUT_MENU_KEY, 0, global_ini_path);
 
-    if (menu_shortcut)
+    if (dialog_config->menu_shortcut)
     {
-        dialog_config->menu_shortcut = menu_shortcut;
         cas_dialog__format_key(dialog_config->menu_shortcut, text);
         SetDlgItemTextW(window, ID_SHORTCUT_MENU, text);
         SetWindowLongW(GetDlgItem(window, ID_SHORTCUT_MENU), GWLP_USERDATA, dialog_config->menu_shortcut);
@@ -259,107 +316,117 @@ static void cas_dialog__set_values(HWND window, CasDialogConfig* dialog_config)
     }
 }
 
+// NOTE: The value is read as the value type and shown as the result type, wide enough for every CPU a mask can have.
+// A list too long for the result shows nothing like a value that does not parse.
 static void cas_dialog__convert_value(HWND window)
 {
-    WCHAR value_string[64] = { 0 };
-    WCHAR result_string[64] = { 0 };
-    int value_length = 0;
-
-    value_length = GetDlgItemTextW(window, ID_VALUE, value_string, ARRAY_COUNT(value_string));
-
-    if (value_length > 0)
+    WCHAR value_string[MAX_VALUE_LENGTH + 1] = { 0 };
+    WCHAR result_string[MAX_VALUE_LENGTH + 1] = { 0 };
+    char text[MAX_VALUE_LENGTH + 1] = { 0 };
+    uint64_t words[MAX_AFFINITY_MASK_WORDS] = { 0 };
+    CasCpuSet set = { words, MAX_AFFINITY_MASK_WORDS };
+    int value_length = GetDlgItemTextW(window, ID_VALUE, value_string, ARRAY_COUNT(value_string));
+    int length = value_length > 0 ? WideCharToMultiByte(CP_UTF8, 0, value_string, value_length, text, MAX_VALUE_LENGTH, 0, 0) : 0;
+
+    if (length > 0 && cas_cpu_set_parse(&set, (uint32_t)global_value_type, text, (uint32_t)length))
     {
-        // NOTE: Bit value
-        if (global_value_type == 0)
+        uint32_t result_length = cas_cpu_set_format(&set, (uint32_t)global_result_type, text, ARRAY_COUNT(text));
+
+        for (uint32_t i = 0; i < result_length; ++i)
         {
-            WCHAR* wrong_bit = 0;
+            result_string[i] = (WCHAR)text[i];
+        }
+    }
 
-            if (value_length > 32)
-            {
-                value_string[32] = '\0';
-                SetDlgItemTextW(window, ID_VALUE, value_string);
-                SendDlgItemMessageW(window, ID_VALUE, EM_SETSEL, 32, 32);
-            }
-            else if (cas_dialog__validate_bits(value_string, value_length, &wrong_bit))
-            {
-                unsigned int result = cas_dialog__bits_to_integer(value_string, value_length);
+    SetDlgItemTextW(window, ID_RESULT, result_string);
+}
 
-                _snwprintf(result_string, ARRAY_COUNT(result_string), L"%X", result);
-                SetDlgItemTextW(window, ID_RESULT, result_string);
-            }
-            else
-            {
-                if (wrong_bit)
-                {
-                    *wrong_bit = '\0';
-                }
+static int cas_dialog__append_pair(CasDialogConfig* dialog_config, DWORD* length, const WCHAR* process_string, const WCHAR* affinity_mask_string)
+{
+    DWORD process_length = (DWORD)lstrlenW(process_string);
+    DWORD affinity_mask_length = (DWORD)lstrlenW(affinity_mask_string);
+    DWORD needed = *length + process_length + 1 + affinity_mask_length + 2;
 
-                SetDlgItemTextW(window, ID_VALUE, value_string);
-                SendDlgItemMessageW(window, ID_VALUE, EM_SETSEL, (WPARAM)value_length - 1, (LPARAM)value_length - 1);
-            }
-        }
-            // NOTE: Hex value
-        else if (global_value_type == 1)
-        {
-            WCHAR* wrong_hex = 0;
+    if (needed > dialog_config->section_capacity)
+    {
+        DWORD capacity = dialog_config->section_capacity ? dialog_config->section_capacity : 4096;
+        WCHAR* section = 0;
 
-            if (value_length > 8)
-            {
-                value_string[8] = '\0';
-                SetDlgItemTextW(window, ID_VALUE, value_string);
-                SendDlgItemMessageW(window, ID_VALUE, EM_SETSEL, 16, 16);
-            }
-            else if (cas_dialog__validate_hex(value_string, value_length, &wrong_hex))
-            {
-                long long integer = wcstoll(value_string, 0, 16);
+        while (capacity < needed)
+        {
+            capacity *= 2;
+        }
 
-                cas_dialog__integer_to_bits(result_string, integer, 32);
-                SetDlgItemTextW(window, ID_RESULT, result_string);
-            }
-            else
-            {
-                if (wrong_hex)
-                {
-                    *wrong_hex = '\0';
-                }
+        section = realloc(dialog_config->section, capacity * sizeof(WCHAR));
 
-                SetDlgItemTextW(window, ID_VALUE, value_string);
-                SendDlgItemMessageW(window, ID_VALUE, EM_SETSEL, (WPARAM)value_length - 1, (LPARAM)value_length - 1);
-            }
+        if (!section)
+        {
+            return FALSE;
         }
+
+        dialog_config->section = section;
+        dialog_config->section_capacity = capacity;
     }
-    else
-    {
-        SetDlgItemTextW(window, ID_RESULT, L"");
-    }
+
+    memcpy(dialog_config->section + *length, process_string, process_length * sizeof(WCHAR));
+    *length += process_length;
+    dialog_config->section[(*length)++] = L':';
+    memcpy(dialog_config->section + *length, affinity_mask_string, affinity_mask_length * sizeof(WCHAR));
+    *length += affinity_mask_length;
+    dialog_config->section[(*length)++] = L'\0';
+    dialog_config->section[*length] = L'\0';
+
+    return TRUE;
 }
 
-static void cas_dialog__config_save(HWND window)
+// NOTE: The dialog rows come first, rules past them are only in cas.ini and are written back as loaded.
+// The whole section goes out in one write, per pair writes rewrite the file once per rule.
+static void cas_dialog__config_save(HWND window, CasDialogConfig* dialog_config)
 {
-    WritePrivateProfileStringW(CAS_DIALOG_INI_PAIRS_SECTION, 0, L"", global_ini_path);
+    DWORD length = 0;
+    int success = TRUE;
 
-    // NOTE: We do reverse iteration because WritePrivateProfileSectionW insert names to beginning not to end.
-    for (int i = MAX_ITEMS - 1; i >= 0; --i)
+    for (unsigned int i = 0; i < MAX_ITEMS && success; ++i)
     {
-        WCHAR process_string[64] = { 0 };
-        WCHAR affinity_mask_string[64] = { 0 };
-        UINT process_length = 0;
-        UINT affinity_mask_length = 0;
+        WCHAR process_string[MAX_PROCESS_LENGTH] = { 0 };
+        WCHAR affinity_mask_string[MAX_AFFINITY_MASK_LENGTH + 1] = { 0 };
 
-        process_length = GetDlgItemTextW(window, ID_PROCESS + i, process_string, ARRAY_COUNT(process_string));
-        affinity_mask_length = GetDlgItemTextW(window, ID_AFFINITY_MASK + i, affinity_mask_string, ARRAY_COUNT(affinity_mask_string));
+        if (GetDlgItemTextW(window, ID_PROCESS + i, process_string, ARRAY_COUNT(process_string)) &&
+            GetDlgItemTextW(window, ID_AFFINITY_MASK + i, affinity_mask_string, ARRAY_COUNT(affinity_mask_string)))
+        {
+            success = cas_dialog__append_pair(dialog_config, &length, process_string, affinity_mask_string);
+        }
+    }
+
+    for (uint32_t i = MAX_ITEMS; i < dialog_config->rule_count && success; ++i)
+    {
+        CasCpuSet affinity_mask = cas_dialog_affinity_mask(dialog_config, i);
+        char hex_string[MAX_AFFINITY_MASK_LENGTH + 1] = { 0 };
+        WCHAR affinity_mask_string[MAX_AFFINITY_MASK_LENGTH + 1] = { 0 };
+        uint32_t hex_length = cas_cpu_set_format_hex(&affinity_mask, hex_string, ARRAY_COUNT(hex_string));
 
-        if (process_length && affinity_mask_length)
+        for (uint32_t j = 0; j < hex_length; ++j)
         {
-            WCHAR pair_string[128] = { 0 };
-            int length = process_length;
+            affinity_mask_string[j] = (WCHAR)hex_string[j];
+        }
+
+        success = cas_dialog__append_pair(dialog_config, &length, dialog_config->processes[i],
+                                          dialog_config->affinity_mask_texts[i][0] ? dialog_config->affinity_mask_texts[i] : affinity_mask_string);
+    }
 
-            memcpy(pair_string, process_string, length * sizeof(WCHAR));
-            pair_string[length++] = L':';
-            memcpy(pair_string + length, affinity_mask_string, affinity_mask_length * sizeof(WCHAR));
-            WritePrivateProfileSectionW(CAS_DIALOG_INI_PAIRS_SECTION, pair_string, global_ini_path);
+    if (success)
+    {
+        WritePrivateProfileStringW(CAS_DIALOG_INI_PAIRS_SECTION, 0, L"", global_ini_path);
+
+        if (length)
+        {
+            WritePrivateProfileSectionW(CAS_DIALOG_INI_PAIRS_SECTION, dialog_config->section, global_ini_path);
         }
     }
+    else
+    {
+        MessageBoxW(0, L"Not enough memory to save cas.ini.", L"Warning!", MB_ICONWARNING);
+    }
 }
 
 static void cas_dialog__shortcut_save(HWND window, CasDialogConfig* dialog_config)
@@ -446,8 +513,11 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
         SetWindowLongPtrW(window, GWLP_USERDATA, (LONG_PTR)dialog_config);
 
         SendMessage(window, WM_SETICON, ICON_BIG, (LPARAM)global_icon);
-        SendDlgItemMessageW(window, ID_VALUE_TYPE, CB_ADDSTRING, 0, (LPARAM)L"Bit");
-	SendDlgItemMessageW(window, ID_VALUE_TYPE, CB_ADDSTRING, 0, (LPARAM)L"Hex");
+        for (unsigned int i = 0; i < ARRAY_COUNT(global_value_types); ++i)
+        {
+            SendDlgItemMessageW(window, ID_VALUE_TYPE, CB_ADDSTRING, 0, (LPARAM)global_value_types[i]);
+            SendDlgItemMessageW(window, ID_RESULT_TYPE, CB_ADDSTRING, 0, (LPARAM)global_value_types[i]);
+        }
 
         cas_dialog__set_values(window, dialog_config);
 
@@ -492,7 +562,7 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
             {
                 CasDialogConfig* dialog_config = (CasDialogConfig*)GetWindowLongPtrW(window, GWLP_USERDATA);
 
-                cas_dialog__config_save(window);
+                cas_dialog__config_save(window, dialog_config);
 
                 if (cas_dialog_config_load(dialog_config))
                 {
@@ -507,8 +577,7 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
                     }
                     EnableWindow(GetDlgItem(window, ID_PERIOD), 0);
 
-                    UINT period = GetPrivateProfileIntW(CAS_DIALOG_INI_SETTINGS_SECTION, CAS_DIALOG_INI_PERIOD_KEY, 5, global_ini_path);
-                    cas_set_timer(period);
+                    cas_set_timer((int)dialog_config->config.period);
                 }
 
                 return TRUE;
@@ -518,8 +587,6 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
         {
             if (global_started)
             {
-                CasDialogConfig* dialog_config = (CasDialogConfig*)GetWindowLongPtrW(window, GWLP_USERDATA);
-
                 global_started = 0;
 
                 KillTimer(window, CAS_DIALOG_TIMER_HANDLE_ID);
@@ -529,7 +596,6 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
                     EnableWindow(GetDlgItem(window, ID_PROCESS + i), 1);
                     EnableWindow(GetDlgItem(window, ID_AFFINITY_MASK + i), 1);
                     SetDlgItemTextW(window, ID_SET + i, L"");
-                    dialog_config->dones[i] = 0;
                 }
                 EnableWindow(GetDlgItem(window, ID_PERIOD), 1);
 
@@ -546,11 +612,18 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
         else if (control == ID_VALUE_TYPE && HIWORD(wparam) == CBN_SELCHANGE)
 	{
 	    LRESULT index = SendDlgItemMessageW(window, ID_VALUE_TYPE, CB_GETCURSEL, 0, 0);
-            global_value_type = (unsigned int)index;
+            global_value_type = (int)index;
             SetDlgItemTextW(window, ID_RESULT, L"");
             SetDlgItemTextW(window, ID_VALUE, L"");
 	    return TRUE;
 	}
+        else if (control == ID_RESULT_TYPE && HIWORD(wparam) == CBN_SELCHANGE)
+        {
+            LRESULT index = SendDlgItemMessageW(window, ID_RESULT_TYPE, CB_GETCURSEL, 0, 0);
+            global_result_type = (int)index;
+            cas_dialog__convert_value(window);
+            return TRUE;
+        }
         else if (control == ID_VALUE)
         {
             cas_dialog__convert_value(window);
@@ -558,16 +631,28 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
         else if (control >= ID_AFFINITY_MASK && control < ID_AFFINITY_MASK + MAX_ITEMS)
         {
             WCHAR* wrong_hex = 0;
-            WCHAR affinity_mask_string[64] = { 0 };
+            WCHAR affinity_mask_string[MAX_AFFINITY_MASK_LENGTH + 1] = { 0 };
             int affinity_mask_string_length = 0;
+            // NOTE: One hex digit per four CPUs, across all processor groups.
+            int max_length = (int)(cas_cpu_count() + 3) / 4;
 
             affinity_mask_string_length = GetDlgItemTextW(window, control, affinity_mask_string, ARRAY_COUNT(affinity_mask_string));
 
-            if (affinity_mask_string_length > (int)global_system_info.dwNumberOfProcessors / 2)
+            // NOTE: Symbolic masks are checked when the rules are loaded, only their length is limited here.
+            if (cas_dialog__is_symbolic(affinity_mask_string))
             {
-                affinity_mask_string[global_system_info.dwNumberOfProcessors / 2] = '\0';
+                if (affinity_mask_string_length >= MAX_MASK_TEXT_LENGTH)
+                {
+                    affinity_mask_string[MAX_MASK_TEXT_LENGTH - 1] = '\0';
+                    SetDlgItemTextW(window, control, affinity_mask_string);
+                    SendDlgItemMessageW(window, control, EM_SETSEL, MAX_MASK_TEXT_LENGTH - 1, MAX_MASK_TEXT_LENGTH - 1);
+                }
+            }
+            else if (affinity_mask_string_length > max_length)
+            {
+                affinity_mask_string[max_length] = '\0';
                 SetDlgItemTextW(window, control, affinity_mask_string);
-                SendDlgItemMessageW(window, control, EM_SETSEL, global_system_info.dwNumberOfProcessors, global_system_info.dwNumberOfProcessors);
+                SendDlgItemMessageW(window, control, EM_SETSEL, (WPARAM)max_length, (LPARAM)max_length);
             }
             else if (!cas_dialog__validate_hex(affinity_mask_string, affinity_mask_string_length, &wrong_hex))
             {
@@ -577,7 +662,7 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
                 }
 
                 SetDlgItemTextW(window, control, affinity_mask_string);
-                SendDlgItemMessageW(window, control, EM_SETSEL, global_system_info.dwNumberOfProcessors, global_system_info.dwNumberOfProcessors);
+                SendDlgItemMessageW(window, control, EM_SETSEL, (WPARAM)max_length, (LPARAM)max_length);
             }
 
         }
@@ -657,12 +742,15 @@ static LRESULT CALLBACK cas_dialog__proc(HWND window, UINT message, WPARAM wpara
         if (global_started)
         {
             CasDialogConfig* dialog_config = (CasDialogConfig*)GetWindowLongPtrW(window, GWLP_USERDATA);
+            BOOL dones[MAX_ITEMS] = { 0 };
 
-            for (unsigned int i = 0; i < MAX_ITEMS; ++i)
+            cas_read_dones(dones, MAX_ITEMS);
+
+            for (unsigned int i = 0; i < MAX_ITEMS && i < dialog_config->rule_count; ++i)
             {
                 if (*dialog_config->processes[i])
                 {
-                    if (dialog_config->dones[i])
+                    if (dones[i])
                     {
                         SetDlgItemTextW(window, ID_SET + i, (WCHAR*)global_check_mark);
                     }
@@ -886,78 +974,174 @@ static void cas__do_dialog_layout(const CasDialogLayout* dialog_layout, BYTE* bu
     ASSERT(buffer <= end);
 }
 
+// NOTE: Index of the first pair the rules cannot be made from, pair_count when there is none.
+static uint32_t cas_dialog__first_bad_pair(CasDialogConfig* dialog_config, const CasConfig* config)
+{
+    uint64_t active_words[MAX_AFFINITY_MASK_WORDS] = { 0 };
+    CasCpuSet active_set = { active_words, dialog_config->mask_word_count };
+    uint32_t bad_line = 0;
+    uint32_t index = 0;
+
+    cas_cpu_active_set(&active_set);
+    bad_line = cas_config_check(config, cas_current_topology(), &active_set);
+
+    for (; index < config->pair_count; ++index)
+    {
+        const CasConfigPair* pair = config->pairs + index;
+
+        if (pair->line_number == bad_line ||
+            (pair->mask_length >= MAX_MASK_TEXT_LENGTH && cas_config_is_symbolic(config->text + pair->mask_offset, pair->mask_length)))
+        {
+            break;
+        }
+    }
+
+    return index;
+}
+
+static int cas_dialog__parse_config(CasDialogConfig* dialog_config, CasConfig* config, const char* text, uint32_t length, uint32_t* bad_pair)
+{
+    cas_config_init(config);
+
+    if (!cas_config_parse(config, text, length, cas_current_topology()))
+    {
+        cas_config_free(config);
+        return FALSE;
+    }
+
+    *bad_pair = cas_dialog__first_bad_pair(dialog_config, config);
+
+    if (!cas_dialog__reserve_rules(dialog_config, config->pair_count))
+    {
+        cas_config_free(config);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+// NOTE: Fills the first count rows from config and takes it over, the previous config is freed.
+static void cas_dialog__apply_config(CasDialogConfig* dialog_config, CasConfig* config, uint32_t count)
+{
+    const CasTopology* topology = cas_current_topology();
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const CasConfigPair* pair = config->pairs + i;
+        const char* mask_text = config->text + pair->mask_offset;
+        CasCpuSet affinity_mask = cas_dialog_affinity_mask(dialog_config, i);
+        int length = MultiByteToWideChar(CP_UTF8, 0, config->text + pair->name_offset, (int)pair->name_length,
+                                         dialog_config->processes[i], MAX_PROCESS_LENGTH - 1);
+
+        dialog_config->processes[i][length] = L'\0';
+        length = 0;
+
+        if (cas_config_is_symbolic(mask_text, pair->mask_length))
+        {
+            length = MultiByteToWideChar(CP_UTF8, 0, mask_text, (int)pair->mask_length, dialog_config->affinity_mask_texts[i], MAX_MASK_TEXT_LENGTH - 1);
+        }
+
+        dialog_config->affinity_mask_texts[i][length] = L'\0';
+        cas_config_resolve_mask(config, i, topology, &affinity_mask);
+    }
+
+    dialog_config->rule_count = count;
+    dialog_config->menu_shortcut = config->menu_shortcut;
+    cas_config_free(&dialog_config->config);
+    dialog_config->config = *config;
+}
+
 int cas_dialog_config_load(CasDialogConfig* dialog_config)
 {
-    int result = TRUE;
-    WIN32_FILE_ATTRIBUTE_DATA data;
+    CasConfig config;
+    uint32_t length = 0;
+    uint32_t bad_pair = 0;
+    char* text = cas_config_read_file(global_utf8_ini_path, &length);
+    int is_parsed = FALSE;
 
-    if (!GetFileAttributesExW(global_ini_path, GetFileExInfoStandard, &data))
+    if (!text)
     {
         MessageBoxW(0, L"cas.ini may be deleted.", L"Warning!", MB_ICONWARNING);
 	// .ini file deleted?
 	return FALSE;
     }
 
-    WCHAR settings[(sizeof(dialog_config->processes) + sizeof(dialog_config->affinity_masks))] = { 0 };
+    is_parsed = cas_dialog__parse_config(dialog_config, &config, text, length, &bad_pair);
+    free(text);
 
-    GetPrivateProfileSectionW(CAS_DIALOG_INI_PAIRS_SECTION,
-                              settings, ARRAY_COUNT(settings),
-                              global_ini_path);
+    if (!is_parsed)
+    {
+        MessageBoxW(0, L"Not enough memory to load cas.ini.", L"Warning!", MB_ICONWARNING);
+        dialog_config->rule_count = 0;
+        return FALSE;
+    }
 
-    WCHAR* pointer = settings;
-    int pointer_length = 0;
-    int count = 0;
+    // NOTE: The rows before a bad pair are still loaded so the dialog does not save over them.
+    cas_dialog__apply_config(dialog_config, &config, bad_pair);
 
-    while (*pointer != 0)
+    if (bad_pair < dialog_config->config.pair_count)
     {
-        if (count == MAX_ITEMS)
-        {
-            MessageBoxW(0, L"More than 16 items is not supported.", L"Warning!", MB_ICONWARNING);
-            result = FALSE;
-            break;
-        }
+        const CasConfigPair* pair = dialog_config->config.pairs + bad_pair;
 
-        pointer_length = lstrlenW(pointer);
+        MessageBoxW(0, pair->name_length && pair->mask_length ? L"Affinity mask has wrong format." : L"cas.ini may be corrupted.", L"Warning!", MB_ICONWARNING);
+        return FALSE;
+    }
 
-        WCHAR* pair = pointer;
-        StrTrimW(pair, L" \t");
+    return TRUE;
+}
 
-        if (pair[0])
-        {
-            WCHAR* colon = wcsrchr(pair, L':');
+// NOTE: Editors that save through a temporary file remove cas.ini for a moment, the rename after it is another change.
+int cas_dialog_config_reload(CasDialogConfig* dialog_config, uint32_t* bad_line)
+{
+    CasConfig config;
+    uint32_t length = 0;
+    uint32_t bad_pair = 0;
+    DWORD menu_shortcut = dialog_config->menu_shortcut;
+    char* text = cas_config_read_file(global_utf8_ini_path, &length);
 
-            if (colon)
-            {
-                *colon = '\0';
+    *bad_line = 0;
 
-                lstrcpynW(dialog_config->processes[count], pair, ARRAY_COUNT(dialog_config->processes[count]));
-                long long affinity_mask = wcstoll(colon + 1, 0, 16);
+    if (!text || (dialog_config->config.text && length == dialog_config->config.text_length && !memcmp(text, dialog_config->config.text, length)))
+    {
+        free(text);
+        return CAS_DIALOG_RELOAD_UNCHANGED;
+    }
 
-                if (!affinity_mask || affinity_mask == LLONG_MAX || affinity_mask == LLONG_MIN || affinity_mask > (long long)global_system_info.dwActiveProcessorMask)
-                {
-                    MessageBoxW(0, L"Affinity mask has wrong format.", L"Warning!", MB_ICONWARNING);
-                    result = FALSE;
-                    break;
-                }
-                else
-                {
-                    dialog_config->affinity_masks[count] = (UINT)affinity_mask;
-                    ++count;
-                }
+    if (!cas_dialog__parse_config(dialog_config, &config, text, length, &bad_pair))
+    {
+        free(text);
+        return CAS_DIALOG_RELOAD_FAILED;
+    }
 
-            }
-            else
-            {
-                MessageBoxW(0, L"cas.ini may be corrupted.", L"Warning!", MB_ICONWARNING);
-                result = FALSE;
-                break;
-            }
-        }
+    free(text);
 
-        pointer += pointer_length + 1;
+    if (bad_pair < config.pair_count)
+    {
+        *bad_line = config.pairs[bad_pair].line_number;
+        cas_config_free(&config);
+        return CAS_DIALOG_RELOAD_FAILED;
     }
 
-    return result;
+    cas_dialog__apply_config(dialog_config, &config, config.pair_count);
+
+    if (dialog_config->menu_shortcut != menu_shortcut)
+    {
+        cas_disable_hotkeys();
+        cas_enable_hotkeys();
+    }
+
+    // NOTE: The rows can only be refreshed while started, otherwise they may hold edits that are not saved yet.
+    if (global_started)
+    {
+        cas_set_timer((int)dialog_config->config.period);
+
+        if (global_dialog_window)
+        {
+            cas_dialog__set_values(global_dialog_window, dialog_config);
+        }
+    }
+
+    return CAS_DIALOG_RELOAD_APPLIED;
 }
 
 LRESULT cas_dialog_show(CasDialogConfig* dialog_config)
@@ -972,8 +1156,35 @@ LRESULT cas_dialog_show(CasDialogConfig* dialog_config)
     snprintf((char*)title, sizeof(title),
              "cas%s", global_is_elavated ? "" : " (no administrator rights)");
     char* affinity_masks_caption[64] = { 0 };
-    snprintf((char*)affinity_masks_caption, sizeof(affinity_masks_caption),
-             "Affinity Masks (Hex) - Max: %X", (int)global_system_info.dwActiveProcessorMask);
+    char max_hex_string[MAX_AFFINITY_MASK_LENGTH + 1] = { 0 };
+    uint64_t active_words[MAX_AFFINITY_MASK_WORDS] = { 0 };
+    CasCpuSet active_set = { active_words, cas_cpu_set_word_count(cas_cpu_count()) };
+
+    cas_cpu_active_set(&active_set);
+
+    // NOTE: Large masks do not fit the caption, show the CPU count instead.
+    if (cas_cpu_set_format_hex(&active_set, max_hex_string, 33))
+    {
+        snprintf((char*)affinity_masks_caption, sizeof(affinity_masks_caption),
+                 "Affinity Masks (Hex or node0, l3:0, ...) - Max: %s", max_hex_string);
+    }
+    else
+    {
+        snprintf((char*)affinity_masks_caption, sizeof(affinity_masks_caption),
+                 "Affinity Masks (Hex or node0, l3:0, ...) - %u CPUs", cas_cpu_count());
+    }
+    char* processes_caption[64] = { 0 };
+
+    // NOTE: Rules past the dialog rows are kept and saved back, they are only editable in cas.ini.
+    if (dialog_config->rule_count > MAX_ITEMS)
+    {
+        snprintf((char*)processes_caption, sizeof(processes_caption),
+                 "Processes (+%u more in cas.ini)", dialog_config->rule_count - MAX_ITEMS);
+    }
+    else
+    {
+        snprintf((char*)processes_caption, sizeof(processes_caption), "Processes");
+    }
     char* auto_start[64] = { 0 };
     snprintf((char*)auto_start, sizeof(auto_start),
              "Auto-start%s", global_is_elavated ? "" : " (run as administrator)");
@@ -986,7 +1197,7 @@ LRESULT cas_dialog_show(CasDialogConfig* dialog_config)
 	.groups = (CasDialogGroup[])
 	{
             {
-		.caption = "Processes",
+		.caption = (const char*)processes_caption,
 		.rect = { 0, 0, COL_WIDTH, ROW_HEIGHT },
 	    },
 	    {
@@ -1016,6 +1227,7 @@ LRESULT cas_dialog_show(CasDialogConfig* dialog_config)
                 {
                     { "Value Type",  ID_VALUE_TYPE,  ITEM_COMBOBOX | ITEM_LABEL, 48 },
                     { "Value",       ID_VALUE,       ITEM_STRING | ITEM_LABEL, 48 },
+                    { "Result Type", ID_RESULT_TYPE, ITEM_COMBOBOX | ITEM_LABEL, 48 },
                     { "Result",      ID_RESULT,      ITEM_CONST_STRING | ITEM_LABEL, 48 },
                     { NULL },
                 },
@@ -1043,29 +1255,23 @@ LRESULT cas_dialog_show(CasDialogConfig* dialog_config)
 
 void cas_dialog_init(CasDialogConfig* dialog_config, WCHAR* ini_path, HICON icon)
 {
-    UINT silent_start = GetPrivateProfileIntW(CAS_DIALOG_INI_SETTINGS_SECTION, CAS_DIALOG_INI_SILENT_START_KEY, 0, ini_path);
-
     global_ini_path = ini_path;
     global_icon = icon;
     global_is_elavated = cas__is_elavated();
+    dialog_config->mask_word_count = cas_cpu_set_word_count(cas_cpu_count());
+    cas_config_init(&dialog_config->config);
+    WideCharToMultiByte(CP_UTF8, 0, ini_path, -1, global_utf8_ini_path, (int)sizeof(global_utf8_ini_path), 0, 0);
 
-    GetSystemInfo(&global_system_info);
-
-    UINT menu_shortcut = GetPrivateProfileIntW(CAS_DIALOG_INI_SETTINGS_SECTION, CAS_DIALOG_INI_SHORTCUT_MENU_KEY, 0, global_ini_path);
-    dialog_config->menu_shortcut = menu_shortcut;
+    cas_dialog_config_load(dialog_config);
     cas_enable_hotkeys();
 
-    if (silent_start)
+    if (dialog_config->config.silent_start)
     {
-        UINT period = GetPrivateProfileIntW(CAS_DIALOG_INI_SETTINGS_SECTION, CAS_DIALOG_INI_PERIOD_KEY, 5, ini_path);
-
         global_started = 1;
-        cas_dialog_config_load(dialog_config);
-        cas_set_timer(period);
+        cas_set_timer((int)dialog_config->config.period);
     }
     else
     {
-        cas_dialog_config_load(dialog_config);
         cas_dialog_show(dialog_config);
     }
 }
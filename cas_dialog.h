@@ -1,26 +1,55 @@
 #ifndef H_CAS_DIALOG_H
 
+#include "cas_config.h"
+
+// NOTE: Rows shown in the dialog, cas.ini itself can hold any number of rules.
 #define MAX_ITEMS 16
 #define MAX_ITEMS_LENGTH 64
+// NOTE: Room for a thread name and predicates after the process name, same as CAS_RULE_LINE_LENGTH.
+#define MAX_PROCESS_LENGTH 1024
+#define MAX_AFFINITY_MASK_LENGTH (CAS_CPU_SET_MAX_CPUS / 4)
+// NOTE: Symbolic masks such as "cores 0-7 of node0", hex masks are not kept as text.
+#define MAX_MASK_TEXT_LENGTH 64
+#define MAX_AFFINITY_MASK_WORDS (CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS)
 
 #define ID_START   0
 #define ID_STOP    1
 #define ID_CANCEL  2
 
+#define CAS_DIALOG_RELOAD_UNCHANGED  (0)
+#define CAS_DIALOG_RELOAD_APPLIED    (1)
+#define CAS_DIALOG_RELOAD_FAILED     (2)
+
 #define HOT_KEY(key, mod) ((key) | ((mod) << 24))
 #define HOT_GET_KEY(key_mod) ((key_mod) & 0xffffff)
 #define HOT_GET_MOD(key_mod) (((key_mod) >> 24) & 0xff)
 
+// NOTE: One row per rule in cas.ini, affinity masks are mask_word_count words each.
+// A symbolic mask keeps its text in affinity_mask_texts and is resolved again when the topology changes,
+// the text is empty for hex masks. Storage only grows, a reload reuses it. The rows are filled from config,
+// the settings are read from it instead of going back to the file. Window thread only, the timer thread works
+// from a copy of the rules published by cas_set_timer and reports back through cas_read_dones.
 typedef struct
 {
-    WCHAR processes[MAX_ITEMS][64];
-	UINT affinity_masks[MAX_ITEMS];
-    BOOL dones[MAX_ITEMS];
+    WCHAR (*processes)[MAX_PROCESS_LENGTH];
+    uint64_t* affinity_masks;
+    WCHAR (*affinity_mask_texts)[MAX_MASK_TEXT_LENGTH];
+    uint32_t rule_count;
+    uint32_t rule_capacity;
+    uint32_t mask_word_count;
+    CasConfig config;
+    WCHAR* section;
+    DWORD section_capacity;
     DWORD value_type;
     DWORD menu_shortcut;
 } CasDialogConfig;
 
 int cas_dialog_config_load(CasDialogConfig* dialog_config);
+// NOTE: For edits made to cas.ini while cas runs. Nothing changes unless the whole file is valid, bad_line is the
+// line that was not, 0 when memory ran out. Never shows a message box.
+int cas_dialog_config_reload(CasDialogConfig* dialog_config, uint32_t* bad_line);
+CasCpuSet cas_dialog_affinity_mask(CasDialogConfig* dialog_config, uint32_t index);
+void cas_dialog_resolve_masks(CasDialogConfig* dialog_config);
 LRESULT cas_dialog_show(CasDialogConfig* dialog_config);
 void cas_dialog_init(CasDialogConfig* dialog_config, WCHAR* ini_path, HICON icon);
 
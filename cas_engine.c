@@ -0,0 +1,2122 @@
+#include "cas_engine.h"
+
+#define CAS_ENGINE_EMPTY_PID     (0xffffffff)
+#define CAS_ENGINE_FNV_OFFSET    (2166136261u)
+#define CAS_ENGINE_FNV_PRIME     (16777619u)
+// NOTE: Rule line keys that are not predicates, see cas_engine_add_rule_line.
+#define CAS_ENGINE_OPTION_CORES    (0x100)
+#define CAS_ENGINE_OPTION_PRIORITY (0x101)
+#define CAS_ENGINE_OPTION_NICE     (0x102)
+#define CAS_ENGINE_OPTION_SCHED    (0x103)
+#define CAS_ENGINE_OPTION_RTPRIO   (0x104)
+#define CAS_ENGINE_OPTION_IO       (0x105)
+#define CAS_ENGINE_OPTION_MEMORY   (0x106)
+#define CAS_ENGINE_OPTION_ISOLATE  (0x107)
+#define CAS_ENGINE_OPTION_RANK     (0x108)
+#define CAS_ENGINE_MAX_SEED      (1 << 16)
+
+static int cas_engine__grow(void** data, uint32_t* capacity, uint32_t needed, size_t element_size)
+{
+    int result = 1;
+
+    if (needed > *capacity)
+    {
+        uint32_t new_capacity = *capacity ? *capacity : 16;
+        void* new_data = 0;
+
+        while (new_capacity < needed)
+        {
+            new_capacity *= 2;
+        }
+
+        new_data = realloc(*data, new_capacity * element_size);
+
+        if (new_data)
+        {
+            *data = new_data;
+            *capacity = new_capacity;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+static uint32_t cas_engine__power_of_two(uint32_t value)
+{
+    uint32_t result = 16;
+
+    while (result < value)
+    {
+        result *= 2;
+    }
+
+    return result;
+}
+
+static uint8_t cas_engine__fold(uint8_t c)
+{
+    return (c >= 'A' && c <= 'Z') ? (uint8_t)(c + ('a' - 'A')) : c;
+}
+
+// NOTE: FNV-1a over ASCII case folded bytes, so "Game.EXE" and "game.exe" land in the same slot.
+uint32_t cas_engine_hash_name(const char* name, uint32_t length)
+{
+    uint32_t hash = CAS_ENGINE_FNV_OFFSET;
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        hash ^= cas_engine__fold((uint8_t)name[i]);
+        hash *= CAS_ENGINE_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+static int cas_engine__names_equal(const char* folded, const char* name, uint32_t length)
+{
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        if ((uint8_t)folded[i] != cas_engine__fold((uint8_t)name[i]))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+CasProcess* cas_process_table_push(CasProcessTable* table)
+{
+    CasProcess* process = 0;
+
+    if (cas_engine__grow((void**)&table->processes, &table->capacity, table->count + 1, sizeof(CasProcess)))
+    {
+        process = table->processes + table->count++;
+    }
+
+    return process;
+}
+
+void cas_process_table_free(CasProcessTable* table)
+{
+    free(table->processes);
+    memset(table, 0, sizeof(*table));
+}
+
+static uint32_t cas_engine__pid_slot(uint32_t pid, uint32_t mask)
+{
+    // NOTE: PIDs are multiples of 4 on Windows, so mix the bits before masking.
+    return (pid * 2654435761u) & mask;
+}
+
+static int cas_engine__states_reset(CasProcessStateTable* table, uint32_t count)
+{
+    uint32_t capacity = cas_engine__power_of_two(count * 2);
+
+    if (capacity > table->capacity)
+    {
+        CasProcessState* slots = realloc(table->slots, capacity * sizeof(CasProcessState));
+
+        if (!slots)
+        {
+            return 0;
+        }
+
+        table->slots = slots;
+        table->capacity = capacity;
+    }
+
+    for (uint32_t slot = 0; slot < table->capacity; ++slot)
+    {
+        table->slots[slot].pid = CAS_ENGINE_EMPTY_PID;
+    }
+
+    table->count = 0;
+
+    return 1;
+}
+
+static uint32_t cas_engine__states_find(const CasProcessStateTable* table, uint32_t pid)
+{
+    if (table->capacity)
+    {
+        uint32_t mask = table->capacity - 1;
+
+        for (uint32_t slot = cas_engine__pid_slot(pid, mask); table->slots[slot].pid != CAS_ENGINE_EMPTY_PID; slot = (slot + 1) & mask)
+        {
+            if (table->slots[slot].pid == pid)
+            {
+                return slot;
+            }
+        }
+    }
+
+    return CAS_NO_SLOT;
+}
+
+// NOTE: The caller reserves capacity up front, so slot indices stay valid for the whole sweep.
+static uint32_t cas_engine__states_insert(CasProcessStateTable* table, uint32_t pid)
+{
+    uint32_t mask = table->capacity - 1;
+    uint32_t slot = cas_engine__pid_slot(pid, mask);
+
+    while (table->slots[slot].pid != CAS_ENGINE_EMPTY_PID)
+    {
+        if (table->slots[slot].pid == pid)
+        {
+            return slot;
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    memset(table->slots + slot, 0, sizeof(CasProcessState));
+    table->slots[slot].pid = pid;
+    table->slots[slot].rule_index = CAS_NO_RULE;
+    ++table->count;
+
+    return slot;
+}
+
+static int cas_engine__states_reserve(CasProcessStateTable* table, uint32_t extra)
+{
+    if ((table->count + extra) * 2 > table->capacity)
+    {
+        CasProcessStateTable grown = { 0 };
+
+        if (!cas_engine__states_reset(&grown, table->count + extra))
+        {
+            return 0;
+        }
+
+        for (uint32_t slot = 0; slot < table->capacity; ++slot)
+        {
+            if (table->slots[slot].pid != CAS_ENGINE_EMPTY_PID)
+            {
+                grown.slots[cas_engine__states_insert(&grown, table->slots[slot].pid)] = table->slots[slot];
+            }
+        }
+
+        free(table->slots);
+        *table = grown;
+    }
+
+    return 1;
+}
+
+void cas_engine_init(CasEngine* engine)
+{
+    memset(engine, 0, sizeof(*engine));
+    engine->cpu_word_count = 1;
+    cas_rebalancer_init(&engine->rebalancer, engine->cpu_word_count);
+}
+
+void cas_engine_free(CasEngine* engine)
+{
+    free(engine->rule_kinds);
+    free(engine->rule_name_offsets);
+    free(engine->rule_name_lengths);
+    free(engine->rule_name_hashes);
+    free(engine->rule_next_same_name);
+    free(engine->rule_thread_name_offsets);
+    free(engine->rule_thread_name_lengths);
+    free(engine->rule_predicate_offsets);
+    free(engine->rule_predicate_counts);
+    free(engine->rule_rebalance_entries);
+    free(engine->rule_policies);
+    free(engine->rule_isolates);
+    free(engine->rule_ranks);
+    free(engine->name_arena);
+    free(engine->predicates);
+    free(engine->policies);
+    free(engine->mask_words);
+    free(engine->rule_sets);
+    free(engine->rule_set_rules);
+    free(engine->decision_words);
+    free(engine->derived_index);
+    free(engine->scratch_rules);
+    cas_matcher_free(&engine->matcher);
+    cas_rebalancer_free(&engine->rebalancer);
+    free(engine->matcher_state_sets);
+    free(engine->name_entries);
+    free(engine->index_seeds);
+    free(engine->index_entries);
+    free(engine->group_hashes);
+    free(engine->group_rules);
+    free(engine->bucket_starts);
+    free(engine->bucket_entries);
+    free(engine->matches);
+    free(engine->rule_found);
+    free(engine->state_tables[0].slots);
+    free(engine->state_tables[1].slots);
+    free(engine->started_pids);
+    free(engine->exited_pids);
+    free(engine->rule_drifts);
+    free(engine->drift_log_words);
+    free(engine->isolation_words);
+    free(engine->evictions);
+    free(engine->isolation_records);
+    free(engine->isolation_record_words);
+    free(engine->auto_pin_words);
+    free(engine->auto_pin_slots);
+    free(engine->auto_pin_original_words);
+    free(engine->auto_pins);
+    memset(engine, 0, sizeof(*engine));
+}
+
+void cas_engine_clear_rules(CasEngine* engine)
+{
+    engine->rule_count = 0;
+    engine->name_arena_used = 0;
+    engine->predicate_count = 0;
+    engine->policy_count = 0;
+    cas_matcher_clear(&engine->matcher);
+    cas_rebalancer_clear(&engine->rebalancer);
+}
+
+// NOTE: Only valid while there are no rules, masks are stored with the width set here.
+void cas_engine_set_cpu_count(CasEngine* engine, uint32_t cpu_count)
+{
+    ASSERT(engine->rule_count == 0);
+    engine->cpu_word_count = cas_cpu_set_word_count(cpu_count ? cpu_count : 1);
+    engine->rebalancer.cpu_word_count = engine->cpu_word_count;
+}
+
+static int cas_engine__grow_rules(CasEngine* engine, uint32_t needed)
+{
+    uint32_t** arrays[] = { &engine->rule_kinds, &engine->rule_name_offsets, &engine->rule_name_lengths, &engine->rule_name_hashes,
+                            &engine->rule_next_same_name, &engine->rule_thread_name_offsets, &engine->rule_thread_name_lengths,
+                            &engine->rule_predicate_offsets, &engine->rule_predicate_counts, &engine->rule_rebalance_entries,
+                            &engine->rule_policies, &engine->rule_isolates, &engine->rule_ranks };
+    uint32_t capacity = engine->rule_capacity;
+
+    if (needed <= capacity)
+    {
+        return 1;
+    }
+
+    capacity = capacity ? capacity : 16;
+
+    while (capacity < needed)
+    {
+        capacity *= 2;
+    }
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(arrays); ++i)
+    {
+        uint32_t* data = realloc(*arrays[i], capacity * sizeof(uint32_t));
+
+        if (!data)
+        {
+            return 0;
+        }
+
+        *arrays[i] = data;
+    }
+
+    engine->rule_capacity = capacity;
+
+    return 1;
+}
+
+// NOTE: Patterns are kept as written, \\D and \\d are different classes. The matcher folds them itself.
+static uint32_t cas_engine__intern(CasEngine* engine, const char* name, uint32_t length, int is_folded)
+{
+    uint32_t offset = engine->name_arena_used;
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        engine->name_arena[offset + i] = is_folded ? (char)cas_engine__fold((uint8_t)name[i]) : name[i];
+    }
+
+    engine->name_arena[offset + length] = '\0';
+    engine->name_arena_used += length + 1;
+
+    return offset;
+}
+
+int cas_engine_add_thread_rule(CasEngine* engine, const char* name, uint32_t length, const char* thread_name, uint32_t thread_length, const CasCpuSet* affinity_mask)
+{
+    int result = 0;
+    uint32_t rule_index = engine->rule_count;
+    uint32_t mask_offset = rule_index * engine->cpu_word_count;
+    int kind = cas_pattern_kind(name, length);
+
+    // NOTE: A pattern that does not parse is refused like any other rule that can not be added.
+    if (length &&
+        cas_engine__grow_rules(engine, rule_index + 1) &&
+        cas_engine__grow((void**)&engine->name_arena, &engine->name_arena_capacity, engine->name_arena_used + length + thread_length + 2, sizeof(char)) &&
+        cas_engine__grow((void**)&engine->mask_words, &engine->mask_word_capacity, mask_offset + engine->cpu_word_count, sizeof(uint64_t)) &&
+        (!kind || cas_matcher_add(&engine->matcher, name, length, kind, rule_index)))
+    {
+        CasCpuSet mask = { engine->mask_words + mask_offset, engine->cpu_word_count };
+
+        engine->rule_kinds[rule_index] = (uint32_t)kind;
+        engine->rule_name_offsets[rule_index] = cas_engine__intern(engine, name, length, !kind);
+        engine->rule_name_lengths[rule_index] = length;
+        engine->rule_name_hashes[rule_index] = cas_engine_hash_name(name, length);
+        engine->rule_next_same_name[rule_index] = CAS_NO_RULE;
+        engine->rule_thread_name_offsets[rule_index] = cas_engine__intern(engine, thread_name, thread_length, 1);
+        engine->rule_thread_name_lengths[rule_index] = thread_length;
+        engine->rule_predicate_offsets[rule_index] = engine->predicate_count;
+        engine->rule_predicate_counts[rule_index] = 0;
+        engine->rule_rebalance_entries[rule_index] = CAS_NO_RULE;
+        engine->rule_policies[rule_index] = CAS_NO_RULE;
+        engine->rule_isolates[rule_index] = 0;
+        engine->rule_ranks[rule_index] = 0;
+        ++engine->rule_count;
+
+        // NOTE: Narrower masks are zero extended, bits past the engine width are dropped.
+        cas_cpu_set_zero(&mask);
+        memcpy(mask.words, affinity_mask->words, (affinity_mask->word_count < mask.word_count ? affinity_mask->word_count : mask.word_count) * sizeof(uint64_t));
+        result = 1;
+    }
+
+    return result;
+}
+
+int cas_engine_add_rule(CasEngine* engine, const char* name, uint32_t length, const CasCpuSet* affinity_mask)
+{
+    return cas_engine_add_thread_rule(engine, name, length, "", 0, affinity_mask);
+}
+
+static uint32_t cas_engine__predicate_kind(const char* key, uint32_t length)
+{
+    static const struct { const char* key; uint32_t kind; } keys[] =
+    {
+        { "cmdline",  CAS_PREDICATE_CMDLINE },
+        { "path",     CAS_PREDICATE_PATH },
+        { "parent",   CAS_PREDICATE_PARENT },
+        { "user",     CAS_PREDICATE_USER },
+        { "module",   CAS_PREDICATE_MODULE },
+        { "cores",    CAS_ENGINE_OPTION_CORES },
+        { "priority", CAS_ENGINE_OPTION_PRIORITY },
+        { "nice",     CAS_ENGINE_OPTION_NICE },
+        { "sched",    CAS_ENGINE_OPTION_SCHED },
+        { "rtprio",   CAS_ENGINE_OPTION_RTPRIO },
+        { "io",       CAS_ENGINE_OPTION_IO },
+        { "memory",   CAS_ENGINE_OPTION_MEMORY },
+        { "isolate",  CAS_ENGINE_OPTION_ISOLATE },
+        { "rank",     CAS_ENGINE_OPTION_RANK },
+    };
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(keys); ++i)
+    {
+        if (strlen(keys[i].key) == length && !memcmp(keys[i].key, key, length))
+        {
+            return keys[i].kind;
+        }
+    }
+
+    return 0;
+}
+
+static uint32_t cas_engine__segment_end(const char* line, uint32_t start, uint32_t length)
+{
+    while (start < length && line[start] != ';')
+    {
+        ++start;
+    }
+
+    return start;
+}
+
+// NOTE: Digits only, anything else is not a count.
+static uint32_t cas_engine__parse_count(const char* text, uint32_t length, uint32_t max_count)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        if (text[i] < '0' || text[i] > '9' || count > max_count)
+        {
+            return 0;
+        }
+
+        count = count * 10 + (uint32_t)(text[i] - '0');
+    }
+
+    return count <= max_count ? count : 0;
+}
+
+// NOTE: Named values are case insensitive, nice is -20 to 19 and rtprio 1 to 99.
+static int cas_engine__parse_policy(CasPolicy* policy, uint32_t kind, const char* value, uint32_t length)
+{
+    static const struct { uint32_t kind; const char* name; uint32_t value; } names[] =
+    {
+        { CAS_ENGINE_OPTION_PRIORITY, "idle",         CAS_PRIORITY_IDLE },
+        { CAS_ENGINE_OPTION_PRIORITY, "below-normal", CAS_PRIORITY_BELOW_NORMAL },
+        { CAS_ENGINE_OPTION_PRIORITY, "normal",       CAS_PRIORITY_NORMAL },
+        { CAS_ENGINE_OPTION_PRIORITY, "above-normal", CAS_PRIORITY_ABOVE_NORMAL },
+        { CAS_ENGINE_OPTION_PRIORITY, "high",         CAS_PRIORITY_HIGH },
+        { CAS_ENGINE_OPTION_PRIORITY, "realtime",     CAS_PRIORITY_REALTIME },
+        { CAS_ENGINE_OPTION_SCHED,    "other",        CAS_SCHED_OTHER },
+        { CAS_ENGINE_OPTION_SCHED,    "batch",        CAS_SCHED_BATCH },
+        { CAS_ENGINE_OPTION_SCHED,    "idle",         CAS_SCHED_IDLE },
+        { CAS_ENGINE_OPTION_SCHED,    "fifo",         CAS_SCHED_FIFO },
+        { CAS_ENGINE_OPTION_IO,       "very-low",     CAS_IO_VERY_LOW },
+        { CAS_ENGINE_OPTION_IO,       "low",          CAS_IO_LOW },
+        { CAS_ENGINE_OPTION_IO,       "normal",       CAS_IO_NORMAL },
+        { CAS_ENGINE_OPTION_IO,       "high",         CAS_IO_HIGH },
+        { CAS_ENGINE_OPTION_MEMORY,   "very-low",     CAS_MEMORY_VERY_LOW },
+        { CAS_ENGINE_OPTION_MEMORY,   "low",          CAS_MEMORY_LOW },
+        { CAS_ENGINE_OPTION_MEMORY,   "medium",       CAS_MEMORY_MEDIUM },
+        { CAS_ENGINE_OPTION_MEMORY,   "below-normal", CAS_MEMORY_BELOW_NORMAL },
+        { CAS_ENGINE_OPTION_MEMORY,   "normal",       CAS_MEMORY_NORMAL },
+    };
+
+    if (kind == CAS_ENGINE_OPTION_NICE)
+    {
+        int is_negative = length > 1 && value[0] == '-';
+        uint32_t magnitude = cas_engine__parse_count(value + is_negative, length - (uint32_t)is_negative, 20);
+
+        // NOTE: parse_count answers 0 for anything that is not digits, only a literal 0 or -0 is a zero nice.
+        if ((!magnitude && !(length == 1 + (uint32_t)is_negative && value[is_negative] == '0')) || (!is_negative && magnitude > 19))
+        {
+            return 0;
+        }
+
+        policy->nice = is_negative ? -(int32_t)magnitude : (int32_t)magnitude;
+        return 1;
+    }
+
+    if (kind == CAS_ENGINE_OPTION_RTPRIO)
+    {
+        policy->sched_priority = cas_engine__parse_count(value, length, 99);
+        return policy->sched_priority != 0;
+    }
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(names); ++i)
+    {
+        if (names[i].kind == kind && strlen(names[i].name) == length && cas_engine__names_equal(names[i].name, value, length))
+        {
+            uint32_t* field = kind == CAS_ENGINE_OPTION_PRIORITY ? &policy->priority :
+                              kind == CAS_ENGINE_OPTION_SCHED ? &policy->sched :
+                              kind == CAS_ENGINE_OPTION_IO ? &policy->io : &policy->memory;
+
+            *field = names[i].value;
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// NOTE: "name[/thread name][;key=value]..." with cmdline, path, parent, user and module as predicate keys.
+// cores=N is not a predicate, it pins to the N least loaded CPUs of the mask instead of the whole mask.
+// priority, nice, sched, rtprio, io and memory are not predicates either, they make up the policy of the rule.
+// isolate=1 reserves the whole mask, every process no rule matches is kept off it.
+// Everything is checked and reserved before the rule goes in, a bad line adds nothing.
+int cas_engine_add_rule_line(CasEngine* engine, const char* line, uint32_t length, const CasCpuSet* affinity_mask)
+{
+    uint32_t name_length = cas_engine__segment_end(line, 0, length);
+    uint32_t thread_offset = 0;
+    uint32_t predicate_count = 0;
+    uint32_t value_bytes = 0;
+    uint32_t core_count = 0;
+    uint32_t entry_index = CAS_NO_RULE;
+    CasPolicy policy = { 0, CAS_NICE_UNSET, 0, 0, 0, 0 };
+    int has_policy = 0;
+    uint32_t is_isolating = 0;
+    uint32_t rank = 0;
+
+    for (uint32_t start = name_length + 1; start < length; start = cas_engine__segment_end(line, start, length) + 1)
+    {
+        uint32_t end = cas_engine__segment_end(line, start, length);
+        const char* equals = memchr(line + start, '=', end - start);
+
+        if (end == start)
+        {
+            continue;
+        }
+
+        uint32_t kind = equals ? cas_engine__predicate_kind(line + start, (uint32_t)(equals - (line + start))) : 0;
+
+        if (!kind || equals + 1 == line + end)
+        {
+            return 0;
+        }
+
+        if (kind == CAS_ENGINE_OPTION_CORES)
+        {
+            core_count = cas_engine__parse_count(equals + 1, (uint32_t)(line + end - equals - 1), CAS_CPU_SET_MAX_CPUS);
+
+            if (!core_count)
+            {
+                return 0;
+            }
+
+            continue;
+        }
+
+        if (kind == CAS_ENGINE_OPTION_ISOLATE)
+        {
+            is_isolating = cas_engine__parse_count(equals + 1, (uint32_t)(line + end - equals - 1), 1);
+
+            if (!is_isolating)
+            {
+                return 0;
+            }
+
+            continue;
+        }
+
+        if (kind == CAS_ENGINE_OPTION_RANK)
+        {
+            uint32_t value_length = (uint32_t)(line + end - equals - 1);
+
+            rank = cas_engine__parse_count(equals + 1, value_length, CAS_MAX_RANK);
+
+            if (!rank && (value_length != 1 || equals[1] != '0'))
+            {
+                return 0;
+            }
+
+            continue;
+        }
+
+        if (kind > CAS_ENGINE_OPTION_CORES)
+        {
+            if (!cas_engine__parse_policy(&policy, kind, equals + 1, (uint32_t)(line + end - equals - 1)))
+            {
+                return 0;
+            }
+
+            has_policy = 1;
+            continue;
+        }
+
+        ++predicate_count;
+        value_bytes += (uint32_t)(line + end - equals);
+    }
+
+    if (!cas_engine__grow((void**)&engine->predicates, &engine->predicate_capacity, engine->predicate_count + predicate_count, sizeof(CasPredicate)) ||
+        !cas_engine__grow((void**)&engine->policies, &engine->policy_capacity, engine->policy_count + 1, sizeof(CasPolicy)) ||
+        !cas_engine__grow((void**)&engine->name_arena, &engine->name_arena_capacity, engine->name_arena_used + length + 2 + value_bytes, sizeof(char)))
+    {
+        return 0;
+    }
+
+    while (thread_offset < name_length && line[thread_offset] != '/')
+    {
+        ++thread_offset;
+    }
+
+    if (core_count)
+    {
+        entry_index = cas_rebalancer_add(&engine->rebalancer, engine->rule_count, core_count);
+
+        if (entry_index == CAS_NO_CPU)
+        {
+            return 0;
+        }
+    }
+
+    // NOTE: Process names can not contain a slash, the first one starts the thread name.
+    if (!cas_engine_add_thread_rule(engine, line, thread_offset, line + thread_offset + (thread_offset < name_length),
+                                    name_length - thread_offset - (thread_offset < name_length), affinity_mask))
+    {
+        engine->rebalancer.entry_count -= core_count != 0;
+        return 0;
+    }
+
+    engine->rule_rebalance_entries[engine->rule_count - 1] = entry_index;
+    engine->rule_isolates[engine->rule_count - 1] = is_isolating;
+    engine->rule_ranks[engine->rule_count - 1] = rank;
+
+    if (has_policy)
+    {
+        engine->rule_policies[engine->rule_count - 1] = engine->policy_count;
+        engine->policies[engine->policy_count++] = policy;
+    }
+
+    for (uint32_t start = name_length + 1; start < length; start = cas_engine__segment_end(line, start, length) + 1)
+    {
+        uint32_t end = cas_engine__segment_end(line, start, length);
+        const char* equals = memchr(line + start, '=', end - start);
+        uint32_t kind = 0;
+        uint32_t value_length = 0;
+
+        if (end == start)
+        {
+            continue;
+        }
+
+        kind = cas_engine__predicate_kind(line + start, (uint32_t)(equals - (line + start)));
+
+        if (kind >= CAS_ENGINE_OPTION_CORES)
+        {
+            continue;
+        }
+
+        value_length = (uint32_t)(line + end - equals - 1);
+        engine->predicates[engine->predicate_count++] = (CasPredicate)
+        {
+            kind,
+            cas_engine__intern(engine, equals + 1, value_length, 1),
+            value_length,
+        };
+        ++engine->rule_predicate_counts[engine->rule_count - 1];
+    }
+
+    return 1;
+}
+
+// NOTE: A rebalanced rule answers with its current selection, the whole mask until the first loads came in.
+CasCpuSet cas_engine_rule_mask(const CasEngine* engine, uint32_t rule_index)
+{
+    CasCpuSet mask = { engine->mask_words + rule_index * engine->cpu_word_count, engine->cpu_word_count };
+    CasCpuSet selection;
+    uint32_t entry_index = engine->rule_rebalance_entries[rule_index];
+
+    if (entry_index != CAS_NO_RULE && cas_rebalancer_selection(&engine->rebalancer, entry_index, &selection))
+    {
+        mask = selection;
+    }
+
+    return mask;
+}
+
+CasCpuSet cas_engine_match_mask(const CasEngine* engine, uint32_t rule_set, uint32_t rule_index)
+{
+    uint32_t mask_offset = engine->rule_sets[rule_set].mask_offset;
+    CasCpuSet mask = { engine->decision_words + mask_offset, engine->cpu_word_count };
+
+    return mask_offset != CAS_NO_RULE ? mask : cas_engine_rule_mask(engine, rule_index);
+}
+
+const CasPolicy* cas_engine_rule_policy(const CasEngine* engine, uint32_t rule_index)
+{
+    uint32_t policy_index = engine->rule_policies[rule_index];
+
+    return policy_index != CAS_NO_RULE ? engine->policies + policy_index : 0;
+}
+
+static uint32_t cas_engine__mask_version(const CasEngine* engine, uint32_t rule_index)
+{
+    uint32_t entry_index = engine->rule_rebalance_entries[rule_index];
+
+    return entry_index != CAS_NO_RULE ? engine->rebalancer.entries[entry_index].version : 0;
+}
+
+// NOTE: busy and total are cumulative per CPU times, see cas_rebalancer_sample.
+int cas_engine_rebalance(CasEngine* engine, const uint64_t* busy, const uint64_t* total, uint32_t cpu_count)
+{
+    return cas_rebalancer_sample(&engine->rebalancer, busy, total, cpu_count, engine->mask_words);
+}
+
+const char* cas_engine_rule_name(const CasEngine* engine, uint32_t rule_index)
+{
+    return engine->name_arena + engine->rule_name_offsets[rule_index];
+}
+
+static uint32_t cas_engine__perfect_slot(uint32_t hash, uint32_t seed, uint32_t shift)
+{
+    return ((hash ^ seed) * 2654435761u) >> shift;
+}
+
+// NOTE: Compiles what a match of the set does, so matching a process is a lookup of its set. Of the process rules
+// with the highest rank the last one wins, or the first one with CAS_MERGE_FIRST. Intersect and union merge the
+// masks of all of them and apply the winner's policy with it. An empty intersection keeps the winner's mask.
+static int cas_engine__decide(CasEngine* engine, CasRuleSet* set)
+{
+    const uint32_t* rules = engine->rule_set_rules + set->offset;
+    uint32_t top_rank = 0;
+    uint32_t top_count = 0;
+
+    set->has_thread_rules = 0;
+    set->rule_index = CAS_NO_RULE;
+    set->mask_offset = CAS_NO_RULE;
+
+    for (uint32_t i = 0; i < set->count; ++i)
+    {
+        uint32_t rule_index = rules[i];
+        uint32_t rank = engine->rule_ranks[rule_index];
+
+        if (engine->rule_thread_name_lengths[rule_index])
+        {
+            set->has_thread_rules = 1;
+        }
+        else if (set->rule_index == CAS_NO_RULE || rank > top_rank)
+        {
+            set->rule_index = rule_index;
+            top_rank = rank;
+            top_count = 1;
+        }
+        else if (rank == top_rank)
+        {
+            set->rule_index = engine->merge == CAS_MERGE_FIRST ? set->rule_index : rule_index;
+            ++top_count;
+        }
+    }
+
+    if (top_count > 1 && (engine->merge == CAS_MERGE_INTERSECT || engine->merge == CAS_MERGE_UNION))
+    {
+        uint32_t mask_offset = engine->decision_word_count;
+        int is_first = 1;
+
+        if (!cas_engine__grow((void**)&engine->decision_words, &engine->decision_word_capacity, mask_offset + engine->cpu_word_count, sizeof(uint64_t)))
+        {
+            return 0;
+        }
+
+        CasCpuSet merged = { engine->decision_words + mask_offset, engine->cpu_word_count };
+
+        for (uint32_t i = 0; i < set->count; ++i)
+        {
+            uint32_t rule_index = rules[i];
+            CasCpuSet mask = { engine->mask_words + (size_t)rule_index * engine->cpu_word_count, engine->cpu_word_count };
+
+            if (engine->rule_thread_name_lengths[rule_index] || engine->rule_ranks[rule_index] != top_rank)
+            {
+                continue;
+            }
+
+            if (is_first)
+            {
+                cas_cpu_set_copy(&merged, &mask);
+                is_first = 0;
+            }
+            else if (engine->merge == CAS_MERGE_INTERSECT)
+            {
+                cas_cpu_set_and(&merged, &merged, &mask);
+            }
+            else
+            {
+                cas_cpu_set_or(&merged, &merged, &mask);
+            }
+        }
+
+        if (!cas_cpu_set_is_empty(&merged))
+        {
+            set->mask_offset = mask_offset;
+            engine->decision_word_count += engine->cpu_word_count;
+        }
+    }
+
+    return 1;
+}
+
+static int cas_engine__push_rule_set(CasEngine* engine, uint32_t offset)
+{
+    uint32_t has_predicates = 0;
+    CasRuleSet* set = 0;
+
+    if (!cas_engine__grow((void**)&engine->rule_sets, &engine->rule_set_capacity, engine->rule_set_count + 1, sizeof(CasRuleSet)))
+    {
+        return 0;
+    }
+
+    for (uint32_t i = offset; i < engine->rule_set_rule_count; ++i)
+    {
+        has_predicates |= engine->rule_predicate_counts[engine->rule_set_rules[i]] != 0;
+    }
+
+    set = engine->rule_sets + engine->rule_set_count;
+    *set = (CasRuleSet){ offset, engine->rule_set_rule_count - offset, has_predicates, 0, CAS_NO_RULE, CAS_NO_RULE };
+
+    if (!cas_engine__decide(engine, set))
+    {
+        return 0;
+    }
+
+    ++engine->rule_set_count;
+
+    return 1;
+}
+
+static int cas_engine__push_set_rule(CasEngine* engine, uint32_t rule_index)
+{
+    if (!cas_engine__grow((void**)&engine->rule_set_rules, &engine->rule_set_rule_capacity, engine->rule_set_rule_count + 1, sizeof(uint32_t)))
+    {
+        return 0;
+    }
+
+    engine->rule_set_rules[engine->rule_set_rule_count++] = rule_index;
+
+    return 1;
+}
+
+// NOTE: Groups exact rules by name into entries, rules with the same name are linked in configuration order.
+static int cas_engine__group_names(CasEngine* engine)
+{
+    uint32_t capacity = cas_engine__power_of_two(engine->rule_count * 2);
+    uint32_t mask = 0;
+
+    if (capacity > engine->group_capacity)
+    {
+        uint32_t* hashes = realloc(engine->group_hashes, capacity * sizeof(uint32_t));
+        uint32_t* rules = 0;
+
+        if (!hashes)
+        {
+            return 0;
+        }
+
+        engine->group_hashes = hashes;
+        rules = realloc(engine->group_rules, capacity * sizeof(uint32_t));
+
+        if (!rules)
+        {
+            return 0;
+        }
+
+        engine->group_rules = rules;
+        engine->group_capacity = capacity;
+    }
+
+    if (!cas_engine__grow((void**)&engine->name_entries, &engine->name_entry_capacity, engine->rule_count, sizeof(CasNameEntry)))
+    {
+        return 0;
+    }
+
+    memset(engine->group_rules, 0xff, engine->group_capacity * sizeof(uint32_t));
+    mask = engine->group_capacity - 1;
+    engine->name_entry_count = 0;
+
+    for (uint32_t rule_index = 0; rule_index < engine->rule_count; ++rule_index)
+    {
+        uint32_t name_hash = engine->rule_name_hashes[rule_index];
+        uint32_t name_length = engine->rule_name_lengths[rule_index];
+        uint32_t slot = name_hash & mask;
+
+        engine->rule_next_same_name[rule_index] = CAS_NO_RULE;
+
+        if (engine->rule_kinds[rule_index])
+        {
+            continue;
+        }
+
+        for (;;)
+        {
+            uint32_t first = engine->group_rules[slot];
+
+            if (first == CAS_NO_RULE)
+            {
+                engine->group_hashes[slot] = name_hash;
+                engine->group_rules[slot] = rule_index;
+                engine->name_entries[engine->name_entry_count++] = (CasNameEntry){ name_hash, rule_index, CAS_NO_RULE, CAS_NO_RULE };
+                break;
+            }
+
+            if (engine->group_hashes[slot] == name_hash && engine->rule_name_lengths[first] == name_length &&
+                !memcmp(cas_engine_rule_name(engine, first), cas_engine_rule_name(engine, rule_index), name_length))
+            {
+                uint32_t last = first;
+
+                while (engine->rule_next_same_name[last] != CAS_NO_RULE)
+                {
+                    last = engine->rule_next_same_name[last];
+                }
+
+                engine->rule_next_same_name[last] = rule_index;
+                break;
+            }
+
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: The rules of an exact name merged with the patterns that also match it, both lists are already ascending.
+static int cas_engine__build_rule_sets(CasEngine* engine)
+{
+    const CasMatcher* matcher = &engine->matcher;
+
+    engine->rule_set_count = 0;
+    engine->rule_set_rule_count = 0;
+    engine->decision_word_count = 0;
+
+    for (uint32_t entry_index = 0; entry_index < engine->name_entry_count; ++entry_index)
+    {
+        CasNameEntry* entry = engine->name_entries + entry_index;
+        uint32_t offset = engine->rule_set_rule_count;
+        uint32_t state = cas_matcher_run(matcher, cas_engine_rule_name(engine, entry->rule_index), engine->rule_name_lengths[entry->rule_index]);
+        const uint32_t* accepts = matcher->accepts + (state ? matcher->state_accept_offsets[state] : 0);
+        uint32_t accept_count = state ? matcher->state_accept_counts[state] : 0;
+        uint32_t rule_index = entry->rule_index;
+        uint32_t i = 0;
+
+        while (rule_index != CAS_NO_RULE || i < accept_count)
+        {
+            int is_exact = rule_index != CAS_NO_RULE && (i == accept_count || rule_index < accepts[i]);
+
+            if (!cas_engine__push_set_rule(engine, is_exact ? rule_index : accepts[i]))
+            {
+                return 0;
+            }
+
+            if (is_exact)
+            {
+                rule_index = engine->rule_next_same_name[rule_index];
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        entry->rule_set = engine->rule_set_count;
+
+        if (!cas_engine__push_rule_set(engine, offset))
+        {
+            return 0;
+        }
+    }
+
+    if (!cas_engine__grow((void**)&engine->matcher_state_sets, &engine->matcher_state_set_capacity, matcher->state_count + 1, sizeof(uint32_t)))
+    {
+        return 0;
+    }
+
+    engine->matcher_state_sets[CAS_MATCHER_DEAD_STATE] = CAS_NO_RULE;
+
+    for (uint32_t state = 1; state < matcher->state_count; ++state)
+    {
+        uint32_t offset = engine->rule_set_rule_count;
+
+        engine->matcher_state_sets[state] = CAS_NO_RULE;
+
+        if (!matcher->state_accept_counts[state])
+        {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < matcher->state_accept_counts[state]; ++i)
+        {
+            if (!cas_engine__push_set_rule(engine, matcher->accepts[matcher->state_accept_offsets[state] + i]))
+            {
+                return 0;
+            }
+        }
+
+        engine->matcher_state_sets[state] = engine->rule_set_count;
+
+        if (!cas_engine__push_rule_set(engine, offset))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: Hash and displace. Entries are bucketed by the low hash bits and the biggest buckets are placed first,
+// each bucket tries seeds until all of its entries land in free slots. A table that runs out of seeds is doubled.
+static int cas_engine__build_perfect_hash(CasEngine* engine)
+{
+    uint32_t count = engine->name_entry_count;
+    uint32_t bucket_count = cas_engine__power_of_two(count / 4);
+    uint32_t capacity = cas_engine__power_of_two(count * 2);
+
+    for (;;)
+    {
+        uint32_t shift = 32;
+        uint32_t largest = 0;
+        int is_placed = 1;
+
+        if (!cas_engine__grow((void**)&engine->index_seeds, &engine->index_seed_capacity, bucket_count, sizeof(uint32_t)) ||
+            !cas_engine__grow((void**)&engine->index_entries, &engine->index_capacity, capacity, sizeof(uint32_t)) ||
+            !cas_engine__grow((void**)&engine->bucket_starts, &engine->bucket_start_capacity, bucket_count + 1, sizeof(uint32_t)) ||
+            !cas_engine__grow((void**)&engine->bucket_entries, &engine->bucket_entry_capacity, count + 1, sizeof(uint32_t)))
+        {
+            return 0;
+        }
+
+        for (uint32_t size = capacity; size > 1; size /= 2)
+        {
+            --shift;
+        }
+
+        engine->index_bucket_count = bucket_count;
+        engine->index_shift = shift;
+        memset(engine->index_entries, 0xff, capacity * sizeof(uint32_t));
+        memset(engine->bucket_starts, 0, (bucket_count + 1) * sizeof(uint32_t));
+
+        for (uint32_t entry = 0; entry < count; ++entry)
+        {
+            engine->name_entries[entry].next = CAS_NO_RULE;
+            ++engine->bucket_starts[(engine->name_entries[entry].hash & (bucket_count - 1)) + 1];
+        }
+
+        for (uint32_t bucket = 0; bucket < bucket_count; ++bucket)
+        {
+            uint32_t size = engine->bucket_starts[bucket + 1];
+
+            largest = size > largest ? size : largest;
+            engine->bucket_starts[bucket + 1] += engine->bucket_starts[bucket];
+            engine->index_seeds[bucket] = engine->bucket_starts[bucket];
+        }
+
+        // NOTE: index_seeds is the fill cursor until the seeds are chosen.
+        for (uint32_t entry = 0; entry < count; ++entry)
+        {
+            engine->bucket_entries[engine->index_seeds[engine->name_entries[entry].hash & (bucket_count - 1)]++] = entry;
+        }
+
+        memset(engine->index_seeds, 0, bucket_count * sizeof(uint32_t));
+
+        for (uint32_t size = largest; size > 0 && is_placed; --size)
+        {
+            for (uint32_t bucket = 0; bucket < bucket_count && is_placed; ++bucket)
+            {
+                uint32_t* members = engine->bucket_entries + engine->bucket_starts[bucket];
+                uint32_t member_count = engine->bucket_starts[bucket + 1] - engine->bucket_starts[bucket];
+                uint32_t seed = 0;
+
+                if (member_count != size)
+                {
+                    continue;
+                }
+
+                // NOTE: Different names with the same 32 bit hash can never be separated, they share the first one's slot.
+                for (uint32_t i = 1; i < member_count; ++i)
+                {
+                    for (uint32_t j = 0; j < i; ++j)
+                    {
+                        if (members[j] != CAS_NO_RULE && engine->name_entries[members[j]].hash == engine->name_entries[members[i]].hash)
+                        {
+                            engine->name_entries[members[i]].next = engine->name_entries[members[j]].next;
+                            engine->name_entries[members[j]].next = members[i];
+                            members[i] = CAS_NO_RULE;
+                            break;
+                        }
+                    }
+                }
+
+                for (; seed < CAS_ENGINE_MAX_SEED; ++seed)
+                {
+                    uint32_t placed = 0;
+
+                    for (; placed < member_count; ++placed)
+                    {
+                        uint32_t slot = 0;
+
+                        if (members[placed] == CAS_NO_RULE)
+                        {
+                            continue;
+                        }
+
+                        slot = cas_engine__perfect_slot(engine->name_entries[members[placed]].hash, seed, shift);
+
+                        if (engine->index_entries[slot] != CAS_NO_RULE)
+                        {
+                            break;
+                        }
+
+                        engine->index_entries[slot] = members[placed];
+                    }
+
+                    if (placed == member_count)
+                    {
+                        break;
+                    }
+
+                    for (uint32_t i = 0; i < placed; ++i)
+                    {
+                        if (members[i] != CAS_NO_RULE)
+                        {
+                            engine->index_entries[cas_engine__perfect_slot(engine->name_entries[members[i]].hash, seed, shift)] = CAS_NO_RULE;
+                        }
+                    }
+                }
+
+                engine->index_seeds[bucket] = seed;
+                is_placed = seed < CAS_ENGINE_MAX_SEED;
+            }
+        }
+
+        if (is_placed)
+        {
+            return 1;
+        }
+
+        capacity *= 2;
+    }
+}
+
+void cas_engine_set_merge(CasEngine* engine, uint32_t merge)
+{
+    engine->merge = merge;
+}
+
+int cas_engine_build_index(CasEngine* engine)
+{
+    uint8_t* rule_found = realloc(engine->rule_found, engine->rule_count ? engine->rule_count : 1);
+    CasRuleDrift* rule_drifts = rule_found ? realloc(engine->rule_drifts, (engine->rule_count ? engine->rule_count : 1) * sizeof(CasRuleDrift)) : 0;
+    uint64_t* drift_log_words = rule_drifts ? realloc(engine->drift_log_words, CAS_DRIFT_LOG_SIZE * engine->cpu_word_count * sizeof(uint64_t)) : 0;
+    uint64_t* isolation_words = drift_log_words ? realloc(engine->isolation_words, engine->cpu_word_count * sizeof(uint64_t)) : 0;
+
+    engine->rule_found = rule_found ? rule_found : engine->rule_found;
+    engine->rule_drifts = rule_drifts ? rule_drifts : engine->rule_drifts;
+    engine->drift_log_words = drift_log_words ? drift_log_words : engine->drift_log_words;
+    engine->isolation_words = isolation_words ? isolation_words : engine->isolation_words;
+
+    if (!isolation_words)
+    {
+        return 0;
+    }
+
+    memset(rule_drifts, 0, (engine->rule_count ? engine->rule_count : 1) * sizeof(CasRuleDrift));
+    memset(isolation_words, 0, engine->cpu_word_count * sizeof(uint64_t));
+    engine->isolation_rule_count = 0;
+
+    for (uint32_t rule_index = 0; rule_index < engine->rule_count; ++rule_index)
+    {
+        if (engine->rule_isolates[rule_index])
+        {
+            for (uint32_t i = 0; i < engine->cpu_word_count; ++i)
+            {
+                isolation_words[i] |= engine->mask_words[(size_t)rule_index * engine->cpu_word_count + i];
+            }
+
+            ++engine->isolation_rule_count;
+        }
+    }
+    ++engine->generation;
+
+    if (!cas_matcher_compile(&engine->matcher) ||
+        !cas_engine__group_names(engine) ||
+        !cas_engine__build_rule_sets(engine) ||
+        !cas_engine__build_perfect_hash(engine))
+    {
+        return 0;
+    }
+
+    engine->base_rule_set_count = engine->rule_set_count;
+
+    if (engine->derived_index)
+    {
+        memset(engine->derived_index, 0xff, engine->derived_index_capacity * sizeof(uint32_t));
+    }
+
+    return 1;
+}
+
+// NOTE: An exact name costs one slot lookup and a compare, anything else is one run of the matcher.
+uint32_t cas_engine_find_rule_set(const CasEngine* engine, const CasProcess* process)
+{
+    if (engine->name_entry_count)
+    {
+        uint32_t seed = engine->index_seeds[process->name_hash & (engine->index_bucket_count - 1)];
+        uint32_t entry = engine->index_entries[cas_engine__perfect_slot(process->name_hash, seed, engine->index_shift)];
+
+        for (; entry != CAS_NO_RULE; entry = engine->name_entries[entry].next)
+        {
+            uint32_t rule_index = engine->name_entries[entry].rule_index;
+
+            if (engine->name_entries[entry].hash == process->name_hash && engine->rule_name_lengths[rule_index] == process->name_length &&
+                cas_engine__names_equal(cas_engine_rule_name(engine, rule_index), process->name, process->name_length))
+            {
+                return engine->name_entries[entry].rule_set;
+            }
+        }
+    }
+
+    if (engine->matcher.pattern_count)
+    {
+        return engine->matcher_state_sets[cas_matcher_run(&engine->matcher, process->name, process->name_length)];
+    }
+
+    return CAS_NO_RULE;
+}
+
+// NOTE: Same rule as for processes, the matching thread rule of the highest rank wins and ties go to the last one
+// in configuration order, or the first one with CAS_MERGE_FIRST. Thread masks are never merged.
+uint32_t cas_engine_find_thread_rule(const CasEngine* engine, uint32_t rule_set, const char* thread_name, uint32_t thread_length)
+{
+    const CasRuleSet* set = engine->rule_sets + rule_set;
+    uint32_t result = CAS_NO_RULE;
+
+    for (uint32_t i = 0; i < set->count; ++i)
+    {
+        uint32_t rule_index = engine->rule_set_rules[set->offset + i];
+        uint32_t length = engine->rule_thread_name_lengths[rule_index];
+
+        if (length && length == thread_length &&
+            cas_engine__names_equal(engine->name_arena + engine->rule_thread_name_offsets[rule_index], thread_name, thread_length) &&
+            (result == CAS_NO_RULE || engine->rule_ranks[rule_index] > engine->rule_ranks[result] ||
+             (engine->rule_ranks[rule_index] == engine->rule_ranks[result] && engine->merge != CAS_MERGE_FIRST)))
+        {
+            result = rule_index;
+        }
+    }
+
+    return result;
+}
+
+static uint32_t cas_engine__hash_rules(const uint32_t* rules, uint32_t count)
+{
+    uint32_t hash = CAS_ENGINE_FNV_OFFSET;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        hash = (hash ^ rules[i]) * CAS_ENGINE_FNV_PRIME;
+    }
+
+    return hash;
+}
+
+// NOTE: Finds or adds the derived set holding exactly the scratch rules.
+static int cas_engine__derived_set(CasEngine* engine, uint32_t count, uint32_t* rule_set)
+{
+    uint32_t hash = cas_engine__hash_rules(engine->scratch_rules, count);
+    uint32_t derived_count = engine->rule_set_count - engine->base_rule_set_count;
+    uint32_t mask = 0;
+    uint32_t slot = 0;
+
+    if ((derived_count + 1) * 2 > engine->derived_index_capacity)
+    {
+        uint32_t capacity = cas_engine__power_of_two((derived_count + 1) * 2);
+        uint32_t* index = realloc(engine->derived_index, capacity * sizeof(uint32_t));
+
+        if (!index)
+        {
+            return 0;
+        }
+
+        engine->derived_index = index;
+        engine->derived_index_capacity = capacity;
+        memset(index, 0xff, capacity * sizeof(uint32_t));
+
+        for (uint32_t set_index = engine->base_rule_set_count; set_index < engine->rule_set_count; ++set_index)
+        {
+            const CasRuleSet* set = engine->rule_sets + set_index;
+
+            for (slot = cas_engine__hash_rules(engine->rule_set_rules + set->offset, set->count) & (capacity - 1);
+                 index[slot] != CAS_NO_RULE; slot = (slot + 1) & (capacity - 1))
+            {
+            }
+
+            index[slot] = set_index;
+        }
+    }
+
+    mask = engine->derived_index_capacity - 1;
+
+    for (slot = hash & mask; engine->derived_index[slot] != CAS_NO_RULE; slot = (slot + 1) & mask)
+    {
+        const CasRuleSet* set = engine->rule_sets + engine->derived_index[slot];
+
+        if (set->count == count && !memcmp(engine->rule_set_rules + set->offset, engine->scratch_rules, count * sizeof(uint32_t)))
+        {
+            *rule_set = engine->derived_index[slot];
+            return 1;
+        }
+    }
+
+    uint32_t offset = engine->rule_set_rule_count;
+
+    if (!cas_engine__grow((void**)&engine->rule_set_rules, &engine->rule_set_rule_capacity, offset + count, sizeof(uint32_t)))
+    {
+        return 0;
+    }
+
+    memcpy(engine->rule_set_rules + offset, engine->scratch_rules, count * sizeof(uint32_t));
+    engine->rule_set_rule_count += count;
+
+    if (!cas_engine__push_rule_set(engine, offset))
+    {
+        engine->rule_set_rule_count = offset;
+        return 0;
+    }
+
+    // NOTE: Every rule in a derived set already passed, it is never evaluated again.
+    engine->rule_sets[engine->rule_set_count - 1].has_predicates = 0;
+    engine->derived_index[slot] = engine->rule_set_count - 1;
+    *rule_set = engine->rule_set_count - 1;
+
+    return 1;
+}
+
+static int cas_engine__predicates_pass(CasEngine* engine, const CasProcess* process, uint32_t rule_index)
+{
+    const CasPredicate* predicates = engine->predicates + engine->rule_predicate_offsets[rule_index];
+
+    for (uint32_t i = 0; i < engine->rule_predicate_counts[rule_index]; ++i)
+    {
+        ++engine->counters.predicate_evaluations;
+
+        if (!engine->predicate_function ||
+            !engine->predicate_function(engine->predicate_context, process, predicates[i].kind,
+                                        engine->name_arena + predicates[i].value_offset, predicates[i].value_length))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: Predicates only run once the name matched, and only once per process and rule generation.
+// The answer is kept in the process state and carried from sweep to sweep with it.
+static int cas_engine__resolve_rule_set(CasEngine* engine, const CasProcess* process, CasProcessState* state, uint32_t* rule_set)
+{
+    const CasRuleSet* set = engine->rule_sets + *rule_set;
+    uint32_t count = 0;
+    uint32_t result = *rule_set;
+
+    if (!set->has_predicates)
+    {
+        return 1;
+    }
+
+    if (state->rule_set_generation == engine->generation && state->base_rule_set == *rule_set)
+    {
+        *rule_set = state->rule_set;
+        return 1;
+    }
+
+    if (!cas_engine__grow((void**)&engine->scratch_rules, &engine->scratch_rule_capacity, set->count, sizeof(uint32_t)))
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < set->count; ++i)
+    {
+        uint32_t rule_index = engine->rule_set_rules[set->offset + i];
+
+        if (cas_engine__predicates_pass(engine, process, rule_index))
+        {
+            engine->scratch_rules[count++] = rule_index;
+        }
+    }
+
+    if (count != set->count)
+    {
+        result = CAS_NO_RULE;
+
+        if (count && !cas_engine__derived_set(engine, count, &result))
+        {
+            return 0;
+        }
+    }
+
+    state->base_rule_set = *rule_set;
+    state->rule_set = result;
+    state->rule_set_generation = engine->generation;
+    *rule_set = result;
+
+    return 1;
+}
+
+// NOTE: Processes no rule matched are moved off the reserved CPUs while isolating rules exist and moved back once
+// there are none. Like a match, a process answered since the last index build is not looked at again.
+static int cas_engine__evict(CasEngine* engine, const CasProcess* process, uint32_t process_index, uint32_t state_index)
+{
+    CasProcessState* state = engine->state_tables[engine->current_state_table].slots + state_index;
+    int is_answered = state->rule_index == CAS_NO_RULE && state->generation == engine->generation &&
+                      (state->status == CAS_STATUS_PINNED || (state->status == CAS_STATUS_DENIED && (int32_t)(engine->tick - state->retry_tick) < 0));
+    uint32_t is_recorded = state->isolation_record && engine->isolation_records[state->isolation_record - 1].is_saved;
+
+    state->rule_index = CAS_NO_RULE;
+
+    if (!engine->isolation_rule_count && !is_recorded && state->isolation_record)
+    {
+        engine->isolation_records[state->isolation_record - 1].pid = CAS_ENGINE_EMPTY_PID;
+        state->isolation_record = 0;
+    }
+
+    if (is_answered || (!engine->isolation_rule_count && !is_recorded))
+    {
+        return 1;
+    }
+
+    if (!cas_engine__grow((void**)&engine->evictions, &engine->eviction_capacity, engine->eviction_count + 1, sizeof(CasEviction)))
+    {
+        return 0;
+    }
+
+    if (!state->isolation_record)
+    {
+        uint32_t record_index = engine->isolation_record_count;
+
+        if (!cas_engine__grow((void**)&engine->isolation_records, &engine->isolation_record_capacity, record_index + 1, sizeof(CasIsolationRecord)) ||
+            !cas_engine__grow((void**)&engine->isolation_record_words, &engine->isolation_record_word_capacity,
+                              (record_index + 1) * engine->cpu_word_count, sizeof(uint64_t)))
+        {
+            return 0;
+        }
+
+        engine->isolation_records[record_index] = (CasIsolationRecord){ process->pid, 0, process->create_time };
+        state->isolation_record = ++engine->isolation_record_count;
+    }
+
+    engine->evictions[engine->eviction_count++] = (CasEviction){ process_index, state_index, CAS_STATUS_UNKNOWN, is_recorded };
+
+    return 1;
+}
+
+// NOTE: Keeps the records of processes still running and restored ones out, the states follow their record.
+static void cas_engine__compact_records(CasEngine* engine, CasProcessStateTable* states)
+{
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i < engine->isolation_record_count; ++i)
+    {
+        CasIsolationRecord record = engine->isolation_records[i];
+        uint32_t slot = record.pid != CAS_ENGINE_EMPTY_PID ? cas_engine__states_find(states, record.pid) : CAS_NO_SLOT;
+
+        if (slot == CAS_NO_SLOT || states->slots[slot].create_time != record.create_time || states->slots[slot].isolation_record != i + 1)
+        {
+            continue;
+        }
+
+        engine->isolation_records[count] = record;
+        memmove(engine->isolation_record_words + (size_t)count * engine->cpu_word_count,
+                engine->isolation_record_words + (size_t)i * engine->cpu_word_count, engine->cpu_word_count * sizeof(uint64_t));
+        states->slots[slot].isolation_record = ++count;
+    }
+
+    engine->isolation_record_count = count;
+}
+
+// NOTE: Frees the CPUs of processes that are gone or no longer own theirs, like the isolation records.
+static void cas_engine__compact_auto_pins(CasEngine* engine, const CasProcessStateTable* states)
+{
+    for (uint32_t cpu = 0; cpu < engine->auto_pin_slot_count; ++cpu)
+    {
+        CasAutoPinSlot* auto_pin_slot = engine->auto_pin_slots + cpu;
+        uint32_t slot = auto_pin_slot->pid != CAS_ENGINE_EMPTY_PID ? cas_engine__states_find(states, auto_pin_slot->pid) : CAS_NO_SLOT;
+
+        if (slot == CAS_NO_SLOT || states->slots[slot].create_time != auto_pin_slot->create_time || states->slots[slot].auto_pin_cpu != cpu + 1)
+        {
+            auto_pin_slot->pid = CAS_ENGINE_EMPTY_PID;
+        }
+    }
+}
+
+// NOTE: Only looks at CPU times, a process that did not run since the last sweep costs one compare. A process runs
+// hot while every sweep finds it over the threshold, an auto-pinned one counts the time it stays under half of it.
+static void cas_engine__sample(CasEngine* engine, const CasProcess* process, CasProcessState* state, uint64_t elapsed)
+{
+    uint64_t busy = process->cpu_time > state->cpu_time ? process->cpu_time - state->cpu_time : 0;
+    int is_streak = 0;
+
+    state->cpu_time = process->cpu_time;
+
+    if (!busy && !state->auto_pin_cpu)
+    {
+        state->auto_pin_since = 0;
+        return;
+    }
+
+    is_streak = state->auto_pin_cpu ? busy * 200 < elapsed * engine->auto_pin_threshold : elapsed && busy * 100 >= elapsed * engine->auto_pin_threshold;
+
+    if (!is_streak)
+    {
+        state->auto_pin_since = 0;
+    }
+    else if (!state->auto_pin_since)
+    {
+        state->auto_pin_since = engine->sampled_time;
+    }
+}
+
+static int cas_engine__push_auto_pin(CasEngine* engine, uint32_t process_index, uint32_t state_index, uint32_t cpu, uint32_t is_release)
+{
+    if (!cas_engine__grow((void**)&engine->auto_pins, &engine->auto_pin_capacity, engine->auto_pin_count + 1, sizeof(CasAutoPin)))
+    {
+        return 0;
+    }
+
+    engine->auto_pins[engine->auto_pin_count++] = (CasAutoPin){ process_index, state_index, cpu, is_release, CAS_STATUS_UNKNOWN };
+
+    return 1;
+}
+
+// NOTE: Hands a free CPU of the pool to a process that ran hot for auto_pin_time and takes it back once it ran
+// cold for as long, or right away when auto-pin was turned off or the CPU left the pool. Reserved CPUs are not
+// handed out, an auto-pinned process is not evicted.
+static int cas_engine__auto_pin(CasEngine* engine, const CasProcess* process, uint32_t process_index, uint32_t state_index, int* is_pinned)
+{
+    CasProcessState* state = engine->state_tables[engine->current_state_table].slots + state_index;
+    CasCpuSet pool = { engine->auto_pin_words, engine->cpu_word_count };
+    CasCpuSet reserved = cas_engine_isolation_mask(engine);
+    int is_due = state->auto_pin_since && engine->sample_time - state->auto_pin_since >= engine->auto_pin_time;
+    uint32_t cpu = state->auto_pin_cpu - 1;
+
+    *is_pinned = 0;
+
+    if (state->auto_pin_cpu && (cpu >= engine->auto_pin_slot_count || engine->auto_pin_slots[cpu].pid != process->pid))
+    {
+        state->auto_pin_cpu = 0;
+    }
+
+    if (state->auto_pin_cpu)
+    {
+        *is_pinned = 1;
+
+        if (!engine->auto_pin_threshold || is_due || !cas_cpu_set_contains(&pool, cpu) || cas_cpu_set_contains(&reserved, cpu))
+        {
+            state->auto_pin_since = 0;
+
+            return cas_engine__push_auto_pin(engine, process_index, state_index, cpu, 1);
+        }
+
+        return 1;
+    }
+
+    if (!engine->auto_pin_threshold || !is_due)
+    {
+        return 1;
+    }
+
+    // NOTE: A refused auto-pin backs off like a refused match. Evictions of the process go by the same state, both
+    // need the same access to its mask.
+    if (state->status == CAS_STATUS_DENIED && state->generation == engine->generation && (int32_t)(engine->tick - state->retry_tick) < 0)
+    {
+        return 1;
+    }
+
+    for (cpu = cas_cpu_set_next(&pool, 0); cpu != CAS_NO_CPU && cpu < engine->auto_pin_slot_count; cpu = cas_cpu_set_next(&pool, cpu + 1))
+    {
+        if (engine->auto_pin_slots[cpu].pid == CAS_ENGINE_EMPTY_PID && !cas_cpu_set_contains(&reserved, cpu))
+        {
+            engine->auto_pin_slots[cpu] = (CasAutoPinSlot){ process->pid, process->create_time };
+            state->auto_pin_cpu = cpu + 1;
+            state->auto_pin_since = 0;
+            *is_pinned = 1;
+
+            return cas_engine__push_auto_pin(engine, process_index, state_index, cpu, 0);
+        }
+    }
+
+    return 1;
+}
+
+static int cas_engine__match_process(CasEngine* engine, const CasProcess* process, uint32_t process_index, uint32_t state_index)
+{
+    CasProcessState* state = engine->state_tables[engine->current_state_table].slots + state_index;
+    uint32_t rule_set = cas_engine_find_rule_set(engine, process);
+    uint32_t rule_index = CAS_NO_RULE;
+    uint32_t status = CAS_STATUS_UNKNOWN;
+
+    if (rule_set != CAS_NO_RULE && !cas_engine__resolve_rule_set(engine, process, state, &rule_set))
+    {
+        return 0;
+    }
+
+    if (rule_set == CAS_NO_RULE)
+    {
+        int is_pinned = 0;
+
+        if (!cas_engine__auto_pin(engine, process, process_index, state_index, &is_pinned))
+        {
+            return 0;
+        }
+
+        return is_pinned || cas_engine__evict(engine, process, process_index, state_index);
+    }
+
+    // NOTE: A rule took the process over, its mask is the one that counts now.
+    if (state->isolation_record)
+    {
+        engine->isolation_records[state->isolation_record - 1].pid = CAS_ENGINE_EMPTY_PID;
+        state->isolation_record = 0;
+    }
+
+    if (state->auto_pin_cpu)
+    {
+        engine->auto_pin_slots[state->auto_pin_cpu - 1].pid = CAS_ENGINE_EMPTY_PID;
+        state->auto_pin_cpu = 0;
+    }
+
+    // NOTE: Duplicate names used to be applied one after another and the last one stuck, the set's decision
+    // says which single rule and mask apply. Thread rules ride along in the same set and are applied after the
+    // process rule. Every rule of the set still counts as found.
+    const CasRuleSet* set = engine->rule_sets + rule_set;
+    const uint32_t* rules = engine->rule_set_rules + set->offset;
+    uint32_t process_rule_index = set->rule_index;
+    uint32_t thread_status = set->has_thread_rules ? CAS_STATUS_UNKNOWN : CAS_STATUS_PINNED;
+    uint32_t is_drift_check = 0;
+
+    for (uint32_t i = 0; i < set->count; ++i)
+    {
+        engine->rule_found[rules[i]] = 1;
+    }
+
+    // NOTE: The state remembers the process rule, or the first rule for processes that only have thread rules.
+    rule_index = process_rule_index != CAS_NO_RULE ? process_rule_index : rules[0];
+
+    if (state->rule_index == rule_index && state->generation == engine->generation &&
+        state->mask_version == cas_engine__mask_version(engine, rule_index))
+    {
+        if (process_rule_index == CAS_NO_RULE || state->status == CAS_STATUS_PINNED)
+        {
+            status = CAS_STATUS_PINNED;
+            ++engine->counters.state_hits;
+
+            // NOTE: Spread over the sweeps by PID so every sweep checks about the same number of processes.
+            is_drift_check = engine->is_drift_checked && process_rule_index != CAS_NO_RULE &&
+                             (state->drift_count || ((engine->tick + state->pid) & (CAS_DRIFT_SPREAD - 1)) == 0);
+        }
+        else if (state->status == CAS_STATUS_DENIED && (int32_t)(engine->tick - state->retry_tick) < 0)
+        {
+            status = CAS_STATUS_DENIED;
+            ++engine->counters.negative_hits;
+        }
+
+        // NOTE: Threads are only walked again when the process gained or lost threads since the last walk.
+        if (thread_status == CAS_STATUS_UNKNOWN && status != CAS_STATUS_UNKNOWN &&
+            state->thread_status != CAS_STATUS_UNKNOWN && state->thread_count == process->thread_count)
+        {
+            thread_status = state->thread_status;
+        }
+    }
+    else
+    {
+        state->thread_status = CAS_STATUS_UNKNOWN;
+    }
+
+    if (process_rule_index == CAS_NO_RULE)
+    {
+        status = CAS_STATUS_PINNED;
+    }
+
+    if (status == CAS_STATUS_UNKNOWN || thread_status == CAS_STATUS_UNKNOWN)
+    {
+        ++engine->counters.state_misses;
+    }
+
+    if (!cas_engine__grow((void**)&engine->matches, &engine->match_capacity, engine->match_count + 1, sizeof(CasMatch)))
+    {
+        return 0;
+    }
+
+    state->rule_index = rule_index;
+
+    if (process_rule_index == CAS_NO_RULE)
+    {
+        state->generation = engine->generation;
+        state->mask_version = cas_engine__mask_version(engine, rule_index);
+    }
+
+    engine->matches[engine->match_count++] = (CasMatch){ process_index, process_rule_index, rule_set, state_index, status, thread_status, is_drift_check };
+
+    return 1;
+}
+
+// NOTE: Matches only the given processes, used for processes reported by an event source between sweeps.
+int cas_engine_match(CasEngine* engine, const CasProcessTable* table)
+{
+    CasProcessStateTable* states = engine->state_tables + engine->current_state_table;
+
+    engine->match_count = 0;
+    engine->eviction_count = 0;
+    engine->auto_pin_count = 0;
+
+    if (!cas_engine__states_reserve(states, table->count))
+    {
+        return 0;
+    }
+
+    for (uint32_t process_index = 0; process_index < table->count; ++process_index)
+    {
+        const CasProcess* process = table->processes + process_index;
+        uint32_t state_index = cas_engine__states_insert(states, process->pid);
+        CasProcessState* state = states->slots + state_index;
+
+        if (state->create_time != process->create_time)
+        {
+            if (state->seen_tick)
+            {
+                ++engine->counters.pid_reuses;
+            }
+
+            memset(state, 0, sizeof(*state));
+            state->pid = process->pid;
+            state->rule_index = CAS_NO_RULE;
+            state->create_time = process->create_time;
+            state->cpu_time = process->cpu_time;
+        }
+
+        state->seen_tick = engine->tick;
+
+        if (!cas_engine__match_process(engine, process, process_index, state_index))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+int cas_engine_sweep(CasEngine* engine, const CasProcessTable* table)
+{
+    CasProcessStateTable* previous = engine->state_tables + engine->current_state_table;
+    CasProcessStateTable* current = engine->state_tables + (engine->current_state_table ^ 1);
+    uint64_t elapsed = engine->sampled_time && engine->sample_time > engine->sampled_time ? engine->sample_time - engine->sampled_time : 0;
+
+    engine->match_count = 0;
+    engine->eviction_count = 0;
+    engine->auto_pin_count = 0;
+    engine->started_count = 0;
+    engine->exited_count = 0;
+    ++engine->tick;
+
+    if (!cas_engine__states_reset(current, table->count) ||
+        !cas_engine__grow((void**)&engine->started_pids, &engine->started_capacity, table->count, sizeof(uint32_t)) ||
+        !cas_engine__grow((void**)&engine->exited_pids, &engine->exited_capacity, previous->count, sizeof(uint32_t)))
+    {
+        return 0;
+    }
+
+    if (engine->rule_count)
+    {
+        memset(engine->rule_found, 0, engine->rule_count);
+    }
+
+    for (uint32_t process_index = 0; process_index < table->count; ++process_index)
+    {
+        const CasProcess* process = table->processes + process_index;
+        uint32_t previous_index = cas_engine__states_find(previous, process->pid);
+        uint32_t state_index = cas_engine__states_insert(current, process->pid);
+        CasProcessState* state = current->slots + state_index;
+
+        if (previous_index != CAS_NO_SLOT && previous->slots[previous_index].create_time == process->create_time)
+        {
+            previous->slots[previous_index].seen_tick = engine->tick;
+            *state = previous->slots[previous_index];
+
+            if (engine->auto_pin_threshold || state->auto_pin_cpu)
+            {
+                cas_engine__sample(engine, process, state, elapsed);
+            }
+        }
+        else
+        {
+            if (previous_index != CAS_NO_SLOT)
+            {
+                ++engine->counters.pid_reuses;
+            }
+
+            state->create_time = process->create_time;
+            state->cpu_time = process->cpu_time;
+            state->seen_tick = engine->tick;
+            engine->started_pids[engine->started_count++] = process->pid;
+        }
+    }
+
+    for (uint32_t slot = 0; slot < previous->capacity; ++slot)
+    {
+        if (previous->slots[slot].pid != CAS_ENGINE_EMPTY_PID && previous->slots[slot].seen_tick != engine->tick)
+        {
+            engine->exited_pids[engine->exited_count++] = previous->slots[slot].pid;
+        }
+    }
+
+    engine->current_state_table ^= 1;
+    engine->sampled_time = engine->sample_time;
+    cas_engine__compact_records(engine, current);
+    cas_engine__compact_auto_pins(engine, current);
+
+    for (uint32_t process_index = 0; process_index < table->count; ++process_index)
+    {
+        const CasProcess* process = table->processes + process_index;
+
+        if (!cas_engine__match_process(engine, process, process_index, cas_engine__states_find(current, process->pid)))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: Processes that keep refusing us are retried after 2, 4, ... 64 ticks.
+static void cas_engine__set_status(CasEngine* engine, CasProcessState* state, uint32_t status)
+{
+    state->status = status;
+    state->generation = engine->generation;
+
+    if (status == CAS_STATUS_DENIED)
+    {
+        uint32_t shift = state->failure_count < CAS_BACKOFF_MAX_SHIFT ? state->failure_count + 1 : CAS_BACKOFF_MAX_SHIFT;
+
+        state->failure_count = shift;
+        state->retry_tick = engine->tick + (1u << shift);
+    }
+    else
+    {
+        state->failure_count = 0;
+    }
+}
+
+void cas_engine_set_result(CasEngine* engine, const CasMatch* match, uint32_t status)
+{
+    CasProcessState* state = engine->state_tables[engine->current_state_table].slots + match->state_index;
+
+    cas_engine__set_status(engine, state, status);
+    state->mask_version = cas_engine__mask_version(engine, match->rule_index);
+}
+
+void cas_engine_set_thread_result(CasEngine* engine, const CasMatch* match, const CasProcess* process, uint32_t status)
+{
+    CasProcessState* state = engine->state_tables[engine->current_state_table].slots + match->state_index;
+
+    state->thread_status = status;
+    state->thread_count = process->thread_count;
+}
+
+int cas_engine_is_matched(const CasEngine* engine, uint32_t pid)
+{
+    const CasProcessStateTable* states = engine->state_tables + engine->current_state_table;
+    uint32_t slot = cas_engine__states_find(states, pid);
+
+    return slot != CAS_NO_SLOT && states->slots[slot].rule_index != CAS_NO_RULE;
+}
+
+int cas_engine_is_busy(const CasEngine* engine)
+{
+    if (engine->started_count || engine->exited_count || !cas_engine_is_applied(engine))
+    {
+        return 1;
+    }
+
+    for (uint32_t i = 0; i < engine->match_count; ++i)
+    {
+        if (engine->matches[i].status == CAS_STATUS_FAILED || engine->matches[i].thread_status == CAS_STATUS_FAILED)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int cas_engine_is_applied(const CasEngine* engine)
+{
+    for (uint32_t i = 0; i < engine->match_count; ++i)
+    {
+        const CasMatch* match = engine->matches + i;
+
+        if (match->status == CAS_STATUS_UNKNOWN || (match->status == CAS_STATUS_PINNED && match->thread_status == CAS_STATUS_UNKNOWN))
+        {
+            return 0;
+        }
+    }
+
+    for (uint32_t i = 0; i < engine->eviction_count; ++i)
+    {
+        if (engine->evictions[i].status == CAS_STATUS_UNKNOWN)
+        {
+            return 0;
+        }
+    }
+
+    // NOTE: A failed auto-pin gave its CPU back, denied ones back off and do not count.
+    for (uint32_t i = 0; i < engine->auto_pin_count; ++i)
+    {
+        if (engine->auto_pins[i].status == CAS_STATUS_UNKNOWN || engine->auto_pins[i].status == CAS_STATUS_FAILED)
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+void cas_engine_set_drift_check(CasEngine* engine, int is_enabled)
+{
+    engine->is_drift_checked = is_enabled;
+}
+
+void cas_engine_set_checked(CasEngine* engine, const CasMatch* match, uint64_t time)
+{
+    engine->state_tables[engine->current_state_table].slots[match->state_index].checked_time = time;
+}
+
+void cas_engine_set_drift_result(CasEngine* engine, CasMatch* match, const CasCpuSet* found, uint64_t duration_milliseconds)
+{
+    CasProcessState* state = engine->state_tables[engine->current_state_table].slots + match->state_index;
+    const CasRuleSet* set = engine->rule_sets + match->rule_set;
+    uint32_t slot = engine->drift_total % CAS_DRIFT_LOG_SIZE;
+    CasCpuSet logged = { engine->drift_log_words + (size_t)slot * engine->cpu_word_count, engine->cpu_word_count };
+
+    ++engine->rule_drifts[match->rule_index].checks;
+
+    if (!found)
+    {
+        return;
+    }
+
+    ++engine->rule_drifts[match->rule_index].drifts;
+    ++state->drift_count;
+    match->status = CAS_STATUS_UNKNOWN;
+
+    if (set->has_thread_rules)
+    {
+        match->thread_status = CAS_STATUS_UNKNOWN;
+    }
+
+    engine->drift_log[slot] = (CasDrift){ state->pid, match->rule_index, match->rule_set, duration_milliseconds };
+    cas_cpu_set_copy(&logged, found);
+    ++engine->drift_total;
+}
+
+int cas_engine_has_drifted(const CasEngine* engine)
+{
+    const CasProcessStateTable* states = engine->state_tables + engine->current_state_table;
+
+    for (uint32_t i = 0; i < engine->match_count; ++i)
+    {
+        if (engine->matches[i].is_drift_check && states->slots[engine->matches[i].state_index].drift_count)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+const CasDrift* cas_engine_drift(const CasEngine* engine, uint32_t index, CasCpuSet* found)
+{
+    uint32_t slot = index % CAS_DRIFT_LOG_SIZE;
+    CasCpuSet logged = { engine->drift_log_words + (size_t)slot * engine->cpu_word_count, engine->cpu_word_count };
+
+    if (index >= engine->drift_total || engine->drift_total - index > CAS_DRIFT_LOG_SIZE)
+    {
+        return 0;
+    }
+
+    cas_cpu_set_copy(found, &logged);
+
+    return engine->drift_log + slot;
+}
+
+CasCpuSet cas_engine_isolation_mask(const CasEngine* engine)
+{
+    CasCpuSet mask = { engine->isolation_words, engine->cpu_word_count };
+
+    return mask;
+}
+
+CasCpuSet cas_engine_eviction_original(const CasEngine* engine, const CasEviction* eviction)
+{
+    const CasProcessState* state = engine->state_tables[engine->current_state_table].slots + eviction->state_index;
+    CasCpuSet original = { engine->isolation_record_words + (size_t)(state->isolation_record - 1) * engine->cpu_word_count, engine->cpu_word_count };
+
+    return original;
+}
+
+void cas_engine_set_eviction_result(CasEngine* engine, const CasEviction* eviction, uint32_t status, int keeps_original)
+{
+    CasProcessState* state = engine->state_tables[engine->current_state_table].slots + eviction->state_index;
+
+    cas_engine__set_status(engine, state, status);
+
+    if (!state->isolation_record)
+    {
+        return;
+    }
+
+    if (keeps_original)
+    {
+        engine->isolation_records[state->isolation_record - 1].is_saved = 1;
+    }
+    else
+    {
+        engine->isolation_records[state->isolation_record - 1].pid = CAS_ENGINE_EMPTY_PID;
+        state->isolation_record = 0;
+    }
+}
+
+// NOTE: Slots are only reallocated when the mask width changed, CPUs handed out before keep their owner otherwise.
+int cas_engine_set_auto_pin(CasEngine* engine, const CasCpuSet* pool, uint32_t threshold_percent, uint64_t time)
+{
+    uint32_t slot_count = engine->cpu_word_count * CAS_CPU_SET_WORD_BITS;
+    CasCpuSet words = { 0 };
+
+    engine->auto_pin_threshold = 0;
+
+    if (slot_count != engine->auto_pin_slot_count)
+    {
+        uint64_t* pool_words = realloc(engine->auto_pin_words, engine->cpu_word_count * sizeof(uint64_t));
+        CasAutoPinSlot* slots = pool_words ? realloc(engine->auto_pin_slots, slot_count * sizeof(CasAutoPinSlot)) : 0;
+        uint64_t* original_words = slots ? realloc(engine->auto_pin_original_words, (size_t)slot_count * engine->cpu_word_count * sizeof(uint64_t)) : 0;
+
+        engine->auto_pin_words = pool_words ? pool_words : engine->auto_pin_words;
+        engine->auto_pin_slots = slots ? slots : engine->auto_pin_slots;
+        engine->auto_pin_original_words = original_words ? original_words : engine->auto_pin_original_words;
+        engine->auto_pin_slot_count = 0;
+
+        if (!original_words)
+        {
+            return 0;
+        }
+
+        for (uint32_t cpu = 0; cpu < slot_count; ++cpu)
+        {
+            slots[cpu].pid = CAS_ENGINE_EMPTY_PID;
+        }
+
+        engine->auto_pin_slot_count = slot_count;
+    }
+
+    words = (CasCpuSet){ engine->auto_pin_words, engine->cpu_word_count };
+    cas_cpu_set_zero(&words);
+
+    if (pool && threshold_percent)
+    {
+        memcpy(words.words, pool->words, (pool->word_count < words.word_count ? pool->word_count : words.word_count) * sizeof(uint64_t));
+        engine->auto_pin_threshold = cas_cpu_set_is_empty(&words) ? 0 : threshold_percent;
+        engine->auto_pin_time = time;
+    }
+
+    return 1;
+}
+
+void cas_engine_set_sample_time(CasEngine* engine, uint64_t time)
+{
+    engine->sample_time = time;
+}
+
+int cas_engine_has_auto_pins(const CasEngine* engine)
+{
+    for (uint32_t cpu = 0; cpu < engine->auto_pin_slot_count; ++cpu)
+    {
+        if (engine->auto_pin_slots[cpu].pid != CAS_ENGINE_EMPTY_PID)
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+CasCpuSet cas_engine_auto_pin_original(const CasEngine* engine, uint32_t cpu)
+{
+    CasCpuSet original = { engine->auto_pin_original_words + (size_t)cpu * engine->cpu_word_count, engine->cpu_word_count };
+
+    return original;
+}
+
+void cas_engine_set_auto_pin_result(CasEngine* engine, CasAutoPin* auto_pin, uint32_t status)
+{
+    CasProcessState* state = engine->state_tables[engine->current_state_table].slots + auto_pin->state_index;
+
+    auto_pin->status = status;
+
+    // NOTE: Only a refusal goes into the state, a pinned status there would read as an answered eviction once released.
+    if (status == CAS_STATUS_DENIED)
+    {
+        cas_engine__set_status(engine, state, status);
+    }
+    else if (status == CAS_STATUS_PINNED)
+    {
+        state->failure_count = 0;
+    }
+
+    if (auto_pin->is_release || status != CAS_STATUS_PINNED)
+    {
+        engine->auto_pin_slots[auto_pin->cpu].pid = CAS_ENGINE_EMPTY_PID;
+        state->auto_pin_cpu = 0;
+    }
+}
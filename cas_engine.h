@@ -0,0 +1,468 @@
+#ifndef H_CAS_ENGINE_H
+
+#include "cas_base.h"
+#include "cas_cpuset.h"
+#include "cas_match.h"
+#include "cas_rebalance.h"
+
+#define CAS_PROCESS_NAME_LENGTH  (256)
+#define CAS_RULE_NAME_LENGTH     (64)
+#define CAS_RULE_LINE_LENGTH     (1024)
+#define CAS_NO_RULE              (0xffffffff)
+#define CAS_NO_SLOT              (0xffffffff)
+
+#define CAS_STATUS_UNKNOWN       (0)
+#define CAS_STATUS_PINNED        (1)
+#define CAS_STATUS_DENIED        (2)
+#define CAS_STATUS_FAILED        (3)
+
+#define CAS_BACKOFF_MAX_SHIFT    (6)
+
+// NOTE: With drift checks on, a pinned process is read back once every CAS_DRIFT_SPREAD sweeps and one that
+// drifted before on every sweep.
+#define CAS_DRIFT_SPREAD         (16)
+#define CAS_DRIFT_LOG_SIZE       (32)
+
+#define CAS_PREDICATE_CMDLINE    (1)
+#define CAS_PREDICATE_PATH       (2)
+#define CAS_PREDICATE_PARENT     (3)
+#define CAS_PREDICATE_USER       (4)
+#define CAS_PREDICATE_MODULE     (5)
+
+// NOTE: Scheduling attributes a rule can carry besides its mask, 0 leaves the attribute alone.
+// Priority classes and io levels are portable, nice and sched are Linux terms, memory is a Windows one.
+#define CAS_PRIORITY_IDLE         (1)
+#define CAS_PRIORITY_BELOW_NORMAL (2)
+#define CAS_PRIORITY_NORMAL       (3)
+#define CAS_PRIORITY_ABOVE_NORMAL (4)
+#define CAS_PRIORITY_HIGH         (5)
+#define CAS_PRIORITY_REALTIME     (6)
+
+#define CAS_SCHED_OTHER          (1)
+#define CAS_SCHED_BATCH          (2)
+#define CAS_SCHED_IDLE           (3)
+#define CAS_SCHED_FIFO           (4)
+
+#define CAS_IO_VERY_LOW          (1)
+#define CAS_IO_LOW               (2)
+#define CAS_IO_NORMAL            (3)
+#define CAS_IO_HIGH              (4)
+
+// NOTE: Same values as MEMORY_PRIORITY_VERY_LOW ... MEMORY_PRIORITY_NORMAL.
+#define CAS_MEMORY_VERY_LOW      (1)
+#define CAS_MEMORY_LOW           (2)
+#define CAS_MEMORY_MEDIUM        (3)
+#define CAS_MEMORY_BELOW_NORMAL  (4)
+#define CAS_MEMORY_NORMAL        (5)
+
+#define CAS_NICE_UNSET           (0x7fffffff)
+
+// NOTE: How the process rules of the highest rank that match one process are merged. Last and first pick one of
+// them in configuration order, intersect and union merge their masks into one.
+#define CAS_MERGE_LAST           (0)
+#define CAS_MERGE_FIRST          (1)
+#define CAS_MERGE_INTERSECT      (2)
+#define CAS_MERGE_UNION          (3)
+#define CAS_MAX_RANK             (1000)
+
+// NOTE: Bits a backend reports for the attributes it found different from the policy and had to set.
+#define CAS_POLICY_PRIORITY      (0)
+#define CAS_POLICY_NICE          (1)
+#define CAS_POLICY_SCHED         (2)
+#define CAS_POLICY_IO            (3)
+#define CAS_POLICY_MEMORY        (4)
+#define CAS_POLICY_COUNT         (5)
+
+typedef struct
+{
+    uint32_t pid;
+    uint32_t name_hash;
+    uint64_t create_time;
+    uint32_t parent_pid;
+    uint32_t thread_count;
+    // NOTE: User and kernel time the process used so far, in the units of create_time.
+    uint64_t cpu_time;
+    uint32_t name_length;
+    char name[CAS_PROCESS_NAME_LENGTH];
+} CasProcess;
+
+typedef struct
+{
+    CasProcess* processes;
+    uint32_t count;
+    uint32_t capacity;
+} CasProcessTable;
+
+// NOTE: Status is prefilled when the state table already knows the answer, only CAS_STATUS_UNKNOWN needs to be applied.
+// rule_index is CAS_NO_RULE when the process only has thread rules, thread_status covers all of them.
+// rule_set is every rule the process name matched. is_drift_check marks a pinned process due to have its mask read back.
+typedef struct
+{
+    uint32_t process_index;
+    uint32_t rule_index;
+    uint32_t rule_set;
+    uint32_t state_index;
+    uint32_t status;
+    uint32_t thread_status;
+    uint32_t is_drift_check;
+} CasMatch;
+
+// NOTE: A process no rule matched, moved off the CPUs isolating rules reserve. is_recorded is set when its
+// isolation record already holds the mask it had before, otherwise the apply reads it first.
+typedef struct
+{
+    uint32_t process_index;
+    uint32_t state_index;
+    uint32_t status;
+    uint32_t is_recorded;
+} CasEviction;
+
+// NOTE: is_saved is set once the mask was read, a record the apply budget never got to is still empty.
+typedef struct
+{
+    uint32_t pid;
+    uint32_t is_saved;
+    uint64_t create_time;
+} CasIsolationRecord;
+
+// NOTE: A process auto-pin gives a CPU of the pool to, or takes it back from once it went cold.
+typedef struct
+{
+    uint32_t process_index;
+    uint32_t state_index;
+    uint32_t cpu;
+    uint32_t is_release;
+    uint32_t status;
+} CasAutoPin;
+
+// NOTE: The process owning a CPU of the auto-pin pool, a free CPU has the pid no process can have.
+typedef struct
+{
+    uint32_t pid;
+    uint64_t create_time;
+} CasAutoPinSlot;
+
+// NOTE: Keyed by PID, a different creation time under the same PID is a new process.
+typedef struct
+{
+    uint32_t pid;
+    uint32_t rule_index;
+    uint64_t create_time;
+    uint32_t status;
+    uint32_t generation;
+    uint32_t failure_count;
+    uint32_t retry_tick;
+    uint32_t seen_tick;
+    uint32_t thread_status;
+    uint32_t thread_count;
+    // NOTE: The rule set left after the predicates of base_rule_set ran, valid for rule_set_generation.
+    uint32_t base_rule_set;
+    uint32_t rule_set;
+    uint32_t rule_set_generation;
+    // NOTE: Selection version of a rebalanced rule when it was applied, a move makes the process pinned again.
+    uint32_t mask_version;
+    // NOTE: Set once the pinned process was handed to an exit source, whether or not that could watch it.
+    uint32_t is_watched;
+    // NOTE: How often the mask was found changed by someone else, and when it was last found in place in backend
+    // clock units.
+    uint32_t drift_count;
+    uint64_t checked_time;
+    // NOTE: Index + 1 of the isolation record holding the mask the process had before it was evicted, 0 without one.
+    uint32_t isolation_record;
+    // NOTE: CPU time at the last sweep, when the process started to run hot (or cold once auto-pinned) in
+    // sample_time units, 0 while it does not, and the auto-pinned CPU + 1, 0 without one.
+    uint64_t cpu_time;
+    uint64_t auto_pin_since;
+    uint32_t auto_pin_cpu;
+} CasProcessState;
+
+typedef struct
+{
+    CasProcessState* slots;
+    uint32_t capacity;
+    uint32_t count;
+} CasProcessStateTable;
+
+// NOTE: The decision is compiled with the set. rule_index is the process rule a match of the set applies,
+// CAS_NO_RULE with only thread rules, and mask_offset points into decision_words when the masks were merged.
+typedef struct
+{
+    uint32_t offset;
+    uint32_t count;
+    uint32_t has_predicates;
+    uint32_t has_thread_rules;
+    uint32_t rule_index;
+    uint32_t mask_offset;
+} CasRuleSet;
+
+typedef struct
+{
+    uint32_t kind;
+    uint32_t value_offset;
+    uint32_t value_length;
+} CasPredicate;
+
+// NOTE: Answers one predicate for a process, the value is case folded. Without a function every predicate fails.
+typedef int CasPredicateFunction(void* context, const CasProcess* process, uint32_t kind, const char* value, uint32_t length);
+
+// NOTE: nice is CAS_NICE_UNSET when not given, sched_priority only counts for CAS_SCHED_FIFO.
+typedef struct
+{
+    uint32_t priority;
+    int32_t nice;
+    uint32_t sched;
+    uint32_t sched_priority;
+    uint32_t io;
+    uint32_t memory;
+} CasPolicy;
+
+typedef struct
+{
+    uint32_t hash;
+    uint32_t rule_index;
+    uint32_t rule_set;
+    uint32_t next;
+} CasNameEntry;
+
+typedef struct
+{
+    uint32_t checks;
+    uint32_t drifts;
+} CasRuleDrift;
+
+// NOTE: The mask was last found in place duration_milliseconds before the drift was seen, it lasted at most that long.
+typedef struct
+{
+    uint32_t pid;
+    uint32_t rule_index;
+    uint32_t rule_set;
+    uint64_t duration_milliseconds;
+} CasDrift;
+
+typedef struct
+{
+    uint64_t state_hits;
+    uint64_t state_misses;
+    uint64_t negative_hits;
+    uint64_t pid_reuses;
+    uint64_t predicate_evaluations;
+    // NOTE: Attributes found different from the rule policy and set again, indexed by CAS_POLICY_*.
+    uint64_t policy_corrections[CAS_POLICY_COUNT];
+} CasEngineCounters;
+
+typedef struct
+{
+    // NOTE: Rules as parallel arrays indexed by rule, folded names live in name_arena.
+    // Clearing only resets the counts so a reload reuses every allocation.
+    // A rule with a thread name pins the matching threads of the process instead of the whole process.
+    // Glob and regex rules keep their pattern as written and are added to the matcher, rule_kinds tells them apart.
+    uint32_t rule_count;
+    uint32_t rule_capacity;
+    uint32_t* rule_kinds;
+    uint32_t* rule_name_offsets;
+    uint32_t* rule_name_lengths;
+    uint32_t* rule_name_hashes;
+    uint32_t* rule_next_same_name;
+    uint32_t* rule_thread_name_offsets;
+    uint32_t* rule_thread_name_lengths;
+    uint32_t* rule_predicate_offsets;
+    uint32_t* rule_predicate_counts;
+    uint32_t* rule_rebalance_entries;
+    uint32_t* rule_policies;
+    uint32_t* rule_isolates;
+    uint32_t* rule_ranks;
+    char* name_arena;
+    uint32_t name_arena_used;
+    uint32_t name_arena_capacity;
+
+    // NOTE: Predicates of every rule back to back, values live in name_arena.
+    CasPredicate* predicates;
+    uint32_t predicate_count;
+    uint32_t predicate_capacity;
+    CasPredicateFunction* predicate_function;
+    void* predicate_context;
+
+    // NOTE: Only rules with scheduling attributes have a policy, rule_policies indexes it or is CAS_NO_RULE.
+    CasPolicy* policies;
+    uint32_t policy_count;
+    uint32_t policy_capacity;
+
+    // NOTE: Rule masks back to back, cpu_word_count words each.
+    uint64_t* mask_words;
+    uint32_t mask_word_capacity;
+    uint32_t cpu_word_count;
+
+    // NOTE: Rules with a core count are pinned to the least loaded CPUs of their mask, rule_rebalance_entries
+    // points at their entry or is CAS_NO_RULE.
+    CasRebalancer rebalancer;
+
+    // NOTE: Every distinct list of rules a process name can match, spans of rule_set_rules in configuration order.
+    // The set of an exact name already holds the patterns matching it, an exact hit needs no matcher run.
+    CasRuleSet* rule_sets;
+    uint32_t rule_set_count;
+    uint32_t rule_set_capacity;
+    uint32_t* rule_set_rules;
+    uint32_t rule_set_rule_count;
+    uint32_t rule_set_rule_capacity;
+
+    // NOTE: Only the process rules of the highest rank in a set count, merge decides between them. Merged masks
+    // live in decision_words, cpu_word_count words each, and are built from the whole mask of every rule.
+    uint32_t merge;
+    uint64_t* decision_words;
+    uint32_t decision_word_count;
+    uint32_t decision_word_capacity;
+
+    // NOTE: Sets past base_rule_set_count are what is left of a set once predicates failed, they are added
+    // while matching and deduplicated through derived_index so processes with the same outcome share one.
+    uint32_t base_rule_set_count;
+    uint32_t* derived_index;
+    uint32_t derived_index_capacity;
+    uint32_t* scratch_rules;
+    uint32_t scratch_rule_capacity;
+
+    // NOTE: Glob and regex rules compiled into one DFA, matcher_state_sets maps its states to rule sets.
+    CasMatcher matcher;
+    uint32_t* matcher_state_sets;
+    uint32_t matcher_state_set_capacity;
+
+    // NOTE: One entry per distinct exact name, names with the same 32 bit hash are chained through next.
+    // The hash and displace index finds an entry with one seed and one slot, no probing.
+    CasNameEntry* name_entries;
+    uint32_t name_entry_count;
+    uint32_t name_entry_capacity;
+    uint32_t* index_seeds;
+    uint32_t index_seed_capacity;
+    uint32_t index_bucket_count;
+    uint32_t* index_entries;
+    uint32_t index_capacity;
+    uint32_t index_shift;
+
+    // NOTE: Build scratch, the open addressing table grouping equal names and the entries ordered by bucket.
+    uint32_t* group_hashes;
+    uint32_t* group_rules;
+    uint32_t group_capacity;
+    uint32_t* bucket_starts;
+    uint32_t bucket_start_capacity;
+    uint32_t* bucket_entries;
+    uint32_t bucket_entry_capacity;
+
+    CasMatch* matches;
+    uint32_t match_count;
+    uint32_t match_capacity;
+    uint8_t* rule_found;
+
+    // NOTE: The current state table and the one the next sweep is built into, swapped every sweep.
+    CasProcessStateTable state_tables[2];
+    uint32_t current_state_table;
+    uint32_t tick;
+    uint32_t generation;
+    CasEngineCounters counters;
+
+    uint32_t* started_pids;
+    uint32_t started_count;
+    uint32_t started_capacity;
+    uint32_t* exited_pids;
+    uint32_t exited_count;
+    uint32_t exited_capacity;
+
+    // NOTE: Drift checks are counted per rule since the last index build. The log keeps the last CAS_DRIFT_LOG_SIZE
+    // drifts with the mask each process was found with, cpu_word_count words each, drift_total counts all of them.
+    int is_drift_checked;
+    CasRuleDrift* rule_drifts;
+    CasDrift drift_log[CAS_DRIFT_LOG_SIZE];
+    uint64_t* drift_log_words;
+    uint32_t drift_total;
+
+    // NOTE: Isolating rules reserve their whole mask, isolation_words is the union, cpu_word_count words. Every
+    // process no rule matches is evicted off it, its mask from before goes into an isolation record, cpu_word_count
+    // words each in isolation_record_words, and is set again once no rule reserves CPUs any more.
+    // Records of processes that are gone or were restored are dropped every sweep.
+    uint32_t isolation_rule_count;
+    uint64_t* isolation_words;
+    CasEviction* evictions;
+    uint32_t eviction_count;
+    uint32_t eviction_capacity;
+    CasIsolationRecord* isolation_records;
+    uint32_t isolation_record_count;
+    uint32_t isolation_record_capacity;
+    uint64_t* isolation_record_words;
+    uint32_t isolation_record_word_capacity;
+
+    // NOTE: Processes no rule matched that used more than auto_pin_threshold percent of a CPU every sweep for
+    // auto_pin_time get a CPU of auto_pin_words to themselves, and give it back once they stayed under half of
+    // that for as long. One slot per CPU the mask can hold, auto_pin_original_words keeps the mask each owner had
+    // before, cpu_word_count words per slot. Times are in the units sample_time is set in, a threshold of 0 is off.
+    uint32_t auto_pin_threshold;
+    uint64_t auto_pin_time;
+    uint64_t* auto_pin_words;
+    CasAutoPinSlot* auto_pin_slots;
+    uint64_t* auto_pin_original_words;
+    uint32_t auto_pin_slot_count;
+    CasAutoPin* auto_pins;
+    uint32_t auto_pin_count;
+    uint32_t auto_pin_capacity;
+    uint64_t sample_time;
+    uint64_t sampled_time;
+} CasEngine;
+
+uint32_t cas_engine_hash_name(const char* name, uint32_t length);
+
+CasProcess* cas_process_table_push(CasProcessTable* table);
+void cas_process_table_free(CasProcessTable* table);
+
+void cas_engine_init(CasEngine* engine);
+void cas_engine_free(CasEngine* engine);
+void cas_engine_clear_rules(CasEngine* engine);
+void cas_engine_set_cpu_count(CasEngine* engine, uint32_t cpu_count);
+int cas_engine_add_rule(CasEngine* engine, const char* name, uint32_t length, const CasCpuSet* affinity_mask);
+int cas_engine_add_thread_rule(CasEngine* engine, const char* name, uint32_t length, const char* thread_name, uint32_t thread_length, const CasCpuSet* affinity_mask);
+int cas_engine_add_rule_line(CasEngine* engine, const char* line, uint32_t length, const CasCpuSet* affinity_mask);
+CasCpuSet cas_engine_rule_mask(const CasEngine* engine, uint32_t rule_index);
+// NOTE: The mask a match of rule_set applies, merged or the one of rule_index.
+CasCpuSet cas_engine_match_mask(const CasEngine* engine, uint32_t rule_set, uint32_t rule_index);
+const CasPolicy* cas_engine_rule_policy(const CasEngine* engine, uint32_t rule_index);
+const char* cas_engine_rule_name(const CasEngine* engine, uint32_t rule_index);
+// NOTE: One of CAS_MERGE_*, takes effect with the next build.
+void cas_engine_set_merge(CasEngine* engine, uint32_t merge);
+int cas_engine_build_index(CasEngine* engine);
+uint32_t cas_engine_find_rule_set(const CasEngine* engine, const CasProcess* process);
+uint32_t cas_engine_find_thread_rule(const CasEngine* engine, uint32_t rule_set, const char* thread_name, uint32_t thread_length);
+int cas_engine_match(CasEngine* engine, const CasProcessTable* table);
+int cas_engine_sweep(CasEngine* engine, const CasProcessTable* table);
+void cas_engine_set_result(CasEngine* engine, const CasMatch* match, uint32_t status);
+void cas_engine_set_thread_result(CasEngine* engine, const CasMatch* match, const CasProcess* process, uint32_t status);
+int cas_engine_is_matched(const CasEngine* engine, uint32_t pid);
+// NOTE: Whether the last sweep saw processes start or exit, a match failed to apply or was not applied at all.
+// Denied matches have a backoff of their own and do not count.
+int cas_engine_is_busy(const CasEngine* engine);
+// NOTE: Whether every match, eviction and auto-pin of the last sweep or match got its answer, the apply budget may leave
+// some for later. A failed auto-pin has no answer yet.
+int cas_engine_is_applied(const CasEngine* engine);
+int cas_engine_rebalance(CasEngine* engine, const uint64_t* busy, const uint64_t* total, uint32_t cpu_count);
+void cas_engine_set_drift_check(CasEngine* engine, int is_enabled);
+// NOTE: Only writes the state slot of the match, like cas_engine_set_result.
+void cas_engine_set_checked(CasEngine* engine, const CasMatch* match, uint64_t time);
+// NOTE: found is 0 when the mask was still in place. Otherwise the match goes back to unknown, threads too when
+// the process has thread rules, so the same apply pins it again.
+void cas_engine_set_drift_result(CasEngine* engine, CasMatch* match, const CasCpuSet* found, uint64_t duration_milliseconds);
+// NOTE: Whether the last sweep checked a process that drifted before.
+int cas_engine_has_drifted(const CasEngine* engine);
+// NOTE: Drift number index counted by drift_total, 0 once the log moved past it. found gets the mask it was found with.
+const CasDrift* cas_engine_drift(const CasEngine* engine, uint32_t index, CasCpuSet* found);
+// NOTE: The CPUs isolating rules reserve, empty without any.
+CasCpuSet cas_engine_isolation_mask(const CasEngine* engine);
+CasCpuSet cas_engine_eviction_original(const CasEngine* engine, const CasEviction* eviction);
+// NOTE: Only writes the state slot and the isolation record of the eviction. Without keeps_original the record
+// is dropped, the process was restored or never needed one.
+void cas_engine_set_eviction_result(CasEngine* engine, const CasEviction* eviction, uint32_t status, int keeps_original);
+// NOTE: A pool of 0 or a threshold of 0 turns auto-pin off, the next sweep gives every auto-pinned CPU back.
+int cas_engine_set_auto_pin(CasEngine* engine, const CasCpuSet* pool, uint32_t threshold_percent, uint64_t time);
+// NOTE: Time of the next sweep, CPU times are compared between sweeps. Without it no process ever runs hot.
+void cas_engine_set_sample_time(CasEngine* engine, uint64_t time);
+int cas_engine_has_auto_pins(const CasEngine* engine);
+CasCpuSet cas_engine_auto_pin_original(const CasEngine* engine, uint32_t cpu);
+// NOTE: Only writes the state slot and the pool slot of the auto-pin. A release or a failed pin frees the CPU.
+void cas_engine_set_auto_pin_result(CasEngine* engine, CasAutoPin* auto_pin, uint32_t status);
+
+#define H_CAS_ENGINE_H
+#endif
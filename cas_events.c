@@ -0,0 +1,134 @@
+#include "cas_events.h"
+
+int cas_event_queue_push(CasEventQueue* queue, const CasProcessEvent* event)
+{
+    uint32_t head = queue->head;
+    uint32_t tail = CAS_ATOMIC_LOAD(&queue->tail);
+
+    if (head - tail >= CAS_EVENT_QUEUE_SIZE)
+    {
+        CAS_ATOMIC_STORE(&queue->overflow, 1u);
+        return 0;
+    }
+
+    queue->events[head % CAS_EVENT_QUEUE_SIZE] = *event;
+    CAS_ATOMIC_STORE(&queue->head, head + 1);
+
+    return 1;
+}
+
+uint32_t cas_event_queue_pop(CasEventQueue* queue, CasProcessEvent* events, uint32_t max_count)
+{
+    uint32_t count = 0;
+    uint32_t tail = queue->tail;
+    uint32_t head = CAS_ATOMIC_LOAD(&queue->head);
+
+    if (max_count && CAS_ATOMIC_LOAD(&queue->overflow))
+    {
+        CAS_ATOMIC_STORE(&queue->overflow, 0u);
+        events[count++] = (CasProcessEvent){ .type = CAS_EVENT_RESYNC };
+    }
+
+    while (count < max_count && tail != head)
+    {
+        events[count++] = queue->events[tail % CAS_EVENT_QUEUE_SIZE];
+        ++tail;
+    }
+
+    CAS_ATOMIC_STORE(&queue->tail, tail);
+
+    return count;
+}
+
+static int cas_events__fake_start(CasEventSource* source)
+{
+    (void)source;
+    return 1;
+}
+
+static void cas_events__fake_stop(CasEventSource* source)
+{
+    (void)source;
+}
+
+static uint32_t cas_events__fake_read(CasEventSource* source, CasProcessEvent* events, uint32_t max_count)
+{
+    return cas_event_queue_pop((CasEventQueue*)source->context, events, max_count);
+}
+
+// NOTE: In-memory source without a wait handle, events are injected with cas_event_source_fake_push.
+void cas_event_source_fake(CasEventSource* source, CasEventQueue* queue)
+{
+    memset(queue, 0, sizeof(*queue));
+
+    *source = (CasEventSource)
+    {
+        .name = "fake",
+        .wait_handle = -1,
+        .start = &cas_events__fake_start,
+        .stop = &cas_events__fake_stop,
+        .read = &cas_events__fake_read,
+        .context = queue,
+    };
+}
+
+int cas_event_source_fake_push(CasEventSource* source, uint32_t type, uint32_t pid)
+{
+    CasProcessEvent event = { .type = type, .pid = pid };
+
+    return cas_event_queue_push((CasEventQueue*)source->context, &event);
+}
+
+void cas_poll_schedule_init(CasPollSchedule* schedule, uint32_t max_delay_milliseconds, uint32_t drift_delay_milliseconds, uint32_t auto_pin_milliseconds)
+{
+    schedule->max_delay = max_delay_milliseconds;
+    schedule->delay = 0;
+    schedule->drift_delay = drift_delay_milliseconds;
+    schedule->sample_delay = auto_pin_milliseconds / CAS_POLL_AUTO_PIN_SAMPLES;
+    schedule->sample_delay = auto_pin_milliseconds && schedule->sample_delay < CAS_POLL_MIN_DELAY ? CAS_POLL_MIN_DELAY : schedule->sample_delay;
+}
+
+uint32_t cas_poll_schedule_next(CasPollSchedule* schedule, int is_busy)
+{
+    if (!schedule->max_delay)
+    {
+        return 0;
+    }
+
+    if (is_busy || !schedule->delay)
+    {
+        schedule->delay = CAS_POLL_MIN_DELAY;
+    }
+    else
+    {
+        schedule->delay = schedule->delay > schedule->max_delay / 2 ? schedule->max_delay : schedule->delay * 2;
+    }
+
+    schedule->delay = schedule->delay < schedule->max_delay ? schedule->delay : schedule->max_delay;
+
+    return schedule->delay;
+}
+
+// NOTE: Processes that drifted before are checked on every sweep, those sweeps come at least every drift_delay.
+// Kernel events never sweep on their own, there the drift delay is the only poll there is.
+uint32_t cas_poll_schedule_drift(const CasPollSchedule* schedule, uint32_t delay, int has_drifted)
+{
+    if (schedule->drift_delay && (!delay || (has_drifted && delay > schedule->drift_delay)))
+    {
+        return schedule->drift_delay;
+    }
+
+    return delay;
+}
+
+// NOTE: CPU times are only compared on sweeps. Quiet polls do not stretch past a share of the auto-pin time, and
+// like drift checks, with kernel events this is the only poll there is.
+uint32_t cas_poll_schedule_sample(const CasPollSchedule* schedule, uint32_t delay)
+{
+    if (schedule->sample_delay && (!delay || delay > schedule->sample_delay))
+    {
+        return schedule->sample_delay;
+    }
+
+    return delay;
+}
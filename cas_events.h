@@ -0,0 +1,89 @@
+#ifndef H_CAS_EVENTS_H
+
+#include "cas_base.h"
+
+#define CAS_EVENT_START           (1)
+#define CAS_EVENT_EXIT            (2)
+#define CAS_EVENT_RESYNC          (3)
+
+#define CAS_EVENT_SOURCE_KERNEL   (1 << 0)
+
+#define CAS_EVENT_QUEUE_SIZE      (4096)
+
+// NOTE: Shortest delay between polls, used while processes come and go.
+#define CAS_POLL_MIN_DELAY        (50)
+// NOTE: Auto-pin compares CPU times between sweeps, at least this many of them come within its time.
+#define CAS_POLL_AUTO_PIN_SAMPLES (4)
+
+typedef struct
+{
+    uint32_t type;
+    uint32_t pid;
+    uint32_t parent_pid;
+    uint32_t reserved;
+    uint64_t create_time;
+} CasProcessEvent;
+
+// NOTE: Single producer, single consumer ring. Overflow is reported as a resync so the consumer falls back to a full sweep.
+typedef struct
+{
+    CasProcessEvent events[CAS_EVENT_QUEUE_SIZE];
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t overflow;
+} CasEventQueue;
+
+typedef struct CasEventSource CasEventSource;
+
+struct CasEventSource
+{
+    const char* name;
+    uint32_t flags;
+    // NOTE: HANDLE on Windows, file descriptor on Linux, signaled when read has something to return.
+    intptr_t wait_handle;
+    int (*start)(CasEventSource* source);
+    void (*stop)(CasEventSource* source);
+    uint32_t (*read)(CasEventSource* source, CasProcessEvent* events, uint32_t max_count);
+    // NOTE: Only the exit source has one, it keeps a handle to the process and reports its exit. Returns 0 when the
+    // process is already gone or the source is full.
+    int (*watch)(CasEventSource* source, uint32_t pid, uint64_t create_time);
+    void* context;
+};
+
+// NOTE: Delay to the next poll. A busy sweep drops it to CAS_POLL_MIN_DELAY, every quiet one doubles it up to
+// max_delay. A zero max_delay polls once. drift_delay is the longest wait while drift checks are on, sample_delay
+// the longest one while auto-pin is.
+typedef struct
+{
+    uint32_t max_delay;
+    uint32_t delay;
+    uint32_t drift_delay;
+    uint32_t sample_delay;
+} CasPollSchedule;
+
+int cas_event_queue_push(CasEventQueue* queue, const CasProcessEvent* event);
+uint32_t cas_event_queue_pop(CasEventQueue* queue, CasProcessEvent* events, uint32_t max_count);
+
+void cas_event_source_fake(CasEventSource* source, CasEventQueue* queue);
+int cas_event_source_fake_push(CasEventSource* source, uint32_t type, uint32_t pid);
+
+// NOTE: auto_pin_milliseconds is the auto-pin time, 0 while auto-pin is off.
+void cas_poll_schedule_init(CasPollSchedule* schedule, uint32_t max_delay_milliseconds, uint32_t drift_delay_milliseconds, uint32_t auto_pin_milliseconds);
+// NOTE: Returns the delay in milliseconds, 0 when no poll should follow.
+uint32_t cas_poll_schedule_next(CasPollSchedule* schedule, int is_busy);
+// NOTE: Shortens the delay to the next poll for drift checks, called after every sweep with whatever delay it had.
+uint32_t cas_poll_schedule_drift(const CasPollSchedule* schedule, uint32_t delay, int has_drifted);
+// NOTE: Shortens the delay to the next poll for auto-pin samples, called after cas_poll_schedule_drift.
+uint32_t cas_poll_schedule_sample(const CasPollSchedule* schedule, uint32_t delay);
+
+// NOTE: Implemented per platform in cas_events_win32.c and cas_events_linux.c.
+int cas_event_source_kernel(CasEventSource* source);
+int cas_event_source_poll(CasEventSource* source);
+// NOTE: Exits of watched processes only, a pidfd per process on Linux and a registered wait on Windows.
+int cas_event_source_exits(CasEventSource* source);
+void cas_event_source_poll_set_period(CasEventSource* source, uint32_t period_milliseconds);
+// NOTE: One poll after delay, the timer may fire up to a quarter of it late so idle wake ups can be coalesced.
+void cas_event_source_poll_set_delay(CasEventSource* source, uint32_t delay_milliseconds);
+
+#define H_CAS_EVENTS_H
+#endif
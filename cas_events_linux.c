@@ -0,0 +1,389 @@
+#define _GNU_SOURCE
+
+#include "cas_events.h"
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/timerfd.h>
+#include <linux/netlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+
+#define CAS_EVENTS_RECEIVE_SIZE   (16 * 1024)
+#define CAS_EVENTS_MAX_WATCHES    (65536)
+#define CAS_EVENTS_READY_COUNT    (64)
+
+// NOTE: Linux 5.3, the number is the same on every architecture.
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open            (434)
+#endif
+
+typedef struct
+{
+    int socket_fd;
+    int pending_resync;
+} CasEventsKernel;
+
+typedef struct
+{
+    int timer_fd;
+} CasEventsPoll;
+
+// NOTE: pids is indexed by pidfd, 0 for descriptors that are not a watch. Watches stop at half the descriptor limit
+// so /proc reads never run out of descriptors.
+typedef struct
+{
+    int epoll_fd;
+    uint32_t* pids;
+    uint32_t pid_capacity;
+    uint32_t watch_count;
+    uint32_t max_watch_count;
+} CasEventsExits;
+
+typedef struct __attribute__((aligned(NLMSG_ALIGNTO)))
+{
+    struct nlmsghdr header;
+    struct __attribute__((packed))
+    {
+        struct cn_msg message;
+        enum proc_cn_mcast_op operation;
+    } body;
+} CasEventsSubscribe;
+
+static CasEventsKernel global_kernel = { .socket_fd = -1 };
+static CasEventsPoll global_poll = { .timer_fd = -1 };
+static CasEventsExits global_exits = { .epoll_fd = -1 };
+
+static int cas_events__kernel_subscribe(int socket_fd, enum proc_cn_mcast_op operation)
+{
+    CasEventsSubscribe subscribe = { 0 };
+
+    subscribe.header.nlmsg_len = sizeof(subscribe);
+    subscribe.header.nlmsg_pid = (uint32_t)getpid();
+    subscribe.header.nlmsg_type = NLMSG_DONE;
+    subscribe.body.message.id.idx = CN_IDX_PROC;
+    subscribe.body.message.id.val = CN_VAL_PROC;
+    subscribe.body.message.len = sizeof(enum proc_cn_mcast_op);
+    subscribe.body.operation = operation;
+
+    return send(socket_fd, &subscribe, sizeof(subscribe), 0) == (ssize_t)sizeof(subscribe);
+}
+
+static void cas_events__kernel_stop(CasEventSource* source)
+{
+    CasEventsKernel* kernel = (CasEventsKernel*)source->context;
+
+    if (kernel->socket_fd >= 0)
+    {
+        cas_events__kernel_subscribe(kernel->socket_fd, PROC_CN_MCAST_IGNORE);
+        close(kernel->socket_fd);
+        kernel->socket_fd = -1;
+        source->wait_handle = -1;
+    }
+}
+
+// NOTE: Proc connector multicast group, needs CAP_NET_ADMIN.
+static int cas_events__kernel_start(CasEventSource* source)
+{
+    CasEventsKernel* kernel = (CasEventsKernel*)source->context;
+    struct sockaddr_nl address = { .nl_family = AF_NETLINK, .nl_groups = CN_IDX_PROC };
+    int socket_fd = socket(PF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+
+    if (socket_fd < 0)
+    {
+        return 0;
+    }
+
+    if (bind(socket_fd, (struct sockaddr*)&address, sizeof(address)) < 0 ||
+        !cas_events__kernel_subscribe(socket_fd, PROC_CN_MCAST_LISTEN))
+    {
+        close(socket_fd);
+        return 0;
+    }
+
+    kernel->socket_fd = socket_fd;
+    kernel->pending_resync = 0;
+    source->wait_handle = socket_fd;
+
+    return 1;
+}
+
+// NOTE: The proc connector sends one proc_event per datagram, so every receive yields at most one event.
+static uint32_t cas_events__kernel_read(CasEventSource* source, CasProcessEvent* events, uint32_t max_count)
+{
+    CasEventsKernel* kernel = (CasEventsKernel*)source->context;
+    uint32_t count = 0;
+    char buffer[CAS_EVENTS_RECEIVE_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+    while (count < max_count)
+    {
+        ssize_t received = 0;
+
+        if (kernel->pending_resync)
+        {
+            kernel->pending_resync = 0;
+            events[count++] = (CasProcessEvent){ .type = CAS_EVENT_RESYNC };
+            continue;
+        }
+
+        received = recv(kernel->socket_fd, buffer, sizeof(buffer), 0);
+
+        if (received < 0)
+        {
+            // NOTE: The kernel dropped events, only a full sweep can recover.
+            if (errno == ENOBUFS)
+            {
+                kernel->pending_resync = 1;
+                continue;
+            }
+
+            break;
+        }
+
+        for (struct nlmsghdr* header = (struct nlmsghdr*)buffer; NLMSG_OK(header, (uint32_t)received) && count < max_count; header = NLMSG_NEXT(header, received))
+        {
+            struct cn_msg* message = (struct cn_msg*)NLMSG_DATA(header);
+            struct proc_event* proc_event = (struct proc_event*)message->data;
+
+            if (header->nlmsg_type == NLMSG_ERROR || header->nlmsg_type == NLMSG_NOOP)
+            {
+                continue;
+            }
+
+            if (proc_event->what == PROC_EVENT_EXEC)
+            {
+                events[count++] = (CasProcessEvent)
+                {
+                    .type = CAS_EVENT_START,
+                    .pid = (uint32_t)proc_event->event_data.exec.process_tgid,
+                };
+            }
+            else if (proc_event->what == PROC_EVENT_EXIT &&
+                     proc_event->event_data.exit.process_pid == proc_event->event_data.exit.process_tgid)
+            {
+                events[count++] = (CasProcessEvent)
+                {
+                    .type = CAS_EVENT_EXIT,
+                    .pid = (uint32_t)proc_event->event_data.exit.process_tgid,
+                };
+            }
+        }
+    }
+
+    return count;
+}
+
+int cas_event_source_kernel(CasEventSource* source)
+{
+    *source = (CasEventSource)
+    {
+        .name = "proc-connector",
+        .flags = CAS_EVENT_SOURCE_KERNEL,
+        .wait_handle = -1,
+        .start = &cas_events__kernel_start,
+        .stop = &cas_events__kernel_stop,
+        .read = &cas_events__kernel_read,
+        .context = &global_kernel,
+    };
+
+    return 1;
+}
+
+static int cas_events__poll_start(CasEventSource* source)
+{
+    (void)source;
+    return 1;
+}
+
+static void cas_events__poll_stop(CasEventSource* source)
+{
+    CasEventsPoll* poll = (CasEventsPoll*)source->context;
+    struct itimerspec timer = { 0 };
+
+    timerfd_settime(poll->timer_fd, 0, &timer, 0);
+}
+
+static uint32_t cas_events__poll_read(CasEventSource* source, CasProcessEvent* events, uint32_t max_count)
+{
+    CasEventsPoll* poll = (CasEventsPoll*)source->context;
+    uint64_t expirations = 0;
+
+    if (max_count && read(poll->timer_fd, &expirations, sizeof(expirations)) == (ssize_t)sizeof(expirations) && expirations)
+    {
+        events[0] = (CasProcessEvent){ .type = CAS_EVENT_RESYNC };
+        return 1;
+    }
+
+    return 0;
+}
+
+int cas_event_source_poll(CasEventSource* source)
+{
+    CasEventsPoll* poll = &global_poll;
+
+    poll->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+    *source = (CasEventSource)
+    {
+        .name = "poll",
+        .wait_handle = poll->timer_fd,
+        .start = &cas_events__poll_start,
+        .stop = &cas_events__poll_stop,
+        .read = &cas_events__poll_read,
+        .context = poll,
+    };
+
+    return poll->timer_fd >= 0;
+}
+
+void cas_event_source_poll_set_period(CasEventSource* source, uint32_t period_milliseconds)
+{
+    CasEventsPoll* poll = (CasEventsPoll*)source->context;
+    struct itimerspec timer = { 0 };
+
+    // NOTE: Fires immediately, then every period. A zero period makes it a one-shot sweep.
+    timer.it_value.tv_nsec = 1;
+    timer.it_interval.tv_sec = period_milliseconds / 1000;
+    timer.it_interval.tv_nsec = (long)(period_milliseconds % 1000) * 1000000;
+
+    timerfd_settime(poll->timer_fd, 0, &timer, 0);
+}
+
+// NOTE: timerfd has no tolerance of its own, the poll runs on time.
+void cas_event_source_poll_set_delay(CasEventSource* source, uint32_t delay_milliseconds)
+{
+    CasEventsPoll* poll = (CasEventsPoll*)source->context;
+    struct itimerspec timer = { 0 };
+
+    timer.it_value.tv_sec = delay_milliseconds / 1000;
+    timer.it_value.tv_nsec = (long)(delay_milliseconds % 1000) * 1000000;
+
+    timerfd_settime(poll->timer_fd, 0, &timer, 0);
+}
+
+static int cas_events__exits_start(CasEventSource* source)
+{
+    (void)source;
+    return 1;
+}
+
+static void cas_events__exits_stop(CasEventSource* source)
+{
+    CasEventsExits* exits = (CasEventsExits*)source->context;
+
+    for (uint32_t fd = 0; fd < exits->pid_capacity; ++fd)
+    {
+        if (exits->pids[fd])
+        {
+            close((int)fd);
+        }
+    }
+
+    free(exits->pids);
+    exits->pids = 0;
+    exits->pid_capacity = 0;
+    exits->watch_count = 0;
+}
+
+// NOTE: A PID reused between the pin and pidfd_open watches the wrong process, its exit only costs a sweep.
+static int cas_events__exits_watch(CasEventSource* source, uint32_t pid, uint64_t create_time)
+{
+    CasEventsExits* exits = (CasEventsExits*)source->context;
+    struct epoll_event event = { .events = EPOLLIN };
+    int fd = -1;
+
+    (void)create_time;
+
+    if (exits->watch_count >= exits->max_watch_count || (fd = (int)syscall(SYS_pidfd_open, (pid_t)pid, 0)) < 0)
+    {
+        return 0;
+    }
+
+    if ((uint32_t)fd >= exits->pid_capacity)
+    {
+        uint32_t capacity = exits->pid_capacity ? exits->pid_capacity : 16;
+        uint32_t* pids = 0;
+
+        while (capacity <= (uint32_t)fd)
+        {
+            capacity *= 2;
+        }
+
+        pids = realloc(exits->pids, capacity * sizeof(uint32_t));
+
+        if (!pids)
+        {
+            close(fd);
+            return 0;
+        }
+
+        memset(pids + exits->pid_capacity, 0, (capacity - exits->pid_capacity) * sizeof(uint32_t));
+        exits->pids = pids;
+        exits->pid_capacity = capacity;
+    }
+
+    event.data.fd = fd;
+
+    if (epoll_ctl(exits->epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        close(fd);
+        return 0;
+    }
+
+    exits->pids[fd] = pid;
+    ++exits->watch_count;
+
+    return 1;
+}
+
+// NOTE: A pidfd turns readable once its process exited, closing it also takes it out of the epoll set.
+static uint32_t cas_events__exits_read(CasEventSource* source, CasProcessEvent* events, uint32_t max_count)
+{
+    CasEventsExits* exits = (CasEventsExits*)source->context;
+    struct epoll_event ready[CAS_EVENTS_READY_COUNT];
+    int ready_count = epoll_wait(exits->epoll_fd, ready, max_count < CAS_EVENTS_READY_COUNT ? (int)max_count : CAS_EVENTS_READY_COUNT, 0);
+    uint32_t count = 0;
+
+    for (int i = 0; i < ready_count; ++i)
+    {
+        int fd = ready[i].data.fd;
+
+        events[count++] = (CasProcessEvent){ .type = CAS_EVENT_EXIT, .pid = exits->pids[fd] };
+        exits->pids[fd] = 0;
+        --exits->watch_count;
+        close(fd);
+    }
+
+    return count;
+}
+
+int cas_event_source_exits(CasEventSource* source)
+{
+    CasEventsExits* exits = &global_exits;
+    struct rlimit limit = { 0 };
+
+    exits->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    exits->max_watch_count = CAS_EVENTS_MAX_WATCHES;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur / 2 < CAS_EVENTS_MAX_WATCHES)
+    {
+        exits->max_watch_count = (uint32_t)(limit.rlim_cur / 2);
+    }
+
+    *source = (CasEventSource)
+    {
+        .name = "pidfd",
+        .wait_handle = exits->epoll_fd,
+        .start = &cas_events__exits_start,
+        .stop = &cas_events__exits_stop,
+        .read = &cas_events__exits_read,
+        .watch = &cas_events__exits_watch,
+        .context = exits,
+    };
+
+    return exits->epoll_fd >= 0;
+}
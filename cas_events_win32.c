@@ -0,0 +1,447 @@
+#include "cas.h"
+#include "cas_events.h"
+
+#pragma warning(push, 0)
+#include <evntrace.h>
+#include <evntcons.h>
+#pragma warning(pop)
+
+#define CAS_EVENTS_TRACE_NAME               (L"cas-process-trace")
+#define CAS_EVENTS_PROCESS_START_ID         (1)
+#define CAS_EVENTS_PROCESS_STOP_ID          (2)
+#define CAS_EVENTS_KEYWORD_PROCESS          (0x10)
+#define CAS_EVENTS_FLUSH_MILLISECONDS       (10)
+// NOTE: The thread pool waits on 63 handles per thread, this many watches keep it at about 65 threads.
+#define CAS_EVENTS_MAX_WATCHES              (4096)
+
+#ifndef EVENT_TRACE_USE_MS_FLUSH_TIMER
+#define EVENT_TRACE_USE_MS_FLUSH_TIMER      (0x00000010)
+#endif
+
+// NOTE: Microsoft-Windows-Kernel-Process {22FB2CD6-0E7B-422B-A0C7-2FAD1FD0E716}
+static const GUID global_kernel_process_guid = { 0x22fb2cd6, 0x0e7b, 0x422b, { 0xa0, 0xc7, 0x2f, 0xad, 0x1f, 0xd0, 0xe7, 0x16 } };
+
+typedef struct
+{
+    EVENT_TRACE_PROPERTIES properties;
+    WCHAR session_name[64];
+} CasEventsTraceProperties;
+
+typedef struct
+{
+    CasEventQueue queue;
+    HANDLE event_handle;
+    HANDLE thread_handle;
+    TRACEHANDLE session_handle;
+    TRACEHANDLE trace_handle;
+    CasEventsTraceProperties trace_properties;
+} CasEventsKernel;
+
+typedef struct
+{
+    HANDLE timer_handle;
+} CasEventsPoll;
+
+typedef struct CasEventsWatch CasEventsWatch;
+
+struct CasEventsWatch
+{
+    CasEventsWatch* previous;
+    CasEventsWatch* next;
+    HANDLE process_handle;
+    HANDLE wait_handle;
+    uint32_t pid;
+    volatile LONG is_exited;
+};
+
+// NOTE: Wait callbacks run on the thread pool and only flag their watch, the list belongs to the thread reading the
+// source. A read walks every watch, there are few enough of them.
+typedef struct
+{
+    HANDLE event_handle;
+    CasEventsWatch* watches;
+    uint32_t watch_count;
+} CasEventsExits;
+
+static CasEventsKernel global_kernel;
+static CasEventsPoll global_poll;
+static CasEventsExits global_exits;
+
+static void cas_events__reset_properties(CasEventsTraceProperties* trace_properties)
+{
+    memset(trace_properties, 0, sizeof(*trace_properties));
+
+    trace_properties->properties.Wnode.BufferSize = sizeof(*trace_properties);
+    trace_properties->properties.Wnode.Flags = WNODE_FLAG_TRACED_GUID;
+    trace_properties->properties.Wnode.ClientContext = 1;
+    trace_properties->properties.LogFileMode = EVENT_TRACE_REAL_TIME_MODE | EVENT_TRACE_USE_MS_FLUSH_TIMER;
+    trace_properties->properties.FlushTimer = CAS_EVENTS_FLUSH_MILLISECONDS;
+    trace_properties->properties.LoggerNameOffset = offsetof(CasEventsTraceProperties, session_name);
+}
+
+static VOID WINAPI cas_events__trace_callback(PEVENT_RECORD record)
+{
+    CasEventsKernel* kernel = (CasEventsKernel*)record->UserContext;
+    USHORT id = record->EventHeader.EventDescriptor.Id;
+
+    if (IsEqualGUID(&record->EventHeader.ProviderId, &global_kernel_process_guid) &&
+        (id == CAS_EVENTS_PROCESS_START_ID || id == CAS_EVENTS_PROCESS_STOP_ID) &&
+        record->UserDataLength >= 12)
+    {
+        // NOTE: Only ProcessID and CreateTime are shared by the ProcessStart and ProcessStop templates. ParentProcessID
+        // follows them in ProcessStart, in ProcessStop the same offset is the low half of ExitTime.
+        const BYTE* data = (const BYTE*)record->UserData;
+        CasProcessEvent event = { .type = id == CAS_EVENTS_PROCESS_START_ID ? CAS_EVENT_START : CAS_EVENT_EXIT };
+
+        memcpy(&event.pid, data, sizeof(event.pid));
+        memcpy(&event.create_time, data + 4, sizeof(event.create_time));
+
+        if (id == CAS_EVENTS_PROCESS_START_ID && record->UserDataLength >= 16)
+        {
+            memcpy(&event.parent_pid, data + 12, sizeof(event.parent_pid));
+        }
+
+        cas_event_queue_push(&kernel->queue, &event);
+        SetEvent(kernel->event_handle);
+    }
+}
+
+static DWORD WINAPI cas_events__trace_thread_proc(LPVOID parameter)
+{
+    CasEventsKernel* kernel = (CasEventsKernel*)parameter;
+
+    ProcessTrace(&kernel->trace_handle, 1, 0, 0);
+
+    return 0;
+}
+
+static void cas_events__kernel_stop(CasEventSource* source)
+{
+    CasEventsKernel* kernel = (CasEventsKernel*)source->context;
+
+    if (kernel->trace_handle != INVALID_PROCESSTRACE_HANDLE)
+    {
+        CloseTrace(kernel->trace_handle);
+        kernel->trace_handle = INVALID_PROCESSTRACE_HANDLE;
+    }
+
+    if (kernel->session_handle)
+    {
+        cas_events__reset_properties(&kernel->trace_properties);
+        ControlTraceW(kernel->session_handle, 0, &kernel->trace_properties.properties, EVENT_TRACE_CONTROL_STOP);
+        kernel->session_handle = 0;
+    }
+
+    if (kernel->thread_handle)
+    {
+        WaitForSingleObject(kernel->thread_handle, INFINITE);
+        CloseHandle(kernel->thread_handle);
+        kernel->thread_handle = 0;
+    }
+}
+
+static int cas_events__kernel_start(CasEventSource* source)
+{
+    CasEventsKernel* kernel = (CasEventsKernel*)source->context;
+    ULONG status = 0;
+    EVENT_TRACE_LOGFILEW log_file =
+    {
+        .LoggerName = CAS_EVENTS_TRACE_NAME,
+        .ProcessTraceMode = PROCESS_TRACE_MODE_REAL_TIME | PROCESS_TRACE_MODE_EVENT_RECORD,
+        .EventRecordCallback = &cas_events__trace_callback,
+        .Context = kernel,
+    };
+
+    cas_events__reset_properties(&kernel->trace_properties);
+    status = StartTraceW(&kernel->session_handle, CAS_EVENTS_TRACE_NAME, &kernel->trace_properties.properties);
+
+    // NOTE: A session left over from a crashed instance keeps the name, stop it and start over.
+    if (status == ERROR_ALREADY_EXISTS)
+    {
+        ControlTraceW(0, CAS_EVENTS_TRACE_NAME, &kernel->trace_properties.properties, EVENT_TRACE_CONTROL_STOP);
+        cas_events__reset_properties(&kernel->trace_properties);
+        status = StartTraceW(&kernel->session_handle, CAS_EVENTS_TRACE_NAME, &kernel->trace_properties.properties);
+    }
+
+    if (status != ERROR_SUCCESS)
+    {
+        kernel->session_handle = 0;
+        return 0;
+    }
+
+    status = EnableTraceEx2(kernel->session_handle, &global_kernel_process_guid, EVENT_CONTROL_CODE_ENABLE_PROVIDER,
+                            TRACE_LEVEL_INFORMATION, CAS_EVENTS_KEYWORD_PROCESS, 0, 0, 0);
+
+    if (status == ERROR_SUCCESS)
+    {
+        kernel->trace_handle = OpenTraceW(&log_file);
+
+        if (kernel->trace_handle != INVALID_PROCESSTRACE_HANDLE)
+        {
+            kernel->thread_handle = CreateThread(0, 0, &cas_events__trace_thread_proc, kernel, 0, 0);
+        }
+    }
+
+    if (!kernel->thread_handle)
+    {
+        cas_events__kernel_stop(source);
+        return 0;
+    }
+
+    return 1;
+}
+
+static uint32_t cas_events__kernel_read(CasEventSource* source, CasProcessEvent* events, uint32_t max_count)
+{
+    CasEventsKernel* kernel = (CasEventsKernel*)source->context;
+
+    return cas_event_queue_pop(&kernel->queue, events, max_count);
+}
+
+// NOTE: ETW real-time session on the kernel process provider, needs administrator rights.
+int cas_event_source_kernel(CasEventSource* source)
+{
+    CasEventsKernel* kernel = &global_kernel;
+
+    memset(kernel, 0, sizeof(*kernel));
+    kernel->trace_handle = INVALID_PROCESSTRACE_HANDLE;
+    kernel->event_handle = CreateEventW(0, FALSE, FALSE, 0);
+
+    *source = (CasEventSource)
+    {
+        .name = "etw",
+        .flags = CAS_EVENT_SOURCE_KERNEL,
+        .wait_handle = (intptr_t)kernel->event_handle,
+        .start = &cas_events__kernel_start,
+        .stop = &cas_events__kernel_stop,
+        .read = &cas_events__kernel_read,
+        .context = kernel,
+    };
+
+    return kernel->event_handle != 0;
+}
+
+static int cas_events__poll_start(CasEventSource* source)
+{
+    (void)source;
+    return 1;
+}
+
+static void cas_events__poll_stop(CasEventSource* source)
+{
+    CasEventsPoll* poll = (CasEventsPoll*)source->context;
+
+    CancelWaitableTimer(poll->timer_handle);
+}
+
+// NOTE: The timer wait already consumed the signal, every wake up is one full sweep.
+static uint32_t cas_events__poll_read(CasEventSource* source, CasProcessEvent* events, uint32_t max_count)
+{
+    (void)source;
+
+    if (max_count)
+    {
+        events[0] = (CasProcessEvent){ .type = CAS_EVENT_RESYNC };
+        return 1;
+    }
+
+    return 0;
+}
+
+int cas_event_source_poll(CasEventSource* source)
+{
+    CasEventsPoll* poll = &global_poll;
+
+    poll->timer_handle = CreateWaitableTimerW(0, 0, 0);
+
+    *source = (CasEventSource)
+    {
+        .name = "poll",
+        .wait_handle = (intptr_t)poll->timer_handle,
+        .start = &cas_events__poll_start,
+        .stop = &cas_events__poll_stop,
+        .read = &cas_events__poll_read,
+        .context = poll,
+    };
+
+    return poll->timer_handle != 0;
+}
+
+// NOTE: Fires immediately, then every period. A zero period makes it a one-shot sweep.
+void cas_event_source_poll_set_period(CasEventSource* source, uint32_t period_milliseconds)
+{
+    CasEventsPoll* poll = (CasEventsPoll*)source->context;
+    LARGE_INTEGER due_time = { 0 };
+    FILETIME file_time = { 0 };
+    BOOL is_timer_set = 0;
+
+    GetSystemTimeAsFileTime(&file_time);
+
+    due_time.LowPart = file_time.dwLowDateTime;
+    due_time.HighPart = (LONG)file_time.dwHighDateTime;
+
+    is_timer_set = SetWaitableTimer(poll->timer_handle, &due_time, (LONG)period_milliseconds, 0, 0, 0);
+    ASSERT(is_timer_set);
+}
+
+// NOTE: A relative due time, the tolerable delay lets the system fold the wake up into another timer.
+void cas_event_source_poll_set_delay(CasEventSource* source, uint32_t delay_milliseconds)
+{
+    CasEventsPoll* poll = (CasEventsPoll*)source->context;
+    LARGE_INTEGER due_time = { 0 };
+    BOOL is_timer_set = 0;
+
+    due_time.QuadPart = -(LONGLONG)delay_milliseconds * 10000;
+
+    is_timer_set = SetWaitableTimerEx(poll->timer_handle, &due_time, 0, 0, 0, 0, delay_milliseconds / 4);
+    ASSERT(is_timer_set);
+}
+
+static void cas_events__exits_free(CasEventsExits* exits, CasEventsWatch* watch, HANDLE completion_event)
+{
+    UnregisterWaitEx(watch->wait_handle, completion_event);
+    CloseHandle(watch->process_handle);
+
+    if (watch->previous)
+    {
+        watch->previous->next = watch->next;
+    }
+    else
+    {
+        exits->watches = watch->next;
+    }
+
+    if (watch->next)
+    {
+        watch->next->previous = watch->previous;
+    }
+
+    --exits->watch_count;
+    free(watch);
+}
+
+static VOID CALLBACK cas_events__exits_callback(PVOID parameter, BOOLEAN is_timeout)
+{
+    CasEventsWatch* watch = (CasEventsWatch*)parameter;
+
+    (void)is_timeout;
+
+    InterlockedExchange(&watch->is_exited, 1);
+    SetEvent(global_exits.event_handle);
+}
+
+static int cas_events__exits_start(CasEventSource* source)
+{
+    (void)source;
+    return 1;
+}
+
+// NOTE: Waits for callbacks in flight, exits not read yet are dropped.
+static void cas_events__exits_stop(CasEventSource* source)
+{
+    CasEventsExits* exits = (CasEventsExits*)source->context;
+
+    while (exits->watches)
+    {
+        cas_events__exits_free(exits, exits->watches, INVALID_HANDLE_VALUE);
+    }
+}
+
+// NOTE: The handle keeps the PID from being reused, the creation time makes sure it is still the pinned process.
+static int cas_events__exits_watch(CasEventSource* source, uint32_t pid, uint64_t create_time)
+{
+    CasEventsExits* exits = (CasEventsExits*)source->context;
+    CasEventsWatch* watch = 0;
+    FILETIME times[4];
+    ULARGE_INTEGER process_create_time = { 0 };
+
+    if (exits->watch_count >= CAS_EVENTS_MAX_WATCHES)
+    {
+        return 0;
+    }
+
+    watch = malloc(sizeof(CasEventsWatch));
+
+    if (!watch)
+    {
+        return 0;
+    }
+
+    memset(watch, 0, sizeof(*watch));
+    watch->pid = pid;
+    watch->process_handle = OpenProcess(SYNCHRONIZE | PROCESS_QUERY_LIMITED_INFORMATION, FALSE, pid);
+
+    if (watch->process_handle && GetProcessTimes(watch->process_handle, times, times + 1, times + 2, times + 3))
+    {
+        process_create_time.LowPart = times[0].dwLowDateTime;
+        process_create_time.HighPart = times[0].dwHighDateTime;
+    }
+
+    if (!watch->process_handle || process_create_time.QuadPart != create_time ||
+        !RegisterWaitForSingleObject(&watch->wait_handle, watch->process_handle, &cas_events__exits_callback, watch,
+                                     INFINITE, WT_EXECUTEONLYONCE | WT_EXECUTEINWAITTHREAD))
+    {
+        if (watch->process_handle)
+        {
+            CloseHandle(watch->process_handle);
+        }
+
+        free(watch);
+        return 0;
+    }
+
+    watch->next = exits->watches;
+
+    if (exits->watches)
+    {
+        exits->watches->previous = watch;
+    }
+
+    exits->watches = watch;
+    ++exits->watch_count;
+
+    return 1;
+}
+
+static uint32_t cas_events__exits_read(CasEventSource* source, CasProcessEvent* events, uint32_t max_count)
+{
+    CasEventsExits* exits = (CasEventsExits*)source->context;
+    CasEventsWatch* watch = exits->watches;
+    uint32_t count = 0;
+
+    while (watch && count < max_count)
+    {
+        CasEventsWatch* next = watch->next;
+
+        // NOTE: The callback is done with a flagged watch, nothing to wait for.
+        if (watch->is_exited)
+        {
+            events[count++] = (CasProcessEvent){ .type = CAS_EVENT_EXIT, .pid = watch->pid };
+            cas_events__exits_free(exits, watch, 0);
+        }
+
+        watch = next;
+    }
+
+    return count;
+}
+
+int cas_event_source_exits(CasEventSource* source)
+{
+    CasEventsExits* exits = &global_exits;
+
+    exits->event_handle = CreateEventW(0, FALSE, FALSE, 0);
+
+    *source = (CasEventSource)
+    {
+        .name = "process-wait",
+        .wait_handle = (intptr_t)exits->event_handle,
+        .start = &cas_events__exits_start,
+        .stop = &cas_events__exits_stop,
+        .read = &cas_events__exits_read,
+        .watch = &cas_events__exits_watch,
+        .context = exits,
+    };
+
+    return exits->event_handle != 0;
+}
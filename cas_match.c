@@ -0,0 +1,874 @@
+#include "cas_match.h"
+
+#define CAS_MATCHER_NONE           (0xffffffff)
+#define CAS_MATCHER_SET_WORDS      (4)
+
+#define CAS_MATCHER_NODE_SET       (1)
+#define CAS_MATCHER_NODE_SPLIT     (2)
+#define CAS_MATCHER_NODE_EMPTY     (3)
+#define CAS_MATCHER_NODE_MATCH     (4)
+
+// NOTE: A fragment is a start node and a list of dangling exits. The list is threaded through the exits
+// themselves, an entry is node * 2 + 1 for out1 and node * 2 for out.
+typedef struct
+{
+    uint32_t start;
+    uint32_t exits;
+} CasMatcherFragment;
+
+typedef struct
+{
+    CasMatcher* matcher;
+    const char* text;
+    uint32_t length;
+    uint32_t position;
+    int kind;
+    int error;
+} CasMatcherParser;
+
+static int cas_matcher__grow(void** data, uint32_t* capacity, uint32_t needed, size_t element_size)
+{
+    int result = 1;
+
+    if (needed > *capacity)
+    {
+        uint32_t new_capacity = *capacity ? *capacity : 16;
+        void* new_data = 0;
+
+        while (new_capacity < needed)
+        {
+            new_capacity *= 2;
+        }
+
+        new_data = realloc(*data, new_capacity * element_size);
+
+        if (new_data)
+        {
+            *data = new_data;
+            *capacity = new_capacity;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+// NOTE: "re:" starts a regular expression, any of * ? [ makes a glob, everything else is an exact name.
+int cas_pattern_kind(const char* pattern, uint32_t length)
+{
+    if (length > 3 && pattern[0] == 'r' && pattern[1] == 'e' && pattern[2] == ':')
+    {
+        return CAS_PATTERN_REGEX;
+    }
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        if (pattern[i] == '*' || pattern[i] == '?' || pattern[i] == '[')
+        {
+            return CAS_PATTERN_GLOB;
+        }
+    }
+
+    return 0;
+}
+
+void cas_matcher_init(CasMatcher* matcher)
+{
+    memset(matcher, 0, sizeof(*matcher));
+}
+
+void cas_matcher_free(CasMatcher* matcher)
+{
+    free(matcher->nodes);
+    free(matcher->sets);
+    free(matcher->pattern_starts);
+    free(matcher->transitions);
+    free(matcher->state_accept_offsets);
+    free(matcher->state_accept_counts);
+    free(matcher->accepts);
+    free(matcher->state_node_offsets);
+    free(matcher->state_node_counts);
+    free(matcher->state_nodes);
+    free(matcher->state_index);
+    free(matcher->node_marks);
+    free(matcher->node_stack);
+    free(matcher->closure);
+    memset(matcher, 0, sizeof(*matcher));
+}
+
+void cas_matcher_clear(CasMatcher* matcher)
+{
+    matcher->node_count = 0;
+    matcher->set_count = 0;
+    matcher->pattern_count = 0;
+    matcher->state_count = 0;
+    matcher->start_state = CAS_MATCHER_DEAD_STATE;
+}
+
+static uint32_t cas_matcher__node(CasMatcherParser* parser, uint32_t type, uint32_t out, uint32_t out1, uint32_t value)
+{
+    CasMatcher* matcher = parser->matcher;
+
+    if (!cas_matcher__grow((void**)&matcher->nodes, &matcher->node_capacity, matcher->node_count + 1, sizeof(CasMatcherNode)))
+    {
+        parser->error = 1;
+        return CAS_MATCHER_NONE;
+    }
+
+    matcher->nodes[matcher->node_count] = (CasMatcherNode){ type, out, out1, value };
+
+    return matcher->node_count++;
+}
+
+static uint32_t* cas_matcher__exit(CasMatcher* matcher, uint32_t exit)
+{
+    CasMatcherNode* node = matcher->nodes + (exit >> 1);
+
+    return (exit & 1) ? &node->out1 : &node->out;
+}
+
+static void cas_matcher__patch(CasMatcher* matcher, uint32_t exits, uint32_t target)
+{
+    while (exits != CAS_MATCHER_NONE)
+    {
+        uint32_t* field = cas_matcher__exit(matcher, exits);
+
+        exits = *field;
+        *field = target;
+    }
+}
+
+static uint32_t cas_matcher__append(CasMatcher* matcher, uint32_t exits, uint32_t more)
+{
+    uint32_t last = exits;
+
+    if (exits == CAS_MATCHER_NONE)
+    {
+        return more;
+    }
+
+    while (*cas_matcher__exit(matcher, last) != CAS_MATCHER_NONE)
+    {
+        last = *cas_matcher__exit(matcher, last);
+    }
+
+    *cas_matcher__exit(matcher, last) = more;
+
+    return exits;
+}
+
+static uint32_t cas_matcher__new_set(CasMatcherParser* parser)
+{
+    CasMatcher* matcher = parser->matcher;
+
+    if (!cas_matcher__grow((void**)&matcher->sets, &matcher->set_capacity, (matcher->set_count + 1) * CAS_MATCHER_SET_WORDS, sizeof(uint64_t)))
+    {
+        parser->error = 1;
+        return CAS_MATCHER_NONE;
+    }
+
+    memset(matcher->sets + matcher->set_count * CAS_MATCHER_SET_WORDS, 0, CAS_MATCHER_SET_WORDS * sizeof(uint64_t));
+
+    return matcher->set_count++;
+}
+
+static void cas_matcher__set_add(CasMatcher* matcher, uint32_t set, uint32_t first, uint32_t last)
+{
+    uint64_t* words = matcher->sets + set * CAS_MATCHER_SET_WORDS;
+
+    for (uint32_t c = first; c <= last && c < 256; ++c)
+    {
+        words[c / 64] |= 1ull << (c % 64);
+    }
+}
+
+static int cas_matcher__set_contains(const CasMatcher* matcher, uint32_t set, uint32_t c)
+{
+    return (matcher->sets[set * CAS_MATCHER_SET_WORDS + c / 64] >> (c % 64)) & 1;
+}
+
+// NOTE: Letters get both cases before a negation is applied, so [^a] refuses 'A' as well.
+static void cas_matcher__set_finish(CasMatcher* matcher, uint32_t set, int is_negated)
+{
+    uint64_t* words = matcher->sets + set * CAS_MATCHER_SET_WORDS;
+
+    for (uint32_t c = 'a'; c <= 'z'; ++c)
+    {
+        if (cas_matcher__set_contains(matcher, set, c) || cas_matcher__set_contains(matcher, set, c - ('a' - 'A')))
+        {
+            cas_matcher__set_add(matcher, set, c, c);
+            cas_matcher__set_add(matcher, set, c - ('a' - 'A'), c - ('a' - 'A'));
+        }
+    }
+
+    if (is_negated)
+    {
+        for (uint32_t i = 0; i < CAS_MATCHER_SET_WORDS; ++i)
+        {
+            words[i] = ~words[i];
+        }
+    }
+}
+
+static CasMatcherFragment cas_matcher__set_fragment(CasMatcherParser* parser, uint32_t set)
+{
+    uint32_t node = set != CAS_MATCHER_NONE ? cas_matcher__node(parser, CAS_MATCHER_NODE_SET, CAS_MATCHER_NONE, CAS_MATCHER_NONE, set) : CAS_MATCHER_NONE;
+
+    return (CasMatcherFragment){ node, node != CAS_MATCHER_NONE ? node << 1 : CAS_MATCHER_NONE };
+}
+
+static CasMatcherFragment cas_matcher__range_fragment(CasMatcherParser* parser, uint32_t first, uint32_t last)
+{
+    uint32_t set = cas_matcher__new_set(parser);
+
+    if (set != CAS_MATCHER_NONE)
+    {
+        cas_matcher__set_add(parser->matcher, set, first, last);
+        cas_matcher__set_finish(parser->matcher, set, 0);
+    }
+
+    return cas_matcher__set_fragment(parser, set);
+}
+
+static CasMatcherFragment cas_matcher__empty_fragment(CasMatcherParser* parser)
+{
+    uint32_t node = cas_matcher__node(parser, CAS_MATCHER_NODE_EMPTY, CAS_MATCHER_NONE, CAS_MATCHER_NONE, 0);
+
+    return (CasMatcherFragment){ node, node != CAS_MATCHER_NONE ? node << 1 : CAS_MATCHER_NONE };
+}
+
+static CasMatcherFragment cas_matcher__concat(CasMatcherParser* parser, CasMatcherFragment a, CasMatcherFragment b)
+{
+    cas_matcher__patch(parser->matcher, a.exits, b.start);
+
+    return (CasMatcherFragment){ a.start, b.exits };
+}
+
+static CasMatcherFragment cas_matcher__alternate(CasMatcherParser* parser, CasMatcherFragment a, CasMatcherFragment b)
+{
+    uint32_t split = cas_matcher__node(parser, CAS_MATCHER_NODE_SPLIT, a.start, b.start, 0);
+
+    if (split == CAS_MATCHER_NONE)
+    {
+        return a;
+    }
+
+    return (CasMatcherFragment){ split, cas_matcher__append(parser->matcher, a.exits, b.exits) };
+}
+
+// NOTE: '*' loops back through a split that is also the way out, '+' enters the fragment first, '?' may skip it.
+static CasMatcherFragment cas_matcher__repeat(CasMatcherParser* parser, CasMatcherFragment a, char operation)
+{
+    uint32_t split = cas_matcher__node(parser, CAS_MATCHER_NODE_SPLIT, a.start, CAS_MATCHER_NONE, 0);
+    CasMatcherFragment result = a;
+
+    if (split == CAS_MATCHER_NONE)
+    {
+        return a;
+    }
+
+    if (operation == '*')
+    {
+        cas_matcher__patch(parser->matcher, a.exits, split);
+        result = (CasMatcherFragment){ split, (split << 1) | 1 };
+    }
+    else if (operation == '+')
+    {
+        cas_matcher__patch(parser->matcher, a.exits, split);
+        result = (CasMatcherFragment){ a.start, (split << 1) | 1 };
+    }
+    else
+    {
+        result = (CasMatcherFragment){ split, cas_matcher__append(parser->matcher, a.exits, (split << 1) | 1) };
+    }
+
+    return result;
+}
+
+static int cas_matcher__at(const CasMatcherParser* parser, char c)
+{
+    return parser->position < parser->length && parser->text[parser->position] == c;
+}
+
+// NOTE: \d \w \s and their negations, any other escaped byte stands for itself.
+static void cas_matcher__escape(CasMatcherParser* parser, uint32_t set, char c)
+{
+    CasMatcher* matcher = parser->matcher;
+    char lower = (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+    uint32_t scratch = 0;
+
+    if (lower != 'd' && lower != 'w' && lower != 's')
+    {
+        cas_matcher__set_add(matcher, set, (uint8_t)c, (uint8_t)c);
+        return;
+    }
+
+    scratch = lower == c ? set : cas_matcher__new_set(parser);
+
+    if (scratch == CAS_MATCHER_NONE)
+    {
+        return;
+    }
+
+    if (lower == 'd' || lower == 'w')
+    {
+        cas_matcher__set_add(matcher, scratch, '0', '9');
+    }
+
+    if (lower == 'w')
+    {
+        cas_matcher__set_add(matcher, scratch, 'a', 'z');
+        cas_matcher__set_add(matcher, scratch, 'A', 'Z');
+        cas_matcher__set_add(matcher, scratch, '_', '_');
+    }
+
+    if (lower == 's')
+    {
+        cas_matcher__set_add(matcher, scratch, ' ', ' ');
+        cas_matcher__set_add(matcher, scratch, '\t', '\r');
+    }
+
+    // NOTE: The negated class is built in a scratch set and merged, the scratch set is simply left unused.
+    if (scratch != set)
+    {
+        for (uint32_t i = 0; i < CAS_MATCHER_SET_WORDS; ++i)
+        {
+            matcher->sets[set * CAS_MATCHER_SET_WORDS + i] |= ~matcher->sets[scratch * CAS_MATCHER_SET_WORDS + i];
+        }
+    }
+}
+
+// NOTE: [abc] [a-z] [^a] and [!a] in globs. A ']' right after the opening bracket is a member.
+static CasMatcherFragment cas_matcher__class(CasMatcherParser* parser)
+{
+    uint32_t set = cas_matcher__new_set(parser);
+    int is_negated = cas_matcher__at(parser, '^') || (parser->kind == CAS_PATTERN_GLOB && cas_matcher__at(parser, '!'));
+    int is_first = 1;
+
+    if (set == CAS_MATCHER_NONE)
+    {
+        return (CasMatcherFragment){ CAS_MATCHER_NONE, CAS_MATCHER_NONE };
+    }
+
+    parser->position += is_negated ? 1 : 0;
+
+    while (parser->position < parser->length && (is_first || !cas_matcher__at(parser, ']')))
+    {
+        uint8_t first = (uint8_t)parser->text[parser->position++];
+
+        is_first = 0;
+
+        if (first == '\\' && parser->kind == CAS_PATTERN_REGEX && parser->position < parser->length)
+        {
+            cas_matcher__escape(parser, set, parser->text[parser->position++]);
+        }
+        else if (parser->position + 1 < parser->length && cas_matcher__at(parser, '-') && parser->text[parser->position + 1] != ']')
+        {
+            uint8_t last = (uint8_t)parser->text[parser->position + 1];
+
+            parser->position += 2;
+
+            if (last < first)
+            {
+                parser->error = 1;
+            }
+
+            cas_matcher__set_add(parser->matcher, set, first, last);
+        }
+        else
+        {
+            cas_matcher__set_add(parser->matcher, set, first, first);
+        }
+    }
+
+    if (!cas_matcher__at(parser, ']'))
+    {
+        parser->error = 1;
+        return (CasMatcherFragment){ CAS_MATCHER_NONE, CAS_MATCHER_NONE };
+    }
+
+    ++parser->position;
+    cas_matcher__set_finish(parser->matcher, set, is_negated);
+
+    return cas_matcher__set_fragment(parser, set);
+}
+
+static CasMatcherFragment cas_matcher__alternation(CasMatcherParser* parser);
+
+static CasMatcherFragment cas_matcher__atom(CasMatcherParser* parser)
+{
+    char c = parser->text[parser->position++];
+    CasMatcherFragment fragment = { CAS_MATCHER_NONE, CAS_MATCHER_NONE };
+
+    if (c == '[')
+    {
+        fragment = cas_matcher__class(parser);
+    }
+    else if (parser->kind == CAS_PATTERN_GLOB)
+    {
+        if (c == '*')
+        {
+            fragment = cas_matcher__repeat(parser, cas_matcher__range_fragment(parser, 0, 255), '*');
+        }
+        else
+        {
+            fragment = c == '?' ? cas_matcher__range_fragment(parser, 0, 255) : cas_matcher__range_fragment(parser, (uint8_t)c, (uint8_t)c);
+        }
+    }
+    else if (c == '(')
+    {
+        fragment = cas_matcher__alternation(parser);
+
+        if (!cas_matcher__at(parser, ')'))
+        {
+            parser->error = 1;
+        }
+
+        ++parser->position;
+    }
+    else if (c == '.')
+    {
+        fragment = cas_matcher__range_fragment(parser, 0, 255);
+    }
+    else if (c == '\\')
+    {
+        uint32_t set = parser->position < parser->length ? cas_matcher__new_set(parser) : CAS_MATCHER_NONE;
+
+        if (set != CAS_MATCHER_NONE)
+        {
+            cas_matcher__escape(parser, set, parser->text[parser->position++]);
+            cas_matcher__set_finish(parser->matcher, set, 0);
+        }
+
+        parser->error |= set == CAS_MATCHER_NONE;
+        fragment = cas_matcher__set_fragment(parser, set);
+    }
+    else if (c == '*' || c == '+' || c == '?' || c == ')')
+    {
+        parser->error = 1;
+    }
+    else
+    {
+        fragment = cas_matcher__range_fragment(parser, (uint8_t)c, (uint8_t)c);
+    }
+
+    return fragment;
+}
+
+static CasMatcherFragment cas_matcher__sequence(CasMatcherParser* parser)
+{
+    CasMatcherFragment result = { CAS_MATCHER_NONE, CAS_MATCHER_NONE };
+    int is_empty = 1;
+
+    while (!parser->error && parser->position < parser->length &&
+           (parser->kind == CAS_PATTERN_GLOB || (!cas_matcher__at(parser, '|') && !cas_matcher__at(parser, ')'))))
+    {
+        CasMatcherFragment atom = cas_matcher__atom(parser);
+
+        while (!parser->error && parser->kind == CAS_PATTERN_REGEX &&
+               (cas_matcher__at(parser, '*') || cas_matcher__at(parser, '+') || cas_matcher__at(parser, '?')))
+        {
+            atom = cas_matcher__repeat(parser, atom, parser->text[parser->position++]);
+        }
+
+        if (parser->error)
+        {
+            break;
+        }
+
+        result = is_empty ? atom : cas_matcher__concat(parser, result, atom);
+        is_empty = 0;
+    }
+
+    return is_empty && !parser->error ? cas_matcher__empty_fragment(parser) : result;
+}
+
+static CasMatcherFragment cas_matcher__alternation(CasMatcherParser* parser)
+{
+    CasMatcherFragment result = cas_matcher__sequence(parser);
+
+    while (!parser->error && cas_matcher__at(parser, '|'))
+    {
+        ++parser->position;
+        result = cas_matcher__alternate(parser, result, cas_matcher__sequence(parser));
+    }
+
+    return result;
+}
+
+// NOTE: Regular expressions are anchored anyway, a leading '^' and a trailing '$' are accepted and ignored.
+int cas_matcher_add(CasMatcher* matcher, const char* pattern, uint32_t length, int kind, uint32_t id)
+{
+    CasMatcherParser parser = { matcher, pattern, length, 0, kind, 0 };
+    uint32_t node_count = matcher->node_count;
+    uint32_t set_count = matcher->set_count;
+    CasMatcherFragment fragment = { CAS_MATCHER_NONE, CAS_MATCHER_NONE };
+
+    if (kind == CAS_PATTERN_REGEX)
+    {
+        parser.position = 3;
+        parser.position += cas_matcher__at(&parser, '^') ? 1 : 0;
+        parser.length -= (length > parser.position && pattern[length - 1] == '$' && pattern[length - 2] != '\\') ? 1 : 0;
+    }
+
+    fragment = cas_matcher__alternation(&parser);
+
+    if (!parser.error && parser.position == parser.length)
+    {
+        uint32_t match = cas_matcher__node(&parser, CAS_MATCHER_NODE_MATCH, CAS_MATCHER_NONE, CAS_MATCHER_NONE, id);
+
+        if (match != CAS_MATCHER_NONE &&
+            cas_matcher__grow((void**)&matcher->pattern_starts, &matcher->pattern_capacity, matcher->pattern_count + 1, sizeof(uint32_t)))
+        {
+            cas_matcher__patch(matcher, fragment.exits, match);
+            matcher->pattern_starts[matcher->pattern_count++] = fragment.start;
+
+            return 1;
+        }
+    }
+
+    // NOTE: A bad pattern leaves nothing behind.
+    matcher->node_count = node_count;
+    matcher->set_count = set_count;
+
+    return 0;
+}
+
+static int cas_matcher__compare(const void* a, const void* b)
+{
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+// NOTE: Follows splits and empty nodes from the seeds. Only byte sets and matches are kept, sorted, so equal
+// NFA positions always give the same list.
+static uint32_t cas_matcher__closure(CasMatcher* matcher, const uint32_t* seeds, uint32_t seed_count)
+{
+    uint32_t stack_count = 0;
+    uint32_t count = 0;
+
+    ++matcher->mark;
+
+    for (uint32_t i = 0; i < seed_count; ++i)
+    {
+        matcher->node_stack[stack_count++] = seeds[i];
+    }
+
+    while (stack_count)
+    {
+        uint32_t node_index = matcher->node_stack[--stack_count];
+        CasMatcherNode* node = 0;
+
+        if (node_index == CAS_MATCHER_NONE || matcher->node_marks[node_index] == matcher->mark)
+        {
+            continue;
+        }
+
+        matcher->node_marks[node_index] = matcher->mark;
+        node = matcher->nodes + node_index;
+
+        if (node->type == CAS_MATCHER_NODE_SPLIT)
+        {
+            matcher->node_stack[stack_count++] = node->out1;
+            matcher->node_stack[stack_count++] = node->out;
+        }
+        else if (node->type == CAS_MATCHER_NODE_EMPTY)
+        {
+            matcher->node_stack[stack_count++] = node->out;
+        }
+        else
+        {
+            matcher->closure[count++] = node_index;
+        }
+    }
+
+    qsort(matcher->closure, count, sizeof(uint32_t), &cas_matcher__compare);
+
+    return count;
+}
+
+static uint32_t cas_matcher__hash_nodes(const uint32_t* nodes, uint32_t count)
+{
+    uint32_t hash = 2166136261u;
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        hash = (hash ^ nodes[i]) * 16777619u;
+    }
+
+    return hash;
+}
+
+// NOTE: The state index is kept under half full and rebuilt from the states when it grows.
+static int cas_matcher__reserve_index(CasMatcher* matcher)
+{
+    uint32_t capacity = matcher->state_index_capacity;
+    uint32_t* index = 0;
+    uint32_t mask = 0;
+
+    if ((matcher->state_count + 1) * 2 <= capacity)
+    {
+        return 1;
+    }
+
+    capacity *= 2;
+    index = realloc(matcher->state_index, capacity * sizeof(uint32_t));
+
+    if (!index)
+    {
+        return 0;
+    }
+
+    matcher->state_index = index;
+    matcher->state_index_capacity = capacity;
+    mask = capacity - 1;
+    memset(index, 0xff, capacity * sizeof(uint32_t));
+
+    for (uint32_t state = 0; state < matcher->state_count; ++state)
+    {
+        uint32_t slot = cas_matcher__hash_nodes(matcher->state_nodes + matcher->state_node_offsets[state], matcher->state_node_counts[state]) & mask;
+
+        while (index[slot] != CAS_MATCHER_NONE)
+        {
+            slot = (slot + 1) & mask;
+        }
+
+        index[slot] = state;
+    }
+
+    return 1;
+}
+
+// NOTE: Returns the state for the node list in closure, adding it when it is new. CAS_MATCHER_NONE when out of memory or states.
+static uint32_t cas_matcher__state(CasMatcher* matcher, uint32_t count)
+{
+    uint32_t state = matcher->state_count;
+    uint32_t hash = cas_matcher__hash_nodes(matcher->closure, count);
+    uint32_t mask = 0;
+    uint32_t slot = 0;
+
+    if (!cas_matcher__reserve_index(matcher))
+    {
+        return CAS_MATCHER_NONE;
+    }
+
+    mask = matcher->state_index_capacity - 1;
+
+    for (slot = hash & mask; matcher->state_index[slot] != CAS_MATCHER_NONE; slot = (slot + 1) & mask)
+    {
+        uint32_t existing = matcher->state_index[slot];
+
+        if (matcher->state_node_counts[existing] == count &&
+            !memcmp(matcher->state_nodes + matcher->state_node_offsets[existing], matcher->closure, count * sizeof(uint32_t)))
+        {
+            return existing;
+        }
+    }
+
+    if (state == CAS_MATCHER_MAX_STATES ||
+        !cas_matcher__grow((void**)&matcher->state_nodes, &matcher->state_node_capacity, matcher->state_node_used + count + 1, sizeof(uint32_t)) ||
+        !cas_matcher__grow((void**)&matcher->transitions, &matcher->transition_capacity, (state + 1) * matcher->class_count, sizeof(uint32_t)))
+    {
+        return CAS_MATCHER_NONE;
+    }
+
+    if (state == matcher->state_capacity)
+    {
+        uint32_t capacity = matcher->state_capacity ? matcher->state_capacity * 2 : 64;
+        uint32_t** arrays[] = { &matcher->state_node_offsets, &matcher->state_node_counts, &matcher->state_accept_offsets, &matcher->state_accept_counts };
+
+        for (uint32_t i = 0; i < ARRAY_COUNT(arrays); ++i)
+        {
+            uint32_t* data = realloc(*arrays[i], capacity * sizeof(uint32_t));
+
+            if (!data)
+            {
+                return CAS_MATCHER_NONE;
+            }
+
+            *arrays[i] = data;
+        }
+
+        matcher->state_capacity = capacity;
+    }
+
+    matcher->state_index[slot] = state;
+    matcher->state_node_offsets[state] = matcher->state_node_used;
+    matcher->state_node_counts[state] = count;
+    memcpy(matcher->state_nodes + matcher->state_node_used, matcher->closure, count * sizeof(uint32_t));
+    matcher->state_node_used += count;
+    ++matcher->state_count;
+
+    return state;
+}
+
+// NOTE: Bytes no pattern tells apart share a class, the transition table then has one column per class.
+// Every set splits the classes into members and non members.
+static void cas_matcher__byte_classes(CasMatcher* matcher)
+{
+    uint32_t remap[512];
+
+    memset(matcher->byte_classes, 0, sizeof(matcher->byte_classes));
+    matcher->class_count = 1;
+
+    for (uint32_t set = 0; set < matcher->set_count; ++set)
+    {
+        uint32_t class_count = 0;
+
+        memset(remap, 0xff, sizeof(remap));
+
+        for (uint32_t c = 0; c < 256; ++c)
+        {
+            uint32_t key = matcher->byte_classes[c] * 2 + (uint32_t)cas_matcher__set_contains(matcher, set, c);
+
+            if (remap[key] == CAS_MATCHER_NONE)
+            {
+                remap[key] = class_count++;
+            }
+
+            matcher->byte_classes[c] = (uint8_t)remap[key];
+        }
+
+        matcher->class_count = class_count;
+    }
+}
+
+static int cas_matcher__accepts(CasMatcher* matcher, uint32_t state)
+{
+    uint32_t offset = matcher->accept_count;
+    uint32_t count = 0;
+    const uint32_t* nodes = matcher->state_nodes + matcher->state_node_offsets[state];
+
+    for (uint32_t i = 0; i < matcher->state_node_counts[state]; ++i)
+    {
+        const CasMatcherNode* node = matcher->nodes + nodes[i];
+
+        if (node->type == CAS_MATCHER_NODE_MATCH)
+        {
+            if (!cas_matcher__grow((void**)&matcher->accepts, &matcher->accept_capacity, offset + count + 1, sizeof(uint32_t)))
+            {
+                return 0;
+            }
+
+            matcher->accepts[offset + count++] = node->value;
+        }
+    }
+
+    if (count > 1)
+    {
+        qsort(matcher->accepts + offset, count, sizeof(uint32_t), &cas_matcher__compare);
+    }
+
+    matcher->state_accept_offsets[state] = offset;
+    matcher->state_accept_counts[state] = count;
+    matcher->accept_count += count;
+
+    return 1;
+}
+
+// NOTE: Subset construction, states are numbered in the order they are found and expanded in that order.
+// Fails when a pattern set would need more than CAS_MATCHER_MAX_STATES states.
+int cas_matcher_compile(CasMatcher* matcher)
+{
+    uint32_t node_capacity = 0;
+    uint8_t class_bytes[256];
+
+    matcher->state_count = 0;
+    matcher->state_node_used = 0;
+    matcher->accept_count = 0;
+    matcher->start_state = CAS_MATCHER_DEAD_STATE;
+
+    cas_matcher__byte_classes(matcher);
+
+    for (uint32_t c = 256; c > 0; --c)
+    {
+        class_bytes[matcher->byte_classes[c - 1]] = (uint8_t)(c - 1);
+    }
+
+    // NOTE: A node is pushed once per incoming edge, splits have two.
+    node_capacity = matcher->node_count * 3 + matcher->pattern_count + 1;
+
+    if (!cas_matcher__grow((void**)&matcher->state_index, &matcher->state_index_capacity, 64, sizeof(uint32_t)) ||
+        !cas_matcher__grow((void**)&matcher->node_marks, &matcher->node_mark_capacity, matcher->node_count + 1, sizeof(uint32_t)) ||
+        !cas_matcher__grow((void**)&matcher->node_stack, &matcher->node_stack_capacity, node_capacity, sizeof(uint32_t)) ||
+        !cas_matcher__grow((void**)&matcher->closure, &matcher->closure_capacity, node_capacity, sizeof(uint32_t)))
+    {
+        return 0;
+    }
+
+    memset(matcher->node_marks, 0, matcher->node_mark_capacity * sizeof(uint32_t));
+    memset(matcher->state_index, 0xff, matcher->state_index_capacity * sizeof(uint32_t));
+    matcher->mark = 0;
+
+    if (cas_matcher__state(matcher, 0) != CAS_MATCHER_DEAD_STATE)
+    {
+        return 0;
+    }
+
+    matcher->start_state = cas_matcher__state(matcher, cas_matcher__closure(matcher, matcher->pattern_starts, matcher->pattern_count));
+
+    for (uint32_t state = 0; state < matcher->state_count && matcher->start_state != CAS_MATCHER_NONE; ++state)
+    {
+        for (uint32_t byte_class = 0; byte_class < matcher->class_count; ++byte_class)
+        {
+            uint8_t c = class_bytes[byte_class];
+            uint32_t seed_count = 0;
+            uint32_t target = 0;
+
+            // NOTE: The seeds go into the closure buffer, the closure moves them to the stack before writing it.
+            for (uint32_t i = 0; i < matcher->state_node_counts[state]; ++i)
+            {
+                const CasMatcherNode* node = matcher->nodes + matcher->state_nodes[matcher->state_node_offsets[state] + i];
+
+                if (node->type == CAS_MATCHER_NODE_SET && cas_matcher__set_contains(matcher, node->value, c))
+                {
+                    matcher->closure[seed_count++] = node->out;
+                }
+            }
+
+            target = cas_matcher__state(matcher, cas_matcher__closure(matcher, matcher->closure, seed_count));
+
+            if (target == CAS_MATCHER_NONE)
+            {
+                matcher->state_count = 0;
+                matcher->start_state = CAS_MATCHER_DEAD_STATE;
+                return 0;
+            }
+
+            matcher->transitions[state * matcher->class_count + byte_class] = target;
+        }
+
+        if (!cas_matcher__accepts(matcher, state))
+        {
+            matcher->state_count = 0;
+            matcher->start_state = CAS_MATCHER_DEAD_STATE;
+            return 0;
+        }
+    }
+
+    if (matcher->start_state == CAS_MATCHER_NONE)
+    {
+        matcher->state_count = 0;
+        matcher->start_state = CAS_MATCHER_DEAD_STATE;
+        return 0;
+    }
+
+    return 1;
+}
+
+uint32_t cas_matcher_run(const CasMatcher* matcher, const char* text, uint32_t length)
+{
+    uint32_t state = matcher->start_state;
+
+    for (uint32_t i = 0; i < length && state != CAS_MATCHER_DEAD_STATE; ++i)
+    {
+        state = matcher->transitions[state * matcher->class_count + matcher->byte_classes[(uint8_t)text[i]]];
+    }
+
+    return state;
+}
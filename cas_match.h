@@ -0,0 +1,76 @@
+#ifndef H_CAS_MATCH_H
+
+#include "cas_base.h"
+
+#define CAS_PATTERN_GLOB           (1)
+#define CAS_PATTERN_REGEX          (2)
+
+#define CAS_MATCHER_DEAD_STATE     (0)
+#define CAS_MATCHER_MAX_STATES     (1 << 16)
+
+typedef struct
+{
+    uint32_t type;
+    uint32_t out;
+    uint32_t out1;
+    uint32_t value;
+} CasMatcherNode;
+
+// NOTE: Patterns are added as Thompson NFA fragments and compiled into one DFA over byte classes,
+// so a name costs one table lookup per character however many patterns there are.
+// Matching is ASCII case insensitive and anchored at both ends. State 0 is the dead state.
+typedef struct
+{
+    CasMatcherNode* nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+    // NOTE: 256 bit byte sets, four words each.
+    uint64_t* sets;
+    uint32_t set_count;
+    uint32_t set_capacity;
+    uint32_t* pattern_starts;
+    uint32_t pattern_count;
+    uint32_t pattern_capacity;
+
+    uint8_t byte_classes[256];
+    uint32_t class_count;
+    uint32_t* transitions;
+    uint32_t transition_capacity;
+    uint32_t start_state;
+    uint32_t state_count;
+    uint32_t state_capacity;
+    // NOTE: Pattern ids accepted in each state, ascending.
+    uint32_t* state_accept_offsets;
+    uint32_t* state_accept_counts;
+    uint32_t* accepts;
+    uint32_t accept_count;
+    uint32_t accept_capacity;
+
+    // NOTE: Compile scratch, the NFA node set behind each DFA state and the index deduplicating them.
+    uint32_t* state_node_offsets;
+    uint32_t* state_node_counts;
+    uint32_t* state_nodes;
+    uint32_t state_node_used;
+    uint32_t state_node_capacity;
+    uint32_t* state_index;
+    uint32_t state_index_capacity;
+    uint32_t* node_marks;
+    uint32_t node_mark_capacity;
+    uint32_t* node_stack;
+    uint32_t node_stack_capacity;
+    uint32_t* closure;
+    uint32_t closure_capacity;
+    uint32_t mark;
+} CasMatcher;
+
+int cas_pattern_kind(const char* pattern, uint32_t length);
+
+void cas_matcher_init(CasMatcher* matcher);
+void cas_matcher_free(CasMatcher* matcher);
+void cas_matcher_clear(CasMatcher* matcher);
+int cas_matcher_add(CasMatcher* matcher, const char* pattern, uint32_t length, int kind, uint32_t id);
+int cas_matcher_compile(CasMatcher* matcher);
+uint32_t cas_matcher_run(const CasMatcher* matcher, const char* text, uint32_t length);
+
+#define H_CAS_MATCH_H
+#endif
@@ -0,0 +1,112 @@
+#include "cas_pool.h"
+
+#define CAS_POOL_RANGE(begin, end)   ((uint64_t)(begin) | (uint64_t)(end) << 32)
+#define CAS_POOL_BEGIN(range)        ((uint32_t)(range))
+#define CAS_POOL_END(range)          ((uint32_t)((range) >> 32))
+
+static int cas_pool__take(volatile uint64_t* range, uint32_t* item)
+{
+    for (;;)
+    {
+        uint64_t value = CAS_ATOMIC_LOAD(range);
+        uint32_t begin = CAS_POOL_BEGIN(value);
+        uint32_t end = CAS_POOL_END(value);
+
+        if (begin >= end)
+        {
+            return 0;
+        }
+
+        if (CAS_ATOMIC_CAS64(range, value, CAS_POOL_RANGE(begin + 1, end)))
+        {
+            *item = begin;
+            return 1;
+        }
+    }
+}
+
+// NOTE: Only called with an empty range of our own. Thieves never swap an empty range, so a plain store hands the
+// stolen half over, and a range holds the same items whenever it holds the same value.
+static int cas_pool__steal(CasPool* pool, uint32_t worker)
+{
+    for (uint32_t i = 1; i < pool->worker_count; ++i)
+    {
+        uint32_t victim = (worker + i) % pool->worker_count;
+        uint64_t value = CAS_ATOMIC_LOAD(pool->ranges + victim);
+        uint32_t begin = CAS_POOL_BEGIN(value);
+        uint32_t end = CAS_POOL_END(value);
+        uint32_t half = end > begin ? (end - begin + 1) / 2 : 0;
+
+        if (half && CAS_ATOMIC_CAS64(pool->ranges + victim, value, CAS_POOL_RANGE(begin, end - half)))
+        {
+            CAS_ATOMIC_STORE(pool->ranges + worker, CAS_POOL_RANGE(end - half, end));
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+// NOTE: Returns whether this was the last worker out, that one signals the end of the run.
+int cas_pool_work(CasPool* pool, uint32_t worker)
+{
+    uint32_t item = 0;
+
+    while (cas_pool_clock() < pool->deadline)
+    {
+        if (cas_pool__take(pool->ranges + worker, &item))
+        {
+            pool->function(pool->function_context, worker, item);
+        }
+        else if (!cas_pool__steal(pool, worker))
+        {
+            break;
+        }
+    }
+
+    return CAS_ATOMIC_ADD32(&pool->active, (uint32_t)-1) == 1;
+}
+
+// NOTE: Items are split evenly over the workers up front, stealing evens out the items that turn out slow.
+// Returns how many items were left when the budget ran out.
+uint32_t cas_pool_run(CasPool* pool, uint32_t item_count, uint32_t budget_milliseconds, CasPoolFunction* function, void* function_context)
+{
+    uint32_t worker_count = 1 + item_count / CAS_POOL_ITEMS_PER_WORKER;
+    uint32_t left = 0;
+
+    worker_count = worker_count < 1 + pool->thread_count ? worker_count : 1 + pool->thread_count;
+
+    pool->worker_count = worker_count;
+    pool->function = function;
+    pool->function_context = function_context;
+    pool->deadline = cas_pool_clock() + budget_milliseconds;
+
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        uint32_t begin = (uint32_t)((uint64_t)item_count * i / worker_count);
+        uint32_t end = (uint32_t)((uint64_t)item_count * (i + 1) / worker_count);
+
+        CAS_ATOMIC_STORE(pool->ranges + i, CAS_POOL_RANGE(begin, end));
+    }
+
+    CAS_ATOMIC_STORE(&pool->active, worker_count);
+
+    if (worker_count > 1)
+    {
+        cas_pool_wake(pool, worker_count - 1);
+    }
+
+    if (!cas_pool_work(pool, 0))
+    {
+        cas_pool_wait(pool);
+    }
+
+    for (uint32_t i = 0; i < worker_count; ++i)
+    {
+        uint64_t value = CAS_ATOMIC_LOAD(pool->ranges + i);
+
+        left += CAS_POOL_END(value) - CAS_POOL_BEGIN(value);
+    }
+
+    return left;
+}
@@ -0,0 +1,41 @@
+#ifndef H_CAS_POOL_H
+
+#include "cas_base.h"
+
+// NOTE: Workers besides the calling thread, which always takes part as worker 0.
+#define CAS_POOL_MAX_THREADS         (7)
+#define CAS_POOL_MAX_WORKERS         (CAS_POOL_MAX_THREADS + 1)
+// NOTE: A thread is only woken for this many items, smaller runs stay on fewer workers.
+#define CAS_POOL_ITEMS_PER_WORKER    (8)
+
+typedef void CasPoolFunction(void* context, uint32_t worker, uint32_t item);
+
+// NOTE: Every worker owns a range of items packed as begin | end << 32. The owner takes items from the front,
+// a worker that ran dry steals the back half of another range, both with a compare and swap of the whole range.
+// Items left when the deadline passes are not started, the ones in flight finish, on the calling thread as well.
+typedef struct
+{
+    volatile uint64_t ranges[CAS_POOL_MAX_WORKERS];
+    volatile uint32_t active;
+    volatile uint32_t is_stopping;
+    uint32_t worker_count;
+    uint32_t thread_count;
+    uint64_t deadline;
+    CasPoolFunction* function;
+    void* function_context;
+    void* context;
+} CasPool;
+
+uint32_t cas_pool_run(CasPool* pool, uint32_t item_count, uint32_t budget_milliseconds, CasPoolFunction* function, void* function_context);
+int cas_pool_work(CasPool* pool, uint32_t worker);
+
+// NOTE: Per platform, cas_pool_win32.c and cas_pool_linux.c. A pool that could not start its threads still runs
+// everything on the calling thread. wake lets threads 1 to count go, wait returns once the last one of them is done.
+int cas_pool_start(CasPool* pool, uint32_t thread_count);
+void cas_pool_stop(CasPool* pool);
+void cas_pool_wake(CasPool* pool, uint32_t count);
+void cas_pool_wait(CasPool* pool);
+uint64_t cas_pool_clock(void);
+
+#define H_CAS_POOL_H
+#endif
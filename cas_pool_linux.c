@@ -0,0 +1,143 @@
+#define _GNU_SOURCE
+
+#include "cas_pool.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <time.h>
+
+typedef struct
+{
+    CasPool* pool;
+    uint32_t worker;
+    pthread_t thread;
+    sem_t wake;
+} CasPoolThreadLinux;
+
+typedef struct
+{
+    CasPoolThreadLinux threads[CAS_POOL_MAX_WORKERS];
+    sem_t done;
+} CasPoolLinux;
+
+static CasPoolLinux global_pool;
+
+// NOTE: The daemon handles its signals on the main thread, an interrupted wait just waits again.
+static void cas_pool__wait_semaphore(sem_t* semaphore)
+{
+    while (sem_wait(semaphore) < 0 && errno == EINTR)
+    {
+        continue;
+    }
+}
+
+static void* cas_pool__thread(void* parameter)
+{
+    CasPoolThreadLinux* thread = (CasPoolThreadLinux*)parameter;
+    CasPoolLinux* linux_pool = (CasPoolLinux*)thread->pool->context;
+
+    for (;;)
+    {
+        cas_pool__wait_semaphore(&thread->wake);
+
+        if (CAS_ATOMIC_LOAD(&thread->pool->is_stopping))
+        {
+            break;
+        }
+
+        if (cas_pool_work(thread->pool, thread->worker))
+        {
+            sem_post(&linux_pool->done);
+        }
+    }
+
+    return 0;
+}
+
+int cas_pool_start(CasPool* pool, uint32_t thread_count)
+{
+    CasPoolLinux* linux_pool = &global_pool;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->context = linux_pool;
+    thread_count = thread_count < CAS_POOL_MAX_THREADS ? thread_count : CAS_POOL_MAX_THREADS;
+
+    if (sem_init(&linux_pool->done, 0, 0) < 0)
+    {
+        pool->context = 0;
+        return 0;
+    }
+
+    for (uint32_t i = 1; i <= thread_count; ++i)
+    {
+        CasPoolThreadLinux* thread = linux_pool->threads + i;
+
+        thread->pool = pool;
+        thread->worker = i;
+
+        if (sem_init(&thread->wake, 0, 0) < 0)
+        {
+            break;
+        }
+
+        if (pthread_create(&thread->thread, 0, &cas_pool__thread, thread) != 0)
+        {
+            sem_destroy(&thread->wake);
+            break;
+        }
+
+        pool->thread_count = i;
+    }
+
+    return pool->thread_count == thread_count;
+}
+
+void cas_pool_stop(CasPool* pool)
+{
+    CasPoolLinux* linux_pool = (CasPoolLinux*)pool->context;
+
+    if (!linux_pool)
+    {
+        return;
+    }
+
+    CAS_ATOMIC_STORE(&pool->is_stopping, 1);
+
+    for (uint32_t i = 1; i <= pool->thread_count; ++i)
+    {
+        sem_post(&linux_pool->threads[i].wake);
+        pthread_join(linux_pool->threads[i].thread, 0);
+        sem_destroy(&linux_pool->threads[i].wake);
+    }
+
+    sem_destroy(&linux_pool->done);
+    pool->thread_count = 0;
+    pool->context = 0;
+}
+
+void cas_pool_wake(CasPool* pool, uint32_t count)
+{
+    CasPoolLinux* linux_pool = (CasPoolLinux*)pool->context;
+
+    for (uint32_t i = 1; i <= count; ++i)
+    {
+        sem_post(&linux_pool->threads[i].wake);
+    }
+}
+
+void cas_pool_wait(CasPool* pool)
+{
+    CasPoolLinux* linux_pool = (CasPoolLinux*)pool->context;
+
+    cas_pool__wait_semaphore(&linux_pool->done);
+}
+
+uint64_t cas_pool_clock(void)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64_t)now.tv_sec * 1000 + (uint64_t)now.tv_nsec / 1000000;
+}
@@ -0,0 +1,127 @@
+#include "cas.h"
+#include "cas_pool.h"
+
+typedef struct
+{
+    CasPool* pool;
+    uint32_t worker;
+    HANDLE thread;
+    HANDLE wake;
+} CasPoolThreadWin32;
+
+typedef struct
+{
+    CasPoolThreadWin32 threads[CAS_POOL_MAX_WORKERS];
+    HANDLE done;
+} CasPoolWin32;
+
+static CasPoolWin32 global_pool;
+
+static DWORD WINAPI cas_pool__thread(LPVOID parameter)
+{
+    CasPoolThreadWin32* thread = (CasPoolThreadWin32*)parameter;
+    CasPoolWin32* win32_pool = (CasPoolWin32*)thread->pool->context;
+
+    for (;;)
+    {
+        WaitForSingleObject(thread->wake, INFINITE);
+
+        if (CAS_ATOMIC_LOAD(&thread->pool->is_stopping))
+        {
+            break;
+        }
+
+        if (cas_pool_work(thread->pool, thread->worker))
+        {
+            SetEvent(win32_pool->done);
+        }
+    }
+
+    return 0;
+}
+
+int cas_pool_start(CasPool* pool, uint32_t thread_count)
+{
+    CasPoolWin32* win32_pool = &global_pool;
+
+    memset(pool, 0, sizeof(*pool));
+    pool->context = win32_pool;
+    thread_count = thread_count < CAS_POOL_MAX_THREADS ? thread_count : CAS_POOL_MAX_THREADS;
+    win32_pool->done = CreateEventW(0, FALSE, FALSE, 0);
+
+    if (!win32_pool->done)
+    {
+        pool->context = 0;
+        return 0;
+    }
+
+    for (uint32_t i = 1; i <= thread_count; ++i)
+    {
+        CasPoolThreadWin32* thread = win32_pool->threads + i;
+
+        thread->pool = pool;
+        thread->worker = i;
+        thread->wake = CreateEventW(0, FALSE, FALSE, 0);
+        thread->thread = thread->wake ? CreateThread(0, 0, &cas_pool__thread, thread, 0, 0) : 0;
+
+        if (!thread->thread)
+        {
+            if (thread->wake)
+            {
+                CloseHandle(thread->wake);
+            }
+
+            break;
+        }
+
+        pool->thread_count = i;
+    }
+
+    return pool->thread_count == thread_count;
+}
+
+void cas_pool_stop(CasPool* pool)
+{
+    CasPoolWin32* win32_pool = (CasPoolWin32*)pool->context;
+
+    if (!win32_pool)
+    {
+        return;
+    }
+
+    CAS_ATOMIC_STORE(&pool->is_stopping, 1);
+
+    for (uint32_t i = 1; i <= pool->thread_count; ++i)
+    {
+        SetEvent(win32_pool->threads[i].wake);
+        WaitForSingleObject(win32_pool->threads[i].thread, INFINITE);
+        CloseHandle(win32_pool->threads[i].thread);
+        CloseHandle(win32_pool->threads[i].wake);
+    }
+
+    CloseHandle(win32_pool->done);
+    pool->thread_count = 0;
+    pool->context = 0;
+}
+
+void cas_pool_wake(CasPool* pool, uint32_t count)
+{
+    CasPoolWin32* win32_pool = (CasPoolWin32*)pool->context;
+
+    for (uint32_t i = 1; i <= count; ++i)
+    {
+        SetEvent(win32_pool->threads[i].wake);
+    }
+}
+
+void cas_pool_wait(CasPool* pool)
+{
+    CasPoolWin32* win32_pool = (CasPoolWin32*)pool->context;
+
+    WaitForSingleObject(win32_pool->done, INFINITE);
+}
+
+uint64_t cas_pool_clock(void)
+{
+    return GetTickCount64();
+}
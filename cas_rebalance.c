@@ -0,0 +1,242 @@
+#include "cas_rebalance.h"
+
+static int cas_rebalancer__grow(void** data, uint32_t* capacity, uint32_t needed, size_t element_size)
+{
+    int result = 1;
+
+    if (needed > *capacity)
+    {
+        uint32_t new_capacity = *capacity ? *capacity : 16;
+        void* new_data = 0;
+
+        while (new_capacity < needed)
+        {
+            new_capacity *= 2;
+        }
+
+        new_data = realloc(*data, new_capacity * element_size);
+
+        if (new_data)
+        {
+            *data = new_data;
+            *capacity = new_capacity;
+        }
+        else
+        {
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+void cas_rebalancer_init(CasRebalancer* rebalancer, uint32_t cpu_word_count)
+{
+    memset(rebalancer, 0, sizeof(*rebalancer));
+    rebalancer->cpu_word_count = cpu_word_count;
+}
+
+void cas_rebalancer_free(CasRebalancer* rebalancer)
+{
+    free(rebalancer->cpu_busy);
+    free(rebalancer->cpu_total);
+    free(rebalancer->cpu_loads);
+    free(rebalancer->entries);
+    free(rebalancer->selection_words);
+    memset(rebalancer, 0, sizeof(*rebalancer));
+}
+
+// NOTE: Load history is kept across reloads, only the entries go.
+void cas_rebalancer_clear(CasRebalancer* rebalancer)
+{
+    rebalancer->entry_count = 0;
+}
+
+// NOTE: The selection starts empty and is filled from the first loads, until then the whole rule mask applies.
+uint32_t cas_rebalancer_add(CasRebalancer* rebalancer, uint32_t rule_index, uint32_t core_count)
+{
+    uint32_t entry_index = rebalancer->entry_count;
+    uint32_t word_offset = entry_index * rebalancer->cpu_word_count;
+
+    if (!cas_rebalancer__grow((void**)&rebalancer->entries, &rebalancer->entry_capacity, entry_index + 1, sizeof(CasRebalanceEntry)) ||
+        !cas_rebalancer__grow((void**)&rebalancer->selection_words, &rebalancer->selection_word_capacity, word_offset + rebalancer->cpu_word_count, sizeof(uint64_t)))
+    {
+        return CAS_NO_CPU;
+    }
+
+    rebalancer->entries[entry_index] = (CasRebalanceEntry){ rule_index, core_count, 0, rebalancer->sample, 0, CAS_REBALANCE_NO_LOAD };
+    memset(rebalancer->selection_words + word_offset, 0, rebalancer->cpu_word_count * sizeof(uint64_t));
+    ++rebalancer->entry_count;
+
+    return entry_index;
+}
+
+int cas_rebalancer_selection(const CasRebalancer* rebalancer, uint32_t entry_index, CasCpuSet* selection)
+{
+    selection->words = rebalancer->selection_words + entry_index * rebalancer->cpu_word_count;
+    selection->word_count = rebalancer->cpu_word_count;
+
+    return !cas_cpu_set_is_empty(selection);
+}
+
+static uint32_t cas_rebalancer__mean_load(const CasRebalancer* rebalancer, const CasCpuSet* selection)
+{
+    uint64_t sum = 0;
+    uint32_t count = 0;
+
+    for (uint32_t cpu = cas_cpu_set_next(selection, 0); cpu != CAS_NO_CPU; cpu = cas_cpu_set_next(selection, cpu + 1))
+    {
+        sum += rebalancer->cpu_loads[cpu];
+        ++count;
+    }
+
+    return count ? (uint32_t)(sum / count) : 0;
+}
+
+// NOTE: Least loaded CPU of the pool outside the selection, or the most loaded one inside it.
+static uint32_t cas_rebalancer__pick(const CasRebalancer* rebalancer, const CasCpuSet* pool, const CasCpuSet* selection, int is_busiest)
+{
+    uint32_t best_cpu = CAS_NO_CPU;
+
+    for (uint32_t cpu = cas_cpu_set_next(pool, 0); cpu != CAS_NO_CPU && cpu < rebalancer->cpu_count; cpu = cas_cpu_set_next(pool, cpu + 1))
+    {
+        uint32_t load = rebalancer->cpu_loads[cpu];
+
+        if (cas_cpu_set_contains(selection, cpu) != is_busiest)
+        {
+            continue;
+        }
+
+        if (best_cpu == CAS_NO_CPU || (is_busiest ? load > rebalancer->cpu_loads[best_cpu] : load < rebalancer->cpu_loads[best_cpu]))
+        {
+            best_cpu = cpu;
+        }
+    }
+
+    return best_cpu;
+}
+
+// NOTE: At most one CPU is swapped per decision. A move is judged on the next sample, one that did not lower the
+// load of the selection doubles the wait before the next move. A process that is itself the load carries it along
+// to its new CPUs, this is what keeps it from bouncing back and forth.
+static void cas_rebalancer__step(CasRebalancer* rebalancer, CasRebalanceEntry* entry, const CasCpuSet* pool, CasCpuSet* selection)
+{
+    uint32_t busiest = CAS_NO_CPU;
+    uint32_t idlest = CAS_NO_CPU;
+
+    if (cas_cpu_set_is_empty(selection))
+    {
+        for (uint32_t i = 0; i < entry->core_count; ++i)
+        {
+            idlest = cas_rebalancer__pick(rebalancer, pool, selection, 0);
+
+            if (idlest != CAS_NO_CPU)
+            {
+                cas_cpu_set_add(selection, idlest);
+            }
+        }
+
+        ++entry->version;
+        return;
+    }
+
+    if (entry->load_before != CAS_REBALANCE_NO_LOAD)
+    {
+        uint32_t load_after = cas_rebalancer__mean_load(rebalancer, selection);
+
+        rebalancer->counters.load_before += entry->load_before;
+        rebalancer->counters.load_after += load_after;
+
+        if (load_after < entry->load_before)
+        {
+            ++rebalancer->counters.improved;
+            entry->backoff_shift = 0;
+        }
+        else
+        {
+            ++rebalancer->counters.regressed;
+            entry->backoff_shift += entry->backoff_shift < CAS_REBALANCE_MAX_SHIFT;
+        }
+
+        entry->load_before = CAS_REBALANCE_NO_LOAD;
+        entry->next_sample = rebalancer->sample + (1u << entry->backoff_shift);
+    }
+
+    if ((int32_t)(rebalancer->sample - entry->next_sample) < 0)
+    {
+        return;
+    }
+
+    busiest = cas_rebalancer__pick(rebalancer, pool, selection, 1);
+    idlest = cas_rebalancer__pick(rebalancer, pool, selection, 0);
+
+    if (busiest != CAS_NO_CPU && idlest != CAS_NO_CPU &&
+        rebalancer->cpu_loads[busiest] >= rebalancer->cpu_loads[idlest] + CAS_REBALANCE_HYSTERESIS)
+    {
+        entry->load_before = cas_rebalancer__mean_load(rebalancer, selection);
+        cas_cpu_set_remove(selection, busiest);
+        cas_cpu_set_add(selection, idlest);
+        ++entry->version;
+        ++rebalancer->counters.moves;
+    }
+}
+
+// NOTE: busy and total are cumulative per CPU times in any unit, the first sample only sets the baseline.
+// mask_words are the rule masks, the pool each selection is taken from.
+int cas_rebalancer_sample(CasRebalancer* rebalancer, const uint64_t* busy, const uint64_t* total, uint32_t cpu_count, const uint64_t* mask_words)
+{
+    int has_baseline = rebalancer->cpu_count == cpu_count;
+
+    // NOTE: The three per CPU arrays share one capacity, they are grown together.
+    if (cpu_count > rebalancer->cpu_capacity)
+    {
+        uint64_t* cpu_busy = realloc(rebalancer->cpu_busy, cpu_count * sizeof(uint64_t));
+        uint64_t* cpu_total = cpu_busy ? realloc(rebalancer->cpu_total, cpu_count * sizeof(uint64_t)) : 0;
+        uint32_t* cpu_loads = cpu_total ? realloc(rebalancer->cpu_loads, cpu_count * sizeof(uint32_t)) : 0;
+
+        rebalancer->cpu_busy = cpu_busy ? cpu_busy : rebalancer->cpu_busy;
+        rebalancer->cpu_total = cpu_total ? cpu_total : rebalancer->cpu_total;
+        rebalancer->cpu_loads = cpu_loads ? cpu_loads : rebalancer->cpu_loads;
+
+        if (!cpu_loads)
+        {
+            return 0;
+        }
+
+        rebalancer->cpu_capacity = cpu_count;
+        has_baseline = 0;
+    }
+
+    for (uint32_t cpu = 0; cpu < cpu_count; ++cpu)
+    {
+        uint64_t busy_delta = has_baseline ? busy[cpu] - rebalancer->cpu_busy[cpu] : 0;
+        uint64_t total_delta = has_baseline ? total[cpu] - rebalancer->cpu_total[cpu] : 0;
+
+        // NOTE: A CPU that went offline or counters that went backwards read as idle.
+        rebalancer->cpu_loads[cpu] = total_delta && busy_delta <= total_delta ? (uint32_t)(busy_delta * 1000 / total_delta) : 0;
+        rebalancer->cpu_busy[cpu] = busy[cpu];
+        rebalancer->cpu_total[cpu] = total[cpu];
+    }
+
+    rebalancer->cpu_count = cpu_count;
+
+    if (!has_baseline)
+    {
+        return 1;
+    }
+
+    ++rebalancer->sample;
+    ++rebalancer->counters.samples;
+
+    for (uint32_t i = 0; i < rebalancer->entry_count; ++i)
+    {
+        CasRebalanceEntry* entry = rebalancer->entries + i;
+        CasCpuSet pool = { (uint64_t*)mask_words + entry->rule_index * rebalancer->cpu_word_count, rebalancer->cpu_word_count };
+        CasCpuSet selection;
+
+        cas_rebalancer_selection(rebalancer, i, &selection);
+        cas_rebalancer__step(rebalancer, entry, &pool, &selection);
+    }
+
+    return 1;
+}
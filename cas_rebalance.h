@@ -0,0 +1,64 @@
+#ifndef H_CAS_REBALANCE_H
+
+#include "cas_base.h"
+#include "cas_cpuset.h"
+
+// NOTE: Loads are in permille of one CPU. A CPU is only swapped out for one at least this much idler.
+#define CAS_REBALANCE_HYSTERESIS   (250)
+#define CAS_REBALANCE_NO_LOAD      (0xffffffff)
+#define CAS_REBALANCE_MAX_SHIFT    (6)
+
+// NOTE: One per rule with a core count. The selection is core_count CPUs of the rule mask, version changes
+// whenever it does so pinned processes know to be pinned again.
+typedef struct
+{
+    uint32_t rule_index;
+    uint32_t core_count;
+    uint32_t version;
+    uint32_t next_sample;
+    uint32_t backoff_shift;
+    // NOTE: Mean load of the selection right before the last move, CAS_REBALANCE_NO_LOAD once it was judged.
+    uint32_t load_before;
+} CasRebalanceEntry;
+
+typedef struct
+{
+    uint64_t samples;
+    uint64_t moves;
+    uint64_t improved;
+    uint64_t regressed;
+    // NOTE: Summed permille loads of moved selections before and after the move, their difference is the measured effect.
+    uint64_t load_before;
+    uint64_t load_after;
+} CasRebalanceCounters;
+
+// NOTE: Keeps the previous cumulative busy and total times per CPU, loads are the difference between two samples.
+typedef struct
+{
+    uint32_t cpu_count;
+    uint32_t cpu_word_count;
+    uint64_t* cpu_busy;
+    uint64_t* cpu_total;
+    uint32_t* cpu_loads;
+    uint32_t cpu_capacity;
+
+    CasRebalanceEntry* entries;
+    uint32_t entry_count;
+    uint32_t entry_capacity;
+    // NOTE: Selections back to back, cpu_word_count words each.
+    uint64_t* selection_words;
+    uint32_t selection_word_capacity;
+
+    uint32_t sample;
+    CasRebalanceCounters counters;
+} CasRebalancer;
+
+void cas_rebalancer_init(CasRebalancer* rebalancer, uint32_t cpu_word_count);
+void cas_rebalancer_free(CasRebalancer* rebalancer);
+void cas_rebalancer_clear(CasRebalancer* rebalancer);
+uint32_t cas_rebalancer_add(CasRebalancer* rebalancer, uint32_t rule_index, uint32_t core_count);
+int cas_rebalancer_selection(const CasRebalancer* rebalancer, uint32_t entry_index, CasCpuSet* selection);
+int cas_rebalancer_sample(CasRebalancer* rebalancer, const uint64_t* busy, const uint64_t* total, uint32_t cpu_count, const uint64_t* mask_words);
+
+#define H_CAS_REBALANCE_H
+#endif
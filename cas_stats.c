@@ -0,0 +1,304 @@
+#include "cas_stats.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+#include <stdarg.h>
+#include <stdio.h>
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+// NOTE: Only the owning thread writes, so a plain read of its own counter and a release store is enough.
+static void cas_stats__add(volatile uint64_t* counter, uint64_t value)
+{
+    CAS_ATOMIC_STORE(counter, *counter + value);
+}
+
+static uint32_t cas_stats__bucket(uint64_t value)
+{
+    uint32_t bucket = 0;
+
+    while (value && bucket < CAS_STATS_BUCKET_COUNT - 1)
+    {
+        value >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+void cas_stats_init(CasStats* stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->version = CAS_STATS_VERSION;
+    stats->size = sizeof(*stats);
+}
+
+// NOTE: Every recording thread claims its own block once, 0 when all of them are taken.
+CasStatsThread* cas_stats_claim(CasStats* stats)
+{
+    uint32_t index = CAS_ATOMIC_ADD32(&stats->thread_count, 1);
+
+    return index < CAS_STATS_MAX_THREADS ? stats->threads + index : 0;
+}
+
+void cas_stats_tick(CasStatsThread* thread, uint64_t microseconds, uint32_t processes, uint32_t matches)
+{
+    if (thread)
+    {
+        cas_stats__add(&thread->ticks, 1);
+        cas_stats__add(&thread->processes_scanned, processes);
+        cas_stats__add(&thread->rules_matched, matches);
+        cas_stats__add(thread->tick_histogram + cas_stats__bucket(microseconds), 1);
+    }
+}
+
+void cas_stats_set(CasStatsThread* thread, int is_failure, uint32_t error)
+{
+    if (!thread)
+    {
+        return;
+    }
+
+    cas_stats__add(&thread->sets, 1);
+
+    if (is_failure)
+    {
+        uint32_t slot = 0;
+
+        cas_stats__add(&thread->set_failures, 1);
+
+        while (slot < thread->error_code_count && thread->error_codes[slot] != error)
+        {
+            ++slot;
+        }
+
+        // NOTE: The code goes in before the count is published, a reader never sees a slot without its code.
+        if (slot == thread->error_code_count && slot < CAS_STATS_MAX_ERRORS)
+        {
+            thread->error_codes[slot] = error;
+            CAS_ATOMIC_STORE(&thread->error_code_count, slot + 1);
+        }
+
+        cas_stats__add(slot < CAS_STATS_MAX_ERRORS ? thread->error_counts + slot : &thread->other_errors, 1);
+    }
+}
+
+void cas_stats_pin(CasStatsThread* thread, uint64_t milliseconds)
+{
+    if (thread)
+    {
+        cas_stats__add(&thread->pins, 1);
+        cas_stats__add(thread->pin_histogram + cas_stats__bucket(milliseconds), 1);
+    }
+}
+
+void cas_stats_drift(CasStatsThread* thread, int is_drift, uint64_t milliseconds)
+{
+    if (thread)
+    {
+        cas_stats__add(&thread->drift_checks, 1);
+
+        if (is_drift)
+        {
+            cas_stats__add(&thread->drifts, 1);
+            cas_stats__add(thread->drift_histogram + cas_stats__bucket(milliseconds), 1);
+        }
+    }
+}
+
+// NOTE: Sums every claimed block, error codes seen by several threads are merged.
+int cas_stats_snapshot(const CasStats* stats, CasStatsThread* total)
+{
+    uint32_t thread_count = CAS_ATOMIC_LOAD(&stats->thread_count);
+
+    memset(total, 0, sizeof(*total));
+
+    if (stats->version != CAS_STATS_VERSION || stats->size != sizeof(*stats))
+    {
+        return 0;
+    }
+
+    thread_count = thread_count < CAS_STATS_MAX_THREADS ? thread_count : CAS_STATS_MAX_THREADS;
+
+    for (uint32_t i = 0; i < thread_count; ++i)
+    {
+        const CasStatsThread* thread = stats->threads + i;
+        uint32_t error_code_count = CAS_ATOMIC_LOAD(&thread->error_code_count);
+
+        total->ticks += CAS_ATOMIC_LOAD(&thread->ticks);
+        total->processes_scanned += CAS_ATOMIC_LOAD(&thread->processes_scanned);
+        total->rules_matched += CAS_ATOMIC_LOAD(&thread->rules_matched);
+        total->sets += CAS_ATOMIC_LOAD(&thread->sets);
+        total->set_failures += CAS_ATOMIC_LOAD(&thread->set_failures);
+        total->pins += CAS_ATOMIC_LOAD(&thread->pins);
+        total->other_errors += CAS_ATOMIC_LOAD(&thread->other_errors);
+        total->drift_checks += CAS_ATOMIC_LOAD(&thread->drift_checks);
+        total->drifts += CAS_ATOMIC_LOAD(&thread->drifts);
+
+        for (uint32_t bucket = 0; bucket < CAS_STATS_BUCKET_COUNT; ++bucket)
+        {
+            total->tick_histogram[bucket] += CAS_ATOMIC_LOAD(thread->tick_histogram + bucket);
+            total->pin_histogram[bucket] += CAS_ATOMIC_LOAD(thread->pin_histogram + bucket);
+            total->drift_histogram[bucket] += CAS_ATOMIC_LOAD(thread->drift_histogram + bucket);
+        }
+
+        for (uint32_t slot = 0; slot < error_code_count && slot < CAS_STATS_MAX_ERRORS; ++slot)
+        {
+            uint32_t code = thread->error_codes[slot];
+            uint64_t count = CAS_ATOMIC_LOAD(thread->error_counts + slot);
+            uint32_t merged = 0;
+
+            while (merged < total->error_code_count && total->error_codes[merged] != code)
+            {
+                ++merged;
+            }
+
+            if (merged == total->error_code_count && merged < CAS_STATS_MAX_ERRORS)
+            {
+                total->error_codes[merged] = code;
+                ++total->error_code_count;
+            }
+
+            if (merged < CAS_STATS_MAX_ERRORS)
+            {
+                total->error_counts[merged] += count;
+            }
+            else
+            {
+                total->other_errors += count;
+            }
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: Upper bound of the bucket holding the given percentile, 0 without samples.
+uint64_t cas_stats_percentile(const volatile uint64_t* histogram, uint32_t percent)
+{
+    uint64_t count = 0;
+    uint64_t seen = 0;
+
+    for (uint32_t bucket = 0; bucket < CAS_STATS_BUCKET_COUNT; ++bucket)
+    {
+        count += histogram[bucket];
+    }
+
+    for (uint32_t bucket = 0; bucket < CAS_STATS_BUCKET_COUNT && count; ++bucket)
+    {
+        seen += histogram[bucket];
+
+        if (seen * 100 >= count * percent)
+        {
+            return bucket ? (1ull << bucket) - 1 : 0;
+        }
+    }
+
+    return 0;
+}
+
+static void cas_stats__append(char* buffer, uint32_t capacity, uint32_t* length, const char* format, ...)
+{
+    va_list arguments;
+    int written = 0;
+
+    if (*length >= capacity)
+    {
+        return;
+    }
+
+    va_start(arguments, format);
+    written = vsnprintf(buffer + *length, capacity - *length, format, arguments);
+    va_end(arguments);
+
+    if (written > 0)
+    {
+        *length += (uint32_t)written < capacity - *length ? (uint32_t)written : capacity - *length - 1;
+    }
+}
+
+static void cas_stats__append_histogram(char* buffer, uint32_t capacity, uint32_t* length, const char* name, const volatile uint64_t* histogram)
+{
+    uint32_t last = CAS_STATS_BUCKET_COUNT;
+
+    while (last && !histogram[last - 1])
+    {
+        --last;
+    }
+
+    cas_stats__append(buffer, capacity, length, ", \"%s\": [", name);
+
+    for (uint32_t bucket = 0; bucket < last; ++bucket)
+    {
+        cas_stats__append(buffer, capacity, length, "%s%llu", bucket ? ", " : "", (unsigned long long)histogram[bucket]);
+    }
+
+    cas_stats__append(buffer, capacity, length, "]");
+}
+
+// NOTE: Histograms are cut after their last non-empty bucket, the layout of a bucket is the one in cas_stats.h.
+uint32_t cas_stats_format_json(const CasStatsThread* total, char* buffer, uint32_t capacity)
+{
+    uint32_t length = 0;
+
+    buffer[0] = '\0';
+
+    cas_stats__append(buffer, capacity, &length,
+                      "{\"ticks\": %llu, \"processes_scanned\": %llu, \"rules_matched\": %llu, \"sets\": %llu, \"set_failures\": %llu, \"pins\": %llu, "
+                      "\"tick_p50_us\": %llu, \"tick_p99_us\": %llu, \"pin_p50_ms\": %llu, \"pin_p99_ms\": %llu",
+                      (unsigned long long)total->ticks, (unsigned long long)total->processes_scanned, (unsigned long long)total->rules_matched,
+                      (unsigned long long)total->sets, (unsigned long long)total->set_failures, (unsigned long long)total->pins,
+                      (unsigned long long)cas_stats_percentile(total->tick_histogram, 50), (unsigned long long)cas_stats_percentile(total->tick_histogram, 99),
+                      (unsigned long long)cas_stats_percentile(total->pin_histogram, 50), (unsigned long long)cas_stats_percentile(total->pin_histogram, 99));
+    cas_stats__append_histogram(buffer, capacity, &length, "tick_histogram_us", total->tick_histogram);
+    cas_stats__append_histogram(buffer, capacity, &length, "pin_histogram_ms", total->pin_histogram);
+    cas_stats__append(buffer, capacity, &length, ", \"drift_checks\": %llu, \"drifts\": %llu", (unsigned long long)total->drift_checks, (unsigned long long)total->drifts);
+    cas_stats__append_histogram(buffer, capacity, &length, "drift_histogram_ms", total->drift_histogram);
+    cas_stats__append(buffer, capacity, &length, ", \"errors\": {");
+
+    for (uint32_t slot = 0; slot < total->error_code_count; ++slot)
+    {
+        cas_stats__append(buffer, capacity, &length, "%s\"%u\": %llu", slot ? ", " : "", total->error_codes[slot], (unsigned long long)total->error_counts[slot]);
+    }
+
+    cas_stats__append(buffer, capacity, &length, "}, \"other_errors\": %llu}\n", (unsigned long long)total->other_errors);
+
+    return length;
+}
+
+uint32_t cas_stats_format_text(const CasStatsThread* total, char* buffer, uint32_t capacity)
+{
+    uint32_t length = 0;
+
+    buffer[0] = '\0';
+
+    cas_stats__append(buffer, capacity, &length,
+                      "Ticks: %llu\nProcesses scanned: %llu\nRules matched: %llu\nSets: %llu (%llu failed)\nPins: %llu\n"
+                      "Tick time p50/p99: < %llu / < %llu us\nCreation to pin p50/p99: < %llu / < %llu ms\n",
+                      (unsigned long long)total->ticks, (unsigned long long)total->processes_scanned, (unsigned long long)total->rules_matched,
+                      (unsigned long long)total->sets, (unsigned long long)total->set_failures, (unsigned long long)total->pins,
+                      (unsigned long long)cas_stats_percentile(total->tick_histogram, 50) + 1, (unsigned long long)cas_stats_percentile(total->tick_histogram, 99) + 1,
+                      (unsigned long long)cas_stats_percentile(total->pin_histogram, 50) + 1, (unsigned long long)cas_stats_percentile(total->pin_histogram, 99) + 1);
+
+    if (total->drift_checks)
+    {
+        cas_stats__append(buffer, capacity, &length, "Drift checks: %llu (%llu drifted)\nDrift duration p50/p99: < %llu / < %llu ms\n",
+                          (unsigned long long)total->drift_checks, (unsigned long long)total->drifts,
+                          (unsigned long long)cas_stats_percentile(total->drift_histogram, 50) + 1,
+                          (unsigned long long)cas_stats_percentile(total->drift_histogram, 99) + 1);
+    }
+
+    for (uint32_t slot = 0; slot < total->error_code_count; ++slot)
+    {
+        cas_stats__append(buffer, capacity, &length, "Error %u: %llu\n", total->error_codes[slot], (unsigned long long)total->error_counts[slot]);
+    }
+
+    if (total->other_errors)
+    {
+        cas_stats__append(buffer, capacity, &length, "Other errors: %llu\n", (unsigned long long)total->other_errors);
+    }
+
+    return length;
+}
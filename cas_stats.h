@@ -0,0 +1,62 @@
+#ifndef H_CAS_STATS_H
+
+#include "cas_base.h"
+
+#define CAS_STATS_VERSION        (3)
+// NOTE: The ticking thread and the threads of its apply pool.
+#define CAS_STATS_MAX_THREADS    (8)
+#define CAS_STATS_BUCKET_COUNT   (32)
+#define CAS_STATS_MAX_ERRORS     (15)
+
+// NOTE: Counters of one thread, only that thread writes them so no locks or read-modify-write atomics are needed.
+// Readers sum every claimed block, a value may be one update behind but is never torn.
+// Histogram bucket 0 counts zeros, bucket b counts values in [2^(b-1), 2^b). Ticks are in microseconds,
+// creation to pin and drift durations in milliseconds. Errors are OpenProcess / opendir codes, the first CAS_STATS_MAX_ERRORS
+// distinct ones get a slot, the rest are counted in other_errors.
+typedef struct
+{
+    volatile uint64_t ticks;
+    volatile uint64_t processes_scanned;
+    volatile uint64_t rules_matched;
+    volatile uint64_t sets;
+    volatile uint64_t set_failures;
+    volatile uint64_t pins;
+    volatile uint64_t other_errors;
+    volatile uint64_t drift_checks;
+    volatile uint64_t drifts;
+    volatile uint64_t tick_histogram[CAS_STATS_BUCKET_COUNT];
+    volatile uint64_t pin_histogram[CAS_STATS_BUCKET_COUNT];
+    volatile uint64_t drift_histogram[CAS_STATS_BUCKET_COUNT];
+    volatile uint64_t error_counts[CAS_STATS_MAX_ERRORS];
+    volatile uint32_t error_codes[CAS_STATS_MAX_ERRORS];
+    volatile uint32_t error_code_count;
+} CasStatsThread;
+
+// NOTE: Lives in shared memory so other processes can read it, version and size let a reader refuse a different layout.
+typedef struct
+{
+    uint32_t version;
+    uint32_t size;
+    volatile uint32_t thread_count;
+    uint32_t reserved;
+    CasStatsThread threads[CAS_STATS_MAX_THREADS];
+} CasStats;
+
+void cas_stats_init(CasStats* stats);
+CasStatsThread* cas_stats_claim(CasStats* stats);
+void cas_stats_tick(CasStatsThread* thread, uint64_t microseconds, uint32_t processes, uint32_t matches);
+void cas_stats_set(CasStatsThread* thread, int is_failure, uint32_t error);
+void cas_stats_pin(CasStatsThread* thread, uint64_t milliseconds);
+void cas_stats_drift(CasStatsThread* thread, int is_drift, uint64_t milliseconds);
+int cas_stats_snapshot(const CasStats* stats, CasStatsThread* total);
+uint64_t cas_stats_percentile(const volatile uint64_t* histogram, uint32_t percent);
+uint32_t cas_stats_format_json(const CasStatsThread* total, char* buffer, uint32_t capacity);
+uint32_t cas_stats_format_text(const CasStatsThread* total, char* buffer, uint32_t capacity);
+
+// NOTE: Per platform, cas_stats_win32.c and cas_stats_linux.c. The owner creates and initializes the shared block,
+// anyone else maps it read only. Returns 0 when there is nothing to map.
+CasStats* cas_stats_map(int is_owner);
+void cas_stats_unmap(CasStats* stats);
+
+#define H_CAS_STATS_H
+#endif
@@ -0,0 +1,48 @@
+#define _GNU_SOURCE
+
+#include "cas_stats.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CAS_STATS_SHM_NAME       "/cas_stats"
+
+// NOTE: /dev/shm/cas_stats, readable by everyone and removed by nobody, the next owner initializes it again.
+CasStats* cas_stats_map(int is_owner)
+{
+    int fd = shm_open(CAS_STATS_SHM_NAME, is_owner ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+    void* stats = MAP_FAILED;
+    struct stat status;
+
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    // NOTE: Mapping past the end of a shorter block from another version would fault on the first read.
+    if (is_owner ? ftruncate(fd, sizeof(CasStats)) == 0 : fstat(fd, &status) == 0 && (size_t)status.st_size >= sizeof(CasStats))
+    {
+        stats = mmap(0, sizeof(CasStats), is_owner ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    }
+
+    close(fd);
+
+    if (stats == MAP_FAILED)
+    {
+        return 0;
+    }
+
+    if (is_owner)
+    {
+        cas_stats_init((CasStats*)stats);
+    }
+
+    return (CasStats*)stats;
+}
+
+void cas_stats_unmap(CasStats* stats)
+{
+    munmap(stats, sizeof(CasStats));
+}
@@ -0,0 +1,45 @@
+#include "cas.h"
+#include "cas_stats.h"
+
+// NOTE: Per session, a reader in the same session as cas.exe finds it.
+#define CAS_STATS_MAPPING_NAME   (L"Local\\cas_stats")
+
+static HANDLE global_stats_mapping;
+
+CasStats* cas_stats_map(int is_owner)
+{
+    HANDLE mapping = is_owner ? CreateFileMappingW(INVALID_HANDLE_VALUE, 0, PAGE_READWRITE, 0, (DWORD)sizeof(CasStats), CAS_STATS_MAPPING_NAME) :
+                                OpenFileMappingW(FILE_MAP_READ, FALSE, CAS_STATS_MAPPING_NAME);
+    CasStats* stats = 0;
+
+    if (!mapping)
+    {
+        return 0;
+    }
+
+    stats = (CasStats*)MapViewOfFile(mapping, is_owner ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, sizeof(CasStats));
+
+    if (!stats)
+    {
+        CloseHandle(mapping);
+        return 0;
+    }
+
+    // NOTE: The view keeps the mapping alive for readers, the owner holds on to the handle so the name stays.
+    if (is_owner)
+    {
+        global_stats_mapping = mapping;
+        cas_stats_init(stats);
+    }
+    else
+    {
+        CloseHandle(mapping);
+    }
+
+    return stats;
+}
+
+void cas_stats_unmap(CasStats* stats)
+{
+    UnmapViewOfFile(stats);
+}
@@ -0,0 +1,1041 @@
+// NOTE: Behavior tests on the fake backend and event source, run cas_test.exe. Every failed check is printed with
+// its line, the exit code is 1 when there was one.
+
+#ifndef _WIN32
+#define _GNU_SOURCE
+#endif
+
+#include "cas_backend.h"
+#include "cas_config.h"
+#include "cas_topology.h"
+
+#ifdef _MSC_VER
+#pragma warning(push, 0)
+#endif
+#include <stdio.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+
+#define CAS_TEST_CHECK(condition) cas_test__check((condition) != 0, #condition, __LINE__)
+
+static uint32_t global_check_count;
+static uint32_t global_failure_count;
+
+static void cas_test__check(int is_passed, const char* condition, int line)
+{
+    ++global_check_count;
+
+    if (!is_passed)
+    {
+        ++global_failure_count;
+        printf("cas_test.c:%d: failed: %s\n", line, condition);
+    }
+}
+
+// NOTE: One word masks are enough for the fake backend, it never has more than 64 CPUs.
+static int cas_test__add_rule(CasEngine* engine, const char* line, uint64_t mask_word)
+{
+    CasCpuSet mask = { &mask_word, 1 };
+
+    return cas_engine_add_rule_line(engine, line, (uint32_t)strlen(line), &mask);
+}
+
+static void cas_test__events(void)
+{
+    CasBackend backend;
+    CasBackendFake fake;
+    CasEngine engine;
+    CasEventSource source;
+    CasEventQueue* queue = malloc(sizeof(CasEventQueue));
+    CasProcessTable table = { 0 };
+
+    if (!queue)
+    {
+        CAS_TEST_CHECK(queue);
+        return;
+    }
+
+    cas_backend_fake(&backend, &fake, 8);
+    cas_event_source_fake(&source, queue);
+    cas_engine_init(&engine);
+    cas_engine_set_cpu_count(&engine, 8);
+    CAS_TEST_CHECK(cas_test__add_rule(&engine, "game.exe", 0x3));
+    CAS_TEST_CHECK(cas_engine_build_index(&engine));
+    cas_backend_fake_add_process(&fake, 10, "game.exe", 1);
+    cas_backend_fake_add_process(&fake, 11, "idle.exe", 1);
+
+    // NOTE: Started processes are looked up right away, one the backend does not know any more is dropped.
+    CAS_TEST_CHECK(cas_event_source_fake_push(&source, CAS_EVENT_START, 10));
+    CAS_TEST_CHECK(cas_event_source_fake_push(&source, CAS_EVENT_START, 11));
+    CAS_TEST_CHECK(cas_event_source_fake_push(&source, CAS_EVENT_START, 12));
+    CAS_TEST_CHECK(!cas_backend_read_events(&backend, &engine, &source, &table));
+    CAS_TEST_CHECK(table.count == 2);
+    CAS_TEST_CHECK(cas_engine_match(&engine, &table));
+    CAS_TEST_CHECK(engine.match_count == 1);
+    CAS_TEST_CHECK(engine.match_count == 1 && table.processes[engine.matches[0].process_index].pid == 10);
+    cas_backend_apply(&backend, &engine, &table);
+    CAS_TEST_CHECK(fake.set_affinity_count == 1);
+    CAS_TEST_CHECK(cas_engine_is_matched(&engine, 10));
+    CAS_TEST_CHECK(!cas_engine_is_matched(&engine, 11));
+
+    // NOTE: Only the exit of a matched process needs a sweep.
+    CAS_TEST_CHECK(cas_event_source_fake_push(&source, CAS_EVENT_EXIT, 11));
+    CAS_TEST_CHECK(!cas_backend_read_events(&backend, &engine, &source, &table));
+    CAS_TEST_CHECK(table.count == 0);
+    CAS_TEST_CHECK(cas_event_source_fake_push(&source, CAS_EVENT_EXIT, 10));
+    CAS_TEST_CHECK(cas_backend_read_events(&backend, &engine, &source, &table));
+
+    // NOTE: A full queue drops the event and the next read starts with a resync, which asks for a full sweep.
+    for (uint32_t i = 0; i < CAS_EVENT_QUEUE_SIZE; ++i)
+    {
+        cas_event_source_fake_push(&source, CAS_EVENT_START, 11);
+    }
+
+    CAS_TEST_CHECK(!cas_event_source_fake_push(&source, CAS_EVENT_START, 11));
+    CAS_TEST_CHECK(cas_backend_read_events(&backend, &engine, &source, &table));
+    CAS_TEST_CHECK(table.count == CAS_EVENT_QUEUE_SIZE);
+    CAS_TEST_CHECK(!cas_backend_read_events(&backend, &engine, &source, &table));
+    CAS_TEST_CHECK(cas_backend_sweep(&backend, &engine, &table));
+    CAS_TEST_CHECK(fake.snapshot_count == 1);
+
+    cas_engine_free(&engine);
+    cas_process_table_free(&table);
+    cas_process_table_free(&fake.processes);
+    free(queue);
+}
+
+static void cas_test__sweep(void)
+{
+    CasBackend backend;
+    CasBackendFake fake;
+    CasEngine engine;
+    CasProcessTable table = { 0 };
+
+    cas_backend_fake(&backend, &fake, 8);
+    cas_engine_init(&engine);
+    cas_engine_set_cpu_count(&engine, 8);
+    CAS_TEST_CHECK(cas_test__add_rule(&engine, "game.exe", 0x3));
+    CAS_TEST_CHECK(cas_engine_build_index(&engine));
+    cas_backend_fake_add_process(&fake, 1, "game.exe", 1);
+    cas_backend_fake_add_process(&fake, 2, "idle.exe", 1);
+    cas_backend_fake_add_process(&fake, 3, "game.exe", 1);
+
+    CAS_TEST_CHECK(cas_backend_sweep(&backend, &engine, &table));
+    CAS_TEST_CHECK(engine.started_count == 3 && engine.exited_count == 0);
+    CAS_TEST_CHECK(engine.match_count == 2 && fake.set_affinity_count == 2);
+    CAS_TEST_CHECK(engine.counters.state_misses == 2 && engine.counters.state_hits == 0);
+
+    // NOTE: Nothing changed, both matches come out of the state cache without a system call.
+    CAS_TEST_CHECK(cas_backend_sweep(&backend, &engine, &table));
+    CAS_TEST_CHECK(engine.started_count == 0 && engine.exited_count == 0);
+    CAS_TEST_CHECK(fake.set_affinity_count == 2);
+    CAS_TEST_CHECK(engine.counters.state_misses == 2 && engine.counters.state_hits == 2);
+    CAS_TEST_CHECK(!cas_engine_is_busy(&engine));
+
+    cas_backend_fake_remove_process(&fake, 2);
+    cas_backend_fake_add_process(&fake, 4, "game.exe", 1);
+    CAS_TEST_CHECK(cas_backend_sweep(&backend, &engine, &table));
+    CAS_TEST_CHECK(engine.started_count == 1 && engine.started_pids[0] == 4);
+    CAS_TEST_CHECK(engine.exited_count == 1 && engine.exited_pids[0] == 2);
+    CAS_TEST_CHECK(fake.set_affinity_count == 3);
+    CAS_TEST_CHECK(engine.counters.state_misses == 3 && engine.counters.state_hits == 4);
+    CAS_TEST_CHECK(cas_engine_is_busy(&engine));
+
+    // NOTE: The same PID with another creation time is a new process, it misses and is pinned again.
+    cas_backend_fake_remove_process(&fake, 3);
+    cas_backend_fake_add_process(&fake, 3, "game.exe", 2);
+    CAS_TEST_CHECK(cas_backend_sweep(&backend, &engine, &table));
+    CAS_TEST_CHECK(engine.counters.pid_reuses == 1);
+    CAS_TEST_CHECK(engine.started_count == 1 && engine.started_pids[0] == 3);
+    CAS_TEST_CHECK(engine.exited_count == 1 && engine.exited_pids[0] == 3);
+    CAS_TEST_CHECK(fake.set_affinity_count == 4);
+    CAS_TEST_CHECK(engine.counters.state_misses == 4 && engine.counters.state_hits == 6);
+
+    CAS_TEST_CHECK(cas_backend_sweep(&backend, &engine, &table));
+    CAS_TEST_CHECK(fake.set_affinity_count == 4);
+    CAS_TEST_CHECK(engine.counters.state_misses == 4 && engine.counters.state_hits == 9);
+
+    cas_engine_free(&engine);
+    cas_process_table_free(&table);
+    cas_process_table_free(&fake.processes);
+}
+
+// NOTE: A denied process is retried 2, 4, ... 64 ticks after the last refusal and every 64 ticks from then on.
+static void cas_test__backoff(void)
+{
+    static const uint32_t expected_ticks[] = { 0, 2, 6, 14, 30, 62, 126, 190 };
+    CasBackend backend;
+    CasBackendFake fake;
+    CasEngine engine;
+    CasProcessTable table = { 0 };
+    uint32_t attempt_count = 0;
+    uint32_t set_affinity_count = 0;
+
+    cas_backend_fake(&backend, &fake, 8);
+    cas_engine_init(&engine);
+    cas_engine_set_cpu_count(&engine, 8);
+    CAS_TEST_CHECK(cas_test__add_rule(&engine, "game.exe", 0x3));
+    CAS_TEST_CHECK(cas_engine_build_index(&engine));
+    cas_backend_fake_add_process(&fake, 5, "game.exe", 1);
+    fake.denied_pid = 5;
+
+    for (uint32_t tick = 0; tick < 200; ++tick)
+    {
+        cas_backend_sweep(&backend, &engine, &table);
+
+        if (fake.set_affinity_count != set_affinity_count)
+        {
+            CAS_TEST_CHECK(attempt_count < ARRAY_COUNT(expected_ticks) && expected_ticks[attempt_count] == tick);
+            CAS_TEST_CHECK(engine.matches[0].status == CAS_STATUS_DENIED);
+            set_affinity_count = fake.set_affinity_count;
+            ++attempt_count;
+        }
+        else
+        {
+            CAS_TEST_CHECK(!cas_engine_is_busy(&engine));
+        }
+    }
+
+    CAS_TEST_CHECK(attempt_count == ARRAY_COUNT(expected_ticks));
+    CAS_TEST_CHECK(engine.counters.negative_hits == 200 - ARRAY_COUNT(expected_ticks));
+
+    // NOTE: Once allowed the next retry pins it and the backoff is over.
+    fake.denied_pid = 0xffffffff;
+
+    for (uint32_t tick = 200; tick < 260; ++tick)
+    {
+        cas_backend_sweep(&backend, &engine, &table);
+    }
+
+    CAS_TEST_CHECK(fake.set_affinity_count == set_affinity_count + 1);
+    CAS_TEST_CHECK(engine.matches[0].status == CAS_STATUS_PINNED);
+
+    cas_engine_free(&engine);
+    cas_process_table_free(&table);
+    cas_process_table_free(&fake.processes);
+}
+
+typedef struct
+{
+    const char* pattern;
+    const char* name;
+    int is_match;
+} CasTestMatch;
+
+static int cas_test__run_pattern(const char* pattern, const char* name)
+{
+    CasMatcher matcher;
+    uint32_t length = (uint32_t)strlen(pattern);
+    uint32_t state = CAS_MATCHER_DEAD_STATE;
+    int result = -1;
+
+    cas_matcher_init(&matcher);
+
+    if (cas_matcher_add(&matcher, pattern, length, cas_pattern_kind(pattern, length), 0) && cas_matcher_compile(&matcher))
+    {
+        state = cas_matcher_run(&matcher, name, (uint32_t)strlen(name));
+        result = state != CAS_MATCHER_DEAD_STATE && matcher.state_accept_counts[state] != 0;
+    }
+
+    cas_matcher_free(&matcher);
+
+    return result;
+}
+
+// NOTE: Every pattern is compiled on its own, -1 is a pattern that has to be refused.
+static void cas_test__patterns(void)
+{
+    static const CasTestMatch matches[] =
+    {
+        { "game*",              "game.exe",        1 },
+        { "game*",              "game",            1 },
+        { "game*",              "agame.exe",       0 },
+        { "*.exe",              "a.exe",           1 },
+        { "*.exe",              "a.exe.bak",       0 },
+        { "*helper*",           "GPU Helper.exe",  1 },
+        { "g?me.exe",           "game.exe",        1 },
+        { "g?me.exe",           "gme.exe",         0 },
+        { "g?me.exe",           "gaame.exe",       0 },
+        { "[abc]x.exe",         "bx.exe",          1 },
+        { "[abc]x.exe",         "dx.exe",          0 },
+        { "[!abc]x.exe",        "dx.exe",          1 },
+        { "[!abc]x.exe",        "Ax.exe",          0 },
+        { "[a-c]x.exe",         "Cx.exe",          1 },
+        { "GAME*",              "game.EXE",        1 },
+        { "re:ga+me\\.exe",     "gaaame.exe",      1 },
+        { "re:ga+me\\.exe",     "gme.exe",         0 },
+        { "re:ga+me\\.exe",     "gamexexe",        0 },
+        { "re:chrome|firefox",  "firefox",         1 },
+        { "re:chrome|firefox",  "firefox.exe",     0 },
+        { "re:chrome|firefox",  "xchrome",         0 },
+        { "re:\\d+\\.exe",      "123.exe",         1 },
+        { "re:\\d+\\.exe",      "a23.exe",         0 },
+        { "re:\\w+\\s\\w+",     "my app",          1 },
+        { "re:(ab)*c",          "ababc",           1 },
+        { "re:(ab)*c",          "abac",            0 },
+        { "re:colou?r",         "color",           1 },
+        { "re:colou?r",         "colour",          1 },
+        { "re:.*helper.*",      "Helper",          1 },
+        { "re:[^a]b",           "Ab",              0 },
+        { "re:[^a]b",           "cb",              1 },
+        { "re:GAME",            "game",            1 },
+        { "re:(ab",             "ab",             -1 },
+        { "re:ab)",             "ab",             -1 },
+        { "[abc",               "a",              -1 },
+    };
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(matches); ++i)
+    {
+        int result = cas_test__run_pattern(matches[i].pattern, matches[i].name);
+
+        if (result != matches[i].is_match)
+        {
+            printf("pattern %s on %s: %d\n", matches[i].pattern, matches[i].name, result);
+        }
+
+        CAS_TEST_CHECK(result == matches[i].is_match);
+    }
+}
+
+// NOTE: Exact names go through the hash and displace table, enough of them that seeds have to be searched.
+static void cas_test__exact_names(void)
+{
+    CasEngine engine;
+    CasProcess process = { 0 };
+    char name[32];
+
+    cas_engine_init(&engine);
+    cas_engine_set_cpu_count(&engine, 8);
+
+    for (uint32_t i = 0; i < 1000; ++i)
+    {
+        snprintf(name, sizeof(name), "process%u.exe", i);
+        CAS_TEST_CHECK(cas_test__add_rule(&engine, name, 0x1));
+    }
+
+    CAS_TEST_CHECK(cas_test__add_rule(&engine, "process1*.exe", 0x2));
+    CAS_TEST_CHECK(cas_engine_build_index(&engine));
+
+    for (uint32_t i = 0; i < 1100; ++i)
+    {
+        uint32_t rule_set = CAS_NO_RULE;
+
+        process.name_length = (uint32_t)snprintf(process.name, sizeof(process.name), "process%u.exe", i);
+        process.name[0] = i % 2 ? 'P' : 'p';
+        process.name_hash = cas_engine_hash_name(process.name, process.name_length);
+        rule_set = cas_engine_find_rule_set(&engine, &process);
+
+        // NOTE: Names starting with 1 match the pattern as well, it comes later in the list and wins.
+        if (process.name[7] == '1')
+        {
+            CAS_TEST_CHECK(rule_set != CAS_NO_RULE && engine.rule_sets[rule_set].count == (i < 1000 ? 2u : 1u) &&
+                           engine.rule_sets[rule_set].rule_index == 1000);
+        }
+        else
+        {
+            CAS_TEST_CHECK(rule_set != CAS_NO_RULE && engine.rule_sets[rule_set].count == 1 && engine.rule_sets[rule_set].rule_index == i);
+        }
+    }
+
+    process.name_length = (uint32_t)snprintf(process.name, sizeof(process.name), "process2.ex");
+    process.name_hash = cas_engine_hash_name(process.name, process.name_length);
+    CAS_TEST_CHECK(cas_engine_find_rule_set(&engine, &process) == CAS_NO_RULE);
+
+    cas_engine_free(&engine);
+}
+
+typedef struct
+{
+    uint32_t merge;
+    const char* lines[3];
+    uint64_t mask_words[3];
+    const char* thread_name;
+    uint32_t rule_index;
+    uint64_t mask_word;
+    int is_derived;
+} CasTestDecision;
+
+// NOTE: Every case matches game.exe started by launcher.exe. With a thread name the case checks the thread rule
+// picked for it, otherwise the process rule and mask the match applies.
+static void cas_test__decisions(void)
+{
+    static const CasTestDecision decisions[] =
+    {
+        { CAS_MERGE_LAST,      { "game.exe;rank=1", "game.exe" },                   { 0x1, 0x2 },      0, 0, 0x1, 0 },
+        { CAS_MERGE_FIRST,     { "game.exe", "game.exe;rank=2", "game.exe;rank=1" }, { 0x1, 0x2, 0x4 }, 0, 1, 0x2, 0 },
+        { CAS_MERGE_LAST,      { "game.exe", "game.exe" },                          { 0x1, 0x2 },      0, 1, 0x2, 0 },
+        { CAS_MERGE_FIRST,     { "game.exe", "game.exe" },                          { 0x1, 0x2 },      0, 0, 0x1, 0 },
+        { CAS_MERGE_LAST,      { "*.exe", "game.exe" },                             { 0x1, 0x2 },      0, 1, 0x2, 0 },
+        { CAS_MERGE_LAST,      { "game.exe", "g*.exe" },                            { 0x1, 0x2 },      0, 1, 0x2, 0 },
+        { CAS_MERGE_INTERSECT, { "game.exe", "game.exe" },                          { 0x3, 0x6 },      0, 1, 0x2, 0 },
+        { CAS_MERGE_UNION,     { "game.exe", "*.exe" },                             { 0x3, 0x6 },      0, 1, 0x7, 0 },
+        { CAS_MERGE_INTERSECT, { "game.exe", "game.exe" },                          { 0x3, 0xc },      0, 1, 0xc, 0 },
+        { CAS_MERGE_INTERSECT, { "game.exe;rank=1", "game.exe", "game.exe;rank=1" }, { 0x3, 0x10, 0x6 }, 0, 2, 0x2, 0 },
+        { CAS_MERGE_UNION,     { "game.exe;rank=1", "game.exe", "game.exe;rank=1" }, { 0x3, 0x10, 0x6 }, 0, 2, 0x7, 0 },
+        { CAS_MERGE_LAST,      { "game.exe/render", "game.exe/render;rank=1", "game.exe/render" }, { 0x1, 0x2, 0x4 }, "RENDER", 1, 0x2, 0 },
+        { CAS_MERGE_LAST,      { "game.exe/render", "game.exe/render", "game.exe/audio" },         { 0x1, 0x2, 0x4 }, "render", 1, 0x2, 0 },
+        { CAS_MERGE_FIRST,     { "game.exe/render", "game.exe/render", "game.exe/audio" },         { 0x1, 0x2, 0x4 }, "render", 0, 0x1, 0 },
+        { CAS_MERGE_INTERSECT, { "game.exe/render", "game.exe/render", "game.exe/audio" },         { 0x1, 0x2, 0x4 }, "audio", 2, 0x4, 0 },
+        { CAS_MERGE_LAST,      { "game.exe", "game.exe;parent=launcher.exe", "game.exe;parent=steam.exe;rank=2" }, { 0x1, 0x2, 0x4 }, 0, 1, 0x2, 1 },
+        { CAS_MERGE_INTERSECT, { "game.exe;rank=1", "game.exe;parent=launcher.exe;rank=1", "game.exe;parent=steam.exe;rank=1" },
+          { 0x3, 0x6, 0x1 }, 0, 1, 0x2, 1 },
+        { CAS_MERGE_LAST,      { "game.exe", "game.exe;parent=launcher.exe" },      { 0x1, 0x2 },      0, 1, 0x2, 0 },
+    };
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(decisions); ++i)
+    {
+        const CasTestDecision* decision = decisions + i;
+        CasBackend backend;
+        CasBackendFake fake;
+        CasEngine engine;
+        CasProcessTable table = { 0 };
+        CasProcess* process = 0;
+        uint32_t rule_index = CAS_NO_RULE;
+        CasCpuSet mask = { 0 };
+
+        cas_backend_fake(&backend, &fake, 8);
+        cas_engine_init(&engine);
+        cas_engine_set_cpu_count(&engine, 8);
+        cas_engine_set_merge(&engine, decision->merge);
+
+        for (uint32_t j = 0; j < ARRAY_COUNT(decision->lines) && decision->lines[j]; ++j)
+        {
+            CAS_TEST_CHECK(cas_test__add_rule(&engine, decision->lines[j], decision->mask_words[j]));
+        }
+
+        CAS_TEST_CHECK(cas_engine_build_index(&engine));
+        cas_backend_fake_add_process(&fake, 1, "launcher.exe", 1);
+        process = cas_backend_fake_add_process(&fake, 2, "game.exe", 2);
+        process->parent_pid = 1;
+        CAS_TEST_CHECK(cas_backend_sweep(&backend, &engine, &table));
+
+        for (uint32_t j = 0; j < engine.match_count; ++j)
+        {
+            const CasMatch* match = engine.matches + j;
+
+            if (table.processes[match->process_index].pid != 2)
+            {
+                continue;
+            }
+
+            if (decision->thread_name)
+            {
+                rule_index = cas_engine_find_thread_rule(&engine, match->rule_set, decision->thread_name, (uint32_t)strlen(decision->thread_name));
+                mask = rule_index != CAS_NO_RULE ? cas_engine_rule_mask(&engine, rule_index) : mask;
+                CAS_TEST_CHECK(match->rule_index == CAS_NO_RULE);
+            }
+            else
+            {
+                rule_index = match->rule_index;
+                mask = rule_index != CAS_NO_RULE ? cas_engine_match_mask(&engine, match->rule_set, rule_index) : mask;
+            }
+
+            CAS_TEST_CHECK((match->rule_set >= engine.base_rule_set_count) == decision->is_derived);
+        }
+
+        if (rule_index != decision->rule_index || !mask.words || mask.words[0] != decision->mask_word)
+        {
+            printf("decision %u picks rule %u\n", i, rule_index);
+        }
+
+        CAS_TEST_CHECK(rule_index == decision->rule_index && mask.words && mask.words[0] == decision->mask_word);
+
+        cas_engine_free(&engine);
+        cas_process_table_free(&table);
+        cas_process_table_free(&fake.processes);
+    }
+}
+
+static uint64_t global_clock;
+
+static uint64_t cas_test__clock(CasBackend* backend)
+{
+    (void)backend;
+    return global_clock;
+}
+
+static uint32_t cas_test__query_affinity(CasBackend* backend, uint32_t pid, CasCpuSet* affinity_mask)
+{
+    (void)pid;
+    cas_cpu_set_zero(affinity_mask);
+
+    for (uint32_t i = 0; i < backend->cpu_count; ++i)
+    {
+        cas_cpu_set_add(affinity_mask, i);
+    }
+
+    return CAS_STATUS_PINNED;
+}
+
+// NOTE: A process using a whole CPU on every sweep is due again right after each refusal, the backoff spaces the
+// retries out like the ones of a denied match.
+static void cas_test__auto_pin_backoff(void)
+{
+    CasBackend backend;
+    CasBackendFake fake;
+    CasEngine engine;
+    CasProcessTable table = { 0 };
+    CasProcess* process = 0;
+    uint64_t pool_word = 0x80;
+    CasCpuSet pool = { &pool_word, 1 };
+    uint32_t set_affinity_count = 0;
+    uint32_t last_attempt = 0;
+    uint32_t last_gap = 0;
+    uint32_t attempt_count = 0;
+
+    cas_backend_fake(&backend, &fake, 8);
+    backend.clock = &cas_test__clock;
+    backend.clock_frequency = 100;
+    backend.query_affinity = &cas_test__query_affinity;
+    global_clock = 1;
+    cas_engine_init(&engine);
+    cas_engine_set_cpu_count(&engine, 8);
+    CAS_TEST_CHECK(cas_engine_build_index(&engine));
+    CAS_TEST_CHECK(cas_engine_set_auto_pin(&engine, &pool, 90, 100));
+    process = cas_backend_fake_add_process(&fake, 20, "hot.exe", 1);
+    fake.denied_pid = 20;
+
+    for (uint32_t tick = 0; tick < 200; ++tick)
+    {
+        global_clock += 100;
+        process->cpu_time += 100;
+        cas_backend_sweep(&backend, &engine, &table);
+
+        if (fake.set_affinity_count != set_affinity_count)
+        {
+            CAS_TEST_CHECK(engine.auto_pin_count == 1 && engine.auto_pins[0].status == CAS_STATUS_DENIED);
+            CAS_TEST_CHECK(!attempt_count || tick - last_attempt >= last_gap);
+            CAS_TEST_CHECK(cas_engine_is_applied(&engine));
+            last_gap = attempt_count ? tick - last_attempt : 0;
+            last_attempt = tick;
+            set_affinity_count = fake.set_affinity_count;
+            ++attempt_count;
+        }
+    }
+
+    CAS_TEST_CHECK(attempt_count >= 4 && attempt_count <= 8);
+    CAS_TEST_CHECK(last_gap >= 32);
+    CAS_TEST_CHECK(!cas_engine_has_auto_pins(&engine));
+
+    // NOTE: Allowed again, the next retry hands the CPU out.
+    fake.denied_pid = 0xffffffff;
+
+    for (uint32_t tick = 200; tick < 300 && !cas_engine_has_auto_pins(&engine); ++tick)
+    {
+        global_clock += 100;
+        process->cpu_time += 100;
+        cas_backend_sweep(&backend, &engine, &table);
+    }
+
+    CAS_TEST_CHECK(cas_engine_has_auto_pins(&engine));
+    CAS_TEST_CHECK(engine.auto_pin_count == 1 && engine.auto_pins[0].status == CAS_STATUS_PINNED && cas_engine_is_applied(&engine));
+
+    cas_engine_free(&engine);
+    cas_process_table_free(&table);
+    cas_process_table_free(&fake.processes);
+}
+
+// NOTE: Every sample is 1000 time units long, so the busy times added are the permille loads the rebalancer sees.
+static int cas_test__rebalance_sample(CasRebalancer* rebalancer, uint64_t* busy, uint64_t* total, const uint32_t* loads, const uint64_t* mask_words)
+{
+    for (uint32_t cpu = 0; cpu < 8; ++cpu)
+    {
+        busy[cpu] += loads[cpu];
+        total[cpu] += 1000;
+    }
+
+    return cas_rebalancer_sample(rebalancer, busy, total, 8, mask_words);
+}
+
+static void cas_test__rebalance(void)
+{
+    static const uint32_t idle_loads[8] = { 0 };
+    static const uint32_t first_loads[8] = { 900, 800, 100, 50, 700, 600, 500, 400 };
+    static const uint32_t close_loads[8] = { 900, 900, 300, 200, 900, 100, 900, 900 };
+    static const uint32_t far_loads[8] = { 900, 900, 600, 600, 900, 100, 120, 900 };
+    static const uint32_t worse_loads[8] = { 0, 900, 900, 900, 900, 900, 900, 900 };
+    static const uint32_t better_loads[8] = { 100, 900, 900, 100, 900, 900, 900, 900 };
+    uint64_t mask_word = 0xff;
+    uint64_t busy[8] = { 0 };
+    uint64_t total[8] = { 0 };
+    uint64_t previous_word = 0;
+    CasRebalancer rebalancer;
+    CasCpuSet selection;
+
+    cas_rebalancer_init(&rebalancer, 1);
+    CAS_TEST_CHECK(cas_rebalancer_add(&rebalancer, 0, 2) == 0);
+
+    // NOTE: The first sample only sets the baseline, the second fills the selection with the core_count idlest CPUs.
+    CAS_TEST_CHECK(cas_test__rebalance_sample(&rebalancer, busy, total, idle_loads, &mask_word));
+    CAS_TEST_CHECK(!cas_rebalancer_selection(&rebalancer, 0, &selection));
+    CAS_TEST_CHECK(cas_test__rebalance_sample(&rebalancer, busy, total, first_loads, &mask_word));
+    CAS_TEST_CHECK(cas_rebalancer_selection(&rebalancer, 0, &selection) && selection.words[0] == 0xc);
+    CAS_TEST_CHECK(rebalancer.entries[0].version == 1);
+
+    // NOTE: CPU 5 is idler than CPU 2 but by less than the hysteresis, the selection holds.
+    CAS_TEST_CHECK(cas_test__rebalance_sample(&rebalancer, busy, total, close_loads, &mask_word));
+    CAS_TEST_CHECK(selection.words[0] == 0xc && rebalancer.entries[0].version == 1 && rebalancer.counters.moves == 0);
+
+    // NOTE: Both selected CPUs are busy and two are idle, still only the first busiest one is swapped.
+    CAS_TEST_CHECK(cas_test__rebalance_sample(&rebalancer, busy, total, far_loads, &mask_word));
+    CAS_TEST_CHECK(selection.words[0] == 0x28 && rebalancer.entries[0].version == 2 && rebalancer.counters.moves == 1);
+
+    // NOTE: The move made things worse, the wait doubles to two samples and nothing moves until it is over.
+    CAS_TEST_CHECK(cas_test__rebalance_sample(&rebalancer, busy, total, worse_loads, &mask_word));
+    CAS_TEST_CHECK(rebalancer.counters.regressed == 1 && rebalancer.entries[0].backoff_shift == 1);
+    CAS_TEST_CHECK(selection.words[0] == 0x28 && rebalancer.counters.moves == 1);
+    CAS_TEST_CHECK(cas_test__rebalance_sample(&rebalancer, busy, total, worse_loads, &mask_word));
+    CAS_TEST_CHECK(selection.words[0] == 0x28 && rebalancer.counters.moves == 1);
+    CAS_TEST_CHECK(cas_test__rebalance_sample(&rebalancer, busy, total, worse_loads, &mask_word));
+    CAS_TEST_CHECK(rebalancer.counters.moves == 2 && cas_cpu_set_count(&selection) == 2);
+    CAS_TEST_CHECK(cas_cpu_set_contains(&selection, 0) && (selection.words[0] ^ 0x28) == 0x9);
+    previous_word = selection.words[0];
+
+    // NOTE: This one helped, the backoff is reset.
+    CAS_TEST_CHECK(cas_test__rebalance_sample(&rebalancer, busy, total, better_loads, &mask_word));
+    CAS_TEST_CHECK(rebalancer.counters.improved == 1 && rebalancer.entries[0].backoff_shift == 0);
+    CAS_TEST_CHECK(selection.words[0] == previous_word && rebalancer.entries[0].version == 3);
+    CAS_TEST_CHECK(rebalancer.counters.samples == 7);
+
+    cas_rebalancer_free(&rebalancer);
+}
+
+#ifndef _WIN32
+typedef struct
+{
+    char paths[128][128];
+    uint32_t path_count;
+} CasTestFixture;
+
+// NOTE: A directory when text is 0. Paths are kept in creation order so they can be removed backwards.
+static int cas_test__fixture_make(CasTestFixture* fixture, const char* root, const char* relative, const char* text)
+{
+    char* path = fixture->paths[fixture->path_count];
+    FILE* file = 0;
+    int result = 0;
+
+    if (fixture->path_count == ARRAY_COUNT(fixture->paths))
+    {
+        return 0;
+    }
+
+    snprintf(path, sizeof(fixture->paths[0]), "%s/%s", root, relative);
+
+    if (text)
+    {
+        file = fopen(path, "w");
+        result = file && fputs(text, file) >= 0;
+
+        if (file)
+        {
+            fclose(file);
+        }
+    }
+    else
+    {
+        result = !mkdir(path, 0700);
+    }
+
+    fixture->path_count += (uint32_t)result;
+
+    return result;
+}
+
+typedef struct
+{
+    const char* text;
+    uint64_t mask_word;
+} CasTestSymbolic;
+
+// NOTE: Two packages of four CPUs, each its own L3 and node, two threads per core and CPU 7 offline.
+static void cas_test__sysfs(void)
+{
+    static const CasTestSymbolic symbolics[] =
+    {
+        { "all",                       0x7f },
+        { "node0",                     0x0f },
+        { "node1",                     0x70 },
+        { "node2",                     0x00 },
+        { "l3:1",                      0x70 },
+        { "physical-cores",            0x55 },
+        { "smt",                       0x2a },
+        { "cores 1-2",                 0x3c },
+        { "cores 1-2 of node0",        0x0c },
+        { "cpus 0-1 of node1, l3:0",   0x3f },
+        { "cores 0 of l3:1, smt",      0x3a },
+    };
+    CasTestFixture* fixture = calloc(1, sizeof(CasTestFixture));
+    CasTopology topology = { 0 };
+    uint64_t mask_word = 0;
+    CasCpuSet mask = { &mask_word, 1 };
+    char root[32] = "/tmp/cas_test_XXXXXX";
+    char relative[64];
+    char text[16];
+    int result = 0;
+
+    if (!fixture)
+    {
+        CAS_TEST_CHECK(fixture);
+        return;
+    }
+
+    result = mkdtemp(root) && cas_test__fixture_make(fixture, root, "online", "0-6\n");
+
+    for (uint32_t cpu = 0; result && cpu < 8; ++cpu)
+    {
+        snprintf(relative, sizeof(relative), "cpu%u", cpu);
+        result = cas_test__fixture_make(fixture, root, relative, 0);
+        snprintf(relative, sizeof(relative), "cpu%u/node%u", cpu, cpu / 4);
+        result = result && cas_test__fixture_make(fixture, root, relative, 0);
+        snprintf(relative, sizeof(relative), "cpu%u/topology", cpu);
+        result = result && cas_test__fixture_make(fixture, root, relative, 0);
+        snprintf(relative, sizeof(relative), "cpu%u/topology/thread_siblings_list", cpu);
+        snprintf(text, sizeof(text), "%u-%u\n", cpu & ~1u, cpu | 1u);
+        result = result && cas_test__fixture_make(fixture, root, relative, text);
+        snprintf(relative, sizeof(relative), "cpu%u/cache", cpu);
+        result = result && cas_test__fixture_make(fixture, root, relative, 0);
+
+        // NOTE: The L1 comes first and is private, only the level 3 list picks the L3 leader.
+        for (uint32_t index = 0; result && index < 2; ++index)
+        {
+            snprintf(relative, sizeof(relative), "cpu%u/cache/index%u", cpu, index);
+            result = cas_test__fixture_make(fixture, root, relative, 0);
+            snprintf(relative, sizeof(relative), "cpu%u/cache/index%u/level", cpu, index);
+            result = result && cas_test__fixture_make(fixture, root, relative, index ? "3\n" : "1\n");
+            snprintf(relative, sizeof(relative), "cpu%u/cache/index%u/shared_cpu_list", cpu, index);
+            snprintf(text, sizeof(text), "%u-%u\n", index ? cpu & ~3u : cpu, index ? cpu | 3u : cpu);
+            result = result && cas_test__fixture_make(fixture, root, relative, text);
+        }
+    }
+
+    CAS_TEST_CHECK(result);
+
+    // NOTE: One CPU more than the fixture has, it has no directory and is left out.
+    result = result && cas_topology_read_sysfs(&topology, 9, root);
+    CAS_TEST_CHECK(result);
+    CAS_TEST_CHECK(!result || (topology.core_count == 4 && topology.l3_count == 2 && !topology.cpu_present[7] && !topology.cpu_present[8]));
+
+    for (uint32_t i = 0; result && i < ARRAY_COUNT(symbolics); ++i)
+    {
+        int is_resolved = cas_topology_resolve(&topology, symbolics[i].text, (uint32_t)strlen(symbolics[i].text), &mask);
+
+        if (!is_resolved || mask_word != symbolics[i].mask_word)
+        {
+            printf("symbolic %s resolves to %llx\n", symbolics[i].text, (unsigned long long)mask_word);
+        }
+
+        CAS_TEST_CHECK(is_resolved && mask_word == symbolics[i].mask_word);
+    }
+
+    for (uint32_t i = fixture->path_count; i > 0; --i)
+    {
+        remove(fixture->paths[i - 1]);
+    }
+
+    remove(root);
+    free(fixture);
+    cas_topology_free(&topology);
+}
+#endif
+
+typedef struct
+{
+    const char* text;
+    int has_topology;
+    uint64_t mask_word;
+} CasTestMask;
+
+typedef struct
+{
+    const char* name;
+    const char* mask;
+    uint32_t line_number;
+} CasTestPair;
+
+static int cas_test__text_equals(const char* text, uint32_t offset, uint32_t length, const char* expected)
+{
+    return length == strlen(expected) && !memcmp(text + offset, expected, length);
+}
+
+// NOTE: Eight CPUs in two L3s of two threads per core, filled in by hand so it works the same on every platform.
+static int cas_test__topology(CasTopology* topology)
+{
+    if (!cas_topology_alloc(topology, 8))
+    {
+        return 0;
+    }
+
+    for (uint32_t cpu = 0; cpu < 8; ++cpu)
+    {
+        topology->cpu_present[cpu] = 1;
+        topology->cpu_nodes[cpu] = cpu / 4;
+        topology->cpu_l3_leaders[cpu] = cpu & ~3u;
+        topology->cpu_core_leaders[cpu] = cpu & ~1u;
+    }
+
+    cas_topology_finish(topology);
+
+    return 1;
+}
+
+static void cas_test__config(void)
+{
+    static const CasTestMask masks[] =
+    {
+        { "ff",         0, 0xff },
+        { "0x10",       0, 0x10 },
+        { "10",         0, 0x10 },
+        { "0-3",        0, 0x0f },
+        { "1,2",        0, 0x06 },
+        { "0-7:2",      0, 0x55 },
+        { "0:f0",       0, 0xf0 },
+        { "l3:1",       1, 0xf0 },
+        { "smt",        1, 0xaa },
+        { "cores 1-2",  1, 0x3c },
+        { "l3:1",       0, 0 },
+        { "0",          0, 0 },
+        { "0x",         0, 0 },
+        { "",           0, 0 },
+        { "zz",         1, 0 },
+    };
+    static const CasTestPair pairs[] =
+    {
+        { "game.exe",     "0x3",          4 },
+        { "tool.exe",     "0-3,7",        5 },
+        { "app.exe",      "l3:0",         6 },
+        { "build.exe",    "0-7:2",        7 },
+        { "my:app.exe",   "f",            8 },
+        { "nomask.exe",   "",             9 },
+        { "",             "ff",          10 },
+        { "big.exe",      "ff00",        11 },
+    };
+    static const char text[] =
+        "\xef\xbb\xbf; Comments and blank lines are skipped.\n"
+        "\n"
+        "[ Pairs ]\n"
+        "game.exe:0x3\n"
+        "  tool.exe : 0-3,7  \r\n"
+        "app.exe:l3:0\n"
+        "build.exe:0-7:2\n"
+        "my:app.exe:f\n"
+        "nomask.exe\n"
+        ":ff\n"
+        "big.exe:ff00\n"
+        "# game.exe:0x1\n"
+        "[other]\n"
+        "other.exe:0x1\n"
+        "[SETTINGS]\n"
+        "period=200\n"
+        "not a setting\n"
+        "Merge = Union\n"
+        "auto-pin = cores 1 of node1 \n"
+        "auto-pin-time=0\n";
+    CasConfig config;
+    CasTopology topology = { 0 };
+    CasEngine engine;
+    uint64_t mask_word = 0;
+    CasCpuSet mask = { &mask_word, 1 };
+    uint64_t active_word = 0xff;
+    CasCpuSet active_set = { &active_word, 1 };
+    uint32_t bad_line = 0;
+
+    cas_config_init(&config);
+    CAS_TEST_CHECK(cas_test__topology(&topology));
+
+    // NOTE: Hex digits are always hex, so "10" is CPU 4 and not CPU 10. Empty sets do not resolve.
+    for (uint32_t i = 0; i < ARRAY_COUNT(masks); ++i)
+    {
+        uint32_t length = (uint32_t)strlen(masks[i].text);
+        int is_resolved = cas_config_resolve(masks[i].text, length, masks[i].has_topology ? &topology : 0, &mask);
+
+        CAS_TEST_CHECK(masks[i].mask_word ? is_resolved && mask_word == masks[i].mask_word : !is_resolved);
+    }
+
+    CAS_TEST_CHECK(!cas_config_is_symbolic("0xff", 4) && !cas_config_is_symbolic("ff", 2));
+    CAS_TEST_CHECK(cas_config_is_symbolic("0-3", 3) && cas_config_is_symbolic("node0", 5));
+
+    // NOTE: Pairs keep their line numbers, the line without a mask and the one without a name are kept for the check.
+    CAS_TEST_CHECK(cas_config_parse(&config, text, sizeof(text) - 1, &topology));
+    CAS_TEST_CHECK(config.pair_count == ARRAY_COUNT(pairs));
+
+    for (uint32_t i = 0; i < config.pair_count && i < ARRAY_COUNT(pairs); ++i)
+    {
+        const CasConfigPair* pair = config.pairs + i;
+
+        CAS_TEST_CHECK(cas_test__text_equals(config.text, pair->name_offset, pair->name_length, pairs[i].name));
+        CAS_TEST_CHECK(cas_test__text_equals(config.text, pair->mask_offset, pair->mask_length, pairs[i].mask));
+        CAS_TEST_CHECK(pair->line_number == pairs[i].line_number);
+    }
+
+    CAS_TEST_CHECK(config.period == CAS_CONFIG_MAX_PERIOD && config.merge == CAS_MERGE_UNION && config.auto_pin_time == 1);
+    CAS_TEST_CHECK(config.auto_pin_line == 19 && cas_config_resolve_auto_pin(&config, &topology, &mask) && mask_word == 0xc0);
+
+    // NOTE: The first bad pair is reported, the rest are added and the bad ones skipped.
+    CAS_TEST_CHECK(cas_config_check(&config, &topology, &active_set) == 9);
+    cas_engine_init(&engine);
+    cas_engine_set_cpu_count(&engine, 8);
+    CAS_TEST_CHECK(cas_config_add_rules(&config, &engine, &topology, &active_set, &bad_line) == 5 && bad_line == 9);
+    CAS_TEST_CHECK(engine.rule_count == 5);
+    cas_engine_free(&engine);
+
+    // NOTE: A reload parses into the same config from scratch, nothing of the previous text is left.
+    CAS_TEST_CHECK(cas_config_parse(&config, "[pairs]\nsolo.exe:1\n", 19, 0));
+    CAS_TEST_CHECK(config.pair_count == 1 && config.period == CAS_CONFIG_DEFAULT_PERIOD && config.merge == CAS_MERGE_LAST);
+    CAS_TEST_CHECK(!config.auto_pin_line && cas_config_check(&config, 0, &active_set) == 0);
+
+    cas_config_free(&config);
+    cas_topology_free(&topology);
+}
+
+typedef struct
+{
+    const char* text;
+    const char* list;
+} CasTestList;
+
+static int cas_test__parse_list(CasCpuSet* set, const char* text)
+{
+    return cas_cpu_set_parse_list(set, text, (uint32_t)strlen(text));
+}
+
+// NOTE: Parsed lists are checked by formatting them again, the formatter compresses strides the way it can.
+static void cas_test__cpu_lists(void)
+{
+    static const CasTestList lists[] =
+    {
+        { "0",              "0" },
+        { "0-3,8",          "0-3,8" },
+        { " 8 , 0-3\n",     "0-3,8" },
+        { "0-14:2",         "0-14:2" },
+        { "0-15:2/4",       "0-1,4-5,8-9,12-13" },
+        { "3-3",            "3" },
+        { "63,64",          "63-64" },
+        { "0-4095",         "0-4095" },
+        { "4095",           "4095" },
+        { "1:ff",           "64-71" },
+        { "0:0x1,1:1",      "0,64" },
+        { "0:0",            "" },
+    };
+    static const char* malformed[] =
+    {
+        "", " ", "3-1", "1,,2", "1,", ",1", "1-", "-1", "a", "1 2", "4096", "0-4096", "99999999999999999999",
+        "4294967297", "0-7:0", "0-7:3/2", "0-7:0/2", "64:1", "0:", "0:11111111111111111", "1;2",
+    };
+    uint64_t words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    CasCpuSet set = { words, ARRAY_COUNT(words) };
+    uint64_t narrow_word = 0;
+    CasCpuSet narrow = { &narrow_word, 1 };
+    char text[64];
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(lists); ++i)
+    {
+        uint32_t length = 0;
+
+        CAS_TEST_CHECK(cas_test__parse_list(&set, lists[i].text));
+        length = cas_cpu_set_format_list(&set, text, sizeof(text));
+
+        if (strcmp(text, lists[i].list))
+        {
+            printf("list %s formats as %s\n", lists[i].text, text);
+        }
+
+        CAS_TEST_CHECK(length == strlen(lists[i].list) && !strcmp(text, lists[i].list));
+    }
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(malformed); ++i)
+    {
+        if (cas_test__parse_list(&set, malformed[i]))
+        {
+            printf("list %s parsed\n", malformed[i]);
+        }
+
+        CAS_TEST_CHECK(!cas_test__parse_list(&set, malformed[i]));
+    }
+
+    // NOTE: The width of the set bounds the CPUs as well, not only CAS_CPU_SET_MAX_CPUS.
+    CAS_TEST_CHECK(cas_test__parse_list(&narrow, "0-63") && narrow_word == 0xffffffffffffffffull);
+    CAS_TEST_CHECK(!cas_test__parse_list(&narrow, "64"));
+    CAS_TEST_CHECK(!cas_test__parse_list(&narrow, "1:1"));
+    CAS_TEST_CHECK(!cas_cpu_set_parse_bits(&narrow, "0b2", 3) && !cas_cpu_set_parse_bits(&narrow, "", 0));
+    CAS_TEST_CHECK(cas_cpu_set_parse_bits(&narrow, "0b101", 5) && narrow_word == 0x5);
+    CAS_TEST_CHECK(cas_cpu_set_parse_hex(&narrow, "ff", 2) && narrow_word == 0xff);
+    CAS_TEST_CHECK(!cas_cpu_set_parse_hex(&narrow, "fg", 2) && !cas_cpu_set_parse_hex(&narrow, "10000000000000000", 17));
+
+    // NOTE: Text that does not fit is refused rather than cut.
+    CAS_TEST_CHECK(cas_test__parse_list(&set, "0-3,8"));
+    CAS_TEST_CHECK(cas_cpu_set_format_list(&set, text, 5) == 0);
+    CAS_TEST_CHECK(cas_cpu_set_format_list(&set, text, 6) == 5);
+}
+
+// NOTE: Random sets of both widths through every format and back, with runs and strides mixed in.
+static void cas_test__cpu_set_round_trips(void)
+{
+    static const uint32_t formats[] = { CAS_CPU_SET_FORMAT_LIST, CAS_CPU_SET_FORMAT_HEX, CAS_CPU_SET_FORMAT_GROUPS, CAS_CPU_SET_FORMAT_BITS };
+    static const uint32_t word_counts[] = { 1, CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS };
+    uint64_t words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    uint64_t parsed_words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    char* text = malloc(4 * CAS_CPU_SET_MAX_CPUS);
+    uint64_t seed = 0x2545f4914f6cdd1dull;
+
+    if (!text)
+    {
+        CAS_TEST_CHECK(text);
+        return;
+    }
+
+    for (uint32_t i = 0; i < 400; ++i)
+    {
+        uint32_t word_count = word_counts[i % ARRAY_COUNT(word_counts)];
+        CasCpuSet set = { words, word_count };
+        CasCpuSet parsed = { parsed_words, word_count };
+        uint32_t stride = 1 + i % 5;
+
+        cas_cpu_set_zero(&set);
+
+        for (uint32_t cpu = (i / 2) % 7; cpu < word_count * CAS_CPU_SET_WORD_BITS; cpu += stride)
+        {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+
+            if ((seed >> 33) % 4 != 0 || i % 10 == 0)
+            {
+                cas_cpu_set_add(&set, cpu);
+            }
+        }
+
+        for (uint32_t j = 0; j < ARRAY_COUNT(formats); ++j)
+        {
+            uint32_t length = cas_cpu_set_format(&set, formats[j], text, 4 * CAS_CPU_SET_MAX_CPUS);
+
+            CAS_TEST_CHECK(length && length == strlen(text));
+            CAS_TEST_CHECK(cas_cpu_set_parse(&parsed, formats[j], text, length) && cas_cpu_set_equal(&set, &parsed));
+        }
+    }
+
+    free(text);
+}
+
+int main(void)
+{
+    cas_test__events();
+    cas_test__sweep();
+    cas_test__backoff();
+    cas_test__patterns();
+    cas_test__exact_names();
+    cas_test__decisions();
+    cas_test__auto_pin_backoff();
+    cas_test__rebalance();
+#ifndef _WIN32
+    cas_test__sysfs();
+#endif
+    cas_test__config();
+    cas_test__cpu_lists();
+    cas_test__cpu_set_round_trips();
+
+    printf("%u checks, %u failed\n", global_check_count, global_failure_count);
+
+    return global_failure_count != 0;
+}
@@ -0,0 +1,400 @@
+#include "cas_topology.h"
+
+#define CAS_TOPOLOGY_NONE        (0xffffffff)
+
+#define CAS_TOPOLOGY_PICK_CORES  (1)
+#define CAS_TOPOLOGY_PICK_CPUS   (2)
+
+#define CAS_TOPOLOGY_GROUP_ALL   (1)
+#define CAS_TOPOLOGY_GROUP_NODE  (2)
+#define CAS_TOPOLOGY_GROUP_L3    (3)
+#define CAS_TOPOLOGY_GROUP_CORES (4)
+#define CAS_TOPOLOGY_GROUP_SMT   (5)
+
+typedef struct
+{
+    const CasTopology* topology;
+    const char* text;
+    uint32_t length;
+    uint32_t position;
+} CasTopologyParser;
+
+int cas_topology_alloc(CasTopology* topology, uint32_t cpu_count)
+{
+    if (cpu_count > topology->cpu_capacity)
+    {
+        uint8_t* cpu_present = realloc(topology->cpu_present, cpu_count * sizeof(uint8_t));
+        uint32_t** arrays[] = { &topology->cpu_nodes, &topology->cpu_l3_leaders, &topology->cpu_core_leaders, &topology->cpu_l3s, &topology->cpu_cores };
+
+        if (!cpu_present)
+        {
+            return 0;
+        }
+
+        topology->cpu_present = cpu_present;
+
+        for (uint32_t i = 0; i < ARRAY_COUNT(arrays); ++i)
+        {
+            uint32_t* array = realloc(*arrays[i], cpu_count * sizeof(uint32_t));
+
+            if (!array)
+            {
+                return 0;
+            }
+
+            *arrays[i] = array;
+        }
+
+        topology->cpu_capacity = cpu_count;
+    }
+
+    // NOTE: Until discovery says otherwise every CPU is its own core and L3 on node 0.
+    topology->cpu_count = cpu_count;
+
+    for (uint32_t cpu = 0; cpu < cpu_count; ++cpu)
+    {
+        topology->cpu_present[cpu] = 0;
+        topology->cpu_nodes[cpu] = 0;
+        topology->cpu_l3_leaders[cpu] = cpu;
+        topology->cpu_core_leaders[cpu] = cpu;
+    }
+
+    return 1;
+}
+
+void cas_topology_free(CasTopology* topology)
+{
+    free(topology->cpu_present);
+    free(topology->cpu_nodes);
+    free(topology->cpu_l3_leaders);
+    free(topology->cpu_core_leaders);
+    free(topology->cpu_l3s);
+    free(topology->cpu_cores);
+    memset(topology, 0, sizeof(*topology));
+}
+
+// NOTE: Leaders are CPU numbers, the indices are handed out the first time a leader shows up walking CPUs in order.
+// cpu_l3s and cpu_cores hold the index for leaders first, every CPU then takes the index of its leader.
+void cas_topology_finish(CasTopology* topology)
+{
+    topology->l3_count = 0;
+    topology->core_count = 0;
+
+    for (uint32_t cpu = 0; cpu < topology->cpu_count; ++cpu)
+    {
+        topology->cpu_l3s[cpu] = CAS_TOPOLOGY_NONE;
+        topology->cpu_cores[cpu] = CAS_TOPOLOGY_NONE;
+    }
+
+    for (uint32_t cpu = 0; cpu < topology->cpu_count; ++cpu)
+    {
+        uint32_t l3_leader = topology->cpu_l3_leaders[cpu] < topology->cpu_count ? topology->cpu_l3_leaders[cpu] : cpu;
+        uint32_t core_leader = topology->cpu_core_leaders[cpu] < topology->cpu_count ? topology->cpu_core_leaders[cpu] : cpu;
+
+        topology->cpu_l3_leaders[cpu] = l3_leader;
+        topology->cpu_core_leaders[cpu] = core_leader;
+
+        if (!topology->cpu_present[cpu])
+        {
+            continue;
+        }
+
+        if (topology->cpu_l3s[l3_leader] == CAS_TOPOLOGY_NONE)
+        {
+            topology->cpu_l3s[l3_leader] = topology->l3_count++;
+        }
+
+        if (topology->cpu_cores[core_leader] == CAS_TOPOLOGY_NONE)
+        {
+            topology->cpu_cores[core_leader] = topology->core_count++;
+        }
+
+        topology->cpu_l3s[cpu] = topology->cpu_l3s[l3_leader];
+        topology->cpu_cores[cpu] = topology->cpu_cores[core_leader];
+    }
+}
+
+static char cas_topology__fold(char c)
+{
+    return c >= 'A' && c <= 'Z' ? (char)(c + ('a' - 'A')) : c;
+}
+
+static void cas_topology__skip_spaces(CasTopologyParser* parser)
+{
+    while (parser->position < parser->length && (parser->text[parser->position] == ' ' || parser->text[parser->position] == '\t'))
+    {
+        ++parser->position;
+    }
+}
+
+// NOTE: Words ending in a letter have to end there, "node" does not match "nodes". Words ending in ':' or
+// followed by a number are prefixes.
+static int cas_topology__accept(CasTopologyParser* parser, const char* word)
+{
+    uint32_t length = (uint32_t)strlen(word);
+    uint32_t end = 0;
+
+    cas_topology__skip_spaces(parser);
+    end = parser->position + length;
+
+    if (end > parser->length)
+    {
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < length; ++i)
+    {
+        if (cas_topology__fold(parser->text[parser->position + i]) != word[i])
+        {
+            return 0;
+        }
+    }
+
+    if (end < parser->length && word[length - 1] != ':')
+    {
+        char next = cas_topology__fold(parser->text[end]);
+
+        if ((next >= 'a' && next <= 'z') || next == '-')
+        {
+            return 0;
+        }
+    }
+
+    parser->position = end;
+
+    return 1;
+}
+
+static int cas_topology__number(CasTopologyParser* parser, uint32_t* value)
+{
+    uint32_t start = 0;
+
+    cas_topology__skip_spaces(parser);
+    start = parser->position;
+    *value = 0;
+
+    while (parser->position < parser->length && parser->text[parser->position] >= '0' && parser->text[parser->position] <= '9' &&
+           *value < CAS_CPU_SET_MAX_CPUS)
+    {
+        *value = *value * 10 + (uint32_t)(parser->text[parser->position++] - '0');
+    }
+
+    return parser->position > start && *value < CAS_CPU_SET_MAX_CPUS;
+}
+
+static int cas_topology__range(CasTopologyParser* parser, uint32_t* first, uint32_t* last)
+{
+    if (!cas_topology__number(parser, first))
+    {
+        return 0;
+    }
+
+    *last = *first;
+    cas_topology__skip_spaces(parser);
+
+    if (parser->position < parser->length && parser->text[parser->position] == '-')
+    {
+        ++parser->position;
+        return cas_topology__number(parser, last) && *last >= *first;
+    }
+
+    return 1;
+}
+
+// NOTE: One named group of CPUs: all, nodeN, l3:N, physical-cores (one CPU per core), no-smt (the same)
+// and smt (the other hardware threads).
+static int cas_topology__group(CasTopologyParser* parser, CasCpuSet* set)
+{
+    const CasTopology* topology = parser->topology;
+    uint32_t kind = 0;
+    uint32_t value = 0;
+
+    if (cas_topology__accept(parser, "all"))
+    {
+        kind = CAS_TOPOLOGY_GROUP_ALL;
+    }
+    else if (cas_topology__accept(parser, "node"))
+    {
+        kind = CAS_TOPOLOGY_GROUP_NODE;
+    }
+    else if (cas_topology__accept(parser, "l3:"))
+    {
+        kind = CAS_TOPOLOGY_GROUP_L3;
+    }
+    else if (cas_topology__accept(parser, "physical-cores") || cas_topology__accept(parser, "no-smt"))
+    {
+        kind = CAS_TOPOLOGY_GROUP_CORES;
+    }
+    else if (cas_topology__accept(parser, "smt"))
+    {
+        kind = CAS_TOPOLOGY_GROUP_SMT;
+    }
+
+    if (!kind || ((kind == CAS_TOPOLOGY_GROUP_NODE || kind == CAS_TOPOLOGY_GROUP_L3) && !cas_topology__number(parser, &value)))
+    {
+        return 0;
+    }
+
+    cas_cpu_set_zero(set);
+
+    for (uint32_t cpu = 0; cpu < topology->cpu_count; ++cpu)
+    {
+        int is_primary = topology->cpu_core_leaders[cpu] == cpu;
+        int is_member = (kind == CAS_TOPOLOGY_GROUP_ALL) ||
+                        (kind == CAS_TOPOLOGY_GROUP_NODE && topology->cpu_nodes[cpu] == value) ||
+                        (kind == CAS_TOPOLOGY_GROUP_L3 && topology->cpu_l3s[cpu] == value) ||
+                        (kind == CAS_TOPOLOGY_GROUP_CORES && is_primary) ||
+                        (kind == CAS_TOPOLOGY_GROUP_SMT && !is_primary);
+
+        if (topology->cpu_present[cpu] && is_member)
+        {
+            cas_cpu_set_add(set, cpu);
+        }
+    }
+
+    return 1;
+}
+
+// NOTE: "cores A-B" counts physical cores and takes all their threads, "cpus A-B" counts CPUs.
+// Both count inside the scope, in CPU order.
+static int cas_topology__pick(const CasTopology* topology, uint32_t pick, uint32_t first, uint32_t last, const CasCpuSet* scope, CasCpuSet* set)
+{
+    uint32_t* core_ranks = 0;
+    uint32_t rank = 0;
+
+    if (pick == CAS_TOPOLOGY_PICK_CORES)
+    {
+        core_ranks = malloc((topology->core_count + 1) * sizeof(uint32_t));
+
+        if (!core_ranks)
+        {
+            return 0;
+        }
+
+        memset(core_ranks, 0xff, (topology->core_count + 1) * sizeof(uint32_t));
+    }
+
+    cas_cpu_set_zero(set);
+
+    for (uint32_t cpu = cas_cpu_set_next(scope, 0); cpu != CAS_NO_CPU && cpu < topology->cpu_count; cpu = cas_cpu_set_next(scope, cpu + 1))
+    {
+        uint32_t index = rank;
+
+        if (pick == CAS_TOPOLOGY_PICK_CORES)
+        {
+            uint32_t core = topology->cpu_cores[cpu];
+
+            if (core_ranks[core] == CAS_TOPOLOGY_NONE)
+            {
+                core_ranks[core] = rank++;
+            }
+
+            index = core_ranks[core];
+        }
+        else
+        {
+            ++rank;
+        }
+
+        if (index >= first && index <= last)
+        {
+            cas_cpu_set_add(set, cpu);
+        }
+    }
+
+    free(core_ranks);
+
+    return 1;
+}
+
+// NOTE: term := group | cores A[-B] | cpus A[-B], followed by an optional "of group" that narrows it down.
+static int cas_topology__term(CasTopologyParser* parser, CasCpuSet* set, CasCpuSet* scope)
+{
+    uint32_t pick = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+
+    if (cas_topology__accept(parser, "cores"))
+    {
+        pick = CAS_TOPOLOGY_PICK_CORES;
+    }
+    else if (cas_topology__accept(parser, "cpus"))
+    {
+        pick = CAS_TOPOLOGY_PICK_CPUS;
+    }
+
+    if (pick ? !cas_topology__range(parser, &first, &last) : !cas_topology__group(parser, set))
+    {
+        return 0;
+    }
+
+    if (cas_topology__accept(parser, "of"))
+    {
+        if (!cas_topology__group(parser, scope))
+        {
+            return 0;
+        }
+    }
+    else
+    {
+        cas_cpu_set_zero(scope);
+
+        for (uint32_t cpu = 0; cpu < parser->topology->cpu_count; ++cpu)
+        {
+            if (parser->topology->cpu_present[cpu])
+            {
+                cas_cpu_set_add(scope, cpu);
+            }
+        }
+    }
+
+    if (pick)
+    {
+        return cas_topology__pick(parser->topology, pick, first, last, scope, set);
+    }
+
+    cas_cpu_set_and(set, set, scope);
+
+    return 1;
+}
+
+// NOTE: Terms separated by commas are joined, "cores 0-3 of node0, l3:2" is valid. Only CPUs below the set width
+// make it in, the set is left empty when the text does not parse.
+int cas_topology_resolve(const CasTopology* topology, const char* text, uint32_t length, CasCpuSet* set)
+{
+    CasTopologyParser parser = { topology, text, length, 0 };
+    CasCpuSet term = { 0 };
+    CasCpuSet scope = { 0 };
+    int result = cas_cpu_set_alloc(&term, set->word_count * CAS_CPU_SET_WORD_BITS) &&
+                 cas_cpu_set_alloc(&scope, set->word_count * CAS_CPU_SET_WORD_BITS);
+
+    cas_cpu_set_zero(set);
+
+    while (result)
+    {
+        result = cas_topology__term(&parser, &term, &scope);
+
+        if (result)
+        {
+            cas_cpu_set_or(set, set, &term);
+            cas_topology__skip_spaces(&parser);
+
+            if (parser.position == parser.length)
+            {
+                break;
+            }
+
+            result = parser.text[parser.position++] == ',';
+        }
+    }
+
+    if (!result)
+    {
+        cas_cpu_set_zero(set);
+    }
+
+    cas_cpu_set_free(&term);
+    cas_cpu_set_free(&scope);
+
+    return result;
+}
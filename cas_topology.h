@@ -0,0 +1,40 @@
+#ifndef H_CAS_TOPOLOGY_H
+
+#include "cas_base.h"
+#include "cas_cpuset.h"
+
+#define CAS_TOPOLOGY_NO_NODE     (0xffffffff)
+
+// NOTE: Per CPU layout, indexed by the same CPU numbers masks use. Discovery fills nodes and the leaders,
+// the lowest CPU sharing the L3 and the lowest CPU of the physical core. cas_topology_finish turns leaders
+// into dense l3 and core indices in CPU order. CPUs that are not present are in no set.
+typedef struct
+{
+    uint32_t cpu_count;
+    uint32_t cpu_capacity;
+    uint8_t* cpu_present;
+    uint32_t* cpu_nodes;
+    uint32_t* cpu_l3_leaders;
+    uint32_t* cpu_core_leaders;
+    uint32_t* cpu_l3s;
+    uint32_t* cpu_cores;
+    uint32_t l3_count;
+    uint32_t core_count;
+} CasTopology;
+
+int cas_topology_alloc(CasTopology* topology, uint32_t cpu_count);
+void cas_topology_free(CasTopology* topology);
+void cas_topology_finish(CasTopology* topology);
+int cas_topology_resolve(const CasTopology* topology, const char* text, uint32_t length, CasCpuSet* set);
+
+// NOTE: Per platform, cas_topology_win32.c and cas_topology_linux.c. The signature is cheap and changes
+// whenever CPUs or nodes come and go, only then is the topology discovered again.
+int cas_topology_discover(CasTopology* topology, uint32_t cpu_count);
+uint64_t cas_topology_signature(void);
+
+#ifndef _WIN32
+int cas_topology_read_sysfs(CasTopology* topology, uint32_t cpu_count, const char* root);
+#endif
+
+#define H_CAS_TOPOLOGY_H
+#endif
@@ -0,0 +1,160 @@
+#define _GNU_SOURCE
+
+#include "cas_topology.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define CAS_TOPOLOGY_SYSFS_ROOT  "/sys/devices/system/cpu"
+#define CAS_TOPOLOGY_MAX_CACHES  (16)
+
+// NOTE: The buffer is always terminated, a file that could not be read comes back empty.
+static uint32_t cas_topology__read_file(const char* path, char* buffer, uint32_t capacity)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    ssize_t length = 0;
+
+    buffer[0] = '\0';
+
+    if (fd < 0)
+    {
+        return 0;
+    }
+
+    length = read(fd, buffer, capacity - 1);
+    close(fd);
+
+    length = length > 0 ? length : 0;
+    buffer[length] = '\0';
+
+    return (uint32_t)length;
+}
+
+// NOTE: Lists look like "0-3,8,10-11", the first CPU is the leader of a shared list.
+static uint32_t cas_topology__first_cpu(const char* path)
+{
+    char text[4096];
+    uint64_t words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    CasCpuSet set = { words, ARRAY_COUNT(words) };
+    uint32_t length = cas_topology__read_file(path, text, sizeof(text));
+
+    return length && cas_cpu_set_parse_list(&set, text, length) ? cas_cpu_set_next(&set, 0) : CAS_NO_CPU;
+}
+
+static int cas_topology__read_online(CasTopology* topology, const char* root)
+{
+    char path[256];
+    char text[4096];
+    uint64_t words[CAS_CPU_SET_MAX_CPUS / CAS_CPU_SET_WORD_BITS];
+    CasCpuSet online = { words, ARRAY_COUNT(words) };
+    uint32_t length = 0;
+
+    snprintf(path, sizeof(path), "%s/online", root);
+    length = cas_topology__read_file(path, text, sizeof(text));
+
+    if (!length || !cas_cpu_set_parse_list(&online, text, length))
+    {
+        return 0;
+    }
+
+    for (uint32_t cpu = cas_cpu_set_next(&online, 0); cpu < topology->cpu_count; cpu = cas_cpu_set_next(&online, cpu + 1))
+    {
+        topology->cpu_present[cpu] = 1;
+    }
+
+    return 1;
+}
+
+// NOTE: The root is /sys/devices/system/cpu on a real system, any directory laid out the same works.
+// Without an online list every cpuN directory counts as online. The node is the nodeM link in the CPU directory.
+int cas_topology_read_sysfs(CasTopology* topology, uint32_t cpu_count, const char* root)
+{
+    char path[256];
+    int has_online = 0;
+
+    if (!cas_topology_alloc(topology, cpu_count))
+    {
+        return 0;
+    }
+
+    has_online = cas_topology__read_online(topology, root);
+
+    for (uint32_t cpu = 0; cpu < cpu_count; ++cpu)
+    {
+        DIR* directory = 0;
+        struct dirent* entry = 0;
+
+        snprintf(path, sizeof(path), "%s/cpu%u", root, cpu);
+        directory = opendir(path);
+
+        if (!directory)
+        {
+            topology->cpu_present[cpu] = 0;
+            continue;
+        }
+
+        topology->cpu_present[cpu] = (uint8_t)(topology->cpu_present[cpu] || !has_online);
+
+        while ((entry = readdir(directory)) != 0)
+        {
+            if (!strncmp(entry->d_name, "node", 4) && entry->d_name[4] >= '0' && entry->d_name[4] <= '9')
+            {
+                topology->cpu_nodes[cpu] = (uint32_t)strtoul(entry->d_name + 4, 0, 10);
+            }
+        }
+
+        closedir(directory);
+
+        snprintf(path, sizeof(path), "%s/cpu%u/topology/thread_siblings_list", root, cpu);
+        topology->cpu_core_leaders[cpu] = cas_topology__first_cpu(path);
+
+        for (uint32_t index = 0; index < CAS_TOPOLOGY_MAX_CACHES; ++index)
+        {
+            char level[16];
+
+            snprintf(path, sizeof(path), "%s/cpu%u/cache/index%u/level", root, cpu, index);
+
+            if (!cas_topology__read_file(path, level, sizeof(level)))
+            {
+                break;
+            }
+
+            if (level[0] == '3')
+            {
+                snprintf(path, sizeof(path), "%s/cpu%u/cache/index%u/shared_cpu_list", root, cpu, index);
+                topology->cpu_l3_leaders[cpu] = cas_topology__first_cpu(path);
+            }
+        }
+    }
+
+    cas_topology_finish(topology);
+
+    return 1;
+}
+
+int cas_topology_discover(CasTopology* topology, uint32_t cpu_count)
+{
+    return cas_topology_read_sysfs(topology, cpu_count, CAS_TOPOLOGY_SYSFS_ROOT);
+}
+
+// NOTE: FNV-1a over the online CPU and node lists.
+uint64_t cas_topology_signature(void)
+{
+    const char* paths[] = { CAS_TOPOLOGY_SYSFS_ROOT "/online", "/sys/devices/system/node/online" };
+    uint64_t hash = 14695981039346656037ull;
+
+    for (uint32_t i = 0; i < ARRAY_COUNT(paths); ++i)
+    {
+        char text[4096];
+        uint32_t length = cas_topology__read_file(paths[i], text, sizeof(text));
+
+        for (uint32_t j = 0; j <= length; ++j)
+        {
+            hash = (hash ^ (uint8_t)text[j]) * 1099511628211ull;
+        }
+    }
+
+    return hash;
+}
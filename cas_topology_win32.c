@@ -0,0 +1,146 @@
+#include "cas.h"
+#include "cas_topology.h"
+
+#define CAS_TOPOLOGY_MAX_GROUPS  (64)
+
+// NOTE: Same layout as the backend, the active CPUs of each processor group back to back.
+typedef struct
+{
+    WORD group_count;
+    uint32_t first_cpus[CAS_TOPOLOGY_MAX_GROUPS];
+    uint32_t group_cpu_counts[CAS_TOPOLOGY_MAX_GROUPS];
+} CasTopologyGroups;
+
+static void cas_topology__groups(CasTopologyGroups* groups)
+{
+    WORD group_count = GetActiveProcessorGroupCount();
+    uint32_t cpu_count = 0;
+
+    groups->group_count = group_count < CAS_TOPOLOGY_MAX_GROUPS ? group_count : CAS_TOPOLOGY_MAX_GROUPS;
+
+    for (WORD i = 0; i < groups->group_count; ++i)
+    {
+        groups->first_cpus[i] = cpu_count;
+        groups->group_cpu_counts[i] = GetActiveProcessorCount(i);
+        cpu_count += groups->group_cpu_counts[i];
+    }
+}
+
+// NOTE: Lowest CPU of the affinity, CAS_NO_CPU when it is outside the active groups.
+static uint32_t cas_topology__first_cpu(const CasTopologyGroups* groups, const GROUP_AFFINITY* affinity)
+{
+    uint32_t result = CAS_NO_CPU;
+
+    if (affinity->Group < groups->group_count)
+    {
+        for (uint32_t bit = 0; bit < groups->group_cpu_counts[affinity->Group]; ++bit)
+        {
+            if ((affinity->Mask >> bit) & 1)
+            {
+                result = groups->first_cpus[affinity->Group] + bit;
+                break;
+            }
+        }
+    }
+
+    return result;
+}
+
+// NOTE: Sets field (a per CPU array) to value for every CPU of the affinity, marks them present too.
+static void cas_topology__fill(CasTopology* topology, const CasTopologyGroups* groups, const GROUP_AFFINITY* affinity, uint32_t* field, uint32_t value)
+{
+    if (affinity->Group >= groups->group_count)
+    {
+        return;
+    }
+
+    for (uint32_t bit = 0; bit < groups->group_cpu_counts[affinity->Group]; ++bit)
+    {
+        uint32_t cpu = groups->first_cpus[affinity->Group] + bit;
+
+        if (((affinity->Mask >> bit) & 1) && cpu < topology->cpu_count)
+        {
+            topology->cpu_present[cpu] = 1;
+            field[cpu] = value;
+        }
+    }
+}
+
+// NOTE: One GetLogicalProcessorInformationEx call covers cores, caches and NUMA nodes across all groups.
+int cas_topology_discover(CasTopology* topology, uint32_t cpu_count)
+{
+    CasTopologyGroups groups;
+    DWORD size = 0;
+    BYTE* buffer = 0;
+    int result = 0;
+
+    cas_topology__groups(&groups);
+
+    if (!cas_topology_alloc(topology, cpu_count))
+    {
+        return 0;
+    }
+
+    GetLogicalProcessorInformationEx(RelationAll, 0, &size);
+    buffer = size ? malloc(size) : 0;
+
+    if (buffer && GetLogicalProcessorInformationEx(RelationAll, (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)buffer, &size))
+    {
+        for (DWORD offset = 0; offset < size;)
+        {
+            PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX information = (PSYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX)(buffer + offset);
+
+            if (information->Relationship == RelationProcessorCore)
+            {
+                uint32_t leader = CAS_NO_CPU;
+
+                for (WORD i = 0; i < information->Processor.GroupCount; ++i)
+                {
+                    uint32_t cpu = cas_topology__first_cpu(&groups, information->Processor.GroupMask + i);
+                    leader = cpu < leader ? cpu : leader;
+                }
+
+                for (WORD i = 0; i < information->Processor.GroupCount; ++i)
+                {
+                    cas_topology__fill(topology, &groups, information->Processor.GroupMask + i, topology->cpu_core_leaders, leader);
+                }
+            }
+            else if (information->Relationship == RelationNumaNode)
+            {
+                cas_topology__fill(topology, &groups, &information->NumaNode.GroupMask, topology->cpu_nodes, information->NumaNode.NodeNumber);
+            }
+            else if (information->Relationship == RelationCache && information->Cache.Level == 3)
+            {
+                cas_topology__fill(topology, &groups, &information->Cache.GroupMask, topology->cpu_l3_leaders,
+                                   cas_topology__first_cpu(&groups, &information->Cache.GroupMask));
+            }
+
+            offset += information->Size;
+        }
+
+        cas_topology_finish(topology);
+        result = 1;
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+// NOTE: FNV-1a over the active CPU count of every group and the highest NUMA node.
+uint64_t cas_topology_signature(void)
+{
+    CasTopologyGroups groups;
+    ULONG highest_node = 0;
+    uint64_t hash = 14695981039346656037ull;
+
+    cas_topology__groups(&groups);
+    GetNumaHighestNodeNumber(&highest_node);
+
+    for (WORD i = 0; i < groups.group_count; ++i)
+    {
+        hash = (hash ^ groups.group_cpu_counts[i]) * 1099511628211ull;
+    }
+
+    return (hash ^ highest_node) * 1099511628211ull;
+}